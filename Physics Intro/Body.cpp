@@ -1,64 +1,72 @@
 #include "Body.h"
 #include "Shape.h"
 
-Vec3 Body::GetCenterOfMassWorldSpace() const
+template <typename T>
+Vec3T<T> BodyT<T>::GetCenterOfMassWorldSpace() const
 {
-	const Vec3 centerOfMass = shape->GetCenterOfMass();
-	const Vec3 pos = position + orientation.RotatePoint(centerOfMass);
+	const Vec3T<T> centerOfMass(shape->GetCenterOfMass());
+	const Vec3T<T> pos = position + orientation.RotatePoint(centerOfMass);
 	return pos;
 }
 
-Vec3 Body::GetCenterOfMassBodySpace() const
+template <typename T>
+Vec3T<T> BodyT<T>::GetCenterOfMassBodySpace() const
 {
-	return shape->GetCenterOfMass();
+	return Vec3T<T>(shape->GetCenterOfMass());
 }
 
-Mat3 Body::GetInverseInertiaTensorBodySpace() const
+template <typename T>
+Mat3T<T> BodyT<T>::GetInverseInertiaTensorBodySpace() const
 {
-	Mat3 inertiaTensor = shape->InertiaTensor();
-	Mat3 inverseInertiaTensor = inertiaTensor.Inverse() * inverseMass;
+	const Mat3T<T> inertiaTensor(shape->InertiaTensor());
+	Mat3T<T> inverseInertiaTensor = inertiaTensor.Inverse() * inverseMass;
 	
 	return inverseInertiaTensor;
 }
 
-Mat3 Body::GetInverseInertiaTensorWorldSpace() const
+template <typename T>
+Mat3T<T> BodyT<T>::GetInverseInertiaTensorWorldSpace() const
 {
-	Mat3 inertiaTensor = shape->InertiaTensor();
-	Mat3 inverseInertiaTensor = inertiaTensor.Inverse() * inverseMass;
-	Mat3 orient = orientation.ToMat3();
+	const Mat3T<T> inertiaTensor(shape->InertiaTensor());
+	Mat3T<T> inverseInertiaTensor = inertiaTensor.Inverse() * inverseMass;
+	Mat3T<T> orient = orientation.ToMat3();
 	inverseInertiaTensor = orient * inverseInertiaTensor * orient.Transpose();
 
 	return inverseInertiaTensor;
 }
 
-Vec3 Body::WorldSpaceToBodySpace(const Vec3& worldPoint)
+template <typename T>
+Vec3T<T> BodyT<T>::WorldSpaceToBodySpace(const Vec3T<T>& worldPoint)
 {
-	const Vec3 tmp = worldPoint - GetCenterOfMassWorldSpace();
-	const Quat invertOrient = orientation.Inverse();
-	Vec3 bodySpace = invertOrient.RotatePoint(tmp);
+	const Vec3T<T> tmp = worldPoint - GetCenterOfMassWorldSpace();
+	const QuatT<T> invertOrient = orientation.Inverse();
+	Vec3T<T> bodySpace = invertOrient.RotatePoint(tmp);
 	return bodySpace;
 }
 
-Vec3 Body::BodySpaceToWorldSpace(const Vec3& bodyPoint)
+template <typename T>
+Vec3T<T> BodyT<T>::BodySpaceToWorldSpace(const Vec3T<T>& bodyPoint)
 {
-	Vec3 worldSpace = GetCenterOfMassWorldSpace()
+	Vec3T<T> worldSpace = GetCenterOfMassWorldSpace()
 
 	+ orientation.RotatePoint(bodyPoint);
 
 	return worldSpace;
 }
 
-void Body::ApplyImpulseLinear(const Vec3& impulse)
+template <typename T>
+void BodyT<T>::ApplyImpulseLinear(const Vec3T<T>& impulse)
 {
-	if (inverseMass == 0.0f) return;
+	if (inverseMass == T(0)) return;
 	
 	// dv = J / m
 	linearVelocity += impulse * inverseMass;
 }
 
-void Body::ApplyImpulseAngular(const Vec3& impulse)
+template <typename T>
+void BodyT<T>::ApplyImpulseAngular(const Vec3T<T>& impulse)
 {
-	if (inverseMass == 0.0f) return;
+	if (inverseMass == T(0)) return;
 	
 	// L = I w = r x p
 	// dL = I dw = r x J
@@ -67,7 +75,7 @@ void Body::ApplyImpulseAngular(const Vec3& impulse)
 	
 	// Clamp angular velocity
 	// -- 30 rad per seconds, sufficient for now
-	const float maxAngularSpeed = 30.0f;
+	const T maxAngularSpeed = T(30);
 	if (angularVelocity.GetLengthSqr() > maxAngularSpeed * maxAngularSpeed)
 	{
 		angularVelocity.Normalize();
@@ -75,21 +83,23 @@ void Body::ApplyImpulseAngular(const Vec3& impulse)
 	}
 }
 
-void Body::ApplyImpulse(const Vec3& impulsePoint, const Vec3& impulse)
+template <typename T>
+void BodyT<T>::ApplyImpulse(const Vec3T<T>& impulsePoint, const Vec3T<T>& impulse)
 {
-	if (inverseMass == 0.0f) return;
+	if (inverseMass == T(0)) return;
 	
 	ApplyImpulseLinear(impulse);
 	
 	// Applying impulse must produce torques through the center of mass
-	Vec3 position = GetCenterOfMassWorldSpace();
-	Vec3 r = impulsePoint - position;
-	Vec3 dL = r.Cross(impulse); // World space
+	Vec3T<T> position = GetCenterOfMassWorldSpace();
+	Vec3T<T> r = impulsePoint - position;
+	Vec3T<T> dL = r.Cross(impulse); // World space
 	
 	ApplyImpulseAngular(dL);
 }
 
-void Body::Update(const float dt_sec)
+template <typename T>
+void BodyT<T>::Update(const T dt_sec)
 {
 	position += linearVelocity * dt_sec;
 	
@@ -97,8 +107,8 @@ void Body::Update(const float dt_sec)
 	// this needs to be converted to relative to model position.
 	// This way we can properly update the orientation
 	// of the model
-	Vec3 positionCM = GetCenterOfMassWorldSpace();
-	Vec3 CMToPositon = position - positionCM;
+	Vec3T<T> positionCM = GetCenterOfMassWorldSpace();
+	Vec3T<T> CMToPositon = position - positionCM;
 	
 	// Total torques is equal to external applied
 	// torques + internal torque (precession)
@@ -107,19 +117,23 @@ void Body::Update(const float dt_sec)
 	// response function
 	// T = Ia = w x I * w
 	// a = I^-1 (w x I * w)
-	Mat3 orientationMat = orientation.ToMat3();
-	Mat3 inertiaTensor = orientationMat * shape->InertiaTensor() * orientationMat.Transpose();
+	Mat3T<T> orientationMat = orientation.ToMat3();
+	Mat3T<T> inertiaTensor = orientationMat * Mat3T<T>(shape->InertiaTensor()) * orientationMat.Transpose();
 
-	Vec3 alpha = inertiaTensor.Inverse() * (angularVelocity.Cross(inertiaTensor * angularVelocity));
+	Vec3T<T> alpha = inertiaTensor.Inverse() * (angularVelocity.Cross(inertiaTensor * angularVelocity));
 
 	angularVelocity += alpha * dt_sec;
 	
 	// Update orientation
-	Vec3 dAngle = angularVelocity * dt_sec;
-	Quat dq = Quat(dAngle, dAngle.GetMagnitude());
+	Vec3T<T> dAngle = angularVelocity * dt_sec;
+	QuatT<T> dq = QuatT<T>(dAngle, dAngle.GetMagnitude());
 	orientation = dq * orientation;
 	orientation.Normalize();
 	
 	// Get the new model position
 	position = positionCM + dq.RotatePoint(CMToPositon);
 }
+
+// Float for the scenes, double for the reference they are checked against
+template class BodyT<float>;
+template class BodyT<double>;
@@ -4,33 +4,40 @@
 #include "code/Renderer/model.h"
 #include "code/Math/Quat.h"
 
-class Body
+/// <summary>
+/// A rigid body, templated on the scalar. Body is the float one the
+/// scenes run; BodyT<double> is the reference it can be checked against.
+/// The shape stays float either way, its centre of mass and inertia
+/// tensor are widened as they are read. Both are instantiated in Body.cpp.
+/// </summary>
+template <typename T>
+class BodyT
 {
 public:
-	Vec3 position;
-	Quat orientation;
-	Vec3 linearVelocity;
-	Vec3 angularVelocity;
+	Vec3T<T> position;
+	QuatT<T> orientation;
+	Vec3T<T> linearVelocity;
+	Vec3T<T> angularVelocity;
 	
-	float inverseMass;
-	float elasticity;
-	float friction;
+	T inverseMass;
+	T elasticity;
+	T friction;
 	
 	Shape* shape;
 	
-	Vec3 GetCenterOfMassWorldSpace() const;
-	Vec3 GetCenterOfMassBodySpace() const;
+	Vec3T<T> GetCenterOfMassWorldSpace() const;
+	Vec3T<T> GetCenterOfMassBodySpace() const;
 	
-	Mat3 GetInverseInertiaTensorBodySpace() const;
-	Mat3 GetInverseInertiaTensorWorldSpace() const;
+	Mat3T<T> GetInverseInertiaTensorBodySpace() const;
+	Mat3T<T> GetInverseInertiaTensorWorldSpace() const;
 	
-	Vec3 WorldSpaceToBodySpace(const Vec3& worldPoint);
-	Vec3 BodySpaceToWorldSpace(const Vec3& bodyPoint);
+	Vec3T<T> WorldSpaceToBodySpace(const Vec3T<T>& worldPoint);
+	Vec3T<T> BodySpaceToWorldSpace(const Vec3T<T>& bodyPoint);
 	
-	void ApplyImpulseLinear(const Vec3& impulse);
-	void ApplyImpulseAngular(const Vec3& impulse);
+	void ApplyImpulseLinear(const Vec3T<T>& impulse);
+	void ApplyImpulseAngular(const Vec3T<T>& impulse);
 	
-	void Update(const float dt_sec);
+	void Update(const T dt_sec);
 	
 	/// <summary>
 	/// Apply impulse on a specific world space
@@ -42,5 +49,8 @@ public:
 	/// <param name="impulse">
 	/// The world space direction and magnitude of the impulse
 	///</param>
-	void ApplyImpulse(const Vec3& impulsePoint, const Vec3& impulse);
+	void ApplyImpulse(const Vec3T<T>& impulsePoint, const Vec3T<T>& impulse);
 };
+
+typedef BodyT<float> Body;
+typedef BodyT<double> Bodyd;
@@ -1,5 +1,9 @@
 #include "Shape.h"
 
+#include <algorithm>
+
+#include "code/ConvexHull.h"
+
 Mat3 ShapeSphere::InertiaTensor() const
 {
 	Mat3 tensor;
@@ -28,3 +32,276 @@ Bounds ShapeSphere::GetBounds() const
 	
 	return tmp;
 }
+
+Vec3 ShapeSphere::Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const
+{
+	Vec3 dirNormalized = dir;
+	dirNormalized.Normalize();
+	
+	return pos + dirNormalized * (radius + bias);
+}
+
+ShapeBox::ShapeBox(const Vec3* pts, const int num)
+{
+	m_bounds.Expand(pts, num);
+	
+	m_points[0] = Vec3(m_bounds.mins.x, m_bounds.mins.y, m_bounds.mins.z);
+	m_points[1] = Vec3(m_bounds.maxs.x, m_bounds.mins.y, m_bounds.mins.z);
+	m_points[2] = Vec3(m_bounds.mins.x, m_bounds.maxs.y, m_bounds.mins.z);
+	m_points[3] = Vec3(m_bounds.mins.x, m_bounds.mins.y, m_bounds.maxs.z);
+	
+	m_points[4] = Vec3(m_bounds.maxs.x, m_bounds.maxs.y, m_bounds.maxs.z);
+	m_points[5] = Vec3(m_bounds.mins.x, m_bounds.maxs.y, m_bounds.maxs.z);
+	m_points[6] = Vec3(m_bounds.maxs.x, m_bounds.mins.y, m_bounds.maxs.z);
+	m_points[7] = Vec3(m_bounds.maxs.x, m_bounds.maxs.y, m_bounds.mins.z);
+	
+	centerOfMass = (m_bounds.maxs + m_bounds.mins) * 0.5f;
+}
+
+Mat3 ShapeBox::InertiaTensor() const
+{
+	// Inertia tensor of the box about its own center, which is the center of
+	// mass, wherever the box sits in body space
+	const float dx = m_bounds.WidthX();
+	const float dy = m_bounds.WidthY();
+	const float dz = m_bounds.WidthZ();
+	
+	Mat3 tensor;
+	tensor.Zero();
+	tensor.rows[0][0] = (dy * dy + dz * dz) / 12.0f;
+	tensor.rows[1][1] = (dx * dx + dz * dz) / 12.0f;
+	tensor.rows[2][2] = (dx * dx + dy * dy) / 12.0f;
+	return tensor;
+}
+
+Bounds ShapeBox::GetBounds(const Vec3& pos, const Quat& orient) const
+{
+	Vec3 corners[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		corners[i] = orient.RotatePoint(m_points[i]) + pos;
+	}
+	
+	Bounds bounds;
+	bounds.Expand(corners, 8);
+	return bounds;
+}
+
+Vec3 ShapeBox::Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const
+{
+	// Pick the corner in body space, each axis independently takes the
+	// half extent with the sign of the direction, so there is no branching
+	const Vec3 localDir = orient.Inverse().RotatePoint(dir);
+	const Vec3 center = (m_bounds.maxs + m_bounds.mins) * 0.5f;
+	const Vec3 halfExtent = (m_bounds.maxs - m_bounds.mins) * 0.5f;
+	
+	Vec3 localPt;
+	localPt.x = center.x + copysignf(halfExtent.x, localDir.x);
+	localPt.y = center.y + copysignf(halfExtent.y, localDir.y);
+	localPt.z = center.z + copysignf(halfExtent.z, localDir.z);
+	
+	Vec3 dirNormalized = dir;
+	dirNormalized.Normalize();
+	
+	return orient.RotatePoint(localPt) + pos + dirNormalized * bias;
+}
+
+float ShapeBox::FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const
+{
+	// Both are in body space. The speed of a corner r along dir is
+	// dir . ( w x r ) = r . ( dir x w ), maximized like the support point
+	const Vec3 k = dir.Cross(angularVelocity);
+	const Vec3 center = (m_bounds.maxs + m_bounds.mins) * 0.5f - centerOfMass;
+	const Vec3 halfExtent = (m_bounds.maxs - m_bounds.mins) * 0.5f;
+	
+	const float maxSpeed = center.Dot(k) + halfExtent.x * fabsf(k.x) + halfExtent.y * fabsf(k.y) + halfExtent.z * fabsf(k.z);
+	return maxSpeed;
+}
+
+ShapeConvex::ShapeConvex(const Vec3* pts, const int num)
+{
+	const std::vector<Vec3> verts(pts, pts + num);
+	if (!BuildConvexHull(verts, m_points, m_tris))
+	{
+		// Too few points, or all of them in a plane or on a line, leave no volume
+		// to take a mass from. The box around them stands in, thickened where flat.
+		const float minWidth = 0.01f;
+		Bounds bounds;
+		if (num > 0)
+		{
+			bounds.Expand(pts, num);
+		}
+		else
+		{
+			bounds.Expand(Vec3(0.0f));
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float grow = std::max(minWidth - (bounds.maxs[axis] - bounds.mins[axis]), 0.0f) * 0.5f;
+			bounds.mins[axis] -= grow;
+			bounds.maxs[axis] += grow;
+		}
+
+		const std::vector<Vec3> corners = {
+			Vec3(bounds.mins.x, bounds.mins.y, bounds.mins.z),
+			Vec3(bounds.maxs.x, bounds.mins.y, bounds.mins.z),
+			Vec3(bounds.mins.x, bounds.maxs.y, bounds.mins.z),
+			Vec3(bounds.mins.x, bounds.mins.y, bounds.maxs.z),
+			Vec3(bounds.maxs.x, bounds.maxs.y, bounds.maxs.z),
+			Vec3(bounds.mins.x, bounds.maxs.y, bounds.maxs.z),
+			Vec3(bounds.maxs.x, bounds.mins.y, bounds.maxs.z),
+			Vec3(bounds.maxs.x, bounds.maxs.y, bounds.mins.z),
+		};
+		BuildConvexHull(corners, m_points, m_tris);
+	}
+	Build();
+}
+
+ShapeConvex::ShapeConvex(const Vec3* hullPts, const int numPts, const tri_t* hullTris, const int numTris)
+{
+	m_points.assign(hullPts, hullPts + numPts);
+	m_tris.assign(hullTris, hullTris + numTris);
+	Build();
+}
+
+void ShapeConvex::Build()
+{
+	m_bounds.Clear();
+	m_bounds.Expand(m_points.data(), (int)m_points.size());
+	
+	CalculateHullMassProperties(m_points, m_tris, centerOfMass, m_inertiaTensor);
+	BuildAdjacency();
+}
+
+void ShapeConvex::BuildAdjacency()
+{
+	const int numPts = (int)m_points.size();
+	
+	// Each triangle edge links its two vertices, both ways.
+	// Edges are shared by two triangles, duplicates are removed afterwards.
+	std::vector<std::vector<int>> neighbours(numPts);
+	for (const tri_t& tri : m_tris)
+	{
+		const int ids[3] = { tri.a, tri.b, tri.c };
+		for (int i = 0; i < 3; ++i)
+		{
+			neighbours[ids[i]].push_back(ids[(i + 1) % 3]);
+			neighbours[ids[i]].push_back(ids[(i + 2) % 3]);
+		}
+	}
+	
+	m_adjacencyStart.resize(numPts + 1);
+	m_adjacency.clear();
+	for (int i = 0; i < numPts; ++i)
+	{
+		std::sort(neighbours[i].begin(), neighbours[i].end());
+		neighbours[i].erase(std::unique(neighbours[i].begin(), neighbours[i].end()), neighbours[i].end());
+		
+		m_adjacencyStart[i] = (int)m_adjacency.size();
+		m_adjacency.insert(m_adjacency.end(), neighbours[i].begin(), neighbours[i].end());
+	}
+	m_adjacencyStart[numPts] = (int)m_adjacency.size();
+	
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		int minId = 0;
+		int maxId = 0;
+		for (int i = 1; i < numPts; ++i)
+		{
+			minId = m_points[i][axis] < m_points[minId][axis] ? i : minId;
+			maxId = m_points[i][axis] > m_points[maxId][axis] ? i : maxId;
+		}
+		m_extremes[axis * 2 + 0] = minId;
+		m_extremes[axis * 2 + 1] = maxId;
+	}
+}
+
+int ShapeConvex::SupportIndex(const Vec3& localDir) const
+{
+	// Below this a linear scan is cheaper than walking the hull
+	const int maxBruteForcePoints = 32;
+	
+	const int numPts = (int)m_points.size();
+	if (numPts <= maxBruteForcePoints || m_adjacency.empty())
+	{
+		int bestId = 0;
+		float bestDist = m_points[0].Dot(localDir);
+		for (int i = 1; i < numPts; ++i)
+		{
+			const float dist = m_points[i].Dot(localDir);
+			const bool isBetter = dist > bestDist;
+			bestDist = isBetter ? dist : bestDist;
+			bestId = isBetter ? i : bestId;
+		}
+		return bestId;
+	}
+	
+	// Start from the best of the axis extremes then hill climb:
+	// on a convex hull a vertex no neighbour improves on is the global maximum
+	int bestId = m_extremes[0];
+	float bestDist = m_points[bestId].Dot(localDir);
+	for (int i = 1; i < 6; ++i)
+	{
+		const float dist = m_points[m_extremes[i]].Dot(localDir);
+		const bool isBetter = dist > bestDist;
+		bestDist = isBetter ? dist : bestDist;
+		bestId = isBetter ? m_extremes[i] : bestId;
+	}
+	
+	int previousId = -1;
+	while (previousId != bestId)
+	{
+		previousId = bestId;
+		const int start = m_adjacencyStart[previousId];
+		const int end = m_adjacencyStart[previousId + 1];
+		for (int i = start; i < end; ++i)
+		{
+			const int id = m_adjacency[i];
+			const float dist = m_points[id].Dot(localDir);
+			const bool isBetter = dist > bestDist;
+			bestDist = isBetter ? dist : bestDist;
+			bestId = isBetter ? id : bestId;
+		}
+	}
+	return bestId;
+}
+
+Bounds ShapeConvex::GetBounds(const Vec3& pos, const Quat& orient) const
+{
+	Vec3 corners[8];
+	corners[0] = Vec3(m_bounds.mins.x, m_bounds.mins.y, m_bounds.mins.z);
+	corners[1] = Vec3(m_bounds.mins.x, m_bounds.mins.y, m_bounds.maxs.z);
+	corners[2] = Vec3(m_bounds.mins.x, m_bounds.maxs.y, m_bounds.mins.z);
+	corners[3] = Vec3(m_bounds.maxs.x, m_bounds.mins.y, m_bounds.mins.z);
+	
+	corners[4] = Vec3(m_bounds.maxs.x, m_bounds.maxs.y, m_bounds.maxs.z);
+	corners[5] = Vec3(m_bounds.maxs.x, m_bounds.maxs.y, m_bounds.mins.z);
+	corners[6] = Vec3(m_bounds.maxs.x, m_bounds.mins.y, m_bounds.maxs.z);
+	corners[7] = Vec3(m_bounds.mins.x, m_bounds.maxs.y, m_bounds.maxs.z);
+	
+	Bounds bounds;
+	for (int i = 0; i < 8; ++i)
+	{
+		bounds.Expand(orient.RotatePoint(corners[i]) + pos);
+	}
+	return bounds;
+}
+
+Vec3 ShapeConvex::Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const
+{
+	const Vec3 localDir = orient.Inverse().RotatePoint(dir);
+	const Vec3 localPt = m_points[SupportIndex(localDir)];
+	
+	Vec3 dirNormalized = dir;
+	dirNormalized.Normalize();
+	
+	return orient.RotatePoint(localPt) + pos + dirNormalized * bias;
+}
+
+float ShapeConvex::FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const
+{
+	// Both are in body space, see ShapeBox::FastestLinearSpeed
+	const Vec3 k = dir.Cross(angularVelocity);
+	const Vec3 pt = m_points[SupportIndex(k)] - centerOfMass;
+	return pt.Dot(k);
+}
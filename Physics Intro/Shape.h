@@ -1,25 +1,48 @@
 #pragma once
 
+#include <vector>
+
 #include "code/Math/Bounds.h"
 #include "code/Math/Matrix.h"
 #include "code/Math/Quat.h"
 
+struct tri_t
+{
+	int a;
+	int b;
+	int c;
+};
+
 class Shape
 {
 public:
 	enum class ShapeType
 	{
 		SHAPE_SPHERE,
+		SHAPE_BOX,
+		SHAPE_CONVEX,
 	};
-	
+
+	virtual ~Shape() {}
+
 	virtual Mat3 InertiaTensor() const = 0;
-	
+
 	virtual ShapeType GetType() const = 0;
 	virtual Vec3 GetCenterOfMass() const { return centerOfMass; }
 
 	virtual Bounds GetBounds(const Vec3& pos, const Quat& orient) const = 0;
 	virtual Bounds GetBounds() const = 0;
-	
+
+	/// <summary>
+	/// Furthest world space point of the shape along dir, pushed out by bias
+	/// </summary>
+	virtual Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const = 0;
+
+	/// <summary>
+	/// Fastest speed along dir of any point of the shape due to its rotation alone
+	/// </summary>
+	virtual float FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const { return 0.0f; }
+
 protected:
 	Vec3 centerOfMass;
 };
@@ -31,13 +54,79 @@ public:
 	{
 		centerOfMass.Zero();
 	}
-	
+
 	Mat3 InertiaTensor() const override;
-	
+
 	ShapeType GetType() const override { return ShapeType::SHAPE_SPHERE; }
-	
+
 	Bounds GetBounds(const Vec3& pos, const Quat& orient) const override;
 	Bounds GetBounds() const override;
 
+	Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const override;
+
 	float radius;
 };
+
+class ShapeBox : public Shape
+{
+public:
+	/// <summary>
+	/// Box bounding the given points
+	/// </summary>
+	ShapeBox(const Vec3* pts, const int num);
+
+	Mat3 InertiaTensor() const override;
+
+	ShapeType GetType() const override { return ShapeType::SHAPE_BOX; }
+
+	Bounds GetBounds(const Vec3& pos, const Quat& orient) const override;
+	Bounds GetBounds() const override { return m_bounds; }
+
+	Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const override;
+	float FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const override;
+
+	Vec3 m_points[8];
+	Bounds m_bounds;
+};
+
+class ShapeConvex : public Shape
+{
+public:
+	/// <summary>
+	/// Convex hull of the points
+	/// </summary>
+	ShapeConvex(const Vec3* pts, const int num);
+
+	/// <summary>
+	/// Convex hull already built, given by its vertices and outward facing triangles
+	/// </summary>
+	ShapeConvex(const Vec3* hullPts, const int numPts, const tri_t* hullTris, const int numTris);
+
+	Mat3 InertiaTensor() const override { return m_inertiaTensor; }
+
+	ShapeType GetType() const override { return ShapeType::SHAPE_CONVEX; }
+
+	Bounds GetBounds(const Vec3& pos, const Quat& orient) const override;
+	Bounds GetBounds() const override { return m_bounds; }
+
+	Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const override;
+	float FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const override;
+
+	std::vector<Vec3> m_points;
+	std::vector<tri_t> m_tris;
+	Bounds m_bounds;
+	Mat3 m_inertiaTensor;
+
+private:
+	void Build();
+	int SupportIndex(const Vec3& localDir) const;
+	void BuildAdjacency();
+
+	// Vertex neighbours in compressed rows: the neighbours of vertex i are
+	// m_adjacency[ m_adjacencyStart[ i ] ] up to m_adjacency[ m_adjacencyStart[ i + 1 ] ]
+	std::vector<int> m_adjacencyStart;
+	std::vector<int> m_adjacency;
+
+	// Vertices furthest along -x, +x, -y, +y, -z, +z, where hill climbing starts from
+	int m_extremes[6];
+};
@@ -0,0 +1,426 @@
+#include "AsyncFileReader.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const size_t PAGE_BYTES = 4096;
+
+	// Somewhere the page touches can go that the compiler has to keep
+	volatile unsigned char s_touched;
+}
+
+#if defined(__linux__)
+/*
+====================================================
+AsyncFileReader::Ring
+io_uring through its system calls, there is no liburing to lean on. Only
+the ring thread uses it once it is made. Reads are READV, which kernels
+have had since io_uring came in, where READ needs 5.6.
+====================================================
+*/
+struct AsyncFileReader::Ring
+{
+	static const int DEPTH = 32;
+
+	// A read in flight: the request, and the file and buffer it is read from and into
+	struct Slot
+	{
+		Request request;
+		int fd;
+		unsigned char* buffer;
+		size_t size;
+		size_t numRead;
+		iovec vector;
+	};
+
+	Ring() : fd(-1), numToSubmit(0), sqMap(MAP_FAILED), cqMap(MAP_FAILED), sqes((io_uring_sqe*)MAP_FAILED) {}
+	~Ring();
+
+	static Ring* Create();
+
+	int NumInFlight() const { return DEPTH - (int)freeSlots.size(); }
+	bool Start(Request& request);
+	void Queue(const int slot);
+	void Enter(const unsigned minComplete);
+	void Reap(std::deque<Request>& finished);
+
+	int fd;
+	unsigned numToSubmit;
+	void* sqMap;
+	size_t sqBytes;
+	void* cqMap;
+	size_t cqBytes;
+	io_uring_sqe* sqes;
+	size_t sqeBytes;
+	unsigned* sqTail;
+	unsigned* sqMask;
+	unsigned* sqArray;
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned* cqMask;
+	io_uring_cqe* cqes;
+
+	Slot slots[DEPTH];
+	std::vector<int> freeSlots;
+};
+
+AsyncFileReader::Ring* AsyncFileReader::Ring::Create()
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	const int ringFd = (int)syscall(__NR_io_uring_setup, DEPTH, &params);
+	if (ringFd < 0) return NULL;
+
+	Ring* ring = new Ring();
+	ring->fd = ringFd;
+	ring->sqBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cqBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	ring->sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+
+	// Newer kernels map both queues' rings in one go
+	const bool isSingleMap = 0 != (params.features & IORING_FEAT_SINGLE_MMAP);
+	if (isSingleMap)
+	{
+		ring->sqBytes = ring->cqBytes = std::max(ring->sqBytes, ring->cqBytes);
+	}
+	ring->sqMap = mmap(NULL, ring->sqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+	if (isSingleMap)
+	{
+		ring->cqMap = ring->sqMap;
+	}
+	else
+	{
+		ring->cqMap = mmap(NULL, ring->cqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+	}
+	ring->sqes = (io_uring_sqe*)mmap(NULL, ring->sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+	if (MAP_FAILED == ring->sqMap || MAP_FAILED == ring->cqMap || MAP_FAILED == (void*)ring->sqes)
+	{
+		delete ring;
+		return NULL;
+	}
+
+	unsigned char* sq = (unsigned char*)ring->sqMap;
+	unsigned char* cq = (unsigned char*)ring->cqMap;
+	ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+	ring->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+	ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+	ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+	ring->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+	for (int slot = DEPTH - 1; slot >= 0; --slot)
+	{
+		ring->freeSlots.push_back(slot);
+	}
+	return ring;
+}
+
+AsyncFileReader::Ring::~Ring()
+{
+	if (MAP_FAILED != (void*)sqes) munmap(sqes, sqeBytes);
+	if (MAP_FAILED != cqMap && cqMap != sqMap) munmap(cqMap, cqBytes);
+	if (MAP_FAILED != sqMap) munmap(sqMap, sqBytes);
+	if (fd >= 0) close(fd);
+}
+
+// Opens the file and queues its read. False when the request is already
+// done: the file could not be opened, or is empty and needs no read.
+bool AsyncFileReader::Ring::Start(Request& request)
+{
+	const int file = open(request.fileName.c_str(), O_RDONLY);
+	struct stat info;
+	if (file < 0 || 0 != fstat(file, &info) || 0 == info.st_size)
+	{
+		if (file >= 0)
+		{
+			close(file);
+			request.file.Open(request.fileName.c_str());
+		}
+		return false;
+	}
+
+	// Left uncleared, as FileView's own reads are
+	unsigned char* buffer = (unsigned char*)malloc((size_t)info.st_size);
+	if (NULL == buffer)
+	{
+		close(file);
+		return false;
+	}
+
+	const int slot = freeSlots.back();
+	freeSlots.pop_back();
+	Slot& read = slots[slot];
+	read.request = std::move(request);
+	read.fd = file;
+	read.buffer = buffer;
+	read.size = (size_t)info.st_size;
+	read.numRead = 0;
+	Queue(slot);
+	return true;
+}
+
+// Puts the rest of the slot's file on the submission queue, from wherever its reads have got to
+void AsyncFileReader::Ring::Queue(const int slot)
+{
+	Slot& read = slots[slot];
+	read.vector.iov_base = read.buffer + read.numRead;
+	read.vector.iov_len = read.size - read.numRead;
+
+	const unsigned tail = *sqTail;
+	const unsigned index = tail & *sqMask;
+	io_uring_sqe& sqe = sqes[index];
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_READV;
+	sqe.fd = read.fd;
+	sqe.addr = (unsigned long long)&read.vector;
+	sqe.len = 1;
+	sqe.off = read.numRead;
+	sqe.user_data = (unsigned long long)slot;
+	sqArray[index] = index;
+
+	// The kernel may only see the new tail once the entry is written
+	__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+	++numToSubmit;
+}
+
+// Submits what was queued, and blocks until at least minComplete reads are done
+void AsyncFileReader::Ring::Enter(const unsigned minComplete)
+{
+	int numSubmitted;
+	do
+	{
+		numSubmitted = (int)syscall(__NR_io_uring_enter, fd, numToSubmit, minComplete, minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	} while (numSubmitted < 0 && EINTR == errno);
+	if (numSubmitted > 0)
+	{
+		numToSubmit -= (unsigned)numSubmitted;
+	}
+}
+
+// Hands back the reads that are done, and queues the rest of any that came back short
+void AsyncFileReader::Ring::Reap(std::deque<Request>& finished)
+{
+	unsigned head = *cqHead;
+	const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+	for (; head != tail; ++head)
+	{
+		const io_uring_cqe& cqe = cqes[head & *cqMask];
+		const int slot = (int)cqe.user_data;
+		Slot& read = slots[slot];
+		if (cqe.res > 0)
+		{
+			read.numRead += (size_t)cqe.res;
+			if (read.numRead < read.size)
+			{
+				Queue(slot);
+				continue;
+			}
+		}
+
+		close(read.fd);
+		if (read.numRead == read.size)
+		{
+			read.request.file.Adopt(read.buffer, read.size);
+		}
+		else
+		{
+			printf("ERROR: reading file went wrong %s\n", read.request.fileName.c_str());
+			free(read.buffer);
+		}
+		finished.push_back(std::move(read.request));
+		freeSlots.push_back(slot);
+	}
+	__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+}
+#endif
+
+AsyncFileReader::AsyncFileReader(int numThreads, const Backend backend) : m_ring(NULL), m_numOutstanding(0), m_isRunning(true)
+{
+#if defined(__linux__)
+	if (Backend::IO_URING == backend)
+	{
+		m_ring = Ring::Create();
+	}
+	if (NULL != m_ring)
+	{
+		m_threads.emplace_back(&AsyncFileReader::RingMain, this);
+		return;
+	}
+#endif
+
+	numThreads = std::max(numThreads, 1);
+	for (int i = 0; i < numThreads; ++i)
+	{
+		m_threads.emplace_back(&AsyncFileReader::ThreadMain, this);
+	}
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isRunning = false;
+		m_pending.clear();
+	}
+	m_queued.notify_all();
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+#if defined(__linux__)
+	delete m_ring;
+#endif
+}
+
+void AsyncFileReader::Read(const char* fileName, const Completion& completion)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.emplace_back();
+		m_pending.back().fileName = fileName;
+		m_pending.back().completion = completion;
+		++m_numOutstanding;
+	}
+	m_queued.notify_one();
+}
+
+int AsyncFileReader::Poll()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return RunCompleted(lock);
+}
+
+void AsyncFileReader::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_numOutstanding > 0)
+	{
+		m_finished.wait(lock, [this]() { return !m_completed.empty() || 0 == m_numOutstanding; });
+		RunCompleted(lock);
+	}
+}
+
+int AsyncFileReader::NumOutstanding() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_numOutstanding;
+}
+
+int AsyncFileReader::RunCompleted(std::unique_lock<std::mutex>& lock)
+{
+	// Unlocked while the completions run, they may well queue reads of their own
+	std::deque<Request> completed;
+	completed.swap(m_completed);
+	lock.unlock();
+	for (Request& request : completed)
+	{
+		request.completion(request.file);
+	}
+	lock.lock();
+	m_numOutstanding -= (int)completed.size();
+	if (!completed.empty()) m_finished.notify_all();	// Another thread may be waiting on these
+	return (int)completed.size();
+}
+
+void AsyncFileReader::ThreadMain()
+{
+	PROFILE_THREAD_NAME("File I/O");
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_queued.wait(lock, [this]() { return !m_isRunning || !m_pending.empty(); });
+		if (!m_isRunning) return;
+
+		Request request = std::move(m_pending.front());
+		m_pending.pop_front();
+		lock.unlock();
+
+		{
+			PROFILE_ZONE("Read file");
+			if (request.file.Open(request.fileName.c_str()))
+			{
+				const unsigned char* data = request.file.Data();
+				unsigned char touched = 0;
+				for (size_t offset = 0; offset < request.file.Size(); offset += PAGE_BYTES)
+				{
+					touched ^= data[offset];
+				}
+				s_touched = touched;
+			}
+		}
+
+		lock.lock();
+		m_completed.push_back(std::move(request));
+		m_finished.notify_all();
+	}
+}
+
+#if defined(__linux__)
+void AsyncFileReader::RingMain()
+{
+	PROFILE_THREAD_NAME("File I/O");
+	Ring& ring = *m_ring;
+	std::deque<Request> starting;
+	std::deque<Request> finished;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		// Reads in flight are seen through even when stopping, the kernel is still filling their buffers
+		const int numInFlight = ring.NumInFlight();
+		m_queued.wait(lock, [&]() { return !m_isRunning || !m_pending.empty() || numInFlight > 0; });
+		if (!m_isRunning && 0 == numInFlight) return;
+
+		while (m_isRunning && !m_pending.empty() && (int)starting.size() < Ring::DEPTH - numInFlight)
+		{
+			starting.push_back(std::move(m_pending.front()));
+			m_pending.pop_front();
+		}
+		lock.unlock();
+
+		// Reads queued while this waits on the ring are started after the next one is done
+		{
+			PROFILE_ZONE("Read files");
+			for (Request& request : starting)
+			{
+				if (!ring.Start(request))
+				{
+					finished.push_back(std::move(request));
+				}
+			}
+			starting.clear();
+			if (ring.NumInFlight() > 0)
+			{
+				ring.Enter(1);
+			}
+			ring.Reap(finished);
+		}
+
+		lock.lock();
+		if (!finished.empty())
+		{
+			for (Request& request : finished)
+			{
+				m_completed.push_back(std::move(request));
+			}
+			finished.clear();
+			m_finished.notify_all();
+		}
+	}
+}
+#endif
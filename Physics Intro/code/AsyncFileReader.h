@@ -0,0 +1,97 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Fileio.h"
+
+/// <summary>
+/// Reads files in the background and hands them back whole. Reads are
+/// queued and several are in flight at once, so the disk is kept busy
+/// while the caller works on what came back earlier. The I/O threads are
+/// its own, not the job system's: they spend their time blocked on the
+/// disk, and a worker blocked there would hold up the physics.
+///
+/// A read opens the file as a FileView and touches every page of it, so a
+/// cold file is brought in on an I/O thread and not on the first access.
+/// Completions run on whichever thread calls Poll or Wait, in the order
+/// the reads finished, which keeps Vulkan and scene work where it was.
+///
+/// On Linux the reads go through io_uring instead where the kernel allows
+/// it: one thread opens the files and keeps up to a queue's worth of reads
+/// into buffers in flight, and the kernel does the waiting. Where the ring
+/// cannot be set up, in older kernels or sandboxes that forbid it, the
+/// reader falls back to the thread pool.
+/// </summary>
+class AsyncFileReader
+{
+public:
+	/// <summary>
+	/// The file is not open if it could not be read. The completion may move it somewhere to keep it.
+	/// </summary>
+	typedef std::function<void(FileView& file)> Completion;
+
+	enum class Backend
+	{
+		IO_URING,	// Where the system has it, else THREADS
+		THREADS,	// Blocking reads on a pool of threads
+	};
+
+	explicit AsyncFileReader(int numThreads = 4, const Backend backend = Backend::IO_URING);
+	~AsyncFileReader();	// Reads not started are dropped, their completions never run
+
+	AsyncFileReader(const AsyncFileReader&) = delete;
+	AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+	/// <summary>
+	/// Queues the read, the name is copied
+	/// </summary>
+	void Read(const char* fileName, const Completion& completion);
+
+	/// <summary>
+	/// Runs the completions of the reads that have finished, returns how many ran
+	/// </summary>
+	int Poll();
+
+	/// <summary>
+	/// Runs completions as their reads finish until none are outstanding,
+	/// including reads the completions queue themselves
+	/// </summary>
+	void Wait();
+
+	int NumOutstanding() const;
+
+	/// <summary>
+	/// The backend the reads go through, THREADS if io_uring was asked for and could not be had
+	/// </summary>
+	Backend GetBackend() const { return NULL != m_ring ? Backend::IO_URING : Backend::THREADS; }
+
+private:
+	struct Ring;	// The io_uring queues, kept out of the header
+
+	struct Request
+	{
+		std::string fileName;
+		Completion completion;
+		FileView file;
+	};
+
+	void ThreadMain();
+	void RingMain();
+	int RunCompleted(std::unique_lock<std::mutex>& lock);
+
+	Ring* m_ring;	// NULL when the reads go through the thread pool
+	std::vector<std::thread> m_threads;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_queued;	// Workers wait on this
+	std::condition_variable m_finished;	// Wait waits on this
+	std::deque<Request> m_pending;
+	std::deque<Request> m_completed;
+	int m_numOutstanding;	// Queued, reading or completed but not yet handed back
+	bool m_isRunning;
+};
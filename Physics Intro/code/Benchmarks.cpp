@@ -0,0 +1,2171 @@
+//
+//  Benchmarks.cpp
+//
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AsyncFileReader.h"
+#include "Contact.h"
+#include "Intersections.h"
+#include "JobSystem.h"
+#include "JointSolver.h"
+#include "Math/Simd.h"
+#include "MemoryTracker.h"
+#include "ParticleSystem.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "SceneFile.h"
+#include "SceneQuery.h"
+#include "SceneVariants.h"
+#include "SimulationTrace.h"
+#include "../Shape.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedMs(const Clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static int Check(const bool isPassed, const char* name)
+{
+	printf("  %-40s %s\n", name, isPassed ? "ok" : "FAILED");
+	return isPassed ? 0 : 1;
+}
+
+/*
+====================================================
+AddSphereGrid
+256 spheres dropped in a grid over the floor of Initialize
+====================================================
+*/
+static void AddSphereGrid(Scene& scene)
+{
+	for (int i = 0; i < 256; ++i)
+	{
+		Body body;
+		body.position = Vec3((float)(i % 16) * 0.9f - 7.0f, (float)(i / 16) * 0.9f - 7.0f, 2.0f + (float)(i % 5) * 0.3f);
+		body.orientation = Quat(0, 0, 0, 1);
+		body.linearVelocity = Vec3(0, 0, 0);
+		body.angularVelocity = Vec3(0, 0, 0);
+		body.shape = new ShapeSphere(0.4f);
+		body.inverseMass = 1.0f;
+		body.elasticity = 0.5f;
+		body.friction = 0.5f;
+		scene.bodies.push_back(body);
+	}
+}
+
+/*
+====================================================
+RunJobSystemBenchmark
+====================================================
+*/
+int RunJobSystemBenchmark(const int numWorkers)
+{
+	JobSystem jobs(numWorkers);
+	printf("Job system, %i workers\n", jobs.NumWorkers());
+	int numFailed = 0;
+
+	// Every index visited exactly once, for split and unsplit ranges alike
+	{
+		const int count = 1000003;
+		std::vector<std::atomic<int>> visits(count);
+		for (std::atomic<int>& visit : visits) visit = 0;
+		jobs.ParallelFor(0, count, [&](int first, int last)
+		{
+			for (int i = first; i < last; ++i) ++visits[i];
+		});
+		jobs.ParallelFor(0, 7, [&](int first, int last)
+		{
+			for (int i = first; i < last; ++i) ++visits[i];
+		});
+
+		bool isPassed = true;
+		for (int i = 0; i < count; ++i)
+		{
+			isPassed = isPassed && visits[i] == (i < 7 ? 2 : 1);
+		}
+		numFailed += Check(isPassed, "parallel for covers the range once");
+	}
+
+	// A parallel for from inside a job of another parallel for
+	{
+		std::atomic<int> sum(0);
+		jobs.ParallelFor(0, 64, [&](int first, int last)
+		{
+			for (int i = first; i < last; ++i)
+			{
+				jobs.ParallelFor(0, 1000, [&](int a, int b) { sum += b - a; }, 10);
+			}
+		}, 1);
+		numFailed += Check(sum == 64 * 1000, "nested parallel for");
+	}
+
+	// Parent waits for its children
+	{
+		std::atomic<int> numRun(0);
+		Job* parent = jobs.CreateJob(std::function<void()>());
+		for (int i = 0; i < 1000; ++i)
+		{
+			jobs.Run(jobs.CreateChildJob(parent, [&]() { ++numRun; }));
+		}
+		jobs.Run(parent);
+		jobs.Wait(parent);
+		numFailed += Check(numRun == 1000, "parent finishes after its children");
+	}
+
+	// Continuations: c only starts once a and b are done, d after c
+	{
+		std::atomic<int> order(0);
+		int orderA = -1, orderB = -1, orderC = -1, orderD = -1;
+		Job* a = jobs.CreateJob([&]() { std::this_thread::sleep_for(std::chrono::milliseconds(5)); orderA = order++; });
+		Job* b = jobs.CreateJob([&]() { orderB = order++; });
+		Job* c = jobs.CreateJob([&]() { orderC = order++; });
+		Job* d = jobs.CreateJob([&]() { orderD = order++; });
+		jobs.AddContinuation(a, c);
+		jobs.AddContinuation(b, c);
+		jobs.AddContinuation(c, d);
+		jobs.Run(d);
+		jobs.Run(c);
+		jobs.Run(a);
+		jobs.Run(b);
+		jobs.Wait(d);
+		numFailed += Check(orderC > orderA && orderC > orderB && orderD > orderC, "continuations wait on every dependency");
+	}
+
+	// More jobs in flight than the ring holds
+	{
+		std::atomic<int> numRun(0);
+		Job* parent = jobs.CreateJob(std::function<void()>());
+		for (int i = 0; i < JobSystem::MAX_JOBS_PER_THREAD * 3; ++i)
+		{
+			jobs.Run(jobs.CreateChildJob(parent, [&]() { ++numRun; }));
+		}
+		jobs.Run(parent);
+		jobs.Wait(parent);
+		numFailed += Check(numRun == JobSystem::MAX_JOBS_PER_THREAD * 3, "job ring wraps around");
+	}
+
+	// Timings
+	{
+		// Batches that fit the ring, as a frame's worth of jobs would
+		const int numBatches = 100;
+		const int batchSize = 1000;
+		Clock::time_point start = Clock::now();
+		for (int batch = 0; batch < numBatches; ++batch)
+		{
+			Job* parent = jobs.CreateJob(std::function<void()>());
+			for (int i = 0; i < batchSize; ++i)
+			{
+				jobs.Run(jobs.CreateChildJob(parent, std::function<void()>()));
+			}
+			jobs.Run(parent);
+			jobs.Wait(parent);
+		}
+		const double ms = ElapsedMs(start);
+		printf("  empty jobs: %.0f ns per job\n", ms * 1000000.0 / (numBatches * batchSize));
+	}
+	{
+		const int count = 1 << 22;
+		std::vector<float> values(count);
+		const auto work = [&](int first, int last)
+		{
+			for (int i = first; i < last; ++i)
+			{
+				values[i] = sqrtf((float)i) * sinf((float)i);
+			}
+		};
+
+		Clock::time_point start = Clock::now();
+		work(0, count);
+		const double serialMs = ElapsedMs(start);
+
+		start = Clock::now();
+		jobs.ParallelFor(0, count, work);
+		const double parallelMs = ElapsedMs(start);
+		printf("  parallel for over %i: serial %.2f ms, parallel %.2f ms, %.1fx\n", count, serialMs, parallelMs, serialMs / parallelMs);
+	}
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunDeterminismCheck
+====================================================
+*/
+int RunDeterminismCheck()
+{
+	const Scene::SolverMode modes[3] = { Scene::SolverMode::TIME_OF_IMPACT, Scene::SolverMode::SPECULATIVE, Scene::SolverMode::XPBD };
+	const char* modeNames[3] = { "time of impact", "speculative", "xpbd" };
+	const int numSteps = 600;
+	const unsigned int seed = 1234;
+
+	// A few workers even on small machines, so the work really is split
+	JobSystem jobs(std::max((int)std::thread::hardware_concurrency() - 1, 3));
+	printf("Determinism, %i steps, serial against %i workers\n", numSteps, jobs.NumWorkers());
+	int numFailed = 0;
+	for (int mode = 0; mode < 3; ++mode)
+	{
+		Scene serial;
+		Scene parallel;
+		serial.SetDeterministic(true, seed);
+		parallel.SetDeterministic(true, seed);
+		parallel.SetJobSystem(&jobs);
+		serial.SetSolverMode(modes[mode]);
+		parallel.SetSolverMode(modes[mode]);
+		Scene* scenes[2] = { &serial, &parallel };
+		for (Scene* scene : scenes)
+		{
+			scene->Reset();
+
+			// Enough bodies for the narrow phase and integration to go wide
+			AddSphereGrid(*scene);
+		}
+
+		int firstMismatch = -1;
+		for (int step = 0; step < numSteps && firstMismatch < 0; ++step)
+		{
+			serial.Update(1.0f / 120.0f);
+			parallel.Update(1.0f / 120.0f);
+			if (serial.GetStepHash() != parallel.GetStepHash())
+			{
+				firstMismatch = step;
+			}
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "%s, hash %016llx", modeNames[mode], serial.GetStepHash());
+		numFailed += Check(firstMismatch < 0, name);
+	}
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunVariantsBenchmark
+====================================================
+*/
+int RunVariantsBenchmark(const int numVariants)
+{
+	const int numSteps = 360;	// Three seconds at 120 Hz
+	const float dt = 1.0f / 120.0f;
+	const Vec3 target = Vec3(3, 3, 0);
+
+	Scene base;
+	base.SetDeterministic(true, 1);
+	base.Reset();
+
+	// A fan of throws of the cochonet, body 0
+	const auto setThrows = [&](SceneVariants& variants)
+	{
+		for (int i = 0; i < numVariants; ++i)
+		{
+			const float angle = 6.2831853f * (float)i / (float)numVariants;
+			const float speed = 2.0f + (float)(i % 7);
+			variants.GetVariant(i).bodies[0].linearVelocity = Vec3(cosf(angle), sinf(angle), 0) * speed;
+		}
+	};
+
+	JobSystem jobs;
+	SceneVariants variants;
+	printf("Scene variants, %i throws of %i steps, %i workers\n", numVariants, numSteps, jobs.NumWorkers());
+
+	Clock::time_point start = Clock::now();
+	variants.Build(base, numVariants);
+	setThrows(variants);
+	variants.Run(numSteps, dt, NULL);
+	const double serialMs = ElapsedMs(start);
+	std::vector<VariantOutcome> serialOutcomes;
+	variants.GetOutcomes(0, serialOutcomes);
+
+	start = Clock::now();
+	variants.Build(base, numVariants);
+	setThrows(variants);
+	variants.Run(numSteps, dt, &jobs);
+	const double parallelMs = ElapsedMs(start);
+	std::vector<VariantOutcome> outcomes;
+	variants.GetOutcomes(0, outcomes);
+
+	int best = 0;
+	int numMismatched = 0;
+	for (int i = 0; i < numVariants; ++i)
+	{
+		if ((outcomes[i].position - target).GetLengthSqr() < (outcomes[best].position - target).GetLengthSqr())
+		{
+			best = i;
+		}
+		numMismatched += (outcomes[i].position - serialOutcomes[i].position).GetLengthSqr() == 0.0f ? 0 : 1;
+	}
+	printf("  serial %.2f ms, parallel %.2f ms, %.3f ms per throw\n", serialMs, parallelMs, parallelMs / numVariants);
+	printf("  closest to (%.1f %.1f): throw %i, ends at (%.2f %.2f %.2f)\n", target.x, target.y, best, outcomes[best].position.x, outcomes[best].position.y, outcomes[best].position.z);
+	int numFailed = Check(0 == numMismatched, "parallel outcomes match serial");
+
+	// A variant of a scene loaded from a file resets to the file, here half
+	// the bodies of Initialize, rather than to Initialize
+	{
+		const char* fileName = "variants.scene";
+		SceneFile file;
+		file.FromScene(base);
+		file.bodies.resize(file.bodies.size() / 2);
+		Scene loaded;
+		const bool isLoaded = file.SaveText(fileName) && loaded.LoadScene(fileName);
+		variants.Build(loaded, 1);
+		Scene& variant = variants.GetVariant(0);
+		variant.Update(dt);
+		variant.Reset();
+		bool isSame = isLoaded && variant.bodies.size() == loaded.bodies.size();
+		for (int i = 0; isSame && i < (int)loaded.bodies.size(); ++i)
+		{
+			isSame = variant.bodies[i].position == loaded.bodies[i].position;
+		}
+		numFailed += Check(isSame, "a variant resets to its base's scene file");
+		remove(fileName);
+	}
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunTraceBenchmark
+====================================================
+*/
+int RunTraceBenchmark(const int numSteps)
+{
+	const char* fileName = "benchmark.trace";
+	const char* truncatedName = "benchmark_truncated.trace";
+	const float dt = 1.0f / 120.0f;
+	printf("Simulation trace, %i steps\n", numSteps);
+	int numFailed = 0;
+
+	// The same scene stepped plain and recorded, the difference is what recording costs the step
+	Scene plain;
+	Scene recorded;
+	Scene* scenes[2] = { &plain, &recorded };
+	for (Scene* scene : scenes)
+	{
+		scene->SetDeterministic(true, 1);
+		scene->Reset();
+		AddSphereGrid(*scene);
+	}
+
+	TraceRecorder recorder;
+	if (!recorder.Open(fileName))
+	{
+		printf("  could not create %s\n", fileName);
+		return 1;
+	}
+	recorded.SetTraceRecorder(&recorder);
+
+	// What went in, to hold the decoded frames against
+	std::vector<std::vector<TracePose>> expected(numSteps);
+	double plainMs = 0.0;
+	double recordedMs = 0.0;
+	for (int step = 0; step < numSteps; ++step)
+	{
+		Clock::time_point start = Clock::now();
+		plain.Update(dt);
+		plainMs += ElapsedMs(start);
+
+		start = Clock::now();
+		recorded.Update(dt);
+		recordedMs += ElapsedMs(start);
+
+		for (const Body& body : recorded.bodies)
+		{
+			TracePose pose;
+			pose.position = body.position;
+			pose.orientation = body.orientation;
+			expected[step].push_back(pose);
+		}
+	}
+	recorder.Close();
+	recorded.SetTraceRecorder(NULL);
+	printf("  step: %.3f ms plain, %.3f ms recorded\n", plainMs / numSteps, recordedMs / numSteps);
+
+	TraceReader reader;
+	numFailed += Check(reader.Open(fileName) && reader.NumFrames() == numSteps, "trace opens with every frame");
+	if (!reader.IsOpen() || reader.NumFrames() != numSteps)
+	{
+		return 1;
+	}
+
+	// Within half a quantization step of where the bodies were, front to back
+	bool isPassed = true;
+	TraceFrame frame;
+	for (int i = 0; i < numSteps && isPassed; ++i)
+	{
+		isPassed = reader.ReadFrame(i, frame) && frame.poses.size() == expected[i].size();
+		for (int j = 0; j < (int)frame.poses.size() && isPassed; ++j)
+		{
+			const Vec3 delta = frame.poses[j].position - expected[i][j].position;
+			const Quat& a = frame.poses[j].orientation;
+			const Quat& b = expected[i][j].orientation;
+			const float dot = fabsf(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+			isPassed = fabsf(delta.x) <= 0.001f && fabsf(delta.y) <= 0.001f && fabsf(delta.z) <= 0.001f && dot > 0.99999f;
+		}
+	}
+	numFailed += Check(isPassed, "frames decode to the recorded poses");
+
+	// Random seeks land on the same poses as reading through
+	{
+		TraceFrame sequential;
+		unsigned int random = 12345;
+		const int numSeeks = 1000;
+		isPassed = true;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < numSeeks; ++i)
+		{
+			random = random * 1664525u + 1013904223u;
+			isPassed = isPassed && reader.ReadFrame((int)((random >> 8) % numSteps), frame);
+		}
+		const double seekMs = ElapsedMs(start);
+		const int last = (int)((random >> 8) % numSteps);
+		isPassed = isPassed && reader.ReadFrame(0, sequential);
+		for (int i = 1; i <= last && isPassed; ++i)
+		{
+			isPassed = reader.ReadFrame(i, sequential);
+		}
+		isPassed = isPassed && 0 == memcmp(frame.poses.data(), sequential.poses.data(), frame.poses.size() * sizeof(TracePose));
+		numFailed += Check(isPassed, "random seeks match reading through");
+		printf("  seek: %.1f us per random frame\n", seekMs * 1000.0 / numSeeks);
+	}
+
+	// A session cut off mid-frame, before the index was written, keeps every whole frame
+	{
+		std::vector<unsigned char> bytes;
+		FILE* file = fopen(fileName, "rb");
+		if (NULL != file)
+		{
+			fseek(file, 0, SEEK_END);
+			bytes.resize(ftell(file));
+			rewind(file);
+			bytes.resize(fread(bytes.data(), 1, bytes.size(), file));
+			fclose(file);
+		}
+		printf("  file: %i bytes, %.2f bytes per body per step\n", (int)bytes.size(), (double)bytes.size() / ((double)numSteps * expected[0].size()));
+
+		// Walk the byte counts past the frames kept, then cut a few bytes into the next
+		const int numKept = numSteps / 2;
+		size_t offset = sizeof(TraceHeader);
+		for (int i = 0; i < numKept && offset + sizeof(unsigned int) <= bytes.size(); ++i)
+		{
+			unsigned int byteCount;
+			memcpy(&byteCount, bytes.data() + offset, sizeof(byteCount));
+			offset += sizeof(byteCount) + byteCount;
+		}
+		bytes.resize(std::min(offset + 7, bytes.size()));
+
+		file = fopen(truncatedName, "wb");
+		if (NULL != file)
+		{
+			fwrite(bytes.data(), 1, bytes.size(), file);
+			fclose(file);
+		}
+
+		TraceFrame whole;
+		TraceReader truncated;
+		isPassed = reader.ReadFrame(numKept - 1, frame) && truncated.Open(truncatedName) && truncated.NumFrames() == numKept;
+		isPassed = isPassed && truncated.ReadFrame(numKept - 1, whole) && 0 == memcmp(frame.poses.data(), whole.poses.data(), frame.poses.size() * sizeof(TracePose));
+		numFailed += Check(isPassed, "trace without an index rebuilds it");
+	}
+
+	reader.Close();
+	remove(fileName);
+	remove(truncatedName);
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunSceneFileBenchmark
+====================================================
+*/
+int RunSceneFileBenchmark(const int numBodies)
+{
+	const char* textName = "benchmark.scene";
+	const char* binaryName = "benchmark.pscn";
+	printf("Scene files, %i bodies\n", numBodies);
+	int numFailed = 0;
+
+	// The built in scene: 25 floor spheres and 3 steel balls allocated one by one come down to 3 shapes
+	{
+		Scene scene;
+		scene.Reset();
+		SceneFile file;
+		file.FromScene(scene);
+		numFailed += Check(3 == file.shapes.size() && scene.bodies.size() == file.bodies.size(), "shapes of the built in scene interned");
+	}
+
+	// A stress scene: a few sizes of sphere and a crate over a static floor, in a big grid
+	SceneFile stress;
+	const float radii[3] = { 0.25f, 0.4f, 0.5f };
+	for (float radius : radii)
+	{
+		SceneShape sphere;
+		sphere.type = SceneShape::SPHERE;
+		sphere.radius = radius;
+		stress.shapes.push_back(sphere);
+	}
+	SceneShape crate;
+	crate.type = SceneShape::BOX;
+	crate.radius = 0.0f;
+	crate.points.push_back(Vec3(-0.4f, -0.4f, -0.4f));
+	crate.points.push_back(Vec3(0.4f, 0.4f, 0.4f));
+	stress.shapes.push_back(crate);
+
+	const int side = (int)ceilf(sqrtf((float)numBodies));
+	stress.bodies.resize(numBodies);
+	for (int i = 0; i < numBodies; ++i)
+	{
+		SceneBody& body = stress.bodies[i];
+		body.shape = i % 4;
+		body.position = Vec3((float)(i % side) - side * 0.5f, (float)(i / side) - side * 0.5f, 1.0f + (float)(i % 3));
+		body.orientation = Quat(0, 0, 0, 1);
+		body.linearVelocity = Vec3(0, 0, (float)-(i % 5));
+		body.angularVelocity.Zero();
+		body.inverseMass = i % 10 ? 1.0f : 0.0f;
+		body.elasticity = 0.5f;
+		body.friction = 0.25f + 0.05f * (float)(i % 7);
+	}
+	numFailed += Check(stress.SaveBinary(binaryName) && stress.SaveText(textName), "stress scene saved in both forms");
+
+	// What the loaded scene holds has to be what was saved, shape for shape
+	const auto isSame = [&](const Scene& scene)
+	{
+		SceneFile loaded;
+		loaded.FromScene(scene);
+		bool isPassed = loaded.shapes.size() == stress.shapes.size() && loaded.bodies.size() == stress.bodies.size();
+		isPassed = isPassed && 0 == memcmp(loaded.bodies.data(), stress.bodies.data(), stress.bodies.size() * sizeof(SceneBody));
+
+		std::vector<const Shape*> shapes;
+		for (const Body& body : scene.bodies) shapes.push_back(body.shape);
+		std::sort(shapes.begin(), shapes.end());
+		return isPassed && std::unique(shapes.begin(), shapes.end()) - shapes.begin() == (ptrdiff_t)stress.shapes.size();
+	};
+
+	Scene scene;
+	Clock::time_point start = Clock::now();
+	bool isLoaded = scene.LoadScene(binaryName);
+	const double binaryMs = ElapsedMs(start);
+	numFailed += Check(isLoaded && isSame(scene), "binary form loads what was saved");
+
+	start = Clock::now();
+	isLoaded = scene.LoadScene(textName);
+	const double textMs = ElapsedMs(start);
+	numFailed += Check(isLoaded && isSame(scene), "text form loads what was saved");
+
+	// Reset builds from the loaded file again, freeing each shared shape once
+	start = Clock::now();
+	scene.Reset();
+	const double resetMs = ElapsedMs(start);
+	numFailed += Check(isSame(scene), "reset rebuilds the loaded scene");
+	printf("  load: binary %.2f ms, text %.2f ms, reset %.2f ms\n", binaryMs, textMs, resetMs);
+
+	// Mistakes in a hand written file are reported with their line
+	{
+		const char* text = "shape ball sphere 0.5\nbody ball 0 0 1\nbody crate 0 0 2\n";
+		SceneFile file;
+		const bool isRejected = !file.LoadText(text, strlen(text)) && 0 == file.GetError().find("line 3");
+		const char* bad = "shape ball sphere half\n";
+		numFailed += Check(isRejected && !file.LoadText(bad, strlen(bad)), "bad text rejected with its line");
+	}
+
+	// A binary file has its shapes checked the same, the scene is left as it was
+	{
+		const auto isRejected = [&](const SceneShape::Type type, const int numPoints)
+		{
+			SceneFile file;
+			SceneShape shape;
+			shape.type = type;
+			shape.radius = 0.0f;
+			for (int i = 0; i < numPoints; ++i)
+			{
+				shape.points.push_back(Vec3((float)(i & 1), (float)(i >> 1 & 1), (float)(i >> 2 & 1)));
+			}
+			file.shapes.push_back(shape);
+			file.bodies.push_back(stress.bodies[0]);
+			file.bodies[0].shape = 0;
+			return file.SaveBinary(binaryName) && !scene.LoadScene(binaryName) && scene.bodies.size() == stress.bodies.size();
+		};
+		numFailed += Check(isRejected(SceneShape::BOX, 0) && isRejected(SceneShape::CONVEX, 3) && isRejected(SceneShape::SPHERE, 0), "degenerate binary shapes rejected");
+
+		// The first four corners of the cube are a square, no volume to give a mass
+		numFailed += Check(isRejected(SceneShape::CONVEX, 4), "flat convex shapes rejected");
+	}
+
+	// Built straight from code, a flat convex falls back to its thickened bounds
+	{
+		const Vec3 square[4] = { Vec3(0, 0, 0), Vec3(1, 0, 0), Vec3(0, 1, 0), Vec3(1, 1, 0) };
+		const ShapeConvex flat(square, 4);
+		const Mat3 inertia = flat.InertiaTensor();
+		const bool isFinite = flat.GetCenterOfMass().IsValid() && inertia.rows[0].IsValid() && inertia.rows[1].IsValid() && inertia.rows[2].IsValid();
+		numFailed += Check(isFinite && inertia.rows[2][2] > 0.0f && !flat.m_tris.empty(), "flat convex shape has a finite mass");
+	}
+
+	remove(textName);
+	remove(binaryName);
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+AddWideWorld
+A sphere dropped over every 5 meters of a numSide * 5 meters square, on a static floor wide enough none rolls off
+====================================================
+*/
+static void AddWideWorld(Scene& scene, const int numSide)
+{
+	const float halfWidth = (float)numSide * 2.5f;
+	const float floorHalfWidth = halfWidth + 20.0f;
+	const Vec3 floorPoints[2] = { Vec3(-floorHalfWidth, -floorHalfWidth, -1.0f), Vec3(floorHalfWidth, floorHalfWidth, 0.0f) };
+	Body floor;
+	floor.position.Zero();
+	floor.orientation = Quat(0, 0, 0, 1);
+	floor.linearVelocity.Zero();
+	floor.angularVelocity.Zero();
+	floor.shape = new ShapeBox(floorPoints, 2);
+	floor.inverseMass = 0.0f;
+	floor.elasticity = 0.5f;
+	floor.friction = 0.5f;
+	scene.bodies.push_back(floor);
+
+	for (int i = 0; i < numSide * numSide; ++i)
+	{
+		Body body;
+		body.position = Vec3((float)(i % numSide) * 5.0f - halfWidth + 2.5f, (float)(i / numSide) * 5.0f - halfWidth + 2.5f, 1.0f + (float)(i % 7) * 0.5f);
+		body.orientation = Quat(0, 0, 0, 1);
+		body.linearVelocity = Vec3((float)(i % 3) - 1.0f, (float)(i % 5) * 0.5f - 1.0f, 0.0f);
+		body.angularVelocity.Zero();
+		body.shape = new ShapeSphere(0.5f);
+		body.inverseMass = 1.0f;
+		body.elasticity = 0.5f;
+		body.friction = 0.5f;
+		scene.bodies.push_back(body);
+	}
+}
+
+/*
+====================================================
+RunLodBenchmark
+====================================================
+*/
+int RunLodBenchmark(const int numSide)
+{
+	const int numSteps = 480;
+	const float dt = 1.0f / 120.0f;
+	const float fullRateRadius = 20.0f;
+	printf("Level of detail, %i bodies over %i meters, %i steps\n", numSide * numSide, numSide * 5, numSteps);
+	int numFailed = 0;
+
+	// Speculative contacts: time of impact splits the step at every impact, so
+	// the far bodies' impacts would change where the near ones' steps split
+	Scene full;
+	Scene lod;
+	full.SetSolverMode(Scene::SolverMode::SPECULATIVE);
+	lod.SetSolverMode(Scene::SolverMode::SPECULATIVE);
+	AddWideWorld(full, numSide);
+	AddWideWorld(lod, numSide);
+	lod.SetLevelOfDetail(true, Vec3(0, 0, 0), fullRateRadius);
+
+	Clock::time_point start = Clock::now();
+	for (int step = 0; step < numSteps; ++step)
+	{
+		full.Update(dt);
+	}
+	const double fullMs = ElapsedMs(start);
+
+	double lodMs = 0.0;
+	std::vector<char> isEverCoarse(lod.bodies.size(), 0);
+	for (int step = 0; step < numSteps; ++step)
+	{
+		start = Clock::now();
+		lod.Update(dt);
+		lodMs += ElapsedMs(start);
+		for (int i = 0; i < (int)lod.bodies.size(); ++i)
+		{
+			isEverCoarse[i] |= lod.GetLodLevel(i) > 0;
+		}
+	}
+	int levelCounts[Scene::MAX_LOD_LEVEL + 1] = { 0 };
+	for (int i = 1; i < (int)lod.bodies.size(); ++i)
+	{
+		++levelCounts[lod.GetLodLevel(i)];
+	}
+	printf("  full rate %.2f ms per step, level of detail %.2f ms per step\n", fullMs / numSteps, lodMs / numSteps);
+	printf("  bodies per level: %i %i %i %i\n", levelCounts[0], levelCounts[1], levelCounts[2], levelCounts[3]);
+
+	// Bodies that stayed at full rate, and only met others that did, step
+	// exactly as they do with level of detail off. Far from the focus bodies
+	// still land and stay on the floor.
+	float nearError = 0.0f;
+	float lowest = 1.0f;
+	int numNear = 0;
+	for (int i = 1; i < (int)lod.bodies.size(); ++i)
+	{
+		const Vec3& position = lod.bodies[i].position;
+		lowest = std::min(lowest, position.z);
+		if (!isEverCoarse[i])
+		{
+			nearError = std::max(nearError, (position - full.bodies[i].position).GetMagnitude());
+			++numNear;
+		}
+	}
+	printf("  %i bodies always at full rate, at most %.6f m from full rate, lowest sphere center %.3f m\n", numNear, nearError, lowest);
+	numFailed += Check(numNear > 0 && nearError < 0.001f, "full rate near the focus");
+	numFailed += Check(lowest > 0.4f, "no body sinks into the floor");
+	numFailed += Check(lodMs < fullMs, "faster than full rate");
+
+	// A sphere thrown from inside the full rate radius into one coming from
+	// far outside it: they share a level, bounce off each other and keep
+	// their momentum, whichever solver
+	const Scene::SolverMode modes[3] = { Scene::SolverMode::TIME_OF_IMPACT, Scene::SolverMode::SPECULATIVE, Scene::SolverMode::XPBD };
+	const char* modeNames[3] = { "time of impact", "speculative", "xpbd" };
+	for (int mode = 0; mode < 3; ++mode)
+	{
+		Scene scene;
+		scene.SetSolverMode(modes[mode]);
+		scene.SetLevelOfDetail(true, Vec3(0, 0, 50), 10.0f);
+		for (int i = 0; i < 2; ++i)
+		{
+			Body body;
+			body.position = Vec3(i ? 60.0f : 6.0f, 0.0f, 50.0f);
+			body.orientation = Quat(0, 0, 0, 1);
+			body.linearVelocity = Vec3(i ? -30.0f : 10.0f, 0.0f, 0.0f);
+			body.angularVelocity.Zero();
+			body.shape = new ShapeSphere(0.5f);
+			body.inverseMass = i ? 0.5f : 1.0f;
+			body.elasticity = 1.0f;
+			body.friction = 0.0f;
+			scene.bodies.push_back(body);
+		}
+		const float momentum = 10.0f - 30.0f / 0.5f;
+		for (int step = 0; step < 240; ++step)
+		{
+			scene.Update(dt);
+		}
+		const Body& a = scene.bodies[0];
+		const Body& b = scene.bodies[1];
+		const float after = a.linearVelocity.x / a.inverseMass + b.linearVelocity.x / b.inverseMass;
+
+		char name[64];
+		snprintf(name, sizeof(name), "cross level collision, %s", modeNames[mode]);
+		numFailed += Check(a.linearVelocity.x < 0.0f && fabsf(after - momentum) < 0.01f * fabsf(momentum), name);
+	}
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunAdaptiveBenchmark
+====================================================
+*/
+int RunAdaptiveBenchmark(const int maxSubsteps)
+{
+	const int numSteps = 600;
+	const int throwStep = 240;
+	const float dt = 1.0f / 120.0f;
+	printf("Adaptive substeps, at most %i, a ball thrown into resting spheres on step %i of %i\n", maxSubsteps, throwStep, numSteps);
+	int numFailed = 0;
+
+	// 64 spheres at rest on a floor, far enough apart not to touch
+	const auto build = [](Scene& scene)
+	{
+		const Vec3 floorPoints[2] = { Vec3(-30.0f, -30.0f, -1.0f), Vec3(30.0f, 30.0f, 0.0f) };
+		Body body;
+		body.position.Zero();
+		body.orientation = Quat(0, 0, 0, 1);
+		body.linearVelocity.Zero();
+		body.angularVelocity.Zero();
+		body.shape = new ShapeBox(floorPoints, 2);
+		body.inverseMass = 0.0f;
+		body.elasticity = 0.5f;
+		body.friction = 0.5f;
+		scene.bodies.push_back(body);
+		for (int i = 0; i < 64; ++i)
+		{
+			body.position = Vec3((float)(i % 8) * 1.25f - 4.0f, (float)(i / 8) * 1.25f - 4.0f, 0.5f);
+			body.shape = new ShapeSphere(0.5f);
+			body.inverseMass = 1.0f;
+			scene.bodies.push_back(body);
+		}
+	};
+	const auto throwBall = [](Scene& scene)
+	{
+		Body ball;
+		ball.position = Vec3(-12.0f, 0.3f, 0.5f);
+		ball.orientation = Quat(0, 0, 0, 1);
+		ball.linearVelocity = Vec3(80.0f, 0.0f, 0.0f);
+		ball.angularVelocity.Zero();
+		ball.shape = new ShapeSphere(0.5f);
+		ball.inverseMass = 0.5f;
+		ball.elasticity = 0.5f;
+		ball.friction = 0.5f;
+		scene.bodies.push_back(ball);
+	};
+
+	const Scene::SolverMode modes[3] = { Scene::SolverMode::TIME_OF_IMPACT, Scene::SolverMode::SPECULATIVE, Scene::SolverMode::XPBD };
+	const char* modeNames[3] = { "time of impact", "speculative", "xpbd" };
+	for (int mode = 0; mode < 3; ++mode)
+	{
+		// The worst case every step, then the controller. XPBD scales its own
+		// substeps, its worst case is the scene's substep count in one step.
+		Scene fixed;
+		fixed.SetSolverMode(modes[mode]);
+		build(fixed);
+		const int numFixed = modes[mode] == Scene::SolverMode::XPBD ? 1 : maxSubsteps;
+		Clock::time_point start = Clock::now();
+		for (int step = 0; step < numSteps; ++step)
+		{
+			if (step == throwStep) throwBall(fixed);
+			for (int i = 0; i < numFixed; ++i)
+			{
+				fixed.Update(dt / (float)numFixed);
+			}
+		}
+		const double fixedMs = ElapsedMs(start);
+
+		Scene adaptive;
+		adaptive.SetSolverMode(modes[mode]);
+		adaptive.SetAdaptiveSubsteps(true, maxSubsteps);
+		build(adaptive);
+		int numQuietSubsteps = 0;
+		int mostSubsteps = 0;
+		int totalSubsteps = 0;
+		float lowest = 1.0f;
+		start = Clock::now();
+		for (int step = 0; step < numSteps; ++step)
+		{
+			if (step == throwStep) throwBall(adaptive);
+			adaptive.Update(dt);
+			const int numSubsteps = adaptive.GetLastNumSubsteps();
+			totalSubsteps += numSubsteps;
+			mostSubsteps = std::max(mostSubsteps, numSubsteps);
+			numQuietSubsteps = std::max(numQuietSubsteps, step >= throwStep / 2 && step < throwStep ? numSubsteps : 0);
+		}
+		const double adaptiveMs = ElapsedMs(start);
+		for (int i = 1; i < (int)adaptive.bodies.size(); ++i)
+		{
+			lowest = std::min(lowest, adaptive.bodies[i].position.z);
+		}
+		printf("  %s: worst case %.2f ms per step, adaptive %.2f ms per step, %.2f substeps on average, at most %i\n",
+			modeNames[mode], fixedMs / numSteps, adaptiveMs / numSteps, (float)totalSubsteps / numSteps, mostSubsteps);
+
+		char name[64];
+		snprintf(name, sizeof(name), "%s, one substep when quiet", modeNames[mode]);
+		numFailed += Check(1 == numQuietSubsteps, name);
+		snprintf(name, sizeof(name), "%s, more for the impact", modeNames[mode]);
+		numFailed += Check(mostSubsteps > 1, name);
+		snprintf(name, sizeof(name), "%s, cheaper than the worst case", modeNames[mode]);
+		numFailed += Check(adaptiveMs < fixedMs, name);
+		snprintf(name, sizeof(name), "%s, nothing sinks into the floor", modeNames[mode]);
+		numFailed += Check(lowest > 0.4f, name);
+	}
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunProfilerBenchmark
+====================================================
+*/
+int RunProfilerBenchmark(const int numSteps)
+{
+	const char* traceName = "physics_profile.json";
+	JobSystem jobs(std::max((int)std::thread::hardware_concurrency() - 1, 1));
+	printf("Profiler, %i steps of the seeded scene over %i workers\n", numSteps, jobs.NumWorkers());
+	int numFailed = 0;
+
+#if PHYSICS_PROFILE
+	// What an event costs with the capture on, a zone and a counter in turns
+	// in a tight loop, the median of a few batches. Timing the steps with the
+	// capture off and on cannot tell this from how the machine varies.
+	const int numTimedEvents = 1 << 16;
+	std::vector<double> nsPerEvent;
+	for (int batch = 0; batch < 5; ++batch)
+	{
+		Profiler::BeginCapture();
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < numTimedEvents / 2; ++i)
+		{
+			PROFILE_ZONE("Profiler event cost");
+			PROFILE_COUNTER("Profiler event cost", i);
+		}
+		nsPerEvent.push_back(ElapsedMs(start) * 1.0e6 / numTimedEvents);
+		Profiler::EndCapture();
+	}
+	std::sort(nsPerEvent.begin(), nsPerEvent.end());
+	const double eventNs = nsPerEvent[nsPerEvent.size() / 2];
+#endif
+
+	// The same steps with the capture off and on, in turns so both see the
+	// machine alike, the fastest run of each counting
+	const auto run = [&](const bool isCapturing)
+	{
+		Scene scene;
+		scene.SetDeterministic(true, 1234);
+		scene.SetJobSystem(&jobs);
+		scene.Reset();
+		AddSphereGrid(scene);
+		if (isCapturing) Profiler::BeginCapture();
+		const Clock::time_point start = Clock::now();
+		for (int step = 0; step < numSteps; ++step)
+		{
+			scene.Update(1.0f / 120.0f);
+		}
+		const double ms = ElapsedMs(start);
+		if (isCapturing) Profiler::EndCapture();
+		return ms;
+	};
+	const int numRounds = 3;
+	std::vector<double> offRuns;
+	std::vector<double> onRuns;
+	for (int round = 0; round < numRounds; ++round)
+	{
+		offRuns.push_back(run(false));
+		onRuns.push_back(run(true));
+	}
+	std::sort(offRuns.begin(), offRuns.end());
+	std::sort(onRuns.begin(), onRuns.end());
+	const double offMs = offRuns[0];
+	const double onMs = onRuns[0];
+	printf("  capture off %.2f ms, on %.2f ms, %+.2f%%, as the machine allows, not checked\n", offMs, onMs, 100.0 * (onMs - offMs) / offMs);
+
+	Profiler::PrintZoneStats();
+	std::vector<ProfileZoneStats> stats;
+	Profiler::GetZoneStats(stats);
+#if PHYSICS_PROFILE
+	const auto hasZone = [&stats](const char* name)
+	{
+		return std::any_of(stats.begin(), stats.end(), [name](const ProfileZoneStats& zone) { return 0 == strcmp(zone.name, name); });
+	};
+	numFailed += Check(hasZone("Scene::Update") && hasZone("Broadphase") && hasZone("Narrow phase") && hasZone("Resolve impacts"), "every phase has its zone");
+
+	// The last run's events at the measured cost each, against the steps
+	const long long numEvents = Profiler::NumCapturedEvents();
+	const double captureCost = 100.0 * numEvents * eventNs * 1.0e-6 / offMs;
+	printf("  %lld events captured at %.1f ns each, %.4f%% of the steps\n", numEvents, eventNs, captureCost);
+	numFailed += Check(numEvents > 0 && captureCost < 1.0, "capture costs under 1% of the steps");
+#else
+	numFailed += Check(stats.empty(), "compiled out, nothing recorded");
+#endif
+
+	// The export has to be well formed JSON of trace events
+	numFailed += Check(Profiler::WriteChromeTrace(traceName), "chrome trace written");
+	FILE* file = fopen(traceName, "rb");
+	std::vector<char> text;
+	if (NULL != file)
+	{
+		fseek(file, 0, SEEK_END);
+		text.resize(ftell(file));
+		fseek(file, 0, SEEK_SET);
+		text.resize(fread(text.data(), 1, text.size(), file));
+		fclose(file);
+	}
+	int depth = 0;
+	bool isInString = false;
+	bool isBalanced = !text.empty();
+	for (size_t i = 0; i < text.size() && isBalanced; ++i)
+	{
+		const char c = text[i];
+		if (isInString) { isInString = c != '"' || text[i - 1] == '\\'; continue; }
+		if (c == '"') isInString = true;
+		if (c == '{' || c == '[') ++depth;
+		if (c == '}' || c == ']') isBalanced = --depth >= 0;
+	}
+	const std::string json(text.begin(), text.end());
+	numFailed += Check(isBalanced && 0 == depth && 0 == json.find("{\"displayTimeUnit\""), "trace is balanced JSON");
+#if PHYSICS_PROFILE
+	numFailed += Check(std::string::npos != json.find("\"ph\":\"X\"") && std::string::npos != json.find("\"name\":\"Contacts\",\"ph\":\"C\""), "trace has zones and counters");
+#endif
+	printf("  %s: %i bytes\n", traceName, (int)text.size());
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+Regression scenes
+Each is built the same way every run and stepped with a fixed seed; the
+hash of the final state is compared against the golden one
+====================================================
+*/
+static Body MakeBody(const Vec3& position, Shape* shape, const float inverseMass)
+{
+	Body body;
+	body.position = position;
+	body.orientation = Quat(0, 0, 0, 1);
+	body.linearVelocity.Zero();
+	body.angularVelocity.Zero();
+	body.shape = shape;
+	body.inverseMass = inverseMass;
+	body.elasticity = 0.5f;
+	body.friction = 0.5f;
+	return body;
+}
+
+static Shape* MakeBox(const Vec3& mins, const Vec3& maxs)
+{
+	const Vec3 points[2] = { mins, maxs };
+	return new ShapeBox(points, 2);
+}
+
+// The built in petanque throw
+static void BuildPetanque(Scene& scene)
+{
+	scene.Reset();
+}
+
+// 100 spheres dropped in a loose lattice onto a floor
+static void BuildSpherePile(Scene& scene)
+{
+	scene.bodies.push_back(MakeBody(Vec3(0, 0, 0), MakeBox(Vec3(-20, -20, -1), Vec3(20, 20, 0)), 0.0f));
+	for (int i = 0; i < 100; ++i)
+	{
+		const Vec3 jitter((float)(i * 7 % 11) * 0.01f, (float)(i * 5 % 13) * 0.01f, 0.0f);
+		const Vec3 position((float)(i % 5) * 1.1f - 2.5f, (float)(i / 5 % 5) * 1.1f - 2.5f, 1.0f + (float)(i / 25) * 1.1f);
+		scene.bodies.push_back(MakeBody(position + jitter, new ShapeSphere(0.5f), 1.0f));
+	}
+}
+
+// Small spheres fired at 200 m/s into a wall thinner than they travel in a step
+static void BuildTunnelling(Scene& scene)
+{
+	scene.bodies.push_back(MakeBody(Vec3(0, 0, 0), MakeBox(Vec3(0.0f, -5.0f, -5.0f), Vec3(0.05f, 5.0f, 5.0f)), 0.0f));
+	for (int i = 0; i < 50; ++i)
+	{
+		Body bullet = MakeBody(Vec3(-5.0f - (float)(i % 5), (float)(i / 5) * 0.8f - 3.6f, (float)(i % 5) * 0.5f), new ShapeSphere(0.05f), 10.0f);
+		bullet.linearVelocity = Vec3(200.0f, 0.0f, 0.0f);
+		scene.bodies.push_back(bullet);
+	}
+}
+
+static bool IsNothingThroughWall(const Scene& scene)
+{
+	return std::all_of(scene.bodies.begin() + 1, scene.bodies.end(), [](const Body& body) { return body.position.x < 0.0f; });
+}
+
+// 5 by 5 columns of 2 boxes resting on a floor, each box just touching the one below
+static void BuildRestingStack(Scene& scene)
+{
+	scene.bodies.push_back(MakeBody(Vec3(0, 0, 0), MakeBox(Vec3(-20, -20, -1), Vec3(20, 20, 0)), 0.0f));
+	Shape* box = MakeBox(Vec3(-0.5f, -0.5f, -0.5f), Vec3(0.5f, 0.5f, 0.5f));
+	for (int i = 0; i < 50; ++i)
+	{
+		const Vec3 position((float)(i % 5) * 1.25f - 3.0f, (float)(i / 5 % 5) * 1.25f - 3.0f, 0.5f + (float)(i / 25));
+		scene.bodies.push_back(MakeBody(position, box, 1.0f));
+	}
+}
+
+static bool IsAboveFloor(const Scene& scene)
+{
+	return std::all_of(scene.bodies.begin() + 1, scene.bodies.end(), [](const Body& body) { return body.position.z > 0.0f; });
+}
+
+/*
+====================================================
+RegressionCalibrationMs
+A fixed piece of work outside the engine, a sort and a float loop, the
+fastest of a few runs as the scenes are. Each run is long enough to span
+several of the scheduler's time slices, as a scene's run is. The budgets
+are kept in units of it so they follow the machine they are checked on,
+while a change that slows the engine down still shows against it.
+====================================================
+*/
+static volatile float g_calibrationSink;	// So the compiler cannot drop the calibration's work
+
+static double RegressionCalibrationMs()
+{
+	const int num = 1 << 19;
+	std::vector<float> values(num);
+	std::vector<double> runMs;
+	for (int run = 0; run < 5; ++run)
+	{
+		const Clock::time_point start = Clock::now();
+		unsigned int seed = 1234;
+		for (float& value : values)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			value = (float)(seed >> 8);
+		}
+		std::sort(values.begin(), values.end());
+
+		Vec3 sum(0.0f);
+		for (int i = 0; i + 2 < num; ++i)
+		{
+			Vec3 v(values[i], values[i + 1], values[i + 2]);
+			v.Normalize();
+			sum += v.Cross(sum) * 0.5f + v;
+		}
+		g_calibrationSink = sum.x;
+		runMs.push_back(ElapsedMs(start));
+	}
+	return *std::min_element(runMs.begin(), runMs.end());
+}
+
+struct RegressionScene
+{
+	const char* name;
+	int numSteps;
+	void (*build)(Scene& scene);
+	bool (*check)(const Scene& scene);	// What the scene is there to show, beside its hash
+	bool isCheckedWithTimeOfImpact;		// Time of impact resolves a contact at a time and cannot hold a stack up
+};
+
+/*
+====================================================
+ReadRegressionFile
+"scene solver value" lines, # starts a comment
+====================================================
+*/
+static std::vector<std::pair<std::string, std::string>> ReadRegressionFile(const char* fileName)
+{
+	std::vector<std::pair<std::string, std::string>> entries;
+	FILE* file = fopen(fileName, "rb");
+	if (NULL == file) return entries;
+
+	char line[256];
+	while (NULL != fgets(line, sizeof(line), file))
+	{
+		char scene[64];
+		char solver[64];
+		char value[64];
+		if ('#' == line[0] || 3 != sscanf(line, "%63s %63s %63s", scene, solver, value)) continue;
+		entries.push_back(std::make_pair(std::string(scene) + " " + solver, std::string(value)));
+	}
+	fclose(file);
+	return entries;
+}
+
+/*
+====================================================
+RunRegressionSuite
+====================================================
+*/
+int RunRegressionSuite(const bool isUpdating)
+{
+	const char* goldenName = "data/regression/golden.txt";
+	const char* budgetName = "data/regression/budgets.txt";
+	const float budgetMargin = 2.0f;
+	const float budgetSlackMs = 0.05f;	// So scenes that take next to nothing do not fail on timer noise
+	const double calibrationMs = RegressionCalibrationMs();
+	const int numRuns = 3;
+
+	const RegressionScene scenes[] =
+	{
+		{ "petanque", 600, BuildPetanque, NULL, true },
+		{ "pile", 120, BuildSpherePile, IsAboveFloor, true },
+		{ "tunnelling", 60, BuildTunnelling, IsNothingThroughWall, true },
+		{ "stack", 60, BuildRestingStack, IsAboveFloor, false },
+	};
+	const Scene::SolverMode modes[3] = { Scene::SolverMode::TIME_OF_IMPACT, Scene::SolverMode::SPECULATIVE, Scene::SolverMode::XPBD };
+	const char* modeNames[3] = { "toi", "speculative", "xpbd" };
+
+	const std::vector<std::pair<std::string, std::string>> golden = ReadRegressionFile(goldenName);
+	const std::vector<std::pair<std::string, std::string>> budgets = ReadRegressionFile(budgetName);
+	const auto find = [](const std::vector<std::pair<std::string, std::string>>& entries, const std::string& key)
+	{
+		for (const std::pair<std::string, std::string>& entry : entries)
+		{
+			if (entry.first == key) return entry.second.c_str();
+		}
+		return (const char*)NULL;
+	};
+	if (!isUpdating && (golden.empty() || budgets.empty()))
+	{
+		printf("ERROR: Unable to read %s and %s, run from the project directory or with -regression update\n", goldenName, budgetName);
+		return 1;
+	}
+
+	printf(isUpdating ? "Regression suite, updating the golden hashes and budgets\n" : "Regression suite\n");
+	printf("  calibration %.3f ms, the budgets are in units of it\n", calibrationMs);
+	printf("  %-24s %16s %16s %10s %10s\n", "scene", "hash", "golden", "ms/step", "budget");
+	int numFailed = 0;
+	std::string goldenText = "# Final step hashes of the regression scenes, written by -regression update\n# scene solver hash\n";
+	std::string budgetText =
+		"# The time a step of each regression scene may take, written by -regression update at 2\n"
+		"# times the fastest of 3 runs. In units of the calibration run, a sort and a float loop\n"
+		"# outside the engine timed in the same process, so a slower machine gets longer budgets. A\n"
+		"# step may take 0.05 ms over them for timer noise. The units still differ between compilers,\n"
+		"# build flags and kinds of CPU; when the budgets fail on every scene of a machine, run\n"
+		"# -regression update there in a release build and check in the budgets with the change that\n"
+		"# needed them.\n"
+		"# scene solver units\n";
+	for (const RegressionScene& regression : scenes)
+	{
+		for (int mode = 0; mode < 3; ++mode)
+		{
+			// The fastest of a few runs, every one of which has to step the same
+			double msPerStep = 1.0e30;
+			unsigned long long hash = 0;
+			bool isBehaving = true;
+			for (int run = 0; run < numRuns; ++run)
+			{
+				Scene scene;
+				scene.SetDeterministic(true, 1234);
+				scene.SetSolverMode(modes[mode]);
+				regression.build(scene);
+
+				const Clock::time_point start = Clock::now();
+				for (int step = 0; step < regression.numSteps; ++step)
+				{
+					scene.Update(1.0f / 120.0f);
+				}
+				msPerStep = std::min(msPerStep, ElapsedMs(start) / regression.numSteps);
+				// A run that strays from the ones before it matches no golden hash
+				hash = 0 == run || scene.GetStepHash() == hash ? scene.GetStepHash() : 0;
+				isBehaving = isBehaving && (NULL == regression.check || regression.check(scene));
+			}
+
+			const std::string key = std::string(regression.name) + " " + modeNames[mode];
+			char line[128];
+			snprintf(line, sizeof(line), "%s %016llx\n", key.c_str(), hash);
+			goldenText += line;
+			snprintf(line, sizeof(line), "%s %.6f\n", key.c_str(), msPerStep * budgetMargin / calibrationMs);
+			budgetText += line;
+
+			const char* goldenHash = find(golden, key);
+			const char* budget = find(budgets, key);
+			const double budgetMs = NULL != budget ? atof(budget) * calibrationMs + budgetSlackMs : 0.0;
+			printf("  %-24s %016llx %16s %10.3f %10.3f\n", key.c_str(), hash, NULL != goldenHash ? goldenHash : "-", msPerStep, budgetMs);
+
+			if (NULL != regression.check && (regression.isCheckedWithTimeOfImpact || modes[mode] != Scene::SolverMode::TIME_OF_IMPACT))
+			{
+				numFailed += Check(isBehaving, (key + ", behaves").c_str());
+			}
+			if (!isUpdating)
+			{
+				numFailed += Check(NULL != goldenHash && strtoull(goldenHash, NULL, 16) == hash, (key + ", same trajectory").c_str());
+				numFailed += Check(NULL != budget && msPerStep <= budgetMs, (key + ", within budget").c_str());
+			}
+		}
+	}
+
+	if (isUpdating)
+	{
+		FILE* goldenFile = fopen(goldenName, "wb");
+		FILE* budgetFile = fopen(budgetName, "wb");
+		const bool isWritten = NULL != goldenFile && NULL != budgetFile
+			&& 1 == fwrite(goldenText.data(), goldenText.size(), 1, goldenFile) && 1 == fwrite(budgetText.data(), budgetText.size(), 1, budgetFile);
+		if (NULL != goldenFile) fclose(goldenFile);
+		if (NULL != budgetFile) fclose(budgetFile);
+		numFailed += Check(isWritten, "golden hashes and budgets written");
+	}
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunAsyncReadBenchmark
+Files read one after the other and then through the async reader, each
+hashed whole as it arrives in place of decoding it
+====================================================
+*/
+int RunAsyncReadBenchmark(const int numFiles)
+{
+	const size_t baseSize = 256 * 1024;
+	printf("Async file reads, %i files of %i KB and up\n", numFiles, (int)(baseSize / 1024));
+
+	auto fileName = [](const int i)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "benchmark_read_%i.bin", i);
+		return std::string(name);
+	};
+	auto hash = [](const FileView& file)
+	{
+		unsigned long long h = 14695981039346656037ull;
+		for (size_t i = 0; i < file.Size(); ++i)
+		{
+			h = (h ^ file.Data()[i]) * 1099511628211ull;
+		}
+		return h;
+	};
+
+	int numFailed = 0;
+	bool isWritten = true;
+	unsigned int seed = 1;
+	for (int i = 0; i < numFiles; ++i)
+	{
+		std::vector<unsigned char> bytes(baseSize + i * 4096);
+		for (unsigned char& byte : bytes)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			byte = (unsigned char)(seed >> 24);
+		}
+		FILE* file = fopen(fileName(i).c_str(), "wb");
+		isWritten = isWritten && NULL != file && 1 == fwrite(bytes.data(), bytes.size(), 1, file);
+		if (NULL != file) fclose(file);
+	}
+	numFailed += Check(isWritten, "files written");
+
+	// The caches are warm from writing, so this is the CPU side of the reads and not the disk
+	std::vector<unsigned long long> serialHashes(numFiles);
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < numFiles; ++i)
+	{
+		FileView file;
+		serialHashes[i] = file.Open(fileName(i).c_str()) ? hash(file) : 0;
+	}
+	const double serialMs = ElapsedMs(start);
+
+	// io_uring where the system has it, then the thread pool it falls back to
+	const AsyncFileReader::Backend backends[2] = { AsyncFileReader::Backend::IO_URING, AsyncFileReader::Backend::THREADS };
+	for (const AsyncFileReader::Backend backend : backends)
+	{
+		AsyncFileReader reader(4, backend);
+		const bool isRing = AsyncFileReader::Backend::IO_URING == reader.GetBackend();
+		if (backend != reader.GetBackend())
+		{
+			printf("  io_uring cannot be set up here, so the reader falls back to the thread pool\n");
+		}
+		const std::string backendName = isRing ? "io_uring" : "thread pool";
+
+		std::vector<unsigned long long> asyncHashes(numFiles);
+		bool isOnCaller = true;
+		const std::thread::id caller = std::this_thread::get_id();
+		start = Clock::now();
+		for (int i = 0; i < numFiles; ++i)
+		{
+			reader.Read(fileName(i).c_str(), [&, i](FileView& file)
+			{
+				asyncHashes[i] = file.IsOpen() ? hash(file) : 0;
+				isOnCaller = isOnCaller && std::this_thread::get_id() == caller;
+			});
+		}
+		reader.Wait();
+		const double asyncMs = ElapsedMs(start);
+		printf("  read and hash: %.2f ms one by one, %.2f ms async through the %s\n", serialMs, asyncMs, backendName.c_str());
+
+		numFailed += Check(serialHashes == asyncHashes && 0 == reader.NumOutstanding(), (backendName + ", reads match reading in turn").c_str());
+		numFailed += Check(isOnCaller, (backendName + ", completions on the waiter").c_str());
+
+		// A missing file completes unopened, and reads queued by a completion are waited on too
+		bool isMissingClosed = false;
+		bool isChainedRead = false;
+		reader.Read("benchmark_read_missing.bin", [&](FileView& file)
+		{
+			isMissingClosed = !file.IsOpen();
+			reader.Read(fileName(0).c_str(), [&](FileView& chained) { isChainedRead = chained.IsOpen() && hash(chained) == serialHashes[0]; });
+		});
+		reader.Wait();
+		numFailed += Check(isMissingClosed && isChainedRead, (backendName + ", missing and chained reads").c_str());
+
+		// Moved out of the completion, the view outlives the read
+		FileView kept;
+		reader.Read(fileName(numFiles - 1).c_str(), [&](FileView& file) { kept = std::move(file); });
+		while (0 == reader.Poll())
+		{
+			std::this_thread::yield();
+		}
+		numFailed += Check(kept.IsOpen() && hash(kept) == serialHashes[numFiles - 1], (backendName + ", views kept past completion").c_str());
+		kept.Close();
+
+		// Reads still queued when the reader goes are dropped, and ones in flight are seen out
+		for (int i = 0; i < numFiles; ++i)
+		{
+			reader.Read(fileName(i).c_str(), [](FileView&) {});
+		}
+	}
+
+	for (int i = 0; i < numFiles; ++i)
+	{
+		remove(fileName(i).c_str());
+	}
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunMemoryBenchmark
+====================================================
+*/
+int RunMemoryBenchmark(const int numSteps)
+{
+	const char* jsonName = "memory.json";
+	JobSystem jobs(std::max((int)std::thread::hardware_concurrency() - 1, 1));
+	printf("Memory, %i steps of the seeded scene over %i workers\n", numSteps, jobs.NumWorkers());
+	int numFailed = 0;
+
+	// Explicit counts are for memory operator new never sees, such as Vulkan's
+	const MemoryTagStats gpuBefore = MemoryTracker::GetStats(MemoryTag::GPU_BUFFERS);
+	MemoryTracker::Allocate(MemoryTag::GPU_BUFFERS, 1 << 20);
+	const MemoryTagStats gpuDuring = MemoryTracker::GetStats(MemoryTag::GPU_BUFFERS);
+	MemoryTracker::Free(MemoryTag::GPU_BUFFERS, 1 << 20);
+	const MemoryTagStats gpuAfter = MemoryTracker::GetStats(MemoryTag::GPU_BUFFERS);
+	numFailed += Check(gpuDuring.currentBytes - gpuBefore.currentBytes == 1 << 20 && gpuAfter.currentBytes == gpuBefore.currentBytes && gpuDuring.peakBytes >= 1 << 20, "explicit allocations counted");
+
+#if PHYSICS_MEMORY_TRACKING
+	// Jobs allocate under the tag of the thread that made them
+	{
+		const MemoryTagStats before = MemoryTracker::GetStats(MemoryTag::SCRATCH);
+		ScopedMemoryTag tag(MemoryTag::SCRATCH);
+		std::atomic<char*> escaped(nullptr);
+		jobs.ParallelFor(0, 64, [&escaped](const int begin, const int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				std::vector<char> bytes(1000);
+				escaped.store(bytes.data());
+			}
+		}, 1);
+		const MemoryTagStats after = MemoryTracker::GetStats(MemoryTag::SCRATCH);
+		numFailed += Check(after.numAllocations - before.numAllocations >= 64 && after.currentBytes == before.currentBytes, "job allocations keep their tag");
+	}
+#endif
+
+	const Scene::SolverMode modes[3] = { Scene::SolverMode::TIME_OF_IMPACT, Scene::SolverMode::SPECULATIVE, Scene::SolverMode::XPBD };
+	const char* modeNames[3] = { "toi", "speculative", "xpbd" };
+	std::string json;
+	for (int mode = 0; mode < 3; ++mode)
+	{
+		const MemoryTagStats empty = MemoryTracker::GetStats(MemoryTag::PHYSICS);
+		long long numSteadyAllocations = 0;
+		{
+			Scene scene;
+			scene.SetDeterministic(true, 1234);
+			scene.SetSolverMode(modes[mode]);
+			scene.SetJobSystem(&jobs);
+			{
+				ScopedMemoryTag tag(MemoryTag::PHYSICS);
+				scene.Reset();
+				AddSphereGrid(scene);
+			}
+			const MemoryTagStats built = MemoryTracker::GetStats(MemoryTag::PHYSICS);
+
+			// The first steps grow the step's buffers to the scene, two seconds
+			// lets the pile land and settle, after that it must not allocate
+			for (int step = 0; step < 240; ++step)
+			{
+				scene.Update(1.0f / 120.0f);
+			}
+			MemoryTracker::ResetPeaks();
+			MemorySnapshot steady;
+			MemoryTracker::Snapshot(steady);
+			MemoryTracker::SetHotLoopCheck(MemoryTracker::HotLoopCheck::REPORT);
+			const int numViolations = MemoryTracker::NumHotLoopViolations();
+			for (int step = 0; step < numSteps; ++step)
+			{
+				scene.Update(1.0f / 120.0f);
+			}
+			MemoryTracker::SetHotLoopCheck(MemoryTracker::HotLoopCheck::OFF);
+			numSteadyAllocations = MemoryTracker::GetStats(MemoryTag::PHYSICS).numAllocations - steady.tags[(int)MemoryTag::PHYSICS].numAllocations;
+
+			printf(" %s: scene %.1f KB, %.2f physics allocations per step, %i steps reported\n", modeNames[mode], (built.currentBytes - empty.currentBytes) / 1024.0,
+				(double)numSteadyAllocations / numSteps, MemoryTracker::NumHotLoopViolations() - numViolations);
+			MemoryTracker::PrintStats(&steady);
+			json += std::string(0 == mode ? "{" : ",") + "\n\"" + modeNames[mode] + "\":" + MemoryTracker::ToJson(&steady);
+		}
+#if PHYSICS_MEMORY_TRACKING
+		const std::string steadyName = std::string(modeNames[mode]) + ", settled steps do not allocate";
+		numFailed += Check(0 == numSteadyAllocations, steadyName.c_str());
+		const std::string name = std::string(modeNames[mode]) + ", all freed with the scene";
+		numFailed += Check(MemoryTracker::GetStats(MemoryTag::PHYSICS).currentBytes == empty.currentBytes, name.c_str());
+#endif
+	}
+	json += "}\n";
+
+	FILE* file = fopen(jsonName, "wb");
+	const bool isWritten = NULL != file && 1 == fwrite(json.data(), json.size(), 1, file);
+	if (NULL != file) fclose(file);
+	numFailed += Check(isWritten, "figures written as JSON");
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+Precision scenes
+Built and stepped the same way as float and as double. The double run is
+the reference: how far float strays from it is what float costs, how far
+double strays from what must be kept is the integrator's own error.
+====================================================
+*/
+template <typename T>
+static BodyT<T> MakeBodyT(const Vec3T<T>& position, Shape* shape, const T inverseMass)
+{
+	BodyT<T> body;
+	body.position = position;
+	body.orientation = QuatT<T>(0, 0, 0, 1);
+	body.linearVelocity.Zero();
+	body.angularVelocity.Zero();
+	body.shape = shape;
+	body.inverseMass = inverseMass;
+	body.elasticity = T(0.5);
+	body.friction = T(0.5);
+	return body;
+}
+
+template <typename T>
+static Mat3T<T> InertiaTensorWorldSpace(const BodyT<T>& body)
+{
+	const Mat3T<T> orientation = body.orientation.ToMat3();
+	return orientation * Mat3T<T>(body.shape->InertiaTensor()) * orientation.Transpose() * (T(1) / body.inverseMass);
+}
+
+// Spheres only, the contact as Intersections makes it for two that touch at rest
+template <typename T>
+static bool SphereContact(BodyT<T>& a, BodyT<T>& b, ContactT<T>& contact)
+{
+	const T radiusA = T(static_cast<const ShapeSphere*>(a.shape)->radius);
+	const T radiusB = T(static_cast<const ShapeSphere*>(b.shape)->radius);
+	const Vec3T<T> ab = b.position - a.position;
+	const T distance = ab.GetMagnitude();
+	if (distance > radiusA + radiusB) return false;
+
+	contact.a = &a;
+	contact.b = &b;
+	contact.normal = ab / distance;
+	contact.ptOnAWorldSpace = a.position + contact.normal * radiusA;
+	contact.ptOnBWorldSpace = b.position - contact.normal * radiusB;
+	contact.separationDistance = distance - radiusA - radiusB;
+	contact.timeOfImpact = T(0);
+	return true;
+}
+
+// Gravity, every touching pair resolved, then the bodies moved, as the time of impact step does with no time to impact
+template <typename T>
+static void StepPile(std::vector<BodyT<T>>& bodies, std::vector<ContactT<T>>& contacts, const T dt)
+{
+	for (BodyT<T>& body : bodies)
+	{
+		if (T(0) == body.inverseMass) continue;
+		body.ApplyImpulseLinear(Vec3T<T>(0, 0, -10) * (T(1) / body.inverseMass) * dt);
+	}
+
+	contacts.clear();
+	ContactT<T> contact;
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		for (size_t j = i + 1; j < bodies.size(); ++j)
+		{
+			if (SphereContact(bodies[i], bodies[j], contact)) contacts.push_back(contact);
+		}
+	}
+	for (ContactT<T>& touching : contacts)
+	{
+		ContactT<T>::ResolveContact(touching);
+	}
+
+	for (BodyT<T>& body : bodies)
+	{
+		body.Update(dt);
+	}
+}
+
+struct PrecisionSample
+{
+	Quatd orientation;				// Of the tumbling box
+	Vec3d angularMomentum;			// Of the tumbling box, nothing acts on it to change this
+	std::vector<Vec3d> positions;	// Of the pile's spheres
+	double energy;					// Of the pile, which its contacts only ever take away from
+};
+
+template <typename T>
+static void Sample(const BodyT<T>& tumbler, const std::vector<BodyT<T>>& pile, PrecisionSample& sample)
+{
+	sample.orientation = Quatd(tumbler.orientation);
+	sample.angularMomentum = Vec3d(InertiaTensorWorldSpace(tumbler) * tumbler.angularVelocity);
+	sample.positions.clear();
+	sample.energy = 0.0;
+	for (const BodyT<T>& body : pile)
+	{
+		sample.positions.push_back(Vec3d(body.position));
+		if (T(0) == body.inverseMass) continue;
+		const Vec3d velocity(body.linearVelocity);
+		const Vec3d angularVelocity(body.angularVelocity);
+		const double mass = 1.0 / (double)body.inverseMass;
+		sample.energy += 0.5 * mass * velocity.GetLengthSqr() + 0.5 * angularVelocity.Dot(Mat3d(InertiaTensorWorldSpace(body)) * angularVelocity) + mass * 10.0 * body.position.z;
+	}
+}
+
+/*
+====================================================
+RunPrecisionScenes
+A 1 x 2 x 3 box spun about its middle axis, which is unstable and flips it
+over and over, and 20 spheres dropped in a column onto a large fixed one,
+which they bounce and roll off. Sampled every interval steps and at the end.
+====================================================
+*/
+template <typename T>
+static double RunPrecisionScenes(const int numSteps, const int interval, std::vector<PrecisionSample>& samples)
+{
+	const Vec3 boxPoints[2] = { Vec3(-0.5f, -1.0f, -1.5f), Vec3(0.5f, 1.0f, 1.5f) };
+	ShapeBox box(boxPoints, 2);
+	ShapeSphere ground(1000.0f);
+	ShapeSphere ball(0.5f);
+
+	BodyT<T> tumbler = MakeBodyT<T>(Vec3T<T>(0, 0, 0), &box, T(1));
+	tumbler.angularVelocity = Vec3T<T>(T(0.01), T(4), T(0));
+
+	std::vector<BodyT<T>> pile;
+	pile.push_back(MakeBodyT<T>(Vec3T<T>(0, 0, -1000), &ground, T(0)));
+	for (int i = 0; i < 20; ++i)
+	{
+		const Vec3T<T> position(T(i * 7 % 11) * T(0.01), T(i * 5 % 13) * T(0.01), T(1) + T(i) * T(1.1));
+		pile.push_back(MakeBodyT<T>(position, &ball, T(1)));
+	}
+	std::vector<ContactT<T>> contacts;
+	contacts.reserve(pile.size() * pile.size());
+
+	samples.clear();
+	const T dt = T(1) / T(120);
+	const Clock::time_point start = Clock::now();
+	for (int step = 0; step <= numSteps; ++step)
+	{
+		if (0 == step % interval || numSteps == step)
+		{
+			samples.emplace_back();
+			Sample(tumbler, pile, samples.back());
+		}
+		if (numSteps == step) break;
+
+		tumbler.Update(dt);
+		StepPile(pile, contacts, dt);
+	}
+	return ElapsedMs(start);
+}
+
+/*
+====================================================
+RunPrecisionBenchmark
+====================================================
+*/
+int RunPrecisionBenchmark(const int numSteps)
+{
+	const int interval = std::max(numSteps / 10, 1);
+	printf("Precision, %i steps at 120 Hz in float and in double\n", numSteps);
+	int numFailed = 0;
+
+	std::vector<PrecisionSample> singles;
+	std::vector<PrecisionSample> doubles;
+	const double floatMs = RunPrecisionScenes<float>(numSteps, interval, singles);
+	const double doubleMs = RunPrecisionScenes<double>(numSteps, interval, doubles);
+	printf("  float %.2f ms, double %.2f ms, double costs %.2fx\n", floatMs, doubleMs, doubleMs / floatMs);
+
+	// Drift of each against the start, and of float against double
+	const PrecisionSample& first = doubles.front();
+	const double momentum = first.angularMomentum.GetMagnitude();
+	printf("  %6s %14s %14s %14s %14s %14s %14s\n", "step", "L drift f", "L drift d", "turn f-d rad", "pile f-d m", "energy f J", "energy d J");
+	double maxTurn = 0.0;
+	double maxOffset = 0.0;
+	double maxMomentumGap = 0.0;
+	std::vector<double> turns;
+	std::vector<double> offsets;
+	for (size_t i = 0; i < doubles.size(); ++i)
+	{
+		const PrecisionSample& single = singles[i];
+		const PrecisionSample& reference = doubles[i];
+		const Quatd between = single.orientation * reference.orientation.Inverse();
+		const double turn = 2.0 * atan2(between.xyz().GetMagnitude(), fabs(between.w));
+		double offset = 0.0;
+		for (size_t body = 0; body < reference.positions.size(); ++body)
+		{
+			offset = std::max(offset, (single.positions[body] - reference.positions[body]).GetMagnitude());
+		}
+		turns.push_back(turn);
+		offsets.push_back(offset);
+		maxTurn = std::max(maxTurn, turn);
+		maxOffset = std::max(maxOffset, offset);
+
+		const double singleDrift = (single.angularMomentum - first.angularMomentum).GetMagnitude() / momentum;
+		const double referenceDrift = (reference.angularMomentum - first.angularMomentum).GetMagnitude() / momentum;
+		maxMomentumGap = std::max(maxMomentumGap, fabs(singleDrift - referenceDrift));
+
+		printf("  %6i %14.3e %14.3e %14.3e %14.3e %14.4f %14.4f\n", std::min((int)i * interval, numSteps), singleDrift, referenceDrift, turn, offset, single.energy, reference.energy);
+	}
+	printf("  float strays from double by up to %.3e rad and %.3e m\n", maxTurn, maxOffset);
+
+	numFailed += Check(turns.front() < 1.0e-6 && offsets.front() < 1.0e-5, "both start from the same state");
+	numFailed += Check(maxMomentumGap < 1.0e-4, "float adds nothing to the momentum drift");
+	numFailed += Check(doubles.back().energy <= first.energy + 1.0e-6 * fabs(first.energy), "double pile gains no energy");
+	numFailed += Check(std::all_of(singles.begin(), singles.end(), [](const PrecisionSample& sample) { return sample.orientation.IsValid() && sample.energy == sample.energy; }), "float stays finite");
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+RunParticlesBenchmark
+A block of particles dropped on the floor and stepped until it settles, on
+this thread and over the job system. The grid is built on one thread, so
+both run the same sums in the same order and have to agree to the bit.
+====================================================
+*/
+int RunParticlesBenchmark(const int numParticles)
+{
+	const int numSteps = 240;	// Two seconds at 120 Hz
+	const float dt = 1.0f / 120.0f;
+	const float radius = 0.1f;
+
+	JobSystem jobs;
+	printf("Particles, %i for %i steps, %i workers\n", numParticles, numSteps, jobs.NumWorkers());
+	int numFailed = 0;
+
+	ParticleSystem serial;
+	serial.AddBlock(numParticles, radius, Vec3(0, 0, 0.5f));
+	ParticleSystem parallel = serial;
+	parallel.SetJobSystem(&jobs);
+
+	const auto meanHeight = [](const ParticleSystem& system)
+	{
+		double sum = 0.0;
+		for (const Particle& particle : system.particles)
+		{
+			sum += particle.position.z;
+		}
+		return sum / std::max((int)system.particles.size(), 1);
+	};
+	const double startHeight = meanHeight(serial);
+
+	Clock::time_point start = Clock::now();
+	for (int step = 0; step < numSteps; ++step)
+	{
+		serial.Update(dt);
+	}
+	const double serialMs = ElapsedMs(start);
+
+	start = Clock::now();
+	for (int step = 0; step < numSteps; ++step)
+	{
+		parallel.Update(dt);
+	}
+	const double parallelMs = ElapsedMs(start);
+
+	const double endHeight = meanHeight(parallel);
+	printf("  serial %.3f ms per step, parallel %.3f ms per step, %.1f ns per particle\n", serialMs / numSteps, parallelMs / numSteps, parallelMs * 1.0e6 / numSteps / numParticles);
+	printf("  mean height %.4f m to %.4f m, %i contacts at rest\n", startHeight, endHeight, parallel.NumContacts());
+
+	const bool isSame = 0 == memcmp(serial.particles.data(), parallel.particles.data(), sizeof(Particle) * serial.particles.size());
+	const bool isAboveFloor = std::all_of(parallel.particles.begin(), parallel.particles.end(), [](const Particle& particle) { return particle.position.z >= particle.radius - 1.0e-5f && particle.position.IsValid(); });
+	numFailed += Check(isSame, "parallel matches serial to the bit");
+	numFailed += Check(isAboveFloor, "nothing falls through the floor");
+	numFailed += Check(endHeight < startHeight && endHeight > 2.0 * radius && parallel.NumContacts() > 0, "the block falls and piles up");
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+Scene query brute force
+Every body tested the way SceneQuery tests it, spheres exactly and other
+shapes by their bounds, with no tree to cull any of them
+====================================================
+*/
+static bool BruteRayBody(const Body& body, const RayQuery& ray, float& t)
+{
+	if (body.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE)
+	{
+		float t0 = 0.0f;
+		float t1 = 0.0f;
+		const float radius = static_cast<const ShapeSphere*>(body.shape)->radius;
+		if (!Intersections::RaySphere(ray.rayStart, ray.rayDir, body.position, radius, t0, t1) || t1 < 0.0f || t0 > ray.maxT) return false;
+		t = std::max(t0, 0.0f);
+		return true;
+	}
+
+	const Bounds bounds = body.shape->GetBounds(body.position, body.orientation);
+	float tEnter = 0.0f;
+	float tExit = ray.maxT;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (ray.rayDir[i] == 0.0f)
+		{
+			if (ray.rayStart[i] < bounds.mins[i] || ray.rayStart[i] > bounds.maxs[i]) return false;
+			continue;
+		}
+		const float t0 = (bounds.mins[i] - ray.rayStart[i]) / ray.rayDir[i];
+		const float t1 = (bounds.maxs[i] - ray.rayStart[i]) / ray.rayDir[i];
+		tEnter = std::max(tEnter, std::min(t0, t1));
+		tExit = std::min(tExit, std::max(t0, t1));
+	}
+	t = tEnter;
+	return tEnter <= tExit;
+}
+
+static bool BruteOverlapSphere(const Body& body, const Vec3& center, const float radius)
+{
+	if (body.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE)
+	{
+		const float r = static_cast<const ShapeSphere*>(body.shape)->radius + radius;
+		return (body.position - center).GetLengthSqr() <= r * r;
+	}
+
+	const Bounds bounds = body.shape->GetBounds(body.position, body.orientation);
+	float distSqr = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		const float d = center[i] - std::min(std::max(center[i], bounds.mins[i]), bounds.maxs[i]);
+		distSqr += d * d;
+	}
+	return distSqr <= radius * radius;
+}
+
+/*
+====================================================
+RunQueryBenchmark
+====================================================
+*/
+int RunQueryBenchmark(const int numBodies)
+{
+	const int numQueries = 2000;
+	JobSystem jobs(std::max((int)std::thread::hardware_concurrency() - 1, 1));
+	printf("Scene queries, %i bodies, %i queries of each kind, %i workers\n", numBodies, numQueries, jobs.NumWorkers());
+	int numFailed = 0;
+
+	// Spheres and boxes of a few sizes strewn over the floor of Initialize
+	Scene scene;
+	scene.Reset();
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> across(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> up(0.0f, 20.0f);
+	for (int i = 0; i < numBodies; ++i)
+	{
+		Body body;
+		body.position = Vec3(across(random), across(random), up(random));
+		body.orientation = Quat(0, 0, 0, 1);
+		body.linearVelocity = Vec3(0, 0, 0);
+		body.angularVelocity = Vec3(0, 0, 0);
+		const float size = 0.2f + 0.1f * (float)(i % 4);
+		if (i % 3 == 0)
+		{
+			const Vec3 corners[2] = { Vec3(-size), Vec3(size) };
+			body.shape = new ShapeBox(corners, 2);
+		}
+		else
+		{
+			body.shape = new ShapeSphere(size);
+		}
+		body.inverseMass = 1.0f;
+		body.elasticity = 0.5f;
+		body.friction = 0.5f;
+		scene.bodies.push_back(body);
+	}
+	const int numAll = (int)scene.bodies.size();
+
+	Clock::time_point start = Clock::now();
+	const SceneQuery& query = scene.GetQuery();
+	const double buildMs = ElapsedMs(start);
+
+	// Rays from above the scene into it, in every direction, and spheres inside it
+	std::vector<RayQuery> rays(numQueries);
+	std::vector<Vec3> centers(numQueries);
+	std::vector<float> radii(numQueries);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (int i = 0; i < numQueries; ++i)
+	{
+		rays[i].rayStart = Vec3(across(random), across(random), up(random) + 10.0f);
+		rays[i].rayDir = Vec3(unit(random), unit(random), unit(random) - 0.5f);
+		rays[i].rayDir.Normalize();
+		rays[i].maxT = 60.0f;
+		centers[i] = Vec3(across(random), across(random), up(random));
+		radii[i] = 0.5f + 2.0f * (unit(random) + 1.0f);
+	}
+
+	// Closest hits, the tree's against every body's
+	std::vector<RayHit> hits(numQueries);
+	int numClosestWrong = 0;
+	int numHits = 0;
+	start = Clock::now();
+	for (int i = 0; i < numQueries; ++i)
+	{
+		query.RayCastClosest(rays[i], hits[i]);
+	}
+	const double rayMs = ElapsedMs(start);
+	start = Clock::now();
+	for (int i = 0; i < numQueries; ++i)
+	{
+		float closest = rays[i].maxT;
+		int closestId = -1;
+		for (int id = 0; id < numAll; ++id)
+		{
+			float t = 0.0f;
+			if (BruteRayBody(scene.bodies[id], rays[i], t) && (closestId < 0 || t < closest))
+			{
+				closest = t;
+				closestId = id;
+			}
+		}
+
+		// Bodies hit at the same distance may come back in either order
+		float hitT = 0.0f;
+		const bool isSame = closestId < 0 ? hits[i].bodyId < 0 :
+			hits[i].bodyId >= 0 && fabsf(hits[i].t - closest) <= 1.0e-4f * (1.0f + closest) && BruteRayBody(scene.bodies[hits[i].bodyId], rays[i], hitT) && fabsf(hitT - hits[i].t) <= 1.0e-4f * (1.0f + closest);
+		numClosestWrong += isSame ? 0 : 1;
+		numHits += closestId < 0 ? 0 : 1;
+	}
+	const double bruteRayMs = ElapsedMs(start);
+	numFailed += Check(0 == numClosestWrong && numHits > 0, "closest hits match brute force");
+
+	// Every hit along each ray, front to back
+	int numAllWrong = 0;
+	std::vector<std::vector<RayHit>> allHitsPerRay(numQueries);
+	std::vector<int> ids;
+	std::vector<int> bruteIds;
+	for (int i = 0; i < numQueries; ++i)
+	{
+		std::vector<RayHit>& allHits = allHitsPerRay[i];
+		query.RayCastAll(rays[i], allHits);
+		const bool isSorted = std::is_sorted(allHits.begin(), allHits.end(), [](const RayHit& a, const RayHit& b) { return a.t < b.t; });
+		ids.clear();
+		for (const RayHit& hit : allHits)
+		{
+			ids.push_back(hit.bodyId);
+		}
+		bruteIds.clear();
+		for (int id = 0; id < numAll; ++id)
+		{
+			float t = 0.0f;
+			if (BruteRayBody(scene.bodies[id], rays[i], t)) bruteIds.push_back(id);
+		}
+		std::sort(ids.begin(), ids.end());
+		numAllWrong += isSorted && ids == bruteIds ? 0 : 1;
+	}
+	numFailed += Check(0 == numAllWrong, "all hits match brute force");
+
+	// Sphere overlaps
+	int numOverlapWrong = 0;
+	int numOverlaps = 0;
+	std::vector<std::vector<int>> overlaps(numQueries);
+	start = Clock::now();
+	for (int i = 0; i < numQueries; ++i)
+	{
+		query.OverlapSphere(centers[i], radii[i], overlaps[i]);
+	}
+	const double overlapMs = ElapsedMs(start);
+	start = Clock::now();
+	for (int i = 0; i < numQueries; ++i)
+	{
+		bruteIds.clear();
+		for (int id = 0; id < numAll; ++id)
+		{
+			if (BruteOverlapSphere(scene.bodies[id], centers[i], radii[i])) bruteIds.push_back(id);
+		}
+		ids = overlaps[i];
+		std::sort(ids.begin(), ids.end());
+		numOverlapWrong += ids == bruteIds ? 0 : 1;
+		numOverlaps += (int)bruteIds.size();
+	}
+	const double bruteOverlapMs = ElapsedMs(start);
+	numFailed += Check(0 == numOverlapWrong && numOverlaps > 0, "sphere overlaps match brute force");
+
+	// The batches, on this thread and over the job system, give the single queries' answers
+	std::vector<RayHit> batchHits(numQueries);
+	start = Clock::now();
+	query.RayCastClosestBatch(rays.data(), numQueries, batchHits.data());
+	const double batchSerialMs = ElapsedMs(start);
+	std::vector<RayHit> jobHits(numQueries);
+	start = Clock::now();
+	query.RayCastClosestBatch(rays.data(), numQueries, jobHits.data(), &jobs);
+	const double batchJobsMs = ElapsedMs(start);
+
+	std::vector<std::vector<RayHit>> batchAllHits(numQueries);
+	std::vector<std::vector<RayHit>> jobAllHits(numQueries);
+	query.RayCastAllBatch(rays.data(), numQueries, batchAllHits.data());
+	query.RayCastAllBatch(rays.data(), numQueries, jobAllHits.data(), &jobs);
+
+	std::vector<std::vector<int>> jobOverlaps(numQueries);
+	start = Clock::now();
+	query.OverlapSphereBatch(centers.data(), radii.data(), numQueries, jobOverlaps.data(), &jobs);
+	const double overlapJobsMs = ElapsedMs(start);
+
+	bool isBatchSame = jobOverlaps == overlaps;
+	for (int i = 0; i < numQueries; ++i)
+	{
+		isBatchSame = isBatchSame && batchHits[i].bodyId == hits[i].bodyId && batchHits[i].t == hits[i].t;
+		isBatchSame = isBatchSame && jobHits[i].bodyId == hits[i].bodyId && jobHits[i].t == hits[i].t;
+		isBatchSame = isBatchSame && batchAllHits[i].size() == allHitsPerRay[i].size() && jobAllHits[i].size() == allHitsPerRay[i].size();
+		for (int k = 0; isBatchSame && k < (int)allHitsPerRay[i].size(); ++k)
+		{
+			const RayHit& hit = allHitsPerRay[i][k];
+			isBatchSame = batchAllHits[i][k].bodyId == hit.bodyId && batchAllHits[i][k].t == hit.t;
+			isBatchSame = isBatchSame && jobAllHits[i][k].bodyId == hit.bodyId && jobAllHits[i][k].t == hit.t;
+		}
+	}
+	numFailed += Check(isBatchSame, "batches match single queries");
+
+	printf("  tree built in %.2f ms, %i of %i rays hit\n", buildMs, numHits, numQueries);
+	printf("  closest ray: %.2f us per ray, brute force %.2f us, %.0fx\n", rayMs * 1000.0 / numQueries, bruteRayMs * 1000.0 / numQueries, bruteRayMs / std::max(rayMs, 1.0e-6));
+	printf("  sphere overlap: %.2f us per query, brute force %.2f us, %.0fx\n", overlapMs * 1000.0 / numQueries, bruteOverlapMs * 1000.0 / numQueries, bruteOverlapMs / std::max(overlapMs, 1.0e-6));
+	printf("  ray batch: %.3f ms on this thread, %.3f ms over the job system; overlap batch %.3f ms over the job system\n", batchSerialMs, batchJobsMs, overlapJobsMs);
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
+
+/*
+====================================================
+Joint chains
+A chain hung from a static body, its links joined end to end by one type
+of joint, and the free end kicked sideways so the chain swings as it
+takes its own weight
+====================================================
+*/
+static const float s_chainLinkLength = 0.25f;
+
+static void BuildChain(Scene& scene, const Joint::JointType type, const int numLinks)
+{
+	const float top = 10.0f + (float)numLinks * s_chainLinkLength;
+	Shape* link = new ShapeSphere(0.1f);
+	scene.bodies.push_back(MakeBody(Vec3(0.0f, 0.0f, top), new ShapeSphere(0.1f), 0.0f));
+	for (int i = 1; i <= numLinks; ++i)
+	{
+		scene.bodies.push_back(MakeBody(Vec3(0.0f, 0.0f, top - (float)i * s_chainLinkLength), link, 1.0f));
+	}
+	scene.bodies.back().linearVelocity = Vec3(5.0f, 0.0f, 0.0f);
+
+	for (int i = 1; i <= numLinks; ++i)
+	{
+		const Vec3 a = scene.bodies[i - 1].position;
+		const Vec3 b = scene.bodies[i].position;
+		const Vec3 middle = (a + b) * 0.5f;
+		switch (type)
+		{
+		case Joint::JointType::DISTANCE: scene.AddDistanceJoint(i - 1, i, a, b); break;
+		case Joint::JointType::BALL_SOCKET: scene.AddBallSocketJoint(i - 1, i, middle); break;
+		case Joint::JointType::HINGE: scene.AddHingeJoint(i - 1, i, middle, Vec3(0, 1, 0)); break;
+		case Joint::JointType::FIXED: scene.AddFixedJoint(i - 1, i, middle); break;
+		}
+	}
+}
+
+// How far apart the worst joint's anchors are, or how far off its length for a distance joint
+static float MaxJointError(const Scene& scene)
+{
+	float worst = 0.0f;
+	for (const Joint& joint : scene.GetJoints())
+	{
+		const Body& a = scene.bodies[joint.bodyA];
+		const Body& b = scene.bodies[joint.bodyB];
+		const Vec3 anchorA = a.GetCenterOfMassWorldSpace() + a.orientation.RotatePoint(joint.anchorA);
+		const Vec3 anchorB = b.GetCenterOfMassWorldSpace() + b.orientation.RotatePoint(joint.anchorB);
+		float error = (anchorA - anchorB).GetMagnitude();
+		if (Joint::JointType::DISTANCE == joint.type)
+		{
+			error = fabsf(error - joint.distance);
+		}
+		worst = error == error ? std::max(worst, error) : 1.0e30f;	// A chain gone to NaN is as far off as can be
+	}
+	return worst;
+}
+
+/*
+====================================================
+RunJointsBenchmark
+====================================================
+*/
+int RunJointsBenchmark(const int numLinks)
+{
+	const int numSteps = 120;
+	const float dt = 1.0f / 60.0f;
+	const int numIterations = 10;
+	printf("Joint chains, %i links of %.2f m hung from a static body, %i steps\n", numLinks, s_chainLinkLength, numSteps);
+	int numFailed = 0;
+
+	// The single step modes solve joints as soft springs tuned to the whole
+	// step, and ten iterations cannot carry a long chain's weight up it, so
+	// the links near the top stretch. They are only held to staying bounded.
+	// XPBD's substeps hold the chain.
+	const Scene::SolverMode modes[3] = { Scene::SolverMode::TIME_OF_IMPACT, Scene::SolverMode::SPECULATIVE, Scene::SolverMode::XPBD };
+	const char* modeNames[3] = { "time of impact", "speculative", "xpbd" };
+	const float errorBounds[3] = { 2.0f * s_chainLinkLength, 2.0f * s_chainLinkLength, 0.5f * s_chainLinkLength };
+	const Joint::JointType types[4] = { Joint::JointType::DISTANCE, Joint::JointType::BALL_SOCKET, Joint::JointType::HINGE, Joint::JointType::FIXED };
+	const char* typeNames[4] = { "distance", "ball socket", "hinge", "fixed" };
+	printf("  %-12s %-16s %12s %12s %10s\n", "joint", "solver", "max error", "bound", "ms/step");
+	for (int type = 0; type < 4; ++type)
+	{
+		for (int mode = 0; mode < 3; ++mode)
+		{
+			Scene scene;
+			scene.SetSolverMode(modes[mode]);
+			BuildChain(scene, types[type], numLinks);
+
+			float maxError = 0.0f;
+			double stepMs = 0.0;
+			for (int step = 0; step < numSteps; ++step)
+			{
+				const Clock::time_point start = Clock::now();
+				scene.Update(dt);
+				stepMs += ElapsedMs(start);
+				maxError = std::max(maxError, MaxJointError(scene));
+			}
+			printf("  %-12s %-16s %10.4f m %10.4f m %10.3f\n", typeNames[type], modeNames[mode], maxError, errorBounds[mode], stepMs / numSteps);
+
+			char name[64];
+			snprintf(name, sizeof(name), "%s, %s, bounded", typeNames[type], modeNames[mode]);
+			numFailed += Check(maxError < errorBounds[mode], name);
+		}
+
+		// One step's joint solve from the same swinging chain, in lanes and
+		// through the Simd1 kernel alone
+		Scene scene;
+		scene.SetSolverMode(Scene::SolverMode::SPECULATIVE);
+		BuildChain(scene, types[type], numLinks);
+		for (int step = 0; step < 30; ++step)
+		{
+			scene.Update(dt);
+		}
+		std::vector<Body> laneBodies = scene.bodies;
+		std::vector<Body> scalarBodies = scene.bodies;
+		JointSolver lanes;
+		JointSolver scalar;
+		scalar.SetScalarLanes(true);
+		lanes.Prepare(scene.GetJoints(), laneBodies.data(), dt);
+		scalar.Prepare(scene.GetJoints(), scalarBodies.data(), dt);
+
+		Clock::time_point start = Clock::now();
+		lanes.Solve(numIterations);
+		const double lanesMs = ElapsedMs(start);
+		start = Clock::now();
+		scalar.Solve(numIterations);
+		const double scalarMs = ElapsedMs(start);
+
+		// Both add and multiply in the same order, but the compiler may fuse the scalar ones
+		float worst = 0.0f;
+		float largest = 0.0f;
+		for (int i = 0; i < (int)laneBodies.size(); ++i)
+		{
+			worst = std::max(worst, (laneBodies[i].linearVelocity - scalarBodies[i].linearVelocity).GetMagnitude());
+			worst = std::max(worst, (laneBodies[i].angularVelocity - scalarBodies[i].angularVelocity).GetMagnitude());
+			largest = std::max(largest, scalarBodies[i].linearVelocity.GetMagnitude());
+			largest = std::max(largest, scalarBodies[i].angularVelocity.GetMagnitude());
+		}
+		printf("  %s: %i rows in %i colors, solved in lanes of %i in %.3f ms, scalar %.3f ms, at most %g apart\n",
+			typeNames[type], lanes.NumRows(), lanes.NumColors(), (int)SimdWide::WIDTH, lanesMs, scalarMs, worst);
+
+		char name[64];
+		snprintf(name, sizeof(name), "%s, lanes match Simd1", typeNames[type]);
+		numFailed += Check(worst <= 1.0e-5f * std::max(largest, 1.0f), name);
+	}
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
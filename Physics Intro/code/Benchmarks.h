@@ -0,0 +1,97 @@
+//
+//  Benchmarks.h
+//
+#pragma once
+
+// Headless checks and timings, run from the command line instead of the
+// renderer. Each returns the process exit code, 0 when every check passed.
+
+// -jobbench [workers]: job system correctness checks, then spawn and parallel
+// for timings. 0 workers means one per core.
+int RunJobSystemBenchmark( const int numWorkers );
+
+// -determinism: the same seeded scene stepped on this thread alone and over
+// a job system, for every solver mode, the step hashes have to match
+int RunDeterminismCheck();
+
+// -variants [count]: candidate cochonet throws of the Initialize scene run
+// as scene variants, serially and over the job system
+int RunVariantsBenchmark( const int numVariants );
+
+// -trace [steps]: a seeded scene stepped plain and recorded to a trace, then
+// the trace read back front to back, by random seeks and cut short
+int RunTraceBenchmark( const int numSteps );
+
+// -scenefile [bodies]: a stress scene saved in the text and binary scene
+// file forms, then loaded from each and checked against what was saved
+int RunSceneFileBenchmark( const int numBodies );
+
+// -lod [side]: a side * side grid of spheres over a wide floor stepped at
+// full rate and with level of detail around the origin, then spheres thrown
+// at each other across the levels to check momentum is kept
+int RunLodBenchmark( const int numSide );
+
+// -adaptive [max substeps]: resting spheres hit by a fast ball, stepped with
+// the worst case substep count every step and with adaptive substeps
+int RunAdaptiveBenchmark( const int maxSubsteps );
+
+// -profile [steps]: the seeded scene stepped with the profiler's capture off
+// and on, the zone totals printed and the capture written as a chrome trace.
+// An event's cost is timed in a tight loop, and the capture's events at
+// that cost have to come to under 1% of the steps. The wall clock
+// difference between the runs is printed, not checked.
+int RunProfilerBenchmark( const int numSteps );
+
+// -regression [update]: canonical scenes stepped with a fixed seed in every
+// solver mode, their final state hashes checked against the golden ones in
+// data/regression/golden.txt and their step times against the budgets in
+// data/regression/budgets.txt. update rewrites both from this run.
+int RunRegressionSuite( const bool isUpdating );
+
+// -mathbench: the math library's hot operations timed one value at a time,
+// then as structure of arrays loops on every SIMD width the build has, the
+// wider results checked against the scalar ones. The batched swept sphere
+// test is checked pair by pair against SphereSphereDynamic, tail included.
+// Reports ns/op and Mop/s.
+int RunMathBenchmark();
+
+// -asyncread [files]: files read and hashed one after the other, then read
+// through the async file reader with the hashing in the completions, once
+// on io_uring where the system has it and once on the thread pool
+int RunAsyncReadBenchmark( const int numFiles );
+
+// -memory [steps]: the seeded scene in each solver mode, its memory by tag
+// and how often the steps allocate once settled, with the hot loop check
+// reporting each step that did. Fails if any did. The figures are written
+// to memory.json.
+int RunMemoryBenchmark( const int numSteps );
+
+// -precision [steps]: a tumbling box and a pile of spheres stepped in float
+// and in double side by side. Double is the reference: the table shows how
+// far float strays from it, and how far each strays from the angular
+// momentum and energy the scenes should keep.
+int RunPrecisionBenchmark( const int numSteps );
+
+// -particles [count]: a block of particles dropped onto the floor and
+// stepped until it settles, on one thread and over the job system, the two
+// checked to agree to the bit
+int RunParticlesBenchmark( const int numParticles );
+
+// -gpuparticles [count]: the same block stepped by the particles.comp
+// compute shader and by the CPU, the piles compared overall, then one step
+// from the same state compared particle by particle. Needs a Vulkan device
+// and particles.comp compiled to spirv.
+int RunGPUParticlesCheck( const int numParticles );
+
+// -query [bodies]: spheres and boxes strewn over the floor, then closest
+// ray hits, every hit along a ray and sphere overlaps checked against
+// testing every body, and timed against it. The batches are timed on this
+// thread and over the job system and checked against the single queries.
+int RunQueryBenchmark( const int numBodies );
+
+// -joints [links]: a chain of each joint type hung from a static body and
+// kicked, stepped in every solver mode with its worst joint error held to
+// a bound and its ms/step reported. The bound is loose in the single step
+// modes, where long chains stretch; XPBD holds them. One joint solve is
+// then run in SIMD lanes and through the Simd1 kernel and checked to agree.
+int RunJointsBenchmark( const int numLinks );
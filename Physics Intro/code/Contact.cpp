@@ -2,97 +2,107 @@
 
 #include "Intersections.h"
 
-void Contact::ResolveContact(Contact& contact)
+template <typename T>
+void ContactT<T>::ResolveContact(ContactT& contact)
 {
-	Body* a = contact.a;
-	Body* b = contact.b;
+	BodyT<T>* a = contact.a;
+	BodyT<T>* b = contact.b;
 	
-	const float invMassA = a->inverseMass;
-	const float invMassB = b->inverseMass;
+	const T invMassA = a->inverseMass;
+	const T invMassB = b->inverseMass;
 	
-	const float elasticityA = a->elasticity;
-	const float elasticityB = b->elasticity;
-	const float elasticity = elasticityA * elasticityB;
+	const T elasticityA = a->elasticity;
+	const T elasticityB = b->elasticity;
+	const T elasticity = elasticityA * elasticityB;
 	
-	const Vec3 ptOnA = contact.ptOnAWorldSpace;
-	const Vec3 ptOnB = contact.ptOnBWorldSpace;
+	const Vec3T<T> ptOnA = contact.ptOnAWorldSpace;
+	const Vec3T<T> ptOnB = contact.ptOnBWorldSpace;
 	
-	const Mat3 inverseWorldInertiaA = a->GetInverseInertiaTensorWorldSpace();
-	const Mat3 inverseWorldInertiaB = b->GetInverseInertiaTensorWorldSpace();
-	const Vec3 n = contact.normal;
-	const Vec3 rA = ptOnA - a->GetCenterOfMassWorldSpace();
-	const Vec3 rB = ptOnB - b->GetCenterOfMassWorldSpace();
+	const Mat3T<T> inverseWorldInertiaA = a->GetInverseInertiaTensorWorldSpace();
+	const Mat3T<T> inverseWorldInertiaB = b->GetInverseInertiaTensorWorldSpace();
+	const Vec3T<T> n = contact.normal;
+	const Vec3T<T> rA = ptOnA - a->GetCenterOfMassWorldSpace();
+	const Vec3T<T> rB = ptOnB - b->GetCenterOfMassWorldSpace();
 	
-	const Vec3 angularJA = (inverseWorldInertiaA * rA.Cross(n)).Cross(rA);
-	const Vec3 angularJB = (inverseWorldInertiaB * rB.Cross(n)).Cross(rB);
-	const float angularFactor = (angularJA + angularJB).Dot(n);
+	const Vec3T<T> angularJA = (inverseWorldInertiaA * rA.Cross(n)).Cross(rA);
+	const Vec3T<T> angularJB = (inverseWorldInertiaB * rB.Cross(n)).Cross(rB);
+	const T angularFactor = (angularJA + angularJB).Dot(n);
 	
 	// Get world space velocity of the motion and rotation
-	const Vec3 velA = a->linearVelocity + a->angularVelocity.Cross(rA);
-	const Vec3 velB = b->linearVelocity + b->angularVelocity.Cross(rB);
+	const Vec3T<T> velA = a->linearVelocity + a->angularVelocity.Cross(rA);
+	const Vec3T<T> velB = b->linearVelocity + b->angularVelocity.Cross(rB);
 	
 	// Collision impulse
-	const Vec3& velAb = velA - velB;
+	const Vec3T<T>& velAb = velA - velB;
 	
 	// -- Sign is changed here
-	const float impulseValueJ = (1.0f + elasticity) * velAb.Dot(n) / (invMassA + invMassB + angularFactor);
+	const T impulseValueJ = (T(1) + elasticity) * velAb.Dot(n) / (invMassA + invMassB + angularFactor);
 
-	const Vec3 impulse = n * impulseValueJ;
-	a->ApplyImpulse(ptOnA, impulse * -1.0f); 
-	b->ApplyImpulse(ptOnB, impulse * 1.0f); 
+	const Vec3T<T> impulse = n * impulseValueJ;
+	a->ApplyImpulse(ptOnA, impulse * T(-1)); 
+	b->ApplyImpulse(ptOnB, impulse * T(1)); 
 	
 	// Friction-caused impulse
-	const float frictionA = a->friction;
-	const float frictionB = b->friction;
+	const T frictionA = a->friction;
+	const T frictionB = b->friction;
 	
-	const float friction = frictionA * frictionB;
+	const T friction = frictionA * frictionB;
 	
 	// -- Find the normal direction of the velocity
 	// -- with respect to the normal of the collision
-	const Vec3 velNormal = n * n.Dot(velAb);
+	const Vec3T<T> velNormal = n * n.Dot(velAb);
 	
 	// -- Find the tangent direction of the velocity
 	// -- with respect to the normal of the collision
-	const Vec3 velTangent = velAb - velNormal;
+	const Vec3T<T> velTangent = velAb - velNormal;
 	
 	// -- Get the tangential velocities relative to the other body
-	Vec3 relativeVelTangent = velTangent;
+	Vec3T<T> relativeVelTangent = velTangent;
 	relativeVelTangent.Normalize();
-	const Vec3 inertiaA = (inverseWorldInertiaA * rA.Cross(relativeVelTangent)).Cross(rA);
-	const Vec3 inertiaB = (inverseWorldInertiaB * rB.Cross(relativeVelTangent)).Cross(rB);
-	const float inverseInertia = (inertiaA + inertiaB).Dot(relativeVelTangent);
+	const Vec3T<T> inertiaA = (inverseWorldInertiaA * rA.Cross(relativeVelTangent)).Cross(rA);
+	const Vec3T<T> inertiaB = (inverseWorldInertiaB * rB.Cross(relativeVelTangent)).Cross(rB);
+	const T inverseInertia = (inertiaA + inertiaB).Dot(relativeVelTangent);
 	
 	// -- Tangential impulse for friction
-	const float reducedMass = 1.0f / (a->inverseMass + b->inverseMass + inverseInertia);
-	const Vec3 impulseFriction = velTangent * reducedMass * friction;
+	const T reducedMass = T(1) / (a->inverseMass + b->inverseMass + inverseInertia);
+	const Vec3T<T> impulseFriction = velTangent * reducedMass * friction;
 	
 	// -- Apply kinetic friction
-	a->ApplyImpulse(ptOnA, impulseFriction * -1.0f);
-	b->ApplyImpulse(ptOnB, impulseFriction * 1.0f);
+	a->ApplyImpulse(ptOnA, impulseFriction * T(-1));
+	b->ApplyImpulse(ptOnB, impulseFriction * T(1));
 
 	// If object are interpenetrating, use this to set them on contact
-	if (contact.timeOfImpact == 0.0f)
+	if (contact.timeOfImpact == T(0))
 	{
-		const float tA = invMassA / (invMassA + invMassB);
-		const float tB = invMassB / (invMassA + invMassB);
-		const Vec3 d = ptOnB - ptOnA;
+		const T tA = invMassA / (invMassA + invMassB);
+		const T tB = invMassB / (invMassA + invMassB);
+		const Vec3T<T> d = ptOnB - ptOnA;
 		a->position += d * tA;
 		b->position -= d * tB;
 	}
 }
 
-int Contact::CompareContact(const void* p1, const void* p2)
+template <typename T>
+int ContactT<T>::CompareContact(const void* p1, const void* p2)
 {
-	const Contact& a = *(const Contact*)p1;
-	const Contact& b = *(const Contact*)p1;
-	if (a.timeOfImpact < b.timeOfImpact)
+	const ContactT& a = *(const ContactT*)p1;
+	const ContactT& b = *(const ContactT*)p2;
+	if (a.timeOfImpact != b.timeOfImpact)
 	{
-		return -1;
+		return a.timeOfImpact < b.timeOfImpact ? -1 : 1;
 	}
-	else if (a.timeOfImpact == b.timeOfImpact)
+	
+	// Same time, order by the bodies so ties resolve the same way every run
+	if (a.a != b.a)
 	{
-		return -0;
+		return a.a < b.a ? -1 : 1;
 	}
-	
-	return 1;
-}
\ No newline at end of file
+	if (a.b != b.b)
+	{
+		return a.b < b.b ? -1 : 1;
+	}
+	return 0;
+}
+
+template class ContactT<float>;
+template class ContactT<double>;
@@ -3,22 +3,30 @@
 #include "Math/Vector.h"
 #include "../Body.h"
 
-class Contact
+/// <summary>
+/// Templated on the scalar with the bodies it joins, Contact is the float
+/// one. Both are instantiated in Contact.cpp.
+/// </summary>
+template <typename T>
+class ContactT
 {
 public:
-	Vec3 ptOnAWorldSpace;
-	Vec3 ptOnALocalSpace;
-	Vec3 ptOnBWorldSpace;
-	Vec3 ptOnBLocalSpace;
+	Vec3T<T> ptOnAWorldSpace;
+	Vec3T<T> ptOnALocalSpace;
+	Vec3T<T> ptOnBWorldSpace;
+	Vec3T<T> ptOnBLocalSpace;
 	
-	Vec3 normal;
+	Vec3T<T> normal;
 	
-	float separationDistance;
-	float timeOfImpact;
+	T separationDistance;
+	T timeOfImpact;
 	
-	Body* a{ nullptr };
-	Body* b{ nullptr };
+	BodyT<T>* a{ nullptr };
+	BodyT<T>* b{ nullptr };
 	
-	static void ResolveContact(Contact& contact);
+	static void ResolveContact(ContactT& contact);
 	static int CompareContact(const void* p1, const void* p2);
 };
+
+typedef ContactT<float> Contact;
+typedef ContactT<double> Contactd;
@@ -0,0 +1,128 @@
+#include "ContactSolver.h"
+
+#include <algorithm>
+
+void ContactSolver::Prepare(const Contact* contacts, const int num, const float dt)
+{
+	// Fraction of the penetration removed per step and how much is let be, to avoid jitter
+	const float baumgarte = 0.2f;
+	const float allowedPenetration = 0.005f;
+
+	m_dt = dt;
+	m_constraints.resize(num);
+	for (int i = 0; i < num; ++i)
+	{
+		const Contact& contact = contacts[i];
+		ContactConstraint& constraint = m_constraints[i];
+		constraint.a = contact.a;
+		constraint.b = contact.b;
+		constraint.normal = contact.normal;
+		constraint.rA = contact.ptOnAWorldSpace - contact.a->GetCenterOfMassWorldSpace();
+		constraint.rB = contact.ptOnBWorldSpace - contact.b->GetCenterOfMassWorldSpace();
+		constraint.invInertiaA = contact.a->GetInverseInertiaTensorWorldSpace();
+		constraint.invInertiaB = contact.b->GetInverseInertiaTensorWorldSpace();
+		constraint.friction = contact.a->friction * contact.b->friction;
+		constraint.elasticity = contact.a->elasticity * contact.b->elasticity;
+
+		const float invMass = contact.a->inverseMass + contact.b->inverseMass;
+		auto effectiveMass = [&](const Vec3& dir)
+		{
+			const Vec3 angularA = (constraint.invInertiaA * constraint.rA.Cross(dir)).Cross(constraint.rA);
+			const Vec3 angularB = (constraint.invInertiaB * constraint.rB.Cross(dir)).Cross(constraint.rB);
+			const float k = invMass + (angularA + angularB).Dot(dir);
+			return k > 0.0f ? 1.0f / k : 0.0f;
+		};
+
+		constraint.normal.GetOrtho(constraint.tangents[0], constraint.tangents[1]);
+		constraint.normalMass = effectiveMass(constraint.normal);
+		constraint.tangentMass[0] = effectiveMass(constraint.tangents[0]);
+		constraint.tangentMass[1] = effectiveMass(constraint.tangents[1]);
+
+		// With a gap the bodies may close it this step, but no more.
+		// Penetrating they are pushed apart over a few steps.
+		const float separation = contact.separationDistance;
+		if (separation > 0.0f)
+		{
+			constraint.bias = separation / dt;
+		}
+		else
+		{
+			constraint.bias = -baumgarte * std::max(-separation - allowedPenetration, 0.0f) / dt;
+		}
+
+		constraint.relativeVelocity = RelativeVelocity(constraint, constraint.normal);
+		constraint.normalImpulse = 0.0f;
+		constraint.tangentImpulse[0] = 0.0f;
+		constraint.tangentImpulse[1] = 0.0f;
+	}
+}
+
+float ContactSolver::RelativeVelocity(const ContactConstraint& constraint, const Vec3& dir) const
+{
+	// The normal points from B to A, so this is positive when they move apart
+	const Body* a = constraint.a;
+	const Body* b = constraint.b;
+	const Vec3 velA = a->linearVelocity + a->angularVelocity.Cross(constraint.rA);
+	const Vec3 velB = b->linearVelocity + b->angularVelocity.Cross(constraint.rB);
+	return (velA - velB).Dot(dir);
+}
+
+void ContactSolver::ApplyImpulse(ContactConstraint& constraint, const Vec3& impulse)
+{
+	// Impulse on A, B gets the opposite
+	Body* a = constraint.a;
+	Body* b = constraint.b;
+	a->linearVelocity += impulse * a->inverseMass;
+	a->angularVelocity += constraint.invInertiaA * constraint.rA.Cross(impulse);
+	b->linearVelocity -= impulse * b->inverseMass;
+	b->angularVelocity -= constraint.invInertiaB * constraint.rB.Cross(impulse);
+}
+
+void ContactSolver::Iterate()
+{
+	for (ContactConstraint& constraint : m_constraints)
+	{
+		// Friction, bounded by the normal impulse of the previous iteration
+		const float maxFriction = constraint.friction * constraint.normalImpulse;
+		for (int t = 0; t < 2; ++t)
+		{
+			const Vec3& tangent = constraint.tangents[t];
+			const float lambda = -RelativeVelocity(constraint, tangent) * constraint.tangentMass[t];
+			const float oldImpulse = constraint.tangentImpulse[t];
+			constraint.tangentImpulse[t] = std::max(-maxFriction, std::min(oldImpulse + lambda, maxFriction));
+			ApplyImpulse(constraint, tangent * (constraint.tangentImpulse[t] - oldImpulse));
+		}
+
+		// Normal, the accumulated impulse may only push apart
+		const float velocity = RelativeVelocity(constraint, constraint.normal);
+		const float lambda = -(velocity + constraint.bias) * constraint.normalMass;
+		const float oldImpulse = constraint.normalImpulse;
+		constraint.normalImpulse = std::max(oldImpulse + lambda, 0.0f);
+		ApplyImpulse(constraint, constraint.normal * (constraint.normalImpulse - oldImpulse));
+	}
+}
+
+void ContactSolver::Solve(const int numIterations)
+{
+	for (int iteration = 0; iteration < numIterations; ++iteration)
+	{
+		Iterate();
+	}
+}
+
+void ContactSolver::ApplyRestitution()
+{
+	// Slow approaches are not bounced, resting contacts would never settle
+	const float threshold = 1.0f;
+
+	for (ContactConstraint& constraint : m_constraints)
+	{
+		if (constraint.relativeVelocity > -threshold || constraint.normalImpulse == 0.0f) continue;
+
+		const float velocity = RelativeVelocity(constraint, constraint.normal);
+		const float lambda = -(velocity + constraint.elasticity * constraint.relativeVelocity) * constraint.normalMass;
+		const float oldImpulse = constraint.normalImpulse;
+		constraint.normalImpulse = std::max(oldImpulse + lambda, 0.0f);
+		ApplyImpulse(constraint, constraint.normal * (constraint.normalImpulse - oldImpulse));
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Contact.h"
+#include "Math/Matrix.h"
+
+#include <vector>
+
+/// <summary>
+/// Sequential impulse solver for speculative contacts.
+/// A contact with a gap only pushes back once closing the gap within the step
+/// would be exceeded, so bodies meet the surface exactly at the end of the step
+/// instead of passing it, without stepping time to each impact in turn.
+/// </summary>
+class ContactSolver
+{
+public:
+	/// <summary>
+	/// Room for num contacts, so preparing as many does not allocate
+	/// </summary>
+	void Reserve(const int num) { m_constraints.reserve(num); }
+
+	void Prepare(const Contact* contacts, const int num, const float dt);
+	void Iterate();
+	void Solve(const int numIterations);
+
+	/// <summary>
+	/// Bounce the contacts that were hit this step, once the approach
+	/// has been resolved, from the velocity they approached with
+	/// </summary>
+	void ApplyRestitution();
+
+private:
+	struct ContactConstraint
+	{
+		Body* a;
+		Body* b;
+		Vec3 rA;
+		Vec3 rB;
+		Mat3 invInertiaA;	// World space, scaled by the inverse mass like Body::GetInverseInertiaTensorWorldSpace
+		Mat3 invInertiaB;
+		Vec3 normal;
+		Vec3 tangents[2];
+		float normalMass;
+		float tangentMass[2];
+		float bias;	// Normal velocity allowed towards each other, or needed apart when penetrating
+		float friction;
+		float elasticity;
+		float relativeVelocity;	// Normal velocity before solving
+		float normalImpulse;
+		float tangentImpulse[2];
+	};
+
+	float RelativeVelocity(const ContactConstraint& constraint, const Vec3& dir) const;
+	void ApplyImpulse(ContactConstraint& constraint, const Vec3& impulse);
+
+	std::vector<ContactConstraint> m_constraints;
+	float m_dt;
+};
@@ -0,0 +1,398 @@
+#include "ConvexHull.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <float.h>
+
+int ConvexHullBuilder::AddFace(const int a, const int b, const int c)
+{
+	Face face;
+	face.v[0] = a;
+	face.v[1] = b;
+	face.v[2] = c;
+	face.adjacent[0] = face.adjacent[1] = face.adjacent[2] = -1;
+
+	// Take the cross product at the corner opposite the longest edge, the
+	// widest angle, which keeps the normal of long thin triangles accurate
+	const Vec3& pa = m_pts[a];
+	const Vec3& pb = m_pts[b];
+	const Vec3& pc = m_pts[c];
+	const float ab = (pb - pa).GetLengthSqr();
+	const float bc = (pc - pb).GetLengthSqr();
+	const float ca = (pa - pc).GetLengthSqr();
+	if (bc >= ab && bc >= ca)
+	{
+		face.normal = (pb - pa).Cross(pc - pa);
+	}
+	else if (ca >= ab)
+	{
+		face.normal = (pc - pb).Cross(pa - pb);
+	}
+	else
+	{
+		face.normal = (pa - pc).Cross(pb - pc);
+	}
+	face.normal.Normalize();
+	face.dist = face.normal.Dot((pa + pb + pc) * (1.0f / 3.0f));
+	face.outsideHead = -1;
+	face.furthest = -1;
+	face.furthestDist = 0.0f;
+	face.isAlive = true;
+	face.isVisible = false;
+
+	m_faces.push_back(face);
+	return (int)m_faces.size() - 1;
+}
+
+void ConvexHullBuilder::AddOutside(const int faceId, const int pt)
+{
+	Face& face = m_faces[faceId];
+	const float dist = face.normal.Dot(m_pts[pt]) - face.dist;
+
+	m_nextOutside[pt] = face.outsideHead;
+	face.outsideHead = pt;
+	if (face.furthest < 0 || dist > face.furthestDist)
+	{
+		face.furthest = pt;
+		face.furthestDist = dist;
+	}
+}
+
+bool ConvexHullBuilder::AssignToFaces(const int pt, const int firstFace, const int lastFace)
+{
+	// Give the point to the face it is furthest above, if any
+	int bestFace = -1;
+	float bestDist = m_epsilon;
+	for (int i = firstFace; i <= lastFace; ++i)
+	{
+		const Face& face = m_faces[i];
+		const float dist = face.normal.Dot(m_pts[pt]) - face.dist;
+		if (face.isAlive && dist > bestDist)
+		{
+			bestDist = dist;
+			bestFace = i;
+		}
+	}
+
+	if (bestFace < 0) return false;
+
+	AddOutside(bestFace, pt);
+	return true;
+}
+
+void ConvexHullBuilder::FindHorizon(const int faceId, const Vec3& eye)
+{
+	// Depth first walk over the faces the eye can see. Each face carries on
+	// from the edge after the one it was entered by, so the edges to faces
+	// that are not visible come out as one loop, in order.
+	std::vector<HorizonFrame>& stack = m_stack;
+	stack.clear();
+
+	m_faces[faceId].isVisible = true;
+	m_visible.push_back(faceId);
+	stack.push_back({ faceId, 0, 0, 3 });
+
+	while (!stack.empty())
+	{
+		HorizonFrame& frame = stack.back();
+		if (frame.step == frame.numSteps)
+		{
+			stack.pop_back();
+			continue;
+		}
+
+		const int id = frame.face;
+		const int i = (frame.firstEdge + frame.step) % 3;
+		++frame.step;
+
+		const Face& face = m_faces[id];
+		const int adjacentId = face.adjacent[i];
+		Face& adjacent = m_faces[adjacentId];
+		if (adjacent.isVisible) continue;
+
+		int backEdge = 0;
+		while (adjacent.adjacent[backEdge] != id)
+		{
+			++backEdge;
+		}
+
+		// Faces the eye is within tolerance of the plane of are taken out too,
+		// otherwise the new face next to them can fold over and come out inverted
+		if (adjacent.normal.Dot(eye) - adjacent.dist > -m_epsilon)
+		{
+			adjacent.isVisible = true;
+			m_visible.push_back(adjacentId);
+			stack.push_back({ adjacentId, backEdge + 1, 0, 2 });
+		}
+		else
+		{
+			m_horizon.push_back({ face.v[i], face.v[(i + 1) % 3], adjacentId, backEdge });
+		}
+	}
+}
+
+bool ConvexHullBuilder::Build(const Vec3* pts, const int num, std::vector<Vec3>& hullPts, std::vector<tri_t>& hullTris)
+{
+	hullPts.clear();
+	hullTris.clear();
+	if (num < 4) return false;
+
+	m_pts = pts;
+	m_faces.clear();
+	m_nextOutside.assign(num, -1);
+
+	// Tolerance scaled to the size of the input
+	Bounds bounds;
+	bounds.Expand(pts, num);
+	const Vec3 maxAbs = Vec3(std::max(fabsf(bounds.mins.x), fabsf(bounds.maxs.x)),
+		std::max(fabsf(bounds.mins.y), fabsf(bounds.maxs.y)),
+		std::max(fabsf(bounds.mins.z), fabsf(bounds.maxs.z)));
+	m_epsilon = 3.0f * FLT_EPSILON * (maxAbs.x + maxAbs.y + maxAbs.z);
+
+	// Starting tetrahedron: the two axis extremes furthest apart,
+	// then the point furthest from their line, then from their plane
+	int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 1; i < num; ++i)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			extremes[axis * 2 + 0] = pts[i][axis] < pts[extremes[axis * 2 + 0]][axis] ? i : extremes[axis * 2 + 0];
+			extremes[axis * 2 + 1] = pts[i][axis] > pts[extremes[axis * 2 + 1]][axis] ? i : extremes[axis * 2 + 1];
+		}
+	}
+
+	int p0 = 0;
+	int p1 = 0;
+	float maxDist = 0.0f;
+	for (int i = 0; i < 6; ++i)
+	{
+		for (int j = i + 1; j < 6; ++j)
+		{
+			const float dist = (pts[extremes[i]] - pts[extremes[j]]).GetLengthSqr();
+			if (dist > maxDist)
+			{
+				maxDist = dist;
+				p0 = extremes[i];
+				p1 = extremes[j];
+			}
+		}
+	}
+	if (maxDist <= m_epsilon * m_epsilon) return false;
+
+	int p2 = -1;
+	maxDist = m_epsilon * m_epsilon;
+	const Vec3 line = pts[p1] - pts[p0];
+	for (int i = 0; i < num; ++i)
+	{
+		const float dist = line.Cross(pts[i] - pts[p0]).GetLengthSqr() / line.GetLengthSqr();
+		if (dist > maxDist)
+		{
+			maxDist = dist;
+			p2 = i;
+		}
+	}
+	if (p2 < 0) return false;
+
+	int p3 = -1;
+	maxDist = m_epsilon;
+	Vec3 normal = (pts[p1] - pts[p0]).Cross(pts[p2] - pts[p0]);
+	normal.Normalize();
+	for (int i = 0; i < num; ++i)
+	{
+		const float dist = fabsf(normal.Dot(pts[i] - pts[p0]));
+		if (dist > maxDist)
+		{
+			maxDist = dist;
+			p3 = i;
+		}
+	}
+	if (p3 < 0) return false;
+
+	// Wind the base so that it faces away from the fourth point
+	if (normal.Dot(pts[p3] - pts[p0]) > 0.0f)
+	{
+		std::swap(p1, p2);
+	}
+	AddFace(p0, p1, p2);
+	AddFace(p1, p0, p3);
+	AddFace(p2, p1, p3);
+	AddFace(p0, p2, p3);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const int a = m_faces[i].v[e];
+			const int b = m_faces[i].v[(e + 1) % 3];
+			for (int j = 0; j < 4; ++j)
+			{
+				for (int f = 0; f < 3; ++f)
+				{
+					if (m_faces[j].v[f] == b && m_faces[j].v[(f + 1) % 3] == a)
+					{
+						m_faces[i].adjacent[e] = j;
+					}
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < num; ++i)
+	{
+		if (i == p0 || i == p1 || i == p2 || i == p3) continue;
+		AssignToFaces(i, 0, 3);
+	}
+
+	// Faces are appended as they are made, so a single pass over the list
+	// picks up every face that still has points outside it
+	for (int faceId = 0; faceId < (int)m_faces.size(); ++faceId)
+	{
+		if (!m_faces[faceId].isAlive || m_faces[faceId].outsideHead < 0) continue;
+
+		const int eye = m_faces[faceId].furthest;
+		m_visible.clear();
+		m_horizon.clear();
+		FindHorizon(faceId, pts[eye]);
+
+		// Points outside the faces about to go need a new home
+		m_orphans.clear();
+		for (const int id : m_visible)
+		{
+			for (int pt = m_faces[id].outsideHead; pt >= 0; pt = m_nextOutside[pt])
+			{
+				if (pt != eye)
+				{
+					m_orphans.push_back(pt);
+				}
+			}
+			m_faces[id].isAlive = false;
+		}
+
+		// Fan of new faces from the horizon to the eye
+		const int firstNew = (int)m_faces.size();
+		const int numNew = (int)m_horizon.size();
+		for (int i = 0; i < numNew; ++i)
+		{
+			const HorizonEdge& edge = m_horizon[i];
+			const int newId = AddFace(edge.a, edge.b, eye);
+			m_faces[newId].adjacent[0] = edge.face;
+			m_faces[newId].adjacent[1] = firstNew + (i + 1) % numNew;
+			m_faces[newId].adjacent[2] = firstNew + (i + numNew - 1) % numNew;
+			m_faces[edge.face].adjacent[edge.edge] = newId;
+		}
+
+		for (const int pt : m_orphans)
+		{
+			AssignToFaces(pt, firstNew, firstNew + numNew - 1);
+		}
+	}
+
+	// Compact the surviving faces and the vertices they use
+	m_remap.assign(num, -1);
+	for (const Face& face : m_faces)
+	{
+		if (!face.isAlive) continue;
+
+		int ids[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			if (m_remap[face.v[i]] < 0)
+			{
+				m_remap[face.v[i]] = (int)hullPts.size();
+				hullPts.push_back(pts[face.v[i]]);
+			}
+			ids[i] = m_remap[face.v[i]];
+		}
+		hullTris.push_back({ ids[0], ids[1], ids[2] });
+	}
+	return true;
+}
+
+bool BuildConvexHull(const std::vector<Vec3>& verts, std::vector<Vec3>& hullPts, std::vector<tri_t>& hullTris)
+{
+	thread_local ConvexHullBuilder builder;
+	return builder.Build(verts.data(), (int)verts.size(), hullPts, hullTris);
+}
+
+void BuildConvexHulls(const std::vector<Vec3>* verts, const int num, std::vector<Vec3>* hullPts, std::vector<tri_t>* hullTris, JobSystem* jobs)
+{
+	auto build = [=](const int begin, const int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			BuildConvexHull(verts[i], hullPts[i], hullTris[i]);
+		}
+	};
+	if (nullptr == jobs)
+	{
+		build(0, num);
+		return;
+	}
+
+	// Hull sizes vary a lot, so each hull is its own job and the workers
+	// steal whatever is left rather than being stuck with a fixed chunk
+	jobs->ParallelFor(0, num, build, 1);
+}
+
+void CalculateHullMassProperties(const std::vector<Vec3>& hullPts, const std::vector<tri_t>& hullTris, Vec3& centerOfMass, Mat3& inertiaTensor)
+{
+	// Any interior point works as the apex of the tetrahedra, the average vertex is one
+	Vec3 apex = Vec3(0.0f);
+	for (const Vec3& pt : hullPts)
+	{
+		apex += pt;
+	}
+	apex *= 1.0f / (float)hullPts.size();
+
+	// Second moment of a tetrahedron with a corner at the origin and edges
+	// a, b, c is det * ( a a^T + b b^T + c c^T + (a + b + c)(a + b + c)^T ) / 120
+	// where det is six times its volume
+	float totalVolume = 0.0f;
+	Vec3 weightedCenter = Vec3(0.0f);
+	Mat3 covariance;
+	covariance.Zero();
+	for (const tri_t& tri : hullTris)
+	{
+		const Vec3 a = hullPts[tri.a] - apex;
+		const Vec3 b = hullPts[tri.b] - apex;
+		const Vec3 c = hullPts[tri.c] - apex;
+
+		const float det = a.Dot(b.Cross(c));
+		const float volume = det / 6.0f;
+		totalVolume += volume;
+		weightedCenter += (a + b + c) * (volume * 0.25f);
+
+		const Vec3 sum = a + b + c;
+		const Vec3* edges[4] = { &a, &b, &c, &sum };
+		for (const Vec3* edge : edges)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					covariance.rows[i][j] += (*edge)[i] * (*edge)[j] * det / 120.0f;
+				}
+			}
+		}
+	}
+
+	// Move the second moment from the apex to the center of mass, and scale to a unit mass
+	const Vec3 center = weightedCenter * (1.0f / totalVolume);
+	centerOfMass = apex + center;
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			covariance.rows[i][j] = covariance.rows[i][j] / totalVolume - center[i] * center[j];
+		}
+	}
+
+	// I = trace( C ) * identity - C
+	const float trace = covariance.rows[0][0] + covariance.rows[1][1] + covariance.rows[2][2];
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			inertiaTensor.rows[i][j] = (i == j ? trace : 0.0f) - covariance.rows[i][j];
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../Shape.h"
+
+#include <vector>
+
+class JobSystem;
+
+/// <summary>
+/// Quickhull. The builder keeps its scratch buffers between builds, so once
+/// it has seen its largest input, building more hulls does not allocate.
+/// Builders are not shared between threads, use one per thread.
+/// </summary>
+class ConvexHullBuilder
+{
+public:
+	/// <summary>
+	/// Convex hull of the points as compacted vertices and outward facing triangles.
+	/// Returns false, leaving the hull empty, if the points are all on a plane.
+	/// </summary>
+	bool Build(const Vec3* pts, const int num, std::vector<Vec3>& hullPts, std::vector<tri_t>& hullTris);
+
+private:
+	struct Face
+	{
+		int v[3];
+		int adjacent[3];	// Face across the edge v[i] -> v[(i + 1) % 3]
+		Vec3 normal;
+		float dist;
+		int outsideHead;	// First point of the outside set, linked through m_nextOutside
+		int furthest;		// Point of the outside set furthest above the face
+		float furthestDist;
+		bool isAlive;
+		bool isVisible;
+	};
+
+	struct HorizonEdge
+	{
+		int a;
+		int b;
+		int face;	// Face left on the other side of the edge
+		int edge;	// Index of the edge in that face
+	};
+
+	struct HorizonFrame
+	{
+		int face;
+		int firstEdge;
+		int step;
+		int numSteps;
+	};
+
+	int AddFace(const int a, const int b, const int c);
+	void AddOutside(const int faceId, const int pt);
+	bool AssignToFaces(const int pt, const int firstFace, const int lastFace);
+	void FindHorizon(const int faceId, const Vec3& eye);
+
+	const Vec3* m_pts;
+	float m_epsilon;
+
+	std::vector<Face> m_faces;
+	std::vector<int> m_nextOutside;
+	std::vector<HorizonEdge> m_horizon;
+	std::vector<int> m_visible;
+	std::vector<HorizonFrame> m_stack;
+	std::vector<int> m_orphans;
+	std::vector<int> m_remap;
+};
+
+/// <summary>
+/// Builds the hull with a builder local to the calling thread
+/// </summary>
+bool BuildConvexHull(const std::vector<Vec3>& verts, std::vector<Vec3>& hullPts, std::vector<tri_t>& hullTris);
+
+/// <summary>
+/// Builds the hulls of many point sets at once, spread over the job system when there is one
+/// </summary>
+void BuildConvexHulls(const std::vector<Vec3>* verts, const int num, std::vector<Vec3>* hullPts, std::vector<tri_t>* hullTris, JobSystem* jobs = nullptr);
+
+/// <summary>
+/// Exact center of mass and inertia tensor (for a unit mass, about the center
+/// of mass) of a closed hull, summed over the tetrahedra its triangles form with
+/// an interior point
+/// </summary>
+void CalculateHullMassProperties(const std::vector<Vec3>& hullPts, const std::vector<tri_t>& hullTris, Vec3& centerOfMass, Mat3& inertiaTensor);
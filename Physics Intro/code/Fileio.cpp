@@ -6,9 +6,20 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <sys/stat.h>
 
-#include <direct.h>
-#define GetCurrentDir _getcwd
+#if defined( _WIN32 )
+	#include <direct.h>
+	#define GetCurrentDir _getcwd
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+	#define GetCurrentDir getcwd
+#endif
 
 static char g_ApplicationDirectory[ FILENAME_MAX ];
 static bool g_WasInitialized = false;
@@ -47,7 +58,7 @@ void RelativePathToFullPath( const char * relativePathName, char * fullPath ) {
 /*
 ====================================================
 GetFileData
-Opens the file and stores it in data
+Opens the file and stores it in data, null terminated. The caller frees it.
 ====================================================
 */
 bool GetFileData( const char * fileNameLocal, unsigned char ** data, unsigned int & size ) {
@@ -55,53 +66,26 @@ bool GetFileData( const char * fileNameLocal, unsigned char ** data, unsigned in
 
 	char fileName[ 2048 ];
 	sprintf( fileName, "%s/%s", g_ApplicationDirectory, fileNameLocal );
-	
-	// open file for reading
-	FILE * file = fopen( fileName, "rb" );
-	
-	// handle any errors
-	if ( file == NULL ) {
+
+	FileView view;
+	if ( !view.Open( fileName ) ) {
 		return false;
 	}
 	
-	// get file size
-	fseek( file, 0, SEEK_END );
-	fflush( file );
-	size = ftell( file );
-	fflush( file );
-	rewind( file );
-	fflush( file );
-	
 	// create the data buffer
-	*data = (unsigned char*)malloc( ( size + 1 ) * sizeof( unsigned char ) );
+	*data = (unsigned char*)malloc( view.Size() + 1 );
     
 	// handle any errors
 	if ( *data == NULL ) {
 		printf( "ERROR: Could not allocate memory!  %s\n", fileName );
-		fclose( file );
 		return false;
 	}
 
-	// zero out the memory
-	memset( *data, 0, ( size + 1 ) * sizeof( unsigned char ) );
-	
-	// read the data
-	unsigned int bytesRead = (unsigned int)fread( *data, sizeof( unsigned char ), size, file );
-    fflush( file );
-    
-    assert( bytesRead == size );
-	
-	// handle any errors
-	if ( bytesRead != size ) {
-		printf( "ERROR: reading file went wrong %s\n", fileName );
-		fclose( file );
-		if ( *data != NULL ) {
-			free( *data );
-		}
-		return false;
-	}
-	
-	fclose( file );
+	// only the terminator needs clearing, the rest is written over
+	memcpy( *data, view.Data(), view.Size() );
+	( *data )[ view.Size() ] = 0;
+	size = (unsigned int)view.Size();
+
 	printf( "Read file was success %s\n", fileName );
 	return true;
 }
@@ -139,4 +123,185 @@ bool SaveFileData( const char * fileNameLocal, const void * data, unsigned int s
 	fclose( file );
 	printf( "Write file was success %s\n", fileName );
 	return true;
-}
\ No newline at end of file
+}
+
+/*
+====================================================
+FileExists
+====================================================
+*/
+bool FileExists( const char * fileName, size_t * size ) {
+	struct stat info;
+	if ( 0 != stat( fileName, &info ) || 0 == ( info.st_mode & S_IFREG ) ) {
+		return false;
+	}
+	if ( NULL != size ) {
+		*size = (size_t)info.st_size;
+	}
+	return true;
+}
+
+/*
+========================================================================================================
+
+FileView
+
+========================================================================================================
+*/
+
+static const unsigned char g_emptyFile[ 1 ] = { 0 };
+
+/*
+====================================================
+FileView::FileView
+====================================================
+*/
+FileView::FileView( FileView && rhs ) : m_data( rhs.m_data ), m_size( rhs.m_size ), m_isMapped( rhs.m_isMapped ) {
+	rhs.m_data = NULL;
+	rhs.m_size = 0;
+	rhs.m_isMapped = false;
+}
+
+/*
+====================================================
+FileView::operator =
+====================================================
+*/
+FileView & FileView::operator = ( FileView && rhs ) {
+	if ( this != &rhs ) {
+		Close();
+		m_data = rhs.m_data;
+		m_size = rhs.m_size;
+		m_isMapped = rhs.m_isMapped;
+		rhs.m_data = NULL;
+		rhs.m_size = 0;
+		rhs.m_isMapped = false;
+	}
+	return *this;
+}
+
+/*
+====================================================
+FileView::Open
+====================================================
+*/
+bool FileView::Open( const char * fileName ) {
+	Close();
+
+	size_t size = 0;
+	if ( !FileExists( fileName, &size ) ) {
+		return false;
+	}
+
+	// Nothing to map
+	if ( 0 == size ) {
+		m_data = g_emptyFile;
+		return true;
+	}
+
+	if ( Map( fileName, size ) ) {
+		return true;
+	}
+	return Read( fileName, size );
+}
+
+/*
+====================================================
+FileView::Close
+====================================================
+*/
+void FileView::Close() {
+	if ( NULL == m_data ) {
+		return;
+	}
+
+	if ( m_isMapped ) {
+#if defined( _WIN32 )
+		UnmapViewOfFile( m_data );
+#else
+		munmap( (void *)m_data, m_size );
+#endif
+	} else if ( g_emptyFile != m_data ) {
+		free( (void *)m_data );
+	}
+	m_data = NULL;
+	m_size = 0;
+	m_isMapped = false;
+}
+
+/*
+====================================================
+FileView::Adopt
+====================================================
+*/
+void FileView::Adopt( unsigned char * buffer, const size_t size ) {
+	Close();
+	m_data = buffer;
+	m_size = size;
+	m_isMapped = false;
+}
+
+/*
+====================================================
+FileView::Map
+The view keeps the file open by itself, so the handles go straight away
+====================================================
+*/
+bool FileView::Map( const char * fileName, const size_t size ) {
+#if defined( _WIN32 )
+	HANDLE file = CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( INVALID_HANDLE_VALUE == file ) {
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	const void * view = NULL != mapping ? MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, size ) : NULL;
+	if ( NULL != mapping ) {
+		CloseHandle( mapping );
+	}
+	CloseHandle( file );
+	if ( NULL == view ) {
+		return false;
+	}
+#else
+	const int file = open( fileName, O_RDONLY );
+	if ( file < 0 ) {
+		return false;
+	}
+	void * view = mmap( NULL, size, PROT_READ, MAP_PRIVATE, file, 0 );
+	close( file );
+	if ( MAP_FAILED == view ) {
+		return false;
+	}
+#endif
+	m_data = (const unsigned char *)view;
+	m_size = size;
+	m_isMapped = true;
+	return true;
+}
+
+/*
+====================================================
+FileView::Read
+For files the system will not map, read once into a buffer left uncleared
+====================================================
+*/
+bool FileView::Read( const char * fileName, const size_t size ) {
+	FILE * file = fopen( fileName, "rb" );
+	if ( NULL == file ) {
+		return false;
+	}
+
+	unsigned char * buffer = (unsigned char *)malloc( size );
+	const size_t bytesRead = NULL != buffer ? fread( buffer, 1, size, file ) : 0;
+	fclose( file );
+	if ( bytesRead != size ) {
+		printf( "ERROR: reading file went wrong %s\n", fileName );
+		free( buffer );
+		return false;
+	}
+
+	m_data = buffer;
+	m_size = size;
+	m_isMapped = false;
+	return true;
+}
@@ -2,6 +2,54 @@
 //	Fileio.h
 //
 #pragma once
+#include <stddef.h>
 
 bool GetFileData( const char * fileName, unsigned char ** data, unsigned int & size );
-bool SaveFileData( const char * fileName, const void * data, unsigned int size );
\ No newline at end of file
+bool SaveFileData( const char * fileName, const void * data, unsigned int size );
+
+/*
+====================================================
+FileExists
+One stat, for finding out whether a file is there without opening it
+====================================================
+*/
+bool FileExists( const char * fileName, size_t * size = NULL );
+
+/*
+====================================================
+FileView
+A whole file, read only, for as long as the view lives. The file is
+mapped into memory where the system allows, otherwise it is read into a
+buffer of its own; either way the bytes are never copied or cleared on the
+way in. Names are relative to the working directory, as for GetFileData.
+====================================================
+*/
+class FileView {
+public:
+	FileView() : m_data( NULL ), m_size( 0 ), m_isMapped( false ) {}
+	~FileView() { Close(); }
+
+	FileView( FileView && rhs );
+	FileView & operator = ( FileView && rhs );
+	FileView( const FileView & rhs ) = delete;
+	FileView & operator = ( const FileView & rhs ) = delete;
+
+	bool Open( const char * fileName );
+	void Close();
+
+	// Takes a buffer from malloc that holds the whole file, for readers that fill it themselves
+	void Adopt( unsigned char * buffer, const size_t size );
+
+	bool IsOpen() const { return NULL != m_data; }
+	bool IsMapped() const { return m_isMapped; }
+	const unsigned char * Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+
+private:
+	bool Map( const char * fileName, const size_t size );
+	bool Read( const char * fileName, const size_t size );
+
+	const unsigned char * m_data;	// Empty files point at a static empty string
+	size_t m_size;
+	bool m_isMapped;
+};
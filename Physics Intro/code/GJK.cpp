@@ -0,0 +1,754 @@
+#include "GJK.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	const int maxIterations = 32;
+	const float epaTolerance = 1e-4f;
+
+	struct edge_t
+	{
+		int a;
+		int b;
+
+		bool operator==(const edge_t& rhs) const
+		{
+			return (a == rhs.a && b == rhs.b) || (a == rhs.b && b == rhs.a);
+		}
+	};
+
+	int CompareSigns(const float a, const float b)
+	{
+		if (a > 0.0f && b > 0.0f) return 1;
+		if (a < 0.0f && b < 0.0f) return 1;
+		return 0;
+	}
+
+	// Signed volume of the tetrahedron, via the triple product instead of a 4x4 determinant
+	float SignedVolume(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d)
+	{
+		return (b - a).Dot((c - a).Cross(d - a));
+	}
+
+	// Axis the triangle has the largest projected area along and that area
+	float LargestProjectedArea(const Vec3& s1, const Vec3& s2, const Vec3& s3, int& idx)
+	{
+		idx = 0;
+		float areaMax = 0.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			const int j = (i + 1) % 3;
+			const int k = (i + 2) % 3;
+
+			const Vec2 a = Vec2(s1[j], s1[k]);
+			const Vec2 b = Vec2(s2[j], s2[k]);
+			const Vec2 c = Vec2(s3[j], s3[k]);
+			const Vec2 ab = b - a;
+			const Vec2 ac = c - a;
+
+			const float area = ab.x * ac.y - ab.y * ac.x;
+			if (area * area > areaMax * areaMax)
+			{
+				idx = i;
+				areaMax = area;
+			}
+		}
+		return areaMax;
+	}
+
+	// Projected areas of the sub triangles p-s2-s3, p-s3-s1 and p-s1-s2
+	void ProjectedAreas(const Vec3& p0, const Vec3& s1, const Vec3& s2, const Vec3& s3, const int idx, float areas[3])
+	{
+		const int x = (idx + 1) % 3;
+		const int y = (idx + 2) % 3;
+		const Vec2 s[3] = { Vec2(s1[x], s1[y]), Vec2(s2[x], s2[y]), Vec2(s3[x], s3[y]) };
+		const Vec2 p = Vec2(p0[x], p0[y]);
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const int j = (i + 1) % 3;
+			const int k = (i + 2) % 3;
+			const Vec2 ab = s[j] - p;
+			const Vec2 ac = s[k] - p;
+			areas[i] = ab.x * ac.y - ab.y * ac.x;
+		}
+	}
+
+	Vec3 BarycentricCoordinates(Vec3 s1, Vec3 s2, Vec3 s3, const Vec3& pt)
+	{
+		s1 = s1 - pt;
+		s2 = s2 - pt;
+		s3 = s3 - pt;
+
+		const Vec3 normal = (s2 - s1).Cross(s3 - s1);
+		const Vec3 p0 = normal * s1.Dot(normal) / normal.GetLengthSqr();
+
+		int idx;
+		const float areaMax = LargestProjectedArea(s1, s2, s3, idx);
+		float areas[3];
+		ProjectedAreas(p0, s1, s2, s3, idx, areas);
+
+		Vec3 lambdas = Vec3(areas[0], areas[1], areas[2]) / areaMax;
+		if (!lambdas.IsValid())
+		{
+			lambdas = Vec3(1, 0, 0);
+		}
+		return lambdas;
+	}
+
+	Vec3 NormalDirection(const tri_t& tri, const std::vector<GJK::point_t>& points)
+	{
+		const Vec3& a = points[tri.a].xyz;
+		const Vec3& b = points[tri.b].xyz;
+		const Vec3& c = points[tri.c].xyz;
+
+		Vec3 normal = (b - a).Cross(c - a);
+		normal.Normalize();
+		return normal;
+	}
+
+	float SignedDistanceToTriangle(const tri_t& tri, const Vec3& pt, const std::vector<GJK::point_t>& points)
+	{
+		const Vec3 normal = NormalDirection(tri, points);
+		const Vec3 a2pt = pt - points[tri.a].xyz;
+		return normal.Dot(a2pt);
+	}
+
+	int ClosestTriangle(const std::vector<tri_t>& triangles, const std::vector<GJK::point_t>& points)
+	{
+		float minDistSqr = 1e10f;
+		int idx = -1;
+		for (int i = 0; i < (int)triangles.size(); ++i)
+		{
+			const float dist = SignedDistanceToTriangle(triangles[i], Vec3(0.0f), points);
+			const float distSqr = dist * dist;
+			if (distSqr < minDistSqr)
+			{
+				idx = i;
+				minDistSqr = distSqr;
+			}
+		}
+		return idx;
+	}
+
+	bool HullHasPoint(const Vec3& w, const std::vector<tri_t>& triangles, const std::vector<GJK::point_t>& points)
+	{
+		const float epsilons = 0.001f * 0.001f;
+		for (const tri_t& tri : triangles)
+		{
+			if ((w - points[tri.a].xyz).GetLengthSqr() < epsilons) return true;
+			if ((w - points[tri.b].xyz).GetLengthSqr() < epsilons) return true;
+			if ((w - points[tri.c].xyz).GetLengthSqr() < epsilons) return true;
+		}
+		return false;
+	}
+
+	int RemoveTrianglesFacingPoint(const Vec3& pt, std::vector<tri_t>& triangles, const std::vector<GJK::point_t>& points)
+	{
+		int numRemoved = 0;
+		for (int i = 0; i < (int)triangles.size(); ++i)
+		{
+			if (SignedDistanceToTriangle(triangles[i], pt, points) > 0.0f)
+			{
+				// This triangle faces the point, remove it
+				triangles.erase(triangles.begin() + i);
+				--i;
+				++numRemoved;
+			}
+		}
+		return numRemoved;
+	}
+
+	// Edges of the hole left by the removed triangles, those only used by one triangle
+	void FindDanglingEdges(std::vector<edge_t>& danglingEdges, const std::vector<tri_t>& triangles)
+	{
+		danglingEdges.clear();
+		for (int i = 0; i < (int)triangles.size(); ++i)
+		{
+			const tri_t& tri = triangles[i];
+			const edge_t edges[3] = { { tri.a, tri.b }, { tri.b, tri.c }, { tri.c, tri.a } };
+			int counts[3] = { 0, 0, 0 };
+
+			for (int j = 0; j < (int)triangles.size(); ++j)
+			{
+				if (j == i) continue;
+
+				const tri_t& tri2 = triangles[j];
+				const edge_t edges2[3] = { { tri2.a, tri2.b }, { tri2.b, tri2.c }, { tri2.c, tri2.a } };
+				for (int k = 0; k < 3; ++k)
+				{
+					counts[k] += edges[k] == edges2[0] ? 1 : 0;
+					counts[k] += edges[k] == edges2[1] ? 1 : 0;
+					counts[k] += edges[k] == edges2[2] ? 1 : 0;
+				}
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				if (counts[k] == 0)
+				{
+					danglingEdges.push_back(edges[k]);
+				}
+			}
+		}
+	}
+}
+
+GJK::point_t GJK::Support(const Body& a, const Body& b, Vec3 dir, const float bias)
+{
+	dir.Normalize();
+
+	point_t point;
+	point.dir = dir;
+	point.ptA = a.shape->Support(dir, a.position, a.orientation, bias);
+	point.ptB = b.shape->Support(dir * -1.0f, b.position, b.orientation, bias);
+	point.xyz = point.ptA - point.ptB;
+	return point;
+}
+
+Vec2 GJK::SignedVolume1D(const Vec3& s1, const Vec3& s2)
+{
+	const Vec3 ab = s2 - s1;	// Ray from a to b
+	const Vec3 ap = Vec3(0.0f) - s1;	// Ray from a to the origin
+	const Vec3 p0 = s1 + ab * ab.Dot(ap) / ab.GetLengthSqr();	// Projection of the origin onto the line
+
+	// Choose the axis with the greatest difference/length
+	int idx = 0;
+	float muMax = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		const float mu = s2[i] - s1[i];
+		if (mu * mu > muMax * muMax)
+		{
+			muMax = mu;
+			idx = i;
+		}
+	}
+
+	// Project the simplex points and projected origin onto the axis with greatest length
+	const float a = s1[idx];
+	const float b = s2[idx];
+	const float p = p0[idx];
+
+	// Get the signed distance from a to p and from p to b
+	const float C1 = p - a;
+	const float C2 = b - p;
+
+	// If p is between [a,b]
+	if ((p > a && p < b) || (p > b && p < a))
+	{
+		return Vec2(C2 / muMax, C1 / muMax);
+	}
+
+	// If p is on the far side of a
+	if ((a <= b && p <= a) || (a >= b && p >= a))
+	{
+		return Vec2(1.0f, 0.0f);
+	}
+
+	// p must be on the far side of b
+	return Vec2(0.0f, 1.0f);
+}
+
+Vec3 GJK::SignedVolume2D(const Vec3& s1, const Vec3& s2, const Vec3& s3)
+{
+	const Vec3 normal = (s2 - s1).Cross(s3 - s1);
+	const Vec3 p0 = normal * s1.Dot(normal) / normal.GetLengthSqr();
+
+	// Find the axis with the greatest projected area
+	int idx;
+	const float areaMax = LargestProjectedArea(s1, s2, s3, idx);
+
+	// Project onto the appropriate axis
+	float areas[3];
+	ProjectedAreas(p0, s1, s2, s3, idx, areas);
+
+	// If the projected origin is inside the triangle, then return the barycentric points
+	if (CompareSigns(areaMax, areas[0]) > 0 && CompareSigns(areaMax, areas[1]) > 0 && CompareSigns(areaMax, areas[2]) > 0)
+	{
+		return Vec3(areas[0], areas[1], areas[2]) / areaMax;
+	}
+
+	// Otherwise project onto the edges and keep the closest point
+	float dist = 1e10f;
+	Vec3 lambdas = Vec3(1, 0, 0);
+	const Vec3 edgesPts[3] = { s1, s2, s3 };
+	for (int i = 0; i < 3; ++i)
+	{
+		const int k = (i + 1) % 3;
+		const int l = (i + 2) % 3;
+
+		const Vec2 lambdaEdge = SignedVolume1D(edgesPts[k], edgesPts[l]);
+		const Vec3 pt = edgesPts[k] * lambdaEdge[0] + edgesPts[l] * lambdaEdge[1];
+		if (pt.GetLengthSqr() < dist)
+		{
+			dist = pt.GetLengthSqr();
+			lambdas[i] = 0;
+			lambdas[k] = lambdaEdge[0];
+			lambdas[l] = lambdaEdge[1];
+		}
+	}
+	return lambdas;
+}
+
+void GJK::SignedVolume3D(const Vec3& s1, const Vec3& s2, const Vec3& s3, const Vec3& s4, float lambdas[4])
+{
+	// Barycentric coordinates of the origin: each is the volume of the
+	// tetrahedron with that vertex swapped for the origin, over the whole volume
+	const Vec3 origin = Vec3(0.0f);
+	const float C4[4] =
+	{
+		SignedVolume(origin, s2, s3, s4),
+		SignedVolume(s1, origin, s3, s4),
+		SignedVolume(s1, s2, origin, s4),
+		SignedVolume(s1, s2, s3, origin),
+	};
+	const float detM = SignedVolume(s1, s2, s3, s4);
+
+	// If the barycentric coordinates put the origin within the simplex, then return them
+	if (CompareSigns(detM, C4[0]) > 0 && CompareSigns(detM, C4[1]) > 0 && CompareSigns(detM, C4[2]) > 0 && CompareSigns(detM, C4[3]) > 0)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			lambdas[i] = C4[i] / detM;
+		}
+		return;
+	}
+
+	// Otherwise project the origin onto the faces and keep the closest one
+	float dist = 1e10f;
+	const Vec3 facePts[4] = { s1, s2, s3, s4 };
+	for (int i = 0; i < 4; ++i)
+	{
+		const int j = (i + 1) % 4;
+		const int k = (i + 2) % 4;
+
+		const Vec3 lambdasFace = SignedVolume2D(facePts[i], facePts[j], facePts[k]);
+		const Vec3 pt = facePts[i] * lambdasFace[0] + facePts[j] * lambdasFace[1] + facePts[k] * lambdasFace[2];
+		if (pt.GetLengthSqr() < dist)
+		{
+			dist = pt.GetLengthSqr();
+			lambdas[0] = lambdas[1] = lambdas[2] = lambdas[3] = 0.0f;
+			lambdas[i] = lambdasFace[0];
+			lambdas[j] = lambdasFace[1];
+			lambdas[k] = lambdasFace[2];
+		}
+	}
+}
+
+bool GJK::SimplexSignedVolumes(const point_t* pts, const int num, Vec3& newDir, float lambdas[4])
+{
+	const float epsilonf = 0.0001f * 0.0001f;
+	lambdas[0] = lambdas[1] = lambdas[2] = lambdas[3] = 0.0f;
+
+	Vec3 v;
+	switch (num)
+	{
+	default:
+	case 1:
+	{
+		lambdas[0] = 1.0f;
+		v = pts[0].xyz;
+	} break;
+	case 2:
+	{
+		const Vec2 lambdas2 = SignedVolume1D(pts[0].xyz, pts[1].xyz);
+		lambdas[0] = lambdas2[0];
+		lambdas[1] = lambdas2[1];
+		v = pts[0].xyz * lambdas[0] + pts[1].xyz * lambdas[1];
+	} break;
+	case 3:
+	{
+		const Vec3 lambdas3 = SignedVolume2D(pts[0].xyz, pts[1].xyz, pts[2].xyz);
+		lambdas[0] = lambdas3[0];
+		lambdas[1] = lambdas3[1];
+		lambdas[2] = lambdas3[2];
+		v = pts[0].xyz * lambdas[0] + pts[1].xyz * lambdas[1] + pts[2].xyz * lambdas[2];
+	} break;
+	case 4:
+	{
+		SignedVolume3D(pts[0].xyz, pts[1].xyz, pts[2].xyz, pts[3].xyz, lambdas);
+		v = pts[0].xyz * lambdas[0] + pts[1].xyz * lambdas[1] + pts[2].xyz * lambdas[2] + pts[3].xyz * lambdas[3];
+	} break;
+	}
+
+	// The next search direction is from the closest point towards the origin
+	newDir = v * -1.0f;
+	return v.GetLengthSqr() < epsilonf;
+}
+
+int GJK::SortValids(point_t simplex[4], float lambdas[4], const int num)
+{
+	// Drop the points the closest point does not depend on
+	int numValid = 0;
+	for (int i = 0; i < num; ++i)
+	{
+		if (lambdas[i] == 0.0f) continue;
+
+		simplex[numValid] = simplex[i];
+		lambdas[numValid] = lambdas[i];
+		++numValid;
+	}
+	for (int i = numValid; i < 4; ++i)
+	{
+		lambdas[i] = 0.0f;
+	}
+	return numValid;
+}
+
+bool GJK::HasPoint(const point_t* simplex, const int num, const point_t& newPt)
+{
+	const float precision = 1e-6f;
+	for (int i = 0; i < num; ++i)
+	{
+		const Vec3 delta = simplex[i].xyz - newPt.xyz;
+		if (delta.GetLengthSqr() < precision * precision)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int GJK::StartSimplex(const Body& a, const Body& b, const float bias, const GJKSimplexCache* cache, point_t simplex[4], float lambdas[4], Vec3& newDir, bool& doesContainOrigin)
+{
+	// Rebuild the last simplex from its support directions,
+	// or start from an arbitrary direction without one
+	int numPts = 0;
+	if (nullptr != cache)
+	{
+		for (int i = 0; i < cache->num; ++i)
+		{
+			const point_t pt = Support(a, b, cache->dirs[i], bias);
+			if (!HasPoint(simplex, numPts, pt))
+			{
+				simplex[numPts] = pt;
+				++numPts;
+			}
+		}
+	}
+	if (0 == numPts)
+	{
+		simplex[0] = Support(a, b, Vec3(1, 1, 1), bias);
+		numPts = 1;
+	}
+
+	doesContainOrigin = SimplexSignedVolumes(simplex, numPts, newDir, lambdas);
+	if (!doesContainOrigin)
+	{
+		numPts = SortValids(simplex, lambdas, numPts);
+		doesContainOrigin = (4 == numPts);
+	}
+	return numPts;
+}
+
+void GJK::StoreCache(const point_t* simplex, const int num, GJKSimplexCache* cache)
+{
+	if (nullptr == cache) return;
+
+	cache->num = num;
+	for (int i = 0; i < num; ++i)
+	{
+		cache->dirs[i] = simplex[i].dir;
+	}
+}
+
+bool GJK::DoesIntersect(const Body& a, const Body& b, const float bias, Vec3& ptOnA, Vec3& ptOnB, GJKSimplexCache* cache)
+{
+	point_t simplex[4];
+	float lambdas[4];
+	Vec3 newDir;
+	bool doesContainOrigin;
+	int numPts = StartSimplex(a, b, 0.0f, cache, simplex, lambdas, newDir, doesContainOrigin);
+
+	float closestDist = 1e10f;
+	for (int iteration = 0; !doesContainOrigin && iteration < maxIterations; ++iteration)
+	{
+		// Get the new point to check on
+		const point_t newPt = Support(a, b, newDir, 0.0f);
+
+		// If the new point is the same as a previous point, then we can't expand any further
+		if (HasPoint(simplex, numPts, newPt)) break;
+
+		simplex[numPts] = newPt;
+		++numPts;
+
+		// If this new point hasn't moved passed the origin, then the
+		// origin cannot be in the set. And therefore there is no collision.
+		if (newDir.Dot(newPt.xyz) < 0.0f) break;
+
+		doesContainOrigin = SimplexSignedVolumes(simplex, numPts, newDir, lambdas);
+		if (doesContainOrigin) break;
+
+		// Check that the new projection of the origin onto the simplex is closer than the previous
+		const float dist = newDir.GetLengthSqr();
+		if (dist >= closestDist) break;
+		closestDist = dist;
+
+		// Use the lambdas that support the new search direction, and invalidate any points that don't support it
+		numPts = SortValids(simplex, lambdas, numPts);
+		doesContainOrigin = (4 == numPts);
+	}
+
+	StoreCache(simplex, numPts, cache);
+	if (!doesContainOrigin) return false;
+
+	// Check that we have a 3-simplex (EPA expects a tetrahedron).
+	// When the shapes barely touch the origin is on a face, edge or vertex of
+	// the simplex, which can be a sliver. Points that barely add to the
+	// simplex are dropped, and each missing point is the support furthest
+	// from what is left, so the tetrahedron has volume.
+	if (4 == numPts)
+	{
+		// Height of each point over the triangle the other three make, relative to the simplex size
+		int flattest = -1;
+		float flattestHeight = 1e-3f;
+		float longestSqr = 0.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = i + 1; j < 4; ++j)
+			{
+				longestSqr = std::max(longestSqr, (simplex[j].xyz - simplex[i].xyz).GetLengthSqr());
+			}
+		}
+		const float volume = fabsf(SignedVolume(simplex[0].xyz, simplex[1].xyz, simplex[2].xyz, simplex[3].xyz));
+		for (int i = 0; i < 4; ++i)
+		{
+			const Vec3& s0 = simplex[(i + 1) % 4].xyz;
+			const Vec3& s1 = simplex[(i + 2) % 4].xyz;
+			const Vec3& s2 = simplex[(i + 3) % 4].xyz;
+			const float area = (s1 - s0).Cross(s2 - s0).GetMagnitude();
+			const float height = volume / (area * sqrtf(longestSqr) + 1e-20f);
+			if (height < flattestHeight)
+			{
+				flattestHeight = height;
+				flattest = i;
+			}
+		}
+		if (flattest >= 0)
+		{
+			simplex[flattest] = simplex[3];
+			numPts = 3;
+		}
+	}
+	if (3 == numPts)
+	{
+		const Vec3 ab = simplex[1].xyz - simplex[0].xyz;
+		const Vec3 ac = simplex[2].xyz - simplex[0].xyz;
+		const Vec3 bc = simplex[2].xyz - simplex[1].xyz;
+		const float longestSqr = std::max(ab.GetLengthSqr(), std::max(ac.GetLengthSqr(), bc.GetLengthSqr()));
+		if (ab.Cross(ac).GetLengthSqr() <= 1e-6f * longestSqr * longestSqr)
+		{
+			// Keep the longest edge of a degenerate triangle
+			if (bc.GetLengthSqr() == longestSqr) simplex[0] = simplex[2];
+			else if (ac.GetLengthSqr() == longestSqr) simplex[1] = simplex[2];
+			numPts = 2;
+		}
+	}
+	if (1 == numPts)
+	{
+		simplex[numPts] = Support(a, b, simplex[0].xyz * -1.0f, 0.0f);
+		if ((simplex[1].xyz - simplex[0].xyz).GetLengthSqr() < 1e-8f)
+		{
+			simplex[1] = Support(a, b, Vec3(1, 0, 0), 0.0f);
+		}
+		++numPts;
+	}
+	if (2 == numPts)
+	{
+		const Vec3 ab = simplex[1].xyz - simplex[0].xyz;
+		Vec3 u, v;
+		ab.GetOrtho(u, v);
+		const Vec3 dirs[4] = { u, v, u * -1.0f, v * -1.0f };
+		float bestDistSqr = -1.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			const point_t pt = Support(a, b, dirs[i], 0.0f);
+			const Vec3 ap = pt.xyz - simplex[0].xyz;
+			const float distSqr = ab.Cross(ap).GetLengthSqr();
+			if (distSqr > bestDistSqr)
+			{
+				bestDistSqr = distSqr;
+				simplex[numPts] = pt;
+			}
+		}
+		++numPts;
+	}
+	if (3 == numPts)
+	{
+		const Vec3 ab = simplex[1].xyz - simplex[0].xyz;
+		const Vec3 ac = simplex[2].xyz - simplex[0].xyz;
+		const Vec3 normal = ab.Cross(ac);
+		const point_t above = Support(a, b, normal, 0.0f);
+		const point_t below = Support(a, b, normal * -1.0f, 0.0f);
+		const float distAbove = fabsf(normal.Dot(above.xyz - simplex[0].xyz));
+		const float distBelow = fabsf(normal.Dot(below.xyz - simplex[0].xyz));
+		simplex[numPts] = distAbove >= distBelow ? above : below;
+		++numPts;
+	}
+
+	// Expand the simplex by the bias amount
+	Vec3 avg = Vec3(0.0f);
+	for (int i = 0; i < 4; ++i)
+	{
+		avg += simplex[i].xyz;
+	}
+	avg *= 0.25f;
+	for (int i = 0; i < numPts; ++i)
+	{
+		point_t& pt = simplex[i];
+		Vec3 dir = pt.xyz - avg;
+		dir.Normalize();
+		pt.ptA += dir * bias;
+		pt.ptB -= dir * bias;
+		pt.xyz = pt.ptA - pt.ptB;
+	}
+
+	// Perform EPA expansion of the simplex to find the closest face on the CSO
+	EPA_Expand(a, b, bias, simplex, ptOnA, ptOnB);
+	return true;
+}
+
+void GJK::ClosestPoints(const Body& a, const Body& b, Vec3& ptOnA, Vec3& ptOnB, GJKSimplexCache* cache)
+{
+	point_t simplex[4];
+	float lambdas[4];
+	Vec3 newDir;
+	bool doesContainOrigin;
+	int numPts = StartSimplex(a, b, 0.0f, cache, simplex, lambdas, newDir, doesContainOrigin);
+
+	float closestDist = 1e10f;
+	for (int iteration = 0; !doesContainOrigin && numPts < 4 && iteration < maxIterations; ++iteration)
+	{
+		const point_t newPt = Support(a, b, newDir, 0.0f);
+
+		// If the new point is the same as a previous point, then we can't expand any further
+		if (HasPoint(simplex, numPts, newPt)) break;
+
+		// Add point and get new search direction
+		simplex[numPts] = newPt;
+		++numPts;
+
+		float newLambdas[4];
+		Vec3 dir;
+		SimplexSignedVolumes(simplex, numPts, dir, newLambdas);
+
+		// Check that the new projection of the origin onto the simplex is closer than the previous
+		const float dist = dir.GetLengthSqr();
+		if (dist >= closestDist)
+		{
+			--numPts;
+			break;
+		}
+		closestDist = dist;
+		newDir = dir;
+		for (int i = 0; i < 4; ++i)
+		{
+			lambdas[i] = newLambdas[i];
+		}
+		numPts = SortValids(simplex, lambdas, numPts);
+	}
+
+	StoreCache(simplex, numPts, cache);
+
+	ptOnA.Zero();
+	ptOnB.Zero();
+	for (int i = 0; i < numPts; ++i)
+	{
+		ptOnA += simplex[i].ptA * lambdas[i];
+		ptOnB += simplex[i].ptB * lambdas[i];
+	}
+}
+
+float GJK::EPA_Expand(const Body& a, const Body& b, const float bias, const point_t simplex[4], Vec3& ptOnA, Vec3& ptOnB)
+{
+	// Scratch per thread, so once it has grown to the deepest contact no call
+	// allocates. It outlives any scene, so its growth is not charged to the physics.
+	ScopedMemoryTag tag(MemoryTag::SCRATCH);
+	thread_local std::vector<point_t> points;
+	thread_local std::vector<tri_t> triangles;
+	thread_local std::vector<edge_t> danglingEdges;
+	points.clear();
+	triangles.clear();
+	points.reserve(64);
+	triangles.reserve(64);
+
+	Vec3 center = Vec3(0.0f);
+	for (int i = 0; i < 4; ++i)
+	{
+		points.push_back(simplex[i]);
+		center += simplex[i].xyz;
+	}
+	center *= 0.25f;
+
+	// Build the triangles, wound so the normals point away from the fourth point
+	for (int i = 0; i < 4; ++i)
+	{
+		const int j = (i + 1) % 4;
+		const int k = (i + 2) % 4;
+		tri_t tri = { i, j, k };
+
+		const int unusedPt = (i + 3) % 4;
+		if (SignedDistanceToTriangle(tri, points[unusedPt].xyz, points) > 0.0f)
+		{
+			std::swap(tri.a, tri.b);
+		}
+		triangles.push_back(tri);
+	}
+
+	// Expand the simplex to find the closest face of the CSO to the origin
+	for (int iteration = 0; iteration < 4 * maxIterations; ++iteration)
+	{
+		const int idx = ClosestTriangle(triangles, points);
+		const Vec3 normal = NormalDirection(triangles[idx], points);
+		const point_t newPt = Support(a, b, normal, bias);
+
+		// If the new point is already on the hull, then we can't expand further
+		if (HullHasPoint(newPt.xyz, triangles, points)) break;
+
+		// Nor if it is not past the closest face by more than the precision of
+		// the support points, gentle curves add points that only differ by noise
+		if (SignedDistanceToTriangle(triangles[idx], newPt.xyz, points) <= epaTolerance) break;
+
+		const int newIdx = (int)points.size();
+		points.push_back(newPt);
+
+		// Remove the triangles that face this point
+		if (0 == RemoveTrianglesFacingPoint(newPt.xyz, triangles, points)) break;
+
+		// Find the dangling edges and patch the hole with triangles to the new point
+		FindDanglingEdges(danglingEdges, triangles);
+		if (danglingEdges.empty()) break;
+
+		for (const edge_t& edge : danglingEdges)
+		{
+			tri_t tri = { newIdx, edge.b, edge.a };
+
+			// Make sure it's oriented properly
+			if (SignedDistanceToTriangle(tri, center, points) > 0.0f)
+			{
+				std::swap(tri.b, tri.c);
+			}
+			triangles.push_back(tri);
+		}
+	}
+
+	// Get the projection of the origin on the closest triangle
+	const int idx = ClosestTriangle(triangles, points);
+	const tri_t& tri = triangles[idx];
+	const point_t& ptA = points[tri.a];
+	const point_t& ptB = points[tri.b];
+	const point_t& ptC = points[tri.c];
+	const Vec3 lambdas = BarycentricCoordinates(ptA.xyz, ptB.xyz, ptC.xyz, Vec3(0.0f));
+
+	// Get the point on shape A and shape B
+	ptOnA = ptA.ptA * lambdas[0] + ptB.ptA * lambdas[1] + ptC.ptA * lambdas[2];
+	ptOnB = ptA.ptB * lambdas[0] + ptB.ptB * lambdas[1] + ptC.ptB * lambdas[2];
+
+	// Return the penetration distance
+	const Vec3 delta = ptOnB - ptOnA;
+	return delta.GetMagnitude();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../Body.h"
+#include "../Shape.h"
+
+/// <summary>
+/// Support directions of the simplex GJK finished with for a body pair.
+/// Re-evaluating the supports along them on the next call gives a simplex
+/// that, for bodies that barely moved, is already the answer or one step away.
+/// </summary>
+struct GJKSimplexCache
+{
+	Vec3 dirs[4];
+	int num{ 0 };
+	int lastFrame{ 0 };
+};
+
+class GJK
+{
+public:
+	/// <summary>
+	/// Point of the Minkowski difference A - B along with the points of A and B it came from
+	/// </summary>
+	struct point_t
+	{
+		Vec3 xyz;
+		Vec3 ptA;
+		Vec3 ptB;
+		Vec3 dir;
+	};
+
+	/// <summary>
+	/// True if the shapes (inflated by bias) overlap, in which case EPA
+	/// gives the points of deepest penetration of each body into the other
+	/// </summary>
+	static bool DoesIntersect(const Body& a, const Body& b, const float bias, Vec3& ptOnA, Vec3& ptOnB, GJKSimplexCache* cache = nullptr);
+
+	/// <summary>
+	/// Closest points of two shapes that do not overlap
+	/// </summary>
+	static void ClosestPoints(const Body& a, const Body& b, Vec3& ptOnA, Vec3& ptOnB, GJKSimplexCache* cache = nullptr);
+
+	static point_t Support(const Body& a, const Body& b, Vec3 dir, const float bias);
+
+	/// <summary>
+	/// Barycentric coordinates of the point of the simplex closest to the origin
+	/// </summary>
+	static Vec2 SignedVolume1D(const Vec3& s1, const Vec3& s2);
+	static Vec3 SignedVolume2D(const Vec3& s1, const Vec3& s2, const Vec3& s3);
+	static void SignedVolume3D(const Vec3& s1, const Vec3& s2, const Vec3& s3, const Vec3& s4, float lambdas[4]);
+
+private:
+	static int StartSimplex(const Body& a, const Body& b, const float bias, const GJKSimplexCache* cache, point_t simplex[4], float lambdas[4], Vec3& newDir, bool& doesContainOrigin);
+	static bool SimplexSignedVolumes(const point_t* pts, const int num, Vec3& newDir, float lambdas[4]);
+	static int SortValids(point_t simplex[4], float lambdas[4], const int num);
+	static bool HasPoint(const point_t* simplex, const int num, const point_t& newPt);
+	static void StoreCache(const point_t* simplex, const int num, GJKSimplexCache* cache);
+
+	static float EPA_Expand(const Body& a, const Body& b, const float bias, const point_t simplex[4], Vec3& ptOnA, Vec3& ptOnB);
+};
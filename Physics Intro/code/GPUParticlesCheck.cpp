@@ -0,0 +1,157 @@
+//
+//  GPUParticlesCheck.cpp
+//
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "ParticleSystem.h"
+#include "Renderer/DeviceContext.h"
+#include "Renderer/GPUParticles.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedMs(const Clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static int Check(const bool isPassed, const char* name)
+{
+	printf("  %-40s %s\n", name, isPassed ? "ok" : "FAILED");
+	return isPassed ? 0 : 1;
+}
+
+static int CountContacts(const std::vector<ParticleCorrection>& corrections)
+{
+	long long numContacts = 0;
+	for (const ParticleCorrection& correction : corrections)
+	{
+		numContacts += correction.numContacts;
+	}
+	return (int)(numContacts / 2);
+}
+
+static float MeanHeight(const std::vector<Particle>& particles)
+{
+	double sum = 0.0;
+	for (const Particle& particle : particles)
+	{
+		sum += particle.position.z;
+	}
+	return (float)(sum / std::max((int)particles.size(), 1));
+}
+
+static bool IsAboveFloor(const std::vector<Particle>& particles)
+{
+	return std::all_of(particles.begin(), particles.end(), [](const Particle& particle) { return particle.position.z >= particle.radius - 1.0e-4f && particle.position.IsValid(); });
+}
+
+/*
+====================================================
+Headless device
+No window or surface, so it runs where there is no display, as on a
+software driver like lavapipe
+====================================================
+*/
+static bool CreateHeadlessDevice(DeviceContext& device)
+{
+	device.m_vkSurface = VK_NULL_HANDLE;
+	const std::vector<const char*> extensions;
+	if (!device.CreateInstance(false, extensions))
+	{
+		printf("ERROR: Failed to create vulkan instance\n");
+		return false;
+	}
+	if (!device.CreateDevice() || !device.CreateCommandBuffers())
+	{
+		printf("ERROR: Failed to create vulkan device\n");
+		return false;
+	}
+	return true;
+}
+
+/*
+====================================================
+RunGPUParticlesCheck
+====================================================
+*/
+int RunGPUParticlesCheck(const int numParticles)
+{
+	const int numSteps = 240;	// Two seconds at 120 Hz, long enough to settle
+	const float dt = 1.0f / 120.0f;
+	printf("GPU particles, %i particles for %i steps against the CPU\n", numParticles, numSteps);
+
+	DeviceContext device;
+	if (!CreateHeadlessDevice(device)) return 1;
+
+	ParticleSystem cpu;
+	cpu.AddBlock(numParticles, 0.1f, Vec3(0, 0, 0.5f));
+
+	GPUParticles gpu;
+	if (!gpu.Create(&device, cpu))
+	{
+		device.Cleanup();
+		return 1;
+	}
+
+	int numFailed = 0;
+	std::vector<Particle> gpuParticles(numParticles);
+	std::vector<ParticleCorrection> gpuCorrections(numParticles);
+
+	// Stepped apart, the lists the GPU builds are in the order its threads
+	// got there, so the sums differ in the last bits and the piles only agree overall
+	double cpuMs = 0.0;
+	double gpuMs = 0.0;
+	for (int step = 0; step < numSteps; ++step)
+	{
+		const ParticleParms parms = cpu.GetParms(dt);
+		Clock::time_point start = Clock::now();
+		cpu.Update(dt);
+		cpuMs += ElapsedMs(start);
+
+		start = Clock::now();
+		gpu.Update(&device, parms);
+		gpuMs += ElapsedMs(start);
+	}
+	gpu.ReadBack(&device, gpuParticles.data(), gpuCorrections.data());
+	printf("  cpu %.3f ms per step, gpu %.3f ms per step with the wait\n", cpuMs / numSteps, gpuMs / numSteps);
+
+	const int cpuContacts = cpu.NumContacts();
+	const int gpuContacts = CountContacts(gpuCorrections);
+	const float cpuHeight = MeanHeight(cpu.particles);
+	const float gpuHeight = MeanHeight(gpuParticles);
+	printf("  contacts cpu %i gpu %i, mean height cpu %.4f gpu %.4f\n", cpuContacts, gpuContacts, cpuHeight, gpuHeight);
+	numFailed += Check(IsAboveFloor(gpuParticles), "gpu pile stays above the floor");
+	numFailed += Check(fabsf(gpuHeight - cpuHeight) < 0.02f * cpuHeight, "gpu pile settles as high as the cpu");
+	numFailed += Check(abs(gpuContacts - cpuContacts) <= std::max(cpuContacts / 20, 1), "gpu pile has as many contacts");
+
+	// From the same settled state, one step has to agree particle by particle
+	gpu.Upload(&device, cpu);
+	const ParticleParms parms = cpu.GetParms(dt);
+	cpu.Update(dt);
+	gpu.Update(&device, parms);
+	gpu.ReadBack(&device, gpuParticles.data(), gpuCorrections.data());
+
+	float maxOffset = 0.0f;
+	int numContactsDiffering = 0;
+	for (int i = 0; i < numParticles; ++i)
+	{
+		maxOffset = std::max(maxOffset, (gpuParticles[i].position - cpu.particles[i].position).GetMagnitude());
+		numContactsDiffering += gpuCorrections[i].numContacts == cpu.GetCorrections()[i].numContacts ? 0 : 1;
+	}
+	printf("  one step from the same state: %.3e m apart at most, %i particles count contacts differently\n", maxOffset, numContactsDiffering);
+	numFailed += Check(maxOffset < 1.0e-4f, "one step matches the cpu");
+	numFailed += Check(numContactsDiffering <= numParticles / 1000, "one step finds the same contacts");
+
+	gpu.Cleanup(&device);
+	device.Cleanup();
+
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
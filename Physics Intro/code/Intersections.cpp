@@ -1,6 +1,10 @@
 ﻿#include "Intersections.h"
 
-bool Intersections::Intersect(Body& a, Body& b, const float dt, Contact& contact)
+#include <algorithm>
+
+#include "Math/Simd.h"
+
+bool Intersections::Intersect(Body& a, Body& b, const float dt, Contact& contact, GJKSimplexCache* cache)
 {
 	contact.a = &a;
 	contact.b = &b;
@@ -21,32 +25,150 @@ bool Intersections::Intersect(Body& a, Body& b, const float dt, Contact& contact
 		if (SphereSphereDynamic(*sphereA, *sphereB, posA, posB, valA, velB, dt,
 			contact.ptOnAWorldSpace, contact.ptOnBWorldSpace, contact.timeOfImpact))
 		{
-			// Step bodies forward to get local space collision points
-			a.Update(contact.timeOfImpact);
-			b.Update(contact.timeOfImpact);
-			
-			// Convert world space contacts to local space
-			contact.ptOnALocalSpace = a.WorldSpaceToBodySpace(contact.ptOnAWorldSpace);
-			contact.ptOnBLocalSpace = b.WorldSpaceToBodySpace(contact.ptOnBWorldSpace);
-			
-			Vec3 ab = a.position - b.position;
-			contact.normal = ab;
-			contact.normal.Normalize();
-			
-			// Unwind time step
-			a.Update(-contact.timeOfImpact);
-			b.Update(-contact.timeOfImpact);
-			
-			// Calculate separation distance
-			float r = ab.GetMagnitude() - (sphereA->radius + sphereB->radius);
-			contact.separationDistance = r;
-			
+			FinishSphereContact(a, b, contact);
 			return true;
 		}
+		return false;
+	}
+	
+	// Advance copies so the real bodies are not disturbed by the stepping back and forth
+	Body bodyA = a;
+	Body bodyB = b;
+	if (ConservativeAdvance(bodyA, bodyB, dt, contact, cache))
+	{
+		contact.a = &a;
+		contact.b = &b;
+		return true;
 	}
 	return false;
 }
 
+bool Intersections::IntersectStatic(Body& a, Body& b, Contact& contact, GJKSimplexCache* cache)
+{
+	contact.a = &a;
+	contact.b = &b;
+	contact.timeOfImpact = 0.0f;
+	
+	if (a.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE && b.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE)
+	{
+		const ShapeSphere* sphereA = static_cast<const ShapeSphere*>(a.shape);
+		const ShapeSphere* sphereB = static_cast<const ShapeSphere*>(b.shape);
+		
+		Vec3 ab = b.position - a.position;
+		const float distance = ab.GetMagnitude();
+		ab.Normalize();
+		
+		contact.normal = ab * -1.0f;
+		contact.ptOnAWorldSpace = a.position + ab * sphereA->radius;
+		contact.ptOnBWorldSpace = b.position - ab * sphereB->radius;
+		contact.ptOnALocalSpace = a.WorldSpaceToBodySpace(contact.ptOnAWorldSpace);
+		contact.ptOnBLocalSpace = b.WorldSpaceToBodySpace(contact.ptOnBWorldSpace);
+		contact.separationDistance = distance - (sphereA->radius + sphereB->radius);
+		return contact.separationDistance <= 0.0f;
+	}
+	
+	Vec3 ptOnA;
+	Vec3 ptOnB;
+	const float bias = 0.001f;
+	if (GJK::DoesIntersect(a, b, bias, ptOnA, ptOnB, cache))
+	{
+		// The normal points from B to A, like for spheres
+		Vec3 normal = ptOnB - ptOnA;
+		normal.Normalize();
+		
+		// Remove the bias the shapes were inflated by
+		ptOnA += normal * bias;
+		ptOnB -= normal * bias;
+		
+		contact.normal = normal;
+		contact.ptOnAWorldSpace = ptOnA;
+		contact.ptOnBWorldSpace = ptOnB;
+		contact.ptOnALocalSpace = a.WorldSpaceToBodySpace(ptOnA);
+		contact.ptOnBLocalSpace = b.WorldSpaceToBodySpace(ptOnB);
+		contact.separationDistance = -(ptOnA - ptOnB).GetMagnitude();
+		return true;
+	}
+	
+	// No collision, but the closest points are still needed to advance
+	GJK::ClosestPoints(a, b, ptOnA, ptOnB, cache);
+	contact.normal = ptOnA - ptOnB;
+	contact.normal.Normalize();
+	contact.ptOnAWorldSpace = ptOnA;
+	contact.ptOnBWorldSpace = ptOnB;
+	contact.ptOnALocalSpace = a.WorldSpaceToBodySpace(ptOnA);
+	contact.ptOnBLocalSpace = b.WorldSpaceToBodySpace(ptOnB);
+	contact.separationDistance = (ptOnA - ptOnB).GetMagnitude();
+	return false;
+}
+
+bool Intersections::ConservativeAdvance(Body& a, Body& b, float dt, Contact& contact, GJKSimplexCache* cache)
+{
+	const int maxIterations = 10;
+	
+	float toi = 0.0f;
+	for (int iteration = 0; dt > 0.0f; ++iteration)
+	{
+		if (IntersectStatic(a, b, contact, cache))
+		{
+			contact.timeOfImpact = toi;
+			return true;
+		}
+		if (iteration >= maxIterations) break;
+		
+		// Direction from the closest point on A to the closest point on B
+		Vec3 ab = contact.ptOnBWorldSpace - contact.ptOnAWorldSpace;
+		ab.Normalize();
+		
+		// Upper bound of the closing speed: the relative velocity projected on it
+		// plus the fastest any point of either shape can move along it while rotating
+		const Vec3 relativeVelocity = a.linearVelocity - b.linearVelocity;
+		float orthoSpeed = relativeVelocity.Dot(ab);
+		
+		const Quat invOrientA = a.orientation.Inverse();
+		const Quat invOrientB = b.orientation.Inverse();
+		orthoSpeed += a.shape->FastestLinearSpeed(invOrientA.RotatePoint(a.angularVelocity), invOrientA.RotatePoint(ab));
+		orthoSpeed += b.shape->FastestLinearSpeed(invOrientB.RotatePoint(b.angularVelocity), invOrientB.RotatePoint(ab * -1.0f));
+		if (orthoSpeed <= 0.0f) break;
+		
+		const float timeToGo = contact.separationDistance / orthoSpeed;
+		if (timeToGo > dt) break;
+		
+		dt -= timeToGo;
+		toi += timeToGo;
+		a.Update(timeToGo);
+		b.Update(timeToGo);
+	}
+	return false;
+}
+
+void Intersections::FinishSphereContact(Body& a, Body& b, Contact& contact)
+{
+	const ShapeSphere* sphereA = static_cast<const ShapeSphere*>(a.shape);
+	const ShapeSphere* sphereB = static_cast<const ShapeSphere*>(b.shape);
+	contact.a = &a;
+	contact.b = &b;
+	
+	// Step bodies forward to get local space collision points
+	a.Update(contact.timeOfImpact);
+	b.Update(contact.timeOfImpact);
+	
+	// Convert world space contacts to local space
+	contact.ptOnALocalSpace = a.WorldSpaceToBodySpace(contact.ptOnAWorldSpace);
+	contact.ptOnBLocalSpace = b.WorldSpaceToBodySpace(contact.ptOnBWorldSpace);
+	
+	Vec3 ab = a.position - b.position;
+	contact.normal = ab;
+	contact.normal.Normalize();
+	
+	// Unwind time step
+	a.Update(-contact.timeOfImpact);
+	b.Update(-contact.timeOfImpact);
+	
+	// Calculate separation distance
+	float r = ab.GetMagnitude() - (sphereA->radius + sphereB->radius);
+	contact.separationDistance = r;
+}
+
 bool Intersections::RaySphere(const Vec3& rayStart, const Vec3& rayDir, const Vec3& sphereCenter, const float sphereRadius, float& t0, float& t1)
 {
 	const Vec3& s = sphereCenter - rayStart;
@@ -125,3 +247,140 @@ bool Intersections::SphereSphereDynamic(const ShapeSphere& shapeA, const ShapeSp
 	
 	return true;
 }
+
+
+void SpherePairBatch::Clear()
+{
+	std::vector<float>* arrays[] = { &posAx, &posAy, &posAz, &posBx, &posBy, &posBz,
+		&velAx, &velAy, &velAz, &velBx, &velBy, &velBz, &radiusA, &radiusB };
+	for (std::vector<float>* array : arrays)
+	{
+		array->clear();
+	}
+}
+
+void SpherePairBatch::Reserve(const int num)
+{
+	std::vector<float>* arrays[] = { &posAx, &posAy, &posAz, &posBx, &posBy, &posBz,
+		&velAx, &velAy, &velAz, &velBx, &velBy, &velBz, &radiusA, &radiusB };
+	for (std::vector<float>* array : arrays)
+	{
+		// Doubling like push_back would, so a count that creeps up a pair at a time does not reallocate every step
+		if ((int)array->capacity() < num)
+		{
+			array->reserve(std::max((size_t)num, array->capacity() * 2));
+		}
+	}
+}
+
+void SpherePairBatch::Add(const Vec3& posA, const Vec3& posB, const Vec3& velA, const Vec3& velB, const float rA, const float rB)
+{
+	posAx.push_back(posA.x); posAy.push_back(posA.y); posAz.push_back(posA.z);
+	posBx.push_back(posB.x); posBy.push_back(posB.y); posBz.push_back(posB.z);
+	velAx.push_back(velA.x); velAy.push_back(velA.y); velAz.push_back(velA.z);
+	velBx.push_back(velB.x); velBy.push_back(velB.y); velBz.push_back(velB.z);
+	radiusA.push_back(rA);
+	radiusB.push_back(rB);
+}
+
+void SpherePairResults::Resize(const int num)
+{
+	std::vector<float>* arrays[] = { &timeOfImpact, &ptOnAx, &ptOnAy, &ptOnAz, &ptOnBx, &ptOnBy, &ptOnBz };
+	for (std::vector<float>* array : arrays)
+	{
+		array->resize(num);
+	}
+	hitMask.assign((num + 31) / 32, 0);
+}
+
+// SphereSphereDynamic for T::WIDTH pairs starting at i.
+// Both the "ray too short" and the ray-sphere branches are evaluated
+// and the results blended, so every lane runs the same instructions.
+template <typename T>
+static unsigned int SphereSphereDynamicLanes(const SpherePairBatch& pairs, const int i, const T& dt, SpherePairResults& results)
+{
+	const T zero = T::Splat(0.0f);
+	const T one = T::Splat(1.0f);
+
+	const T pAx = T::Load(&pairs.posAx[i]), pAy = T::Load(&pairs.posAy[i]), pAz = T::Load(&pairs.posAz[i]);
+	const T pBx = T::Load(&pairs.posBx[i]), pBy = T::Load(&pairs.posBy[i]), pBz = T::Load(&pairs.posBz[i]);
+	const T vAx = T::Load(&pairs.velAx[i]), vAy = T::Load(&pairs.velAy[i]), vAz = T::Load(&pairs.velAz[i]);
+	const T vBx = T::Load(&pairs.velBx[i]), vBy = T::Load(&pairs.velBy[i]), vBz = T::Load(&pairs.velBz[i]);
+	const T rA = T::Load(&pairs.radiusA[i]);
+	const T rB = T::Load(&pairs.radiusB[i]);
+	const T radius = rA + rB;
+
+	// Relative motion of A as a ray against a sphere of radius rA + rB at B
+	const T dx = (vAx - vBx) * dt;
+	const T dy = (vAy - vBy) * dt;
+	const T dz = (vAz - vBz) * dt;
+	const T sx = pBx - pAx;
+	const T sy = pBy - pAy;
+	const T sz = pBz - pAz;
+
+	const T a = dx * dx + dy * dy + dz * dz;
+	const T b = sx * dx + sy * dy + sz * dz;
+	const T c = sx * sx + sy * sy + sz * sz - radius * radius;
+
+	// Ray is too short, just check if already intersecting
+	const T isShort = CmpLt(a, T::Splat(0.001f * 0.001f));
+	const T shortRadius = radius + T::Splat(0.001f);
+	const T shortHit = CmpLe(sx * sx + sy * sy + sz * sz, shortRadius * shortRadius);
+
+	const T delta = b * b - a * c;
+	const T rayHit = CmpGe(delta, zero);
+	const T deltaRoot = Sqrt(Max(delta, zero));
+	const T inverseA = one / Select(isShort, one, a);
+	const T t0 = Select(isShort, zero, (b - deltaRoot) * inverseA) * dt;
+	const T t1 = Select(isShort, zero, (b + deltaRoot) * inverseA) * dt;
+
+	// Earliest positive time of impact, which must still be within this frame
+	const T toi = Max(t0, zero);
+	T hit = Select(isShort, shortHit, rayHit);
+	hit = hit & CmpGe(t1, zero) & CmpLe(toi, dt);
+
+	// Points on the respective spheres at the time of impact
+	const T nAx = pAx + vAx * toi, nAy = pAy + vAy * toi, nAz = pAz + vAz * toi;
+	const T nBx = pBx + vBx * toi, nBy = pBy + vBy * toi, nBz = pBz + vBz * toi;
+	T abx = nBx - nAx;
+	T aby = nBy - nAy;
+	T abz = nBz - nAz;
+	const T lengthSqr = abx * abx + aby * aby + abz * abz;
+	const T invLength = Select(CmpGt(lengthSqr, zero), one / Sqrt(Select(CmpGt(lengthSqr, zero), lengthSqr, one)), one);
+	abx = abx * invLength;
+	aby = aby * invLength;
+	abz = abz * invLength;
+
+	toi.Store(&results.timeOfImpact[i]);
+	(nAx + abx * rA).Store(&results.ptOnAx[i]);
+	(nAy + aby * rA).Store(&results.ptOnAy[i]);
+	(nAz + abz * rA).Store(&results.ptOnAz[i]);
+	(nBx - abx * rB).Store(&results.ptOnBx[i]);
+	(nBy - aby * rB).Store(&results.ptOnBy[i]);
+	(nBz - abz * rB).Store(&results.ptOnBz[i]);
+
+	return MoveMask(hit);
+}
+
+void Intersections::SphereSphereDynamicBatch(const SpherePairBatch& pairs, const float dt, SpherePairResults& results)
+{
+	const int num = pairs.Num();
+	results.Resize(num);
+
+	// Lane widths are powers of two up to 16, so a full group never straddles a mask word
+	int i = 0;
+	const SimdWide dtWide = SimdWide::Splat(dt);
+	for (; i + SimdWide::WIDTH <= num; i += SimdWide::WIDTH)
+	{
+		const unsigned int mask = SphereSphereDynamicLanes<SimdWide>(pairs, i, dtWide, results);
+		results.hitMask[i >> 5] |= mask << (i & 31);
+	}
+
+	// Remainder one pair at a time through the same kernel
+	const Simd1 dtScalar = Simd1::Splat(dt);
+	for (; i < num; ++i)
+	{
+		const unsigned int mask = SphereSphereDynamicLanes<Simd1>(pairs, i, dtScalar, results);
+		results.hitMask[i >> 5] |= mask << (i & 31);
+	}
+}
\ No newline at end of file
@@ -3,11 +3,78 @@
 #include "../Body.h"
 #include "../Shape.h"
 #include "Contact.h"
+#include "GJK.h"
+
+#include <vector>
+
+/// <summary>
+/// Packed SoA inputs for Intersections::SphereSphereDynamicBatch, one lane per sphere pair
+/// </summary>
+struct SpherePairBatch
+{
+	std::vector<float> posAx, posAy, posAz;
+	std::vector<float> posBx, posBy, posBz;
+	std::vector<float> velAx, velAy, velAz;
+	std::vector<float> velBx, velBy, velBz;
+	std::vector<float> radiusA, radiusB;
+
+	int Num() const { return (int)radiusA.size(); }
+	void Clear();
+	void Reserve(const int num);
+	void Add(const Vec3& posA, const Vec3& posB, const Vec3& velA, const Vec3& velB, const float rA, const float rB);
+};
+
+/// <summary>
+/// Per pair outputs of Intersections::SphereSphereDynamicBatch.
+/// Lanes that did not hit leave their time of impact and points undefined.
+/// </summary>
+struct SpherePairResults
+{
+	std::vector<float> timeOfImpact;
+	std::vector<float> ptOnAx, ptOnAy, ptOnAz;
+	std::vector<float> ptOnBx, ptOnBy, ptOnBz;
+	std::vector<unsigned int> hitMask; // One bit per pair
+
+	void Resize(const int num);
+	bool IsHit(const int i) const { return ((hitMask[i >> 5] >> (i & 31)) & 1) != 0; }
+	Vec3 PtOnA(const int i) const { return Vec3(ptOnAx[i], ptOnAy[i], ptOnAz[i]); }
+	Vec3 PtOnB(const int i) const { return Vec3(ptOnBx[i], ptOnBy[i], ptOnBz[i]); }
+};
 
 class Intersections
 {
 public:
-	static bool Intersect(Body& a, Body& b, const float dt, Contact& contact);
+	/// <summary>
+	/// Sphere pairs are swept analytically, anything else is advanced
+	/// conservatively with GJK. The optional cache carries the last
+	/// GJK simplex of this pair from one call to the next.
+	/// </summary>
+	static bool Intersect(Body& a, Body& b, const float dt, Contact& contact, GJKSimplexCache* cache = nullptr);
 	static bool RaySphere(const Vec3& rayStart, const Vec3& rayDir, const Vec3& sphereCenter, const float sphereRadius, float& t0, float& t1);
 	static bool SphereSphereDynamic(const ShapeSphere& shapeA, const ShapeSphere& shapeB, const Vec3& posA, const Vec3& posB, const Vec3& velA, const Vec3& velB, const float dt, Vec3& ptOnA, Vec3& ptOnB, float& timeOfImpact);
+
+	/// <summary>
+	/// Same test as SphereSphereDynamic over a whole batch of pairs,
+	/// run branch free on as many lanes as the target SIMD width allows
+	/// </summary>
+	static void SphereSphereDynamicBatch(const SpherePairBatch& pairs, const float dt, SpherePairResults& results);
+
+	/// <summary>
+	/// Fills in the rest of a sphere-sphere contact once the time of impact
+	/// and world space points are known (from either the scalar or batched test)
+	/// </summary>
+	static void FinishSphereContact(Body& a, Body& b, Contact& contact);
+
+	/// <summary>
+	/// Contact between two bodies as they are now, returns false if they do not touch
+	/// but still fills in the closest points, the normal and the separation distance
+	/// </summary>
+	static bool IntersectStatic(Body& a, Body& b, Contact& contact, GJKSimplexCache* cache = nullptr);
+
+private:
+	/// <summary>
+	/// Steps copies of the bodies towards each other by the distance
+	/// between them over the fastest closing speed until they touch
+	/// </summary>
+	static bool ConservativeAdvance(Body& a, Body& b, float dt, Contact& contact, GJKSimplexCache* cache);
 };
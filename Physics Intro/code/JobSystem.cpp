@@ -0,0 +1,314 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+
+namespace
+{
+	std::atomic<int> s_nextSystemId(0);
+
+	// Which system the calling thread last ran jobs for, and its slot there
+	thread_local int t_systemId = -1;
+	thread_local int t_slot = 0;
+}
+
+JobSystem::JobSystem(int numWorkers) : m_numOutsideThreads(0), m_numQueued(0), m_isRunning(true)
+{
+	if (numWorkers <= 0)
+	{
+		numWorkers = std::max((int)std::thread::hardware_concurrency() - 1, 0);
+	}
+	m_id = s_nextSystemId++;
+
+	const int numSlots = numWorkers + MAX_OUTSIDE_THREADS;
+	m_pools.reset(new JobPool[numSlots]);
+	for (int slot = 0; slot < numSlots; ++slot)
+	{
+		m_queues.emplace_back(new WorkQueue);
+
+		JobPool& pool = m_pools[slot];
+		pool.jobs.reset(new Job[MAX_JOBS_PER_THREAD]);
+		pool.next = 0;
+		for (int i = 0; i < MAX_JOBS_PER_THREAD; ++i)
+		{
+			pool.jobs[i].numUnfinished = 0;
+		}
+	}
+
+	for (int slot = 0; slot < numWorkers; ++slot)
+	{
+		m_workers.emplace_back(&JobSystem::WorkerMain, this, slot);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	m_isRunning = false;
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+int JobSystem::ThreadSlot()
+{
+	if (t_systemId != m_id)
+	{
+		// First job from an outside thread, past the maximum they all share the last slot
+		t_systemId = m_id;
+		t_slot = NumWorkers() + std::min(m_numOutsideThreads++, MAX_OUTSIDE_THREADS - 1);
+	}
+	return t_slot;
+}
+
+Job* JobSystem::Allocate()
+{
+	// Skip over jobs that are still going when the ring comes round to them.
+	// One may be the root of a parallel for further up this very thread's
+	// stack, waiting on it here would never return.
+	const int slot = ThreadSlot();
+	JobPool& pool = m_pools[slot];
+	for (;;)
+	{
+		for (int i = 0; i < MAX_JOBS_PER_THREAD; ++i)
+		{
+			Job* job = &pool.jobs[pool.next++ % MAX_JOBS_PER_THREAD];
+			if (job->IsFinished()) return job;
+		}
+
+		// Every job of the ring is in flight, run some of them to free one up
+		Job* next = FindJob(slot);
+		if (nullptr != next)
+		{
+			Execute(next);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+Job* JobSystem::CreateJob(const std::function<void()>& function)
+{
+	Job* job = Allocate();
+	job->function = function;
+	job->rangeFunction = nullptr;
+	job->parent = nullptr;
+	job->numUnfinished = 1;
+	job->numDependencies = 1;
+	job->numContinuations = 0;
+	job->memoryTag = MemoryTracker::ThreadTag();
+	return job;
+}
+
+Job* JobSystem::CreateChildJob(Job* parent, const std::function<void()>& function)
+{
+	parent->numUnfinished.fetch_add(1, std::memory_order_relaxed);
+	Job* job = CreateJob(function);
+	job->parent = parent;
+	return job;
+}
+
+Job* JobSystem::CreateRangeJob(Job* parent, const int begin, const int end, const int grainSize, const std::function<void(int, int)>& function)
+{
+	// The range is kept on the job itself, wrapped in a std::function it would
+	// be too big for its small buffer and every piece of every split would allocate
+	Job* job = CreateChildJob(parent, nullptr);
+	job->rangeFunction = &function;
+	job->rangeBegin = begin;
+	job->rangeEnd = end;
+	job->rangeGrainSize = grainSize;
+	return job;
+}
+
+void JobSystem::AddContinuation(Job* job, Job* continuation)
+{
+	const int index = job->numContinuations++;
+	assert(index < Job::MAX_CONTINUATIONS);
+	continuation->numDependencies.fetch_add(1, std::memory_order_relaxed);
+	job->continuations[index] = continuation;
+}
+
+void JobSystem::Run(Job* job)
+{
+	if (job->numDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		Push(job);
+	}
+}
+
+void JobSystem::Wait(const Job* job)
+{
+	const int slot = ThreadSlot();
+	while (!job->IsFinished())
+	{
+		Job* next = FindJob(slot);
+		if (nullptr != next)
+		{
+			Execute(next);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::Push(Job* job)
+{
+	WorkQueue& queue = *m_queues[ThreadSlot()];
+	{
+		// The queue's storage stays with the job system, whoever's job grew it
+		ScopedMemoryTag tag(MemoryTag::GENERAL);
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	++m_numQueued;
+	m_wake.notify_one();
+}
+
+Job* JobSystem::Pop(const int slot)
+{
+	WorkQueue& queue = *m_queues[slot];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.jobs.empty()) return nullptr;
+
+	Job* job = queue.jobs.back();
+	queue.jobs.pop_back();
+	return job;
+}
+
+Job* JobSystem::Steal(const int slot)
+{
+	// Oldest job of the first other queue that has one, the oldest is the biggest piece of a split range
+	const int numQueues = (int)m_queues.size();
+	for (int i = 1; i < numQueues; ++i)
+	{
+		WorkQueue& queue = *m_queues[(slot + i) % numQueues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty()) continue;
+
+		Job* job = queue.jobs.front();
+		queue.jobs.pop_front();
+		return job;
+	}
+	return nullptr;
+}
+
+Job* JobSystem::FindJob(const int slot)
+{
+	if (m_numQueued.load(std::memory_order_relaxed) <= 0) return nullptr;
+
+	Job* job = Pop(slot);
+	if (nullptr == job)
+	{
+		job = Steal(slot);
+	}
+	if (nullptr != job)
+	{
+		--m_numQueued;
+	}
+	return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	if (nullptr != job->rangeFunction)
+	{
+		ScopedMemoryTag tag(job->memoryTag);
+		SplitRange(job->parent, job->rangeBegin, job->rangeEnd, job->rangeGrainSize, *job->rangeFunction);
+	}
+	else if (job->function)
+	{
+		// Dropped once run, rather than holding what it captured until the ring comes round again
+		ScopedMemoryTag tag(job->memoryTag);
+		job->function();
+		job->function = nullptr;
+	}
+	Finish(job);
+}
+
+void JobSystem::Finish(Job* job)
+{
+	// Read everything off the job before the count that makes it finished, as
+	// a finished job is free to Allocate and its owner may reuse it at once.
+	// Continuations and children are all added before the job can finish, so
+	// these do not change under us.
+	Job* parent = job->parent;
+	Job* continuations[Job::MAX_CONTINUATIONS];
+	const int numContinuations = std::min(job->numContinuations.load(std::memory_order_acquire), (int)Job::MAX_CONTINUATIONS);
+	for (int i = 0; i < numContinuations; ++i)
+	{
+		continuations[i] = job->continuations[i];
+	}
+
+	if (job->numUnfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+	for (int i = 0; i < numContinuations; ++i)
+	{
+		Run(continuations[i]);
+	}
+	if (nullptr != parent)
+	{
+		Finish(parent);
+	}
+}
+
+void JobSystem::ParallelFor(const int begin, const int end, const std::function<void(int, int)>& function, int grainSize)
+{
+	const int count = end - begin;
+	if (count <= 0) return;
+
+	// A few pieces per thread, enough to even out uneven work without drowning in jobs
+	if (grainSize <= 0)
+	{
+		grainSize = std::max(count / (NumThreads() * 8), 1);
+	}
+	if (count <= grainSize)
+	{
+		function(begin, end);
+		return;
+	}
+
+	Job* root = CreateJob(std::function<void()>());
+	SplitRange(root, begin, end, grainSize, function);
+	Finish(root);
+	Wait(root);
+}
+
+void JobSystem::SplitRange(Job* parent, const int begin, const int end, const int grainSize, const std::function<void(int, int)>& function)
+{
+	// Hand off the upper half until what is left is one grain, then run that here
+	int last = end;
+	while (last - begin > grainSize)
+	{
+		const int mid = begin + (last - begin) / 2;
+		Run(CreateRangeJob(parent, mid, last, grainSize, function));
+		last = mid;
+	}
+	function(begin, last);
+}
+
+void JobSystem::WorkerMain(const int slot)
+{
+	t_systemId = m_id;
+	t_slot = slot;
+	PROFILE_THREAD_NAME("Job worker");
+	while (m_isRunning)
+	{
+		Job* job = FindJob(slot);
+		if (nullptr != job)
+		{
+			Execute(job);
+			continue;
+		}
+
+		// A push can land between the check and the wait, the timeout picks it up then
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait_for(lock, std::chrono::milliseconds(1), [this]() { return m_numQueued > 0 || !m_isRunning; });
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MemoryTracker.h"
+
+/// <summary>
+/// Unit of work. A job is finished once its function and all of its
+/// children have run, and only then are its continuations released.
+/// </summary>
+struct Job
+{
+	static const int MAX_CONTINUATIONS = 8;
+
+	std::function<void()> function;
+	const std::function<void(int, int)>* rangeFunction;	// Instead of function, for a piece of a parallel for still to split
+	int rangeBegin;
+	int rangeEnd;
+	int rangeGrainSize;
+	Job* parent;
+	std::atomic<int> numUnfinished;		// Itself and its children
+	std::atomic<int> numDependencies;	// Jobs still to finish before this one may run, plus one until Run
+	std::atomic<int> numContinuations;
+	Job* continuations[MAX_CONTINUATIONS];
+	MemoryTag memoryTag;				// The creating thread's, the job allocates under it
+
+	bool IsFinished() const { return numUnfinished.load(std::memory_order_acquire) == 0; }
+};
+
+/// <summary>
+/// Work-stealing scheduler shared by the physics and the renderer, so the
+/// two never run separate pools that fight over the cores. Every worker
+/// (and every outside thread that submits work) has its own deque: the
+/// owner pushes and pops at the back, idle workers steal the oldest job
+/// from the front of someone else's. A thread waiting on a job runs other
+/// jobs meanwhile instead of blocking.
+///
+/// Jobs come from a ring per thread and are reused once the ring wraps,
+/// so a handle is only good until its thread has created another
+/// MAX_JOBS_PER_THREAD jobs.
+/// </summary>
+class JobSystem
+{
+public:
+	static const int MAX_JOBS_PER_THREAD = 4096;
+	static const int MAX_OUTSIDE_THREADS = 4;
+
+	/// <summary>
+	/// numWorkers of 0 or less uses one worker per core, less the calling thread
+	/// </summary>
+	explicit JobSystem(int numWorkers = 0);
+	~JobSystem();
+
+	int NumWorkers() const { return (int)m_workers.size(); }
+
+	/// <summary>
+	/// Threads that run jobs: the workers and one thread waiting
+	/// </summary>
+	int NumThreads() const { return NumWorkers() + 1; }
+
+	Job* CreateJob(const std::function<void()>& function);
+
+	/// <summary>
+	/// The parent does not finish before the child has
+	/// </summary>
+	Job* CreateChildJob(Job* parent, const std::function<void()>& function);
+
+	/// <summary>
+	/// The continuation runs once job has finished. Set up before either is Run.
+	/// </summary>
+	void AddContinuation(Job* job, Job* continuation);
+
+	/// <summary>
+	/// Submits the job, it starts as soon as the jobs it continues from have finished
+	/// </summary>
+	void Run(Job* job);
+
+	/// <summary>
+	/// Runs other jobs until this one has finished
+	/// </summary>
+	void Wait(const Job* job);
+
+	/// <summary>
+	/// Calls function(first, last) over sub ranges of [begin, end) and waits
+	/// for all of them. Ranges are split in half while longer than the
+	/// grain, so thieves take the big halves and the owner works down to
+	/// the small ones. A grain of 0 picks one from the range and thread count.
+	/// </summary>
+	void ParallelFor(const int begin, const int end, const std::function<void(int, int)>& function, int grainSize = 0);
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job*> jobs;
+	};
+
+	struct JobPool
+	{
+		std::unique_ptr<Job[]> jobs;
+		std::atomic<int> next;	// Atomic as outside threads past the maximum share the last pool
+	};
+
+	int ThreadSlot();
+	Job* Allocate();
+	Job* CreateRangeJob(Job* parent, const int begin, const int end, const int grainSize, const std::function<void(int, int)>& function);
+	void Push(Job* job);
+	Job* Pop(const int slot);
+	Job* Steal(const int slot);
+	Job* FindJob(const int slot);
+	void Execute(Job* job);
+	void Finish(Job* job);
+	void SplitRange(Job* parent, const int begin, const int end, const int grainSize, const std::function<void(int, int)>& function);
+	void WorkerMain(const int slot);
+
+	std::vector<std::thread> m_workers;
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;	// Workers first, then the outside threads
+	std::unique_ptr<JobPool[]> m_pools;
+	int m_id;	// Tells this system's thread slots apart from those of one that lived at the same address
+	std::atomic<int> m_numOutsideThreads;
+	std::atomic<int> m_numQueued;
+	std::atomic<bool> m_isRunning;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;
+};
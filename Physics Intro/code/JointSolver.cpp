@@ -0,0 +1,327 @@
+#include "JointSolver.h"
+
+#include "Math/Simd.h"
+
+#include <algorithm>
+
+int Joint::NumRows() const
+{
+	switch (type)
+	{
+	case JointType::DISTANCE: return 1;
+	case JointType::BALL_SOCKET: return 3;
+	case JointType::HINGE: return 5;
+	case JointType::FIXED: return 6;
+	}
+	return 0;
+}
+
+void JointSolver::JointRows::Resize(const int num)
+{
+	bodyA.resize(num);
+	bodyB.resize(num);
+	for (int i = 0; i < 3; ++i)
+	{
+		n[i].resize(num);
+		angularA[i].resize(num);
+		angularB[i].resize(num);
+		invInertiaAngularA[i].resize(num);
+		invInertiaAngularB[i].resize(num);
+	}
+	invMassA.resize(num);
+	invMassB.resize(num);
+	effectiveMass.resize(num);
+	bias.resize(num);
+	impulse.assign(num, 0.0f);
+}
+
+void JointSolver::Build(const std::vector<Joint>& joints)
+{
+	const int numJoints = (int)joints.size();
+	const int numTypes = 4;
+
+	// Greedy coloring, a joint takes the first color none of its moving bodies has yet.
+	// Static bodies are never written, so any number of joints of a color may share them.
+	int numBodies = 0;
+	for (const Joint& joint : joints)
+	{
+		numBodies = std::max(numBodies, std::max(joint.bodyA, joint.bodyB) + 1);
+	}
+	std::vector<std::vector<int>> bodyColors(numBodies);
+	std::vector<int> colors(numJoints);
+	m_numColors = 0;
+	for (int j = 0; j < numJoints; ++j)
+	{
+		const int ids[2] = { joints[j].bodyA, joints[j].bodyB };
+		int color = 0;
+		for (bool isUsed = true; isUsed; )
+		{
+			isUsed = false;
+			for (int k = 0; k < 2 && !isUsed; ++k)
+			{
+				const std::vector<int>& used = bodyColors[ids[k]];
+				isUsed = std::find(used.begin(), used.end(), color) != used.end();
+			}
+			color += isUsed ? 1 : 0;
+		}
+		for (int k = 0; k < 2; ++k)
+		{
+			if (m_bodies[ids[k]].inverseMass != 0.0f)
+			{
+				bodyColors[ids[k]].push_back(color);
+			}
+		}
+		colors[j] = color;
+		m_numColors = std::max(m_numColors, color + 1);
+	}
+
+	// Bucket the joints by color, then type
+	std::vector<std::vector<int>> buckets(m_numColors * numTypes);
+	m_jointRowStart.resize(numJoints + 1);
+	m_jointRowStart[0] = 0;
+	for (int j = 0; j < numJoints; ++j)
+	{
+		buckets[colors[j] * numTypes + (int)joints[j].type].push_back(j);
+		m_jointRowStart[j + 1] = m_jointRowStart[j] + joints[j].NumRows();
+	}
+	m_jointRowIds.resize(m_jointRowStart[numJoints]);
+	m_rows.Resize(m_jointRowStart[numJoints]);
+
+	// Each slot of the joints in a bucket is one range of rows with no body in common
+	m_ranges.clear();
+	int numRows = 0;
+	for (const std::vector<int>& bucket : buckets)
+	{
+		if (bucket.empty()) continue;
+
+		const int numSlots = joints[bucket[0]].NumRows();
+		for (int slot = 0; slot < numSlots; ++slot)
+		{
+			RowRange range;
+			range.first = numRows;
+			range.num = (int)bucket.size();
+			for (const int j : bucket)
+			{
+				m_jointRowIds[m_jointRowStart[j] + slot] = numRows;
+				m_rows.bodyA[numRows] = joints[j].bodyA;
+				m_rows.bodyB[numRows] = joints[j].bodyB;
+				++numRows;
+			}
+			m_ranges.push_back(range);
+		}
+	}
+	m_isDirty = false;
+}
+
+void JointSolver::SetRow(const int row, const Mat3& invInertiaA, const Mat3& invInertiaB, const Vec3& n, const Vec3& angularA, const Vec3& angularB, const float error)
+{
+	const float invMassA = m_bodies[m_rows.bodyA[row]].inverseMass;
+	const float invMassB = m_bodies[m_rows.bodyB[row]].inverseMass;
+	const Vec3 invInertiaAngularA = invInertiaA * angularA;
+	const Vec3 invInertiaAngularB = invInertiaB * angularB;
+	for (int i = 0; i < 3; ++i)
+	{
+		m_rows.n[i][row] = n[i];
+		m_rows.angularA[i][row] = angularA[i];
+		m_rows.angularB[i][row] = angularB[i];
+		m_rows.invInertiaAngularA[i][row] = invInertiaAngularA[i];
+		m_rows.invInertiaAngularB[i][row] = invInertiaAngularB[i];
+	}
+	m_rows.invMassA[row] = invMassA;
+	m_rows.invMassB[row] = invMassB;
+
+	const float k = (invMassA + invMassB) * n.Dot(n) + angularA.Dot(invInertiaAngularA) + angularB.Dot(invInertiaAngularB);
+	m_rows.effectiveMass[row] = k > 0.0f ? 1.0f / k : 0.0f;
+	m_rows.bias[row] = m_biasRate * error;
+}
+
+void JointSolver::ApplyImpulse(const int row, const float lambda)
+{
+	Body& a = m_bodies[m_rows.bodyA[row]];
+	Body& b = m_bodies[m_rows.bodyB[row]];
+	const Vec3 n = Vec3(m_rows.n[0][row], m_rows.n[1][row], m_rows.n[2][row]);
+	a.linearVelocity += n * (lambda * m_rows.invMassA[row]);
+	b.linearVelocity -= n * (lambda * m_rows.invMassB[row]);
+	a.angularVelocity += Vec3(m_rows.invInertiaAngularA[0][row], m_rows.invInertiaAngularA[1][row], m_rows.invInertiaAngularA[2][row]) * lambda;
+	b.angularVelocity += Vec3(m_rows.invInertiaAngularB[0][row], m_rows.invInertiaAngularB[1][row], m_rows.invInertiaAngularB[2][row]) * lambda;
+}
+
+void JointSolver::SetImpulses(const std::vector<float>& impulses)
+{
+	// Impulses of a different set of joints mean nothing here
+	if (m_isDirty || impulses.size() != m_rows.impulse.size()) return;
+	m_rows.impulse = impulses;
+}
+
+void JointSolver::Prepare(const std::vector<Joint>& joints, Body* bodies, const float dt)
+{
+	m_bodies = bodies;
+	if (m_isDirty || m_jointRowStart.size() != joints.size() + 1)
+	{
+		Build(joints);
+	}
+
+	// Soft constraints (Catto, Solver2D): the drift is pulled back by a stiff
+	// damped spring rather than a fraction of it per step. Warm starting
+	// with a plain Baumgarte bias keeps feeding old corrections back in,
+	// and with small substeps that grows into an oscillation.
+	// The spring is kept well under what one step of dt can resolve.
+	const float hertz = std::min(60.0f, 0.25f / dt);
+	const float dampingRatio = 2.0f;
+	const float omega = 2.0f * 3.14159265f * hertz;
+	const float a1 = 2.0f * dampingRatio + dt * omega;
+	const float a2 = dt * omega * a1;
+	const float a3 = 1.0f / (1.0f + a2);
+	m_biasRate = omega / a1;
+	m_massScale = a2 * a3;
+	m_impulseScale = a3;
+
+	const Vec3 axes[3] = { Vec3(1, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, 1) };
+	for (int j = 0; j < (int)joints.size(); ++j)
+	{
+		const Joint& joint = joints[j];
+		const Body& a = bodies[joint.bodyA];
+		const Body& b = bodies[joint.bodyB];
+		const int* rows = &m_jointRowIds[m_jointRowStart[j]];
+
+		const Mat3 invInertiaA = a.GetInverseInertiaTensorWorldSpace();
+		const Mat3 invInertiaB = b.GetInverseInertiaTensorWorldSpace();
+		const Vec3 rA = a.orientation.RotatePoint(joint.anchorA);
+		const Vec3 rB = b.orientation.RotatePoint(joint.anchorB);
+		const Vec3 delta = (a.GetCenterOfMassWorldSpace() + rA) - (b.GetCenterOfMassWorldSpace() + rB);
+
+		if (Joint::JointType::DISTANCE == joint.type)
+		{
+			const float length = delta.GetMagnitude();
+			const Vec3 n = length > 1e-6f ? delta / length : Vec3(0, 0, 1);
+			SetRow(rows[0], invInertiaA, invInertiaB, n, rA.Cross(n), rB.Cross(n) * -1.0f, length - joint.distance);
+			continue;
+		}
+
+		// The anchors stay together along each world axis
+		for (int i = 0; i < 3; ++i)
+		{
+			const Vec3& n = axes[i];
+			SetRow(rows[i], invInertiaA, invInertiaB, n, rA.Cross(n), rB.Cross(n) * -1.0f, delta[i]);
+		}
+
+		if (Joint::JointType::HINGE == joint.type)
+		{
+			// The axis of A stays perpendicular to two directions perpendicular to the axis of B
+			const Vec3 axisA = a.orientation.RotatePoint(joint.axisA);
+			const Vec3 axisB = b.orientation.RotatePoint(joint.axisB);
+			Vec3 perpendiculars[2];
+			axisB.GetOrtho(perpendiculars[0], perpendiculars[1]);
+			for (int i = 0; i < 2; ++i)
+			{
+				const Vec3 angular = axisA.Cross(perpendiculars[i]);
+				SetRow(rows[3 + i], invInertiaA, invInertiaB, Vec3(0.0f), angular, angular * -1.0f, axisA.Dot(perpendiculars[i]));
+			}
+		}
+		else if (Joint::JointType::FIXED == joint.type)
+		{
+			// Rotation taking B from where A wants it to where it is, as an angle per world axis
+			const Quat error = b.orientation * (a.orientation * joint.relativeOrientation).Inverse();
+			const Vec3 angle = error.xyz() * (error.w < 0.0f ? -2.0f : 2.0f);
+			for (int i = 0; i < 3; ++i)
+			{
+				SetRow(rows[3 + i], invInertiaA, invInertiaB, Vec3(0.0f), axes[i] * -1.0f, axes[i], angle[i]);
+			}
+		}
+	}
+
+	// Warm start from the impulses of the last step
+	for (int row = 0; row < NumRows(); ++row)
+	{
+		ApplyImpulse(row, m_rows.impulse[row]);
+	}
+}
+
+template <typename SimdT>
+void JointSolver::SolveLanes(const int first)
+{
+	const int width = SimdT::WIDTH;
+
+	// Gather the velocities of both bodies of every lane
+	float velocities[12][width];
+	for (int lane = 0; lane < width; ++lane)
+	{
+		const Body& a = m_bodies[m_rows.bodyA[first + lane]];
+		const Body& b = m_bodies[m_rows.bodyB[first + lane]];
+		for (int i = 0; i < 3; ++i)
+		{
+			velocities[i][lane] = a.linearVelocity[i];
+			velocities[3 + i][lane] = a.angularVelocity[i];
+			velocities[6 + i][lane] = b.linearVelocity[i];
+			velocities[9 + i][lane] = b.angularVelocity[i];
+		}
+	}
+
+	SimdT linearA[3], angularVelA[3], linearB[3], angularVelB[3];
+	SimdT n[3];
+	SimdT velocity = SimdT::Splat(0.0f);
+	for (int i = 0; i < 3; ++i)
+	{
+		linearA[i] = SimdT::Load(velocities[i]);
+		angularVelA[i] = SimdT::Load(velocities[3 + i]);
+		linearB[i] = SimdT::Load(velocities[6 + i]);
+		angularVelB[i] = SimdT::Load(velocities[9 + i]);
+		n[i] = SimdT::Load(&m_rows.n[i][first]);
+
+		velocity = velocity + n[i] * (linearA[i] - linearB[i]);
+		velocity = velocity + SimdT::Load(&m_rows.angularA[i][first]) * angularVelA[i];
+		velocity = velocity + SimdT::Load(&m_rows.angularB[i][first]) * angularVelB[i];
+	}
+
+	// Equality rows, the accumulated impulse is not clamped
+	const SimdT impulse = SimdT::Load(&m_rows.impulse[first]);
+	const SimdT lambda = SimdT::Splat(0.0f) - SimdT::Splat(m_massScale) * SimdT::Load(&m_rows.effectiveMass[first]) * (velocity + SimdT::Load(&m_rows.bias[first])) - SimdT::Splat(m_impulseScale) * impulse;
+	(impulse + lambda).Store(&m_rows.impulse[first]);
+
+	const SimdT lambdaA = lambda * SimdT::Load(&m_rows.invMassA[first]);
+	const SimdT lambdaB = lambda * SimdT::Load(&m_rows.invMassB[first]);
+	for (int i = 0; i < 3; ++i)
+	{
+		(linearA[i] + n[i] * lambdaA).Store(velocities[i]);
+		(angularVelA[i] + SimdT::Load(&m_rows.invInertiaAngularA[i][first]) * lambda).Store(velocities[3 + i]);
+		(linearB[i] - n[i] * lambdaB).Store(velocities[6 + i]);
+		(angularVelB[i] + SimdT::Load(&m_rows.invInertiaAngularB[i][first]) * lambda).Store(velocities[9 + i]);
+	}
+
+	// Scatter, lanes of a range never share a moving body
+	for (int lane = 0; lane < width; ++lane)
+	{
+		Body& a = m_bodies[m_rows.bodyA[first + lane]];
+		Body& b = m_bodies[m_rows.bodyB[first + lane]];
+		a.linearVelocity = Vec3(velocities[0][lane], velocities[1][lane], velocities[2][lane]);
+		a.angularVelocity = Vec3(velocities[3][lane], velocities[4][lane], velocities[5][lane]);
+		b.linearVelocity = Vec3(velocities[6][lane], velocities[7][lane], velocities[8][lane]);
+		b.angularVelocity = Vec3(velocities[9][lane], velocities[10][lane], velocities[11][lane]);
+	}
+}
+
+void JointSolver::Iterate()
+{
+	for (const RowRange& range : m_ranges)
+	{
+		// Full lanes first, then the rest of the range one row at a time through the same kernel
+		const int last = range.first + range.num;
+		int i = range.first;
+		for (; !m_isScalar && i + SimdWide::WIDTH <= last; i += SimdWide::WIDTH)
+		{
+			SolveLanes<SimdWide>(i);
+		}
+		for (; i < last; ++i)
+		{
+			SolveLanes<Simd1>(i);
+		}
+	}
+}
+
+void JointSolver::Solve(const int numIterations)
+{
+	for (int iteration = 0; iteration < numIterations; ++iteration)
+	{
+		Iterate();
+	}
+}
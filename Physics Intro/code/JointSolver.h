@@ -0,0 +1,127 @@
+#pragma once
+
+#include "../Body.h"
+
+#include <vector>
+
+/// <summary>
+/// Constraint between two bodies. Anchors and axes are kept relative to each
+/// body (about its center of mass), so they follow the bodies as they move.
+/// </summary>
+struct Joint
+{
+	enum class JointType
+	{
+		DISTANCE,		// Anchors stay the same distance apart
+		BALL_SOCKET,	// Anchors stay together, free rotation
+		HINGE,			// Anchors stay together, rotation only about the axis
+		FIXED,			// Anchors stay together, no relative rotation
+	};
+
+	JointType type;
+	int bodyA;
+	int bodyB;
+	Vec3 anchorA;
+	Vec3 anchorB;
+	Vec3 axisA;
+	Vec3 axisB;
+	Quat relativeOrientation;	// Orientation of B in the frame of A when the joint was made
+	float distance;
+
+	/// <summary>
+	/// Scalar rows the joint is made of: linear rows first, then angular rows
+	/// </summary>
+	int NumRows() const;
+};
+
+/// <summary>
+/// Sequential impulse solver for joints. Every joint is split into scalar
+/// Jacobian rows, stored as structure of arrays. Joints are colored so that
+/// joints of one color share no moving body, and within a color the rows
+/// of the same type and slot are solved side by side in SIMD lanes.
+/// Accumulated impulses are kept between steps to warm start the next one,
+/// which long chains need to converge in a few iterations.
+/// </summary>
+class JointSolver
+{
+public:
+	JointSolver() : m_isDirty(true), m_isScalar(false), m_numColors(0) {}
+
+	/// <summary>
+	/// Joints were added or removed, the batches are rebuilt on the next Prepare
+	/// </summary>
+	void MarkDirty() { m_isDirty = true; }
+
+	/// <summary>
+	/// Computes the rows for the current body poses and applies last step's impulses
+	/// </summary>
+	void Prepare(const std::vector<Joint>& joints, Body* bodies, const float dt);
+	void Iterate();
+	void Solve(const int numIterations);
+
+	int NumRows() const { return (int)m_rows.bodyA.size(); }
+
+	/// <summary>
+	/// Accumulated impulses that warm start the next step, one per row
+	/// </summary>
+	const std::vector<float>& GetImpulses() const { return m_rows.impulse; }
+	void SetImpulses(const std::vector<float>& impulses);
+	int NumColors() const { return m_numColors; }
+
+	/// <summary>
+	/// Solves every row through the Simd1 kernel instead of the widest lanes,
+	/// the reference the lanes are checked against
+	/// </summary>
+	void SetScalarLanes(const bool isScalar) { m_isScalar = isScalar; }
+
+private:
+	/// <summary>
+	/// One scalar constraint per index. The velocity along a row is
+	/// n.(vA - vB) + angularA.wA + angularB.wB
+	/// </summary>
+	struct JointRows
+	{
+		void Resize(const int num);
+
+		std::vector<int> bodyA;
+		std::vector<int> bodyB;
+		std::vector<float> n[3];
+		std::vector<float> angularA[3];
+		std::vector<float> angularB[3];
+		std::vector<float> invInertiaAngularA[3];	// World inverse inertia times the angular row
+		std::vector<float> invInertiaAngularB[3];
+		std::vector<float> invMassA;
+		std::vector<float> invMassB;
+		std::vector<float> effectiveMass;
+		std::vector<float> bias;
+		std::vector<float> impulse;
+	};
+
+	/// <summary>
+	/// Rows whose bodies are all different, so they can be solved at once
+	/// </summary>
+	struct RowRange
+	{
+		int first;
+		int num;
+	};
+
+	template <typename SimdT>
+	void SolveLanes(const int first);
+
+	void Build(const std::vector<Joint>& joints);
+	void SetRow(const int row, const Mat3& invInertiaA, const Mat3& invInertiaB, const Vec3& n, const Vec3& angularA, const Vec3& angularB, const float error);
+	void ApplyImpulse(const int row, const float lambda);
+
+	Body* m_bodies;
+	JointRows m_rows;
+	std::vector<RowRange> m_ranges;
+	std::vector<int> m_jointRowStart;	// Where each joint's rows start in m_jointRowIds
+	std::vector<int> m_jointRowIds;		// Row of each of the joint's slots
+	float m_biasRate;
+	float m_massScale;
+	float m_impulseScale;
+	bool m_isDirty;
+	bool m_isScalar;
+	int m_numColors;
+};
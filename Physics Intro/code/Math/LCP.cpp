@@ -2,6 +2,7 @@
 //	LCP.cpp
 //
 #include "LCP.h"
+#include "../MemoryTracker.h"
 
 /*
 ====================================================
@@ -9,6 +10,7 @@ LCP_GaussSeidel
 ====================================================
 */
 VecN LCP_GaussSeidel( const MatN & A, const VecN & b ) {
+	ScopedMemoryTag tag( MemoryTag::SCRATCH );
 	const int N = b.N;
 	VecN x( N );
 	x.Zero();
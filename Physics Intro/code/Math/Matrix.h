@@ -68,61 +68,79 @@ inline const Mat2 & Mat2::operator += ( const Mat2 & rhs )
 
 /*
 ====================================================
-Mat3
+Mat3T
+Templated on the scalar like Vec3T, Mat3 is the float one
 ====================================================
 */
-class Mat3
+template < typename T >
+class Mat3T
 {
 public:
-	Mat3() {}
-	Mat3( const Mat3 & rhs );
-	Mat3( const float * mat );
-	Mat3( const Vec3 & row0, const Vec3 & row1, const Vec3 & row2 );
-	Mat3 & operator = ( const Mat3 & rhs );
+	Mat3T() {}
+	Mat3T( const Mat3T & rhs );
+	Mat3T( const T * mat );
+	Mat3T( const Vec3T< T > & row0, const Vec3T< T > & row1, const Vec3T< T > & row2 );
+	template < typename U > explicit Mat3T( const Mat3T< U > & rhs );
+	Mat3T & operator = ( const Mat3T & rhs );
 
 	void Zero();
 	void Identity();
 
-	float Trace() const;
-	float Determinant() const;
-	Mat3 Transpose() const;
-	Mat3 Inverse() const;
-	Mat2 Minor( const int i, const int j ) const;
-	float Cofactor( const int i, const int j ) const;
+	T Trace() const;
+	T Determinant() const;
+	Mat3T Transpose() const;
+	Mat3T Inverse() const;
+	T Cofactor( const int i, const int j ) const;
 
-	Vec3 operator * ( const Vec3 & rhs ) const;
-	Mat3 operator * ( const float rhs ) const;
-	Mat3 operator * ( const Mat3 & rhs ) const;
-	Mat3 operator + ( const Mat3 & rhs ) const;
-	const Mat3 & operator *= ( const float rhs );
-	const Mat3 & operator += ( const Mat3 & rhs );
+	Vec3T< T > operator * ( const Vec3T< T > & rhs ) const;
+	Mat3T operator * ( const T rhs ) const;
+	Mat3T operator * ( const Mat3T & rhs ) const;
+	Mat3T operator + ( const Mat3T & rhs ) const;
+	const Mat3T & operator *= ( const T rhs );
+	const Mat3T & operator += ( const Mat3T & rhs );
 
 public:
-	Vec3 rows[ 3 ];
+	Vec3T< T > rows[ 3 ];
 };
 
-inline Mat3::Mat3( const Mat3 & rhs )
+typedef Mat3T< float > Mat3;
+typedef Mat3T< double > Mat3d;
+
+template < typename T >
+inline Mat3T< T >::Mat3T( const Mat3T & rhs )
 {
 	rows[ 0 ] = rhs.rows[ 0 ];
 	rows[ 1 ] = rhs.rows[ 1 ];
 	rows[ 2 ] = rhs.rows[ 2 ];
 }
 
-inline Mat3::Mat3( const float * mat )
+template < typename T >
+inline Mat3T< T >::Mat3T( const T * mat )
 {
 	rows[ 0 ] = mat + 0;
 	rows[ 1 ] = mat + 3;
 	rows[ 2 ] = mat + 6;
 }
 
-inline Mat3::Mat3( const Vec3 & row0, const Vec3 & row1, const Vec3 & row2 )
+template < typename T >
+inline Mat3T< T >::Mat3T( const Vec3T< T > & row0, const Vec3T< T > & row1, const Vec3T< T > & row2 )
 {
 	rows[ 0 ] = row0;
 	rows[ 1 ] = row1;
 	rows[ 2 ] = row2;
 }
 
-inline Mat3 & Mat3::operator = ( const Mat3 & rhs )
+template < typename T >
+template < typename U >
+inline Mat3T< T >::Mat3T( const Mat3T< U > & rhs )
+{
+	rows[ 0 ] = Vec3T< T >( rhs.rows[ 0 ] );
+	rows[ 1 ] = Vec3T< T >( rhs.rows[ 1 ] );
+	rows[ 2 ] = Vec3T< T >( rhs.rows[ 2 ] );
+}
+
+template < typename T >
+inline Mat3T< T > & Mat3T< T >::operator = ( const Mat3T & rhs )
 {
 	rows[ 0 ] = rhs.rows[ 0 ];
 	rows[ 1 ] = rhs.rows[ 1 ];
@@ -130,7 +148,8 @@ inline Mat3 & Mat3::operator = ( const Mat3 & rhs )
 	return *this;
 }
 
-inline const Mat3 & Mat3::operator *= ( const float rhs )
+template < typename T >
+inline const Mat3T< T > & Mat3T< T >::operator *= ( const T rhs )
 {
 	rows[ 0 ] *= rhs;
 	rows[ 1 ] *= rhs;
@@ -138,7 +157,8 @@ inline const Mat3 & Mat3::operator *= ( const float rhs )
 	return *this;
 }
 
-inline const Mat3 & Mat3::operator += ( const Mat3 & rhs )
+template < typename T >
+inline const Mat3T< T > & Mat3T< T >::operator += ( const Mat3T & rhs )
 {
 	rows[ 0 ] += rhs.rows[ 0 ];
 	rows[ 1 ] += rhs.rows[ 1 ];
@@ -146,39 +166,44 @@ inline const Mat3 & Mat3::operator += ( const Mat3 & rhs )
 	return *this;
 }
 
-inline void Mat3::Zero()
+template < typename T >
+inline void Mat3T< T >::Zero()
 {
 	rows[ 0 ].Zero();
 	rows[ 1 ].Zero();
 	rows[ 2 ].Zero();
 }
 
-inline void Mat3::Identity()
+template < typename T >
+inline void Mat3T< T >::Identity()
 {
-	rows[ 0 ] = Vec3( 1, 0, 0 );
-	rows[ 1 ] = Vec3( 0, 1, 0 );
-	rows[ 2 ] = Vec3( 0, 0, 1 );
+	rows[ 0 ] = Vec3T< T >( 1, 0, 0 );
+	rows[ 1 ] = Vec3T< T >( 0, 1, 0 );
+	rows[ 2 ] = Vec3T< T >( 0, 0, 1 );
 }
 
-inline float Mat3::Trace() const
+template < typename T >
+inline T Mat3T< T >::Trace() const
 {
-	const float xx = rows[ 0 ][ 0 ] * rows[ 0 ][ 0 ];
-	const float yy = rows[ 1 ][ 1 ] * rows[ 1 ][ 1 ];
-	const float zz = rows[ 2 ][ 2 ] * rows[ 2 ][ 2 ];
+	const T xx = rows[ 0 ][ 0 ] * rows[ 0 ][ 0 ];
+	const T yy = rows[ 1 ][ 1 ] * rows[ 1 ][ 1 ];
+	const T zz = rows[ 2 ][ 2 ] * rows[ 2 ][ 2 ];
 	return ( xx + yy + zz );
 }
 
-inline float Mat3::Determinant() const
+template < typename T >
+inline T Mat3T< T >::Determinant() const
 {
-	const float i = rows[ 0 ][ 0 ] * ( rows[ 1 ][ 1 ] * rows[ 2 ][ 2 ] - rows[ 1 ][ 2 ] * rows[ 2 ][ 1 ] );
-	const float j = rows[ 0 ][ 1 ] * ( rows[ 1 ][ 0 ] * rows[ 2 ][ 2 ] - rows[ 1 ][ 2 ] * rows[ 2 ][ 0 ] );
-	const float k = rows[ 0 ][ 2 ] * ( rows[ 1 ][ 0 ] * rows[ 2 ][ 1 ] - rows[ 1 ][ 1 ] * rows[ 2 ][ 0 ] );
+	const T i = rows[ 0 ][ 0 ] * ( rows[ 1 ][ 1 ] * rows[ 2 ][ 2 ] - rows[ 1 ][ 2 ] * rows[ 2 ][ 1 ] );
+	const T j = rows[ 0 ][ 1 ] * ( rows[ 1 ][ 0 ] * rows[ 2 ][ 2 ] - rows[ 1 ][ 2 ] * rows[ 2 ][ 0 ] );
+	const T k = rows[ 0 ][ 2 ] * ( rows[ 1 ][ 0 ] * rows[ 2 ][ 1 ] - rows[ 1 ][ 1 ] * rows[ 2 ][ 0 ] );
 	return ( i - j + k );
 }
 
-inline Mat3 Mat3::Transpose() const
+template < typename T >
+inline Mat3T< T > Mat3T< T >::Transpose() const
 {
-	Mat3 transpose;
+	Mat3T transpose;
 	for ( int i = 0; i < 3; i++ )
 	{
 		for ( int j = 0; j < 3; j++ )
@@ -189,9 +214,10 @@ inline Mat3 Mat3::Transpose() const
 	return transpose;
 }
 
-inline Mat3 Mat3::Inverse() const
+template < typename T >
+inline Mat3T< T > Mat3T< T >::Inverse() const
 {
-	Mat3 inv;
+	Mat3T inv;
 	for ( int i = 0; i < 3; i++ )
 	{
 		for ( int j = 0; j < 3; j++ )
@@ -199,69 +225,50 @@ inline Mat3 Mat3::Inverse() const
 			inv.rows[ j ][ i ] = Cofactor( i, j );	// Perform the transpose while calculating the cofactors
 		}
 	}
-	float det = Determinant();
-	float invDet = 1.0f / det;
+	T det = Determinant();
+	T invDet = T( 1 ) / det;
 	inv *= invDet;
 	return inv;
 }
 
-inline Mat2 Mat3::Minor( const int i, const int j ) const
+template < typename T >
+inline T Mat3T< T >::Cofactor( const int i, const int j ) const
 {
-	Mat2 minor;
-
-	int yy = 0;
-	for ( int y = 0; y < 3; y++ )
-	{
-		if ( y == j )
-		{
-			continue;
-		}
-
-		int xx = 0;
-		for ( int x = 0; x < 3; x++ )
-		{
-			if ( x == i )
-			{
-				continue;
-			}
-
-			minor.rows[ xx ][ yy ] = rows[ x ][ y ];
-			xx++;
-		}
-
-		yy++;
-	}
-	return minor;
-}
-
-inline float Mat3::Cofactor( const int i, const int j ) const
-{
-	const Mat2 minor = Minor( i, j );
-	const float C = float( pow( -1, i + 1 + j + 1 ) ) * minor.Determinant();
+	// The determinant of the minor, the rows and columns left once row i and column j are struck out.
+	// Worked in place rather than through a Mat2, which is float only.
+	const int x0 = ( 0 == i ) ? 1 : 0;
+	const int x1 = ( 2 == i ) ? 1 : 2;
+	const int y0 = ( 0 == j ) ? 1 : 0;
+	const int y1 = ( 2 == j ) ? 1 : 2;
+	const T minor = rows[ x0 ][ y0 ] * rows[ x1 ][ y1 ] - rows[ x0 ][ y1 ] * rows[ x1 ][ y0 ];
+	const T C = T( pow( -1, i + 1 + j + 1 ) ) * minor;
 	return C;
 }
 
-inline Vec3 Mat3::operator * ( const Vec3 & rhs ) const
+template < typename T >
+inline Vec3T< T > Mat3T< T >::operator * ( const Vec3T< T > & rhs ) const
 {
-	Vec3 tmp;
+	Vec3T< T > tmp;
 	tmp[ 0 ] = rows[ 0 ].Dot( rhs );
 	tmp[ 1 ] = rows[ 1 ].Dot( rhs );
 	tmp[ 2 ] = rows[ 2 ].Dot( rhs );
 	return tmp;
 }
 
-inline Mat3 Mat3::operator * ( const float rhs ) const
+template < typename T >
+inline Mat3T< T > Mat3T< T >::operator * ( const T rhs ) const
 {
-	Mat3 tmp;
+	Mat3T tmp;
 	tmp.rows[ 0 ] = rows[ 0 ] * rhs;
 	tmp.rows[ 1 ] = rows[ 1 ] * rhs;
 	tmp.rows[ 2 ] = rows[ 2 ] * rhs;
 	return tmp;
 }
 
-inline Mat3 Mat3::operator * ( const Mat3 & rhs ) const
+template < typename T >
+inline Mat3T< T > Mat3T< T >::operator * ( const Mat3T & rhs ) const
 {
-	Mat3 tmp;
+	Mat3T tmp;
 	for ( int i = 0; i < 3; i++ )
 	{
 		tmp.rows[ i ].x = rows[ i ].x * rhs.rows[ 0 ].x + rows[ i ].y * rhs.rows[ 1 ].x + rows[ i ].z * rhs.rows[ 2 ].x;
@@ -271,9 +278,10 @@ inline Mat3 Mat3::operator * ( const Mat3 & rhs ) const
 	return tmp;
 }
 
-inline Mat3 Mat3::operator + ( const Mat3 & rhs ) const
+template < typename T >
+inline Mat3T< T > Mat3T< T >::operator + ( const Mat3T & rhs ) const
 {
-	Mat3 tmp;
+	Mat3T tmp;
 	for ( int i = 0; i < 3; i++ )
 	{
 		tmp.rows[ i ] = rows[ i ] + rhs.rows[ i ];
@@ -281,6 +289,9 @@ inline Mat3 Mat3::operator + ( const Mat3 & rhs ) const
 	return tmp;
 }
 
+extern template class Mat3T< float >;
+extern template class Mat3T< double >;
+
 /*
 ====================================================
 Mat4
@@ -0,0 +1,23 @@
+//
+//	Precision.cpp
+//
+#include "Vector.h"
+#include "Matrix.h"
+#include "Quat.h"
+
+/*
+====================================================
+Explicit instantiations
+The headers declare these extern, so each is compiled once here and not
+in every file that uses it. Float is what the engine runs, double is the
+reference the precision benchmark checks it against.
+====================================================
+*/
+template class Vec3T< float >;
+template class Vec3T< double >;
+
+template class Mat3T< float >;
+template class Mat3T< double >;
+
+template class QuatT< float >;
+template class QuatT< double >;
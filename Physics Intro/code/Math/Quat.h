@@ -7,75 +7,95 @@
 
 /*
  ================================
- Quat
+ QuatT
+ Templated on the scalar like Vec3T, Quat is the float one
  ================================
  */
-class Quat {
+template < typename T >
+class QuatT {
 public:
-	Quat();	
-	Quat( const Quat & rhs );
-	Quat( float X, float Y, float Z, float W );
-	Quat( Vec3 n, const float angleRadians );
-	const Quat & operator = ( const Quat & rhs );
+	QuatT();	
+	QuatT( const QuatT & rhs );
+	QuatT( T X, T Y, T Z, T W );
+	QuatT( Vec3T< T > n, const T angleRadians );
+	template < typename U > explicit QuatT( const QuatT< U > & rhs );
+	const QuatT & operator = ( const QuatT & rhs );
 	
-	Quat &	operator *= ( const float & rhs );
-	Quat &	operator *= ( const Quat & rhs );
-	Quat	operator * ( const Quat & rhs ) const;
-
-	void	Normalize();
-	void	Invert();
-	Quat	Inverse() const;
-	float	MagnitudeSquared() const;
-	float	GetMagnitude() const;
-	Vec3	RotatePoint( const Vec3 & rhs ) const;
-	Mat3	RotateMatrix( const Mat3 & rhs ) const;
-	Vec3	xyz() const { return Vec3( x, y, z ); }
-	bool	IsValid() const;
-
-	Mat3	ToMat3() const;
-	Vec4	ToVec4() const { return Vec4( w, x, y, z ); }
+	QuatT &	operator *= ( const T & rhs );
+	QuatT &	operator *= ( const QuatT & rhs );
+	QuatT	operator * ( const QuatT & rhs ) const;
+
+	void		Normalize();
+	void		Invert();
+	QuatT		Inverse() const;
+	T			MagnitudeSquared() const;
+	T			GetMagnitude() const;
+	Vec3T< T >	RotatePoint( const Vec3T< T > & rhs ) const;
+	Mat3T< T >	RotateMatrix( const Mat3T< T > & rhs ) const;
+	Vec3T< T >	xyz() const { return Vec3T< T >( x, y, z ); }
+	bool		IsValid() const;
+
+	Mat3T< T >	ToMat3() const;
+	Vec4		ToVec4() const { return Vec4( float( w ), float( x ), float( y ), float( z ) ); }
 
 public:
-	float w;
-	float x;
-	float y;
-	float z;
+	T w;
+	T x;
+	T y;
+	T z;
 };
 
-inline Quat::Quat() :
+typedef QuatT< float > Quat;
+typedef QuatT< double > Quatd;
+
+template < typename T >
+inline QuatT< T >::QuatT() :
 x( 0 ),
 y( 0 ),
 z( 0 ),
 w( 1 ) {
 }
 
-inline Quat::Quat( const Quat &rhs ) :
+template < typename T >
+inline QuatT< T >::QuatT( const QuatT &rhs ) :
 x( rhs.x ),
 y( rhs.y ),
 z( rhs.z ),
 w( rhs.w ) {
 }
 
-inline Quat::Quat( float X, float Y, float Z, float W ) :
+template < typename T >
+inline QuatT< T >::QuatT( T X, T Y, T Z, T W ) :
 x( X ),
 y( Y ),
 z( Z ),
 w( W ) {
 }
 
-inline Quat::Quat( Vec3 n, const float angleRadians ) {
-	const float halfAngleRadians = 0.5f * angleRadians;
+template < typename T >
+inline QuatT< T >::QuatT( Vec3T< T > n, const T angleRadians ) {
+	const T halfAngleRadians = T( 0.5 ) * angleRadians;
 
-	w = cosf( halfAngleRadians );
+	w = cos( halfAngleRadians );
 
-	const float halfSine = sinf( halfAngleRadians );
+	const T halfSine = sin( halfAngleRadians );
 	n.Normalize();
 	x = n.x * halfSine;
 	y = n.y * halfSine;
 	z = n.z * halfSine;
 }
 
-inline const Quat & Quat::operator = ( const Quat & rhs ) {
+template < typename T >
+template < typename U >
+inline QuatT< T >::QuatT( const QuatT< U > & rhs ) :
+x( T( rhs.x ) ),
+y( T( rhs.y ) ),
+z( T( rhs.z ) ),
+w( T( rhs.w ) ) {
+}
+
+template < typename T >
+inline const QuatT< T > & QuatT< T >::operator = ( const QuatT & rhs ) {
 	x = rhs.x;
 	y = rhs.y;
 	z = rhs.z;
@@ -83,7 +103,8 @@ inline const Quat & Quat::operator = ( const Quat & rhs ) {
 	return *this;
 }
 
-inline Quat & Quat::operator *= ( const float & rhs ) {
+template < typename T >
+inline QuatT< T > & QuatT< T >::operator *= ( const T & rhs ) {
     x *= rhs;
     y *= rhs;
     z *= rhs;
@@ -91,8 +112,9 @@ inline Quat & Quat::operator *= ( const float & rhs ) {
     return *this;
 }
 
-inline Quat & Quat::operator *= ( const Quat & rhs ) {
-	Quat temp = *this * rhs;
+template < typename T >
+inline QuatT< T > & QuatT< T >::operator *= ( const QuatT & rhs ) {
+	QuatT temp = *this * rhs;
 	w = temp.w;
 	x = temp.x;
 	y = temp.y;
@@ -100,8 +122,9 @@ inline Quat & Quat::operator *= ( const Quat & rhs ) {
 	return *this;
 }
 
-inline Quat Quat::operator * ( const Quat & rhs ) const {
-	Quat temp;	
+template < typename T >
+inline QuatT< T > QuatT< T >::operator * ( const QuatT & rhs ) const {
+	QuatT temp;	
 	temp.w = ( w * rhs.w ) - ( x * rhs.x ) - ( y * rhs.y ) - ( z * rhs.z );
 	temp.x = ( x * rhs.w ) + ( w * rhs.x ) + ( y * rhs.z ) - ( z * rhs.y );
 	temp.y = ( y * rhs.w ) + ( w * rhs.y ) + ( z * rhs.x ) - ( x * rhs.z );
@@ -109,10 +132,11 @@ inline Quat Quat::operator * ( const Quat & rhs ) const {
 	return temp;
 }
 
-inline void Quat::Normalize() {
-	float invMag = 1.0f / GetMagnitude();
+template < typename T >
+inline void QuatT< T >::Normalize() {
+	T invMag = T( 1 ) / GetMagnitude();
 	
-	if ( 0.0f * invMag == 0.0f * invMag ) {
+	if ( T( 0 ) * invMag == T( 0 ) * invMag ) {
 		x = x * invMag;
 		y = y * invMag;
 		z = z * invMag;
@@ -120,34 +144,40 @@ inline void Quat::Normalize() {
 	}
 }
 
-inline void Quat::Invert() {
-    *this *= 1.0f / MagnitudeSquared();
+template < typename T >
+inline void QuatT< T >::Invert() {
+    *this *= T( 1 ) / MagnitudeSquared();
     x = -x;
     y = -y;
     z = -z;
 }
 
-inline Quat Quat::Inverse() const {
-    Quat val( *this );
+template < typename T >
+inline QuatT< T > QuatT< T >::Inverse() const {
+    QuatT val( *this );
     val.Invert();
     return val;
 }
 
-inline float Quat::MagnitudeSquared() const {
+template < typename T >
+inline T QuatT< T >::MagnitudeSquared() const {
     return ( ( x * x ) + ( y * y ) + ( z * z ) + ( w * w ) );
 }
 
-inline float Quat::GetMagnitude() const {
-	return sqrtf( MagnitudeSquared() );
+template < typename T >
+inline T QuatT< T >::GetMagnitude() const {
+	return sqrt( MagnitudeSquared() );
 }
 
-inline Vec3 Quat::RotatePoint( const Vec3 & rhs ) const {
-	Quat vector( rhs.x, rhs.y, rhs.z, 0.0f );
-	Quat final = *this * vector * Inverse();
-	return Vec3( final.x, final.y, final.z );
+template < typename T >
+inline Vec3T< T > QuatT< T >::RotatePoint( const Vec3T< T > & rhs ) const {
+	QuatT vector( rhs.x, rhs.y, rhs.z, T( 0 ) );
+	QuatT final = *this * vector * Inverse();
+	return Vec3T< T >( final.x, final.y, final.z );
 }
 
-inline bool Quat::IsValid() const {
+template < typename T >
+inline bool QuatT< T >::IsValid() const {
 	if ( x * 0 != x * 0 ) {
 		return false;
 	}
@@ -163,20 +193,25 @@ inline bool Quat::IsValid() const {
 	return true;
 }
 
-inline Mat3 Quat::RotateMatrix( const Mat3 & rhs ) const {
-	Mat3 mat;
+template < typename T >
+inline Mat3T< T > QuatT< T >::RotateMatrix( const Mat3T< T > & rhs ) const {
+	Mat3T< T > mat;
 	mat.rows[ 0 ] = RotatePoint( rhs.rows[ 0 ] );
 	mat.rows[ 1 ] = RotatePoint( rhs.rows[ 1 ] );
 	mat.rows[ 2 ] = RotatePoint( rhs.rows[ 2 ] );
 	return mat;
 }
 
-inline Mat3 Quat::ToMat3() const {
-	Mat3 mat;
+template < typename T >
+inline Mat3T< T > QuatT< T >::ToMat3() const {
+	Mat3T< T > mat;
 	mat.Identity();
 
 	mat.rows[ 0 ] = RotatePoint( mat.rows[ 0 ] );
 	mat.rows[ 1 ] = RotatePoint( mat.rows[ 1 ] );
 	mat.rows[ 2 ] = RotatePoint( mat.rows[ 2 ] );
 	return mat;
-}
\ No newline at end of file
+}
+
+extern template class QuatT< float >;
+extern template class QuatT< double >;
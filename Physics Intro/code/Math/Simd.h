@@ -0,0 +1,192 @@
+//
+//	Simd.h
+//
+#pragma once
+#include <math.h>
+#include <string.h>
+
+#if defined( _M_X64 ) || defined( _M_AMD64 ) || defined( __SSE2__ )
+#define SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined( __AVX__ )
+#define SIMD_AVX 1
+#include <immintrin.h>
+#endif
+#if defined( __AVX512F__ )
+#define SIMD_AVX512 1
+#endif
+
+/*
+ ================================
+ Simd1
+ Scalar lane, used for the remainder of a batch and as the reference backend.
+ Masks are stored as all-ones / all-zero bit patterns, like the vector types.
+ ================================
+ */
+struct Simd1 {
+	enum { WIDTH = 1 };
+
+	Simd1() {}
+	Simd1( float f ) : v( f ) {}
+
+	static Simd1 Load( const float * p ) { return Simd1( *p ); }
+	static Simd1 Splat( const float f ) { return Simd1( f ); }
+	void Store( float * p ) const { *p = v; }
+
+	static unsigned int Bits( const Simd1 & a ) { unsigned int u; memcpy( &u, &a.v, sizeof( u ) ); return u; }
+	static Simd1 FromBits( const unsigned int u ) { Simd1 a; memcpy( &a.v, &u, sizeof( u ) ); return a; }
+	static Simd1 Mask( const bool b ) { return FromBits( b ? 0xffffffffu : 0u ); }
+
+	float v;
+};
+
+inline Simd1 operator + ( const Simd1 & a, const Simd1 & b ) { return Simd1( a.v + b.v ); }
+inline Simd1 operator - ( const Simd1 & a, const Simd1 & b ) { return Simd1( a.v - b.v ); }
+inline Simd1 operator * ( const Simd1 & a, const Simd1 & b ) { return Simd1( a.v * b.v ); }
+inline Simd1 operator / ( const Simd1 & a, const Simd1 & b ) { return Simd1( a.v / b.v ); }
+inline Simd1 operator & ( const Simd1 & a, const Simd1 & b ) { return Simd1::FromBits( Simd1::Bits( a ) & Simd1::Bits( b ) ); }
+inline Simd1 operator | ( const Simd1 & a, const Simd1 & b ) { return Simd1::FromBits( Simd1::Bits( a ) | Simd1::Bits( b ) ); }
+inline Simd1 AndNot( const Simd1 & a, const Simd1 & b ) { return Simd1::FromBits( ~Simd1::Bits( a ) & Simd1::Bits( b ) ); }
+inline Simd1 Min( const Simd1 & a, const Simd1 & b ) { return Simd1( a.v < b.v ? a.v : b.v ); }
+inline Simd1 Max( const Simd1 & a, const Simd1 & b ) { return Simd1( a.v > b.v ? a.v : b.v ); }
+inline Simd1 Sqrt( const Simd1 & a ) { return Simd1( sqrtf( a.v ) ); }
+inline Simd1 CmpLt( const Simd1 & a, const Simd1 & b ) { return Simd1::Mask( a.v < b.v ); }
+inline Simd1 CmpLe( const Simd1 & a, const Simd1 & b ) { return Simd1::Mask( a.v <= b.v ); }
+inline Simd1 CmpGt( const Simd1 & a, const Simd1 & b ) { return Simd1::Mask( a.v > b.v ); }
+inline Simd1 CmpGe( const Simd1 & a, const Simd1 & b ) { return Simd1::Mask( a.v >= b.v ); }
+inline Simd1 Select( const Simd1 & mask, const Simd1 & a, const Simd1 & b ) { return ( mask & a ) | AndNot( mask, b ); }
+inline unsigned int MoveMask( const Simd1 & mask ) { return Simd1::Bits( mask ) >> 31; }
+
+#if defined( SIMD_SSE )
+/*
+ ================================
+ Simd4
+ SSE2, which every x64 target has
+ ================================
+ */
+struct Simd4 {
+	enum { WIDTH = 4 };
+
+	Simd4() {}
+	Simd4( __m128 rhs ) : v( rhs ) {}
+
+	static Simd4 Load( const float * p ) { return _mm_loadu_ps( p ); }
+	static Simd4 Splat( const float f ) { return _mm_set1_ps( f ); }
+	void Store( float * p ) const { _mm_storeu_ps( p, v ); }
+
+	__m128 v;
+};
+
+inline Simd4 operator + ( const Simd4 & a, const Simd4 & b ) { return _mm_add_ps( a.v, b.v ); }
+inline Simd4 operator - ( const Simd4 & a, const Simd4 & b ) { return _mm_sub_ps( a.v, b.v ); }
+inline Simd4 operator * ( const Simd4 & a, const Simd4 & b ) { return _mm_mul_ps( a.v, b.v ); }
+inline Simd4 operator / ( const Simd4 & a, const Simd4 & b ) { return _mm_div_ps( a.v, b.v ); }
+inline Simd4 operator & ( const Simd4 & a, const Simd4 & b ) { return _mm_and_ps( a.v, b.v ); }
+inline Simd4 operator | ( const Simd4 & a, const Simd4 & b ) { return _mm_or_ps( a.v, b.v ); }
+inline Simd4 AndNot( const Simd4 & a, const Simd4 & b ) { return _mm_andnot_ps( a.v, b.v ); }
+inline Simd4 Min( const Simd4 & a, const Simd4 & b ) { return _mm_min_ps( a.v, b.v ); }
+inline Simd4 Max( const Simd4 & a, const Simd4 & b ) { return _mm_max_ps( a.v, b.v ); }
+inline Simd4 Sqrt( const Simd4 & a ) { return _mm_sqrt_ps( a.v ); }
+inline Simd4 CmpLt( const Simd4 & a, const Simd4 & b ) { return _mm_cmplt_ps( a.v, b.v ); }
+inline Simd4 CmpLe( const Simd4 & a, const Simd4 & b ) { return _mm_cmple_ps( a.v, b.v ); }
+inline Simd4 CmpGt( const Simd4 & a, const Simd4 & b ) { return _mm_cmpgt_ps( a.v, b.v ); }
+inline Simd4 CmpGe( const Simd4 & a, const Simd4 & b ) { return _mm_cmpge_ps( a.v, b.v ); }
+inline Simd4 Select( const Simd4 & mask, const Simd4 & a, const Simd4 & b ) { return _mm_or_ps( _mm_and_ps( mask.v, a.v ), _mm_andnot_ps( mask.v, b.v ) ); }
+inline unsigned int MoveMask( const Simd4 & mask ) { return (unsigned int)_mm_movemask_ps( mask.v ); }
+#endif
+
+#if defined( SIMD_AVX )
+/*
+ ================================
+ Simd8
+ AVX, only when the compiler targets it (/arch:AVX or -mavx)
+ ================================
+ */
+struct Simd8 {
+	enum { WIDTH = 8 };
+
+	Simd8() {}
+	Simd8( __m256 rhs ) : v( rhs ) {}
+
+	static Simd8 Load( const float * p ) { return _mm256_loadu_ps( p ); }
+	static Simd8 Splat( const float f ) { return _mm256_set1_ps( f ); }
+	void Store( float * p ) const { _mm256_storeu_ps( p, v ); }
+
+	__m256 v;
+};
+
+inline Simd8 operator + ( const Simd8 & a, const Simd8 & b ) { return _mm256_add_ps( a.v, b.v ); }
+inline Simd8 operator - ( const Simd8 & a, const Simd8 & b ) { return _mm256_sub_ps( a.v, b.v ); }
+inline Simd8 operator * ( const Simd8 & a, const Simd8 & b ) { return _mm256_mul_ps( a.v, b.v ); }
+inline Simd8 operator / ( const Simd8 & a, const Simd8 & b ) { return _mm256_div_ps( a.v, b.v ); }
+inline Simd8 operator & ( const Simd8 & a, const Simd8 & b ) { return _mm256_and_ps( a.v, b.v ); }
+inline Simd8 operator | ( const Simd8 & a, const Simd8 & b ) { return _mm256_or_ps( a.v, b.v ); }
+inline Simd8 AndNot( const Simd8 & a, const Simd8 & b ) { return _mm256_andnot_ps( a.v, b.v ); }
+inline Simd8 Min( const Simd8 & a, const Simd8 & b ) { return _mm256_min_ps( a.v, b.v ); }
+inline Simd8 Max( const Simd8 & a, const Simd8 & b ) { return _mm256_max_ps( a.v, b.v ); }
+inline Simd8 Sqrt( const Simd8 & a ) { return _mm256_sqrt_ps( a.v ); }
+inline Simd8 CmpLt( const Simd8 & a, const Simd8 & b ) { return _mm256_cmp_ps( a.v, b.v, _CMP_LT_OQ ); }
+inline Simd8 CmpLe( const Simd8 & a, const Simd8 & b ) { return _mm256_cmp_ps( a.v, b.v, _CMP_LE_OQ ); }
+inline Simd8 CmpGt( const Simd8 & a, const Simd8 & b ) { return _mm256_cmp_ps( a.v, b.v, _CMP_GT_OQ ); }
+inline Simd8 CmpGe( const Simd8 & a, const Simd8 & b ) { return _mm256_cmp_ps( a.v, b.v, _CMP_GE_OQ ); }
+inline Simd8 Select( const Simd8 & mask, const Simd8 & a, const Simd8 & b ) { return _mm256_blendv_ps( b.v, a.v, mask.v ); }
+inline unsigned int MoveMask( const Simd8 & mask ) { return (unsigned int)_mm256_movemask_ps( mask.v ); }
+#endif
+
+#if defined( SIMD_AVX512 )
+/*
+ ================================
+ Simd16
+ AVX-512F. Masks are kept as vectors so the kernels read the same on every width.
+ ================================
+ */
+struct Simd16 {
+	enum { WIDTH = 16 };
+
+	Simd16() {}
+	Simd16( __m512 rhs ) : v( rhs ) {}
+
+	static Simd16 Load( const float * p ) { return _mm512_loadu_ps( p ); }
+	static Simd16 Splat( const float f ) { return _mm512_set1_ps( f ); }
+	void Store( float * p ) const { _mm512_storeu_ps( p, v ); }
+
+	static Simd16 FromMask( const __mmask16 k ) { return _mm512_castsi512_ps( _mm512_maskz_set1_epi32( k, -1 ) ); }
+	static __mmask16 ToMask( const Simd16 & a ) { return _mm512_test_epi32_mask( _mm512_castps_si512( a.v ), _mm512_castps_si512( a.v ) ); }
+
+	__m512 v;
+};
+
+inline Simd16 operator + ( const Simd16 & a, const Simd16 & b ) { return _mm512_add_ps( a.v, b.v ); }
+inline Simd16 operator - ( const Simd16 & a, const Simd16 & b ) { return _mm512_sub_ps( a.v, b.v ); }
+inline Simd16 operator * ( const Simd16 & a, const Simd16 & b ) { return _mm512_mul_ps( a.v, b.v ); }
+inline Simd16 operator / ( const Simd16 & a, const Simd16 & b ) { return _mm512_div_ps( a.v, b.v ); }
+inline Simd16 operator & ( const Simd16 & a, const Simd16 & b ) { return _mm512_castsi512_ps( _mm512_and_epi32( _mm512_castps_si512( a.v ), _mm512_castps_si512( b.v ) ) ); }
+inline Simd16 operator | ( const Simd16 & a, const Simd16 & b ) { return _mm512_castsi512_ps( _mm512_or_epi32( _mm512_castps_si512( a.v ), _mm512_castps_si512( b.v ) ) ); }
+inline Simd16 AndNot( const Simd16 & a, const Simd16 & b ) { return _mm512_castsi512_ps( _mm512_andnot_epi32( _mm512_castps_si512( a.v ), _mm512_castps_si512( b.v ) ) ); }
+inline Simd16 Min( const Simd16 & a, const Simd16 & b ) { return _mm512_min_ps( a.v, b.v ); }
+inline Simd16 Max( const Simd16 & a, const Simd16 & b ) { return _mm512_max_ps( a.v, b.v ); }
+inline Simd16 Sqrt( const Simd16 & a ) { return _mm512_sqrt_ps( a.v ); }
+inline Simd16 CmpLt( const Simd16 & a, const Simd16 & b ) { return Simd16::FromMask( _mm512_cmp_ps_mask( a.v, b.v, _CMP_LT_OQ ) ); }
+inline Simd16 CmpLe( const Simd16 & a, const Simd16 & b ) { return Simd16::FromMask( _mm512_cmp_ps_mask( a.v, b.v, _CMP_LE_OQ ) ); }
+inline Simd16 CmpGt( const Simd16 & a, const Simd16 & b ) { return Simd16::FromMask( _mm512_cmp_ps_mask( a.v, b.v, _CMP_GT_OQ ) ); }
+inline Simd16 CmpGe( const Simd16 & a, const Simd16 & b ) { return Simd16::FromMask( _mm512_cmp_ps_mask( a.v, b.v, _CMP_GE_OQ ) ); }
+inline Simd16 Select( const Simd16 & mask, const Simd16 & a, const Simd16 & b ) { return _mm512_mask_blend_ps( Simd16::ToMask( mask ), b.v, a.v ); }
+inline unsigned int MoveMask( const Simd16 & mask ) { return (unsigned int)Simd16::ToMask( mask ); }
+#endif
+
+/*
+ ================================
+ SimdWide
+ The widest lane type the compiler was asked to target
+ ================================
+ */
+#if defined( SIMD_AVX512 )
+typedef Simd16 SimdWide;
+#elif defined( SIMD_AVX )
+typedef Simd8 SimdWide;
+#elif defined( SIMD_SSE )
+typedef Simd4 SimdWide;
+#else
+typedef Simd1 SimdWide;
+#endif
@@ -202,78 +202,98 @@ inline bool Vec2::IsValid() const
 
 /*
  ================================
- Vec3
+ Vec3T
+ Templated on the scalar so the physics can be run in double as a
+ reference for the float it ships with. Vec3 is the float one.
  ================================
  */
-class Vec3
+template < typename T >
+class Vec3T
 {
 public:
-	Vec3();
-	Vec3( float value );
-	Vec3( const Vec3 & rhs );
-	Vec3( float X, float Y, float Z );
-	Vec3( const float * xyz );
-	Vec3 & operator = ( const Vec3 & rhs );
-	Vec3 & operator = ( const float * rhs );
+	Vec3T();
+	Vec3T( T value );
+	Vec3T( const Vec3T & rhs );
+	Vec3T( T X, T Y, T Z );
+	Vec3T( const T * xyz );
+	template < typename U > explicit Vec3T( const Vec3T< U > & rhs );
+	Vec3T & operator = ( const Vec3T & rhs );
+	Vec3T & operator = ( const T * rhs );
     
-	bool			operator == ( const Vec3 & rhs ) const;
-	bool			operator != ( const Vec3 & rhs ) const;
-	Vec3			operator + ( const Vec3 & rhs ) const;
-	const Vec3 &	operator += ( const Vec3 & rhs );
-	const Vec3 &	operator -= ( const Vec3 & rhs );
-	Vec3			operator - ( const Vec3 & rhs ) const;
-	Vec3			operator * ( const float rhs ) const;
-    Vec3			operator / ( const float rhs ) const;
-	const Vec3 &	operator *= ( const float rhs );
-    const Vec3 &	operator /= ( const float rhs );
-	float			operator [] ( const int idx ) const;
-	float &			operator [] ( const int idx );
-	
-	void Zero() { x = 0.0f; y = 0.0f; z = 0.0f; }
-
-	Vec3 Cross( const Vec3 & rhs ) const;
-	float Dot( const Vec3 & rhs ) const;
-	
-	const Vec3 & Normalize();
-	float GetMagnitude() const;
-	float GetLengthSqr() const { return Dot( *this ); }
+	bool			operator == ( const Vec3T & rhs ) const;
+	bool			operator != ( const Vec3T & rhs ) const;
+	Vec3T			operator + ( const Vec3T & rhs ) const;
+	const Vec3T &	operator += ( const Vec3T & rhs );
+	const Vec3T &	operator -= ( const Vec3T & rhs );
+	Vec3T			operator - ( const Vec3T & rhs ) const;
+	Vec3T			operator * ( const T rhs ) const;
+    Vec3T			operator / ( const T rhs ) const;
+	const Vec3T &	operator *= ( const T rhs );
+    const Vec3T &	operator /= ( const T rhs );
+	T				operator [] ( const int idx ) const;
+	T &				operator [] ( const int idx );
+	
+	void Zero() { x = T( 0 ); y = T( 0 ); z = T( 0 ); }
+
+	Vec3T Cross( const Vec3T & rhs ) const;
+	T Dot( const Vec3T & rhs ) const;
+	
+	const Vec3T & Normalize();
+	T GetMagnitude() const;
+	T GetLengthSqr() const { return Dot( *this ); }
 	bool IsValid() const;
-	void GetOrtho( Vec3 & u, Vec3 & v ) const;
+	void GetOrtho( Vec3T & u, Vec3T & v ) const;
 	
-	const float * ToPtr() const { return &x; }
+	const T * ToPtr() const { return &x; }
 
 public:
-	float x;
-	float y;
-	float z;
+	T x;
+	T y;
+	T z;
 };
 
-inline Vec3::Vec3() :
+typedef Vec3T< float > Vec3;
+typedef Vec3T< double > Vec3d;
+
+template < typename T >
+inline Vec3T< T >::Vec3T() :
 x( 0 ),
 y( 0 ),
 z( 0 ) {}
 
-inline Vec3::Vec3( float value ) :
+template < typename T >
+inline Vec3T< T >::Vec3T( T value ) :
 x( value ),
 y( value ),
 z( value ) {}
 
-inline Vec3::Vec3( const Vec3 &rhs ) :
+template < typename T >
+inline Vec3T< T >::Vec3T( const Vec3T &rhs ) :
 x( rhs.x ),
 y( rhs.y ),
 z( rhs.z ) {}
 
-inline Vec3::Vec3( float X, float Y, float Z ) :
+template < typename T >
+inline Vec3T< T >::Vec3T( T X, T Y, T Z ) :
 x( X ),
 y( Y ),
 z( Z ) {}
 
-inline Vec3::Vec3( const float * xyz ) :
+template < typename T >
+inline Vec3T< T >::Vec3T( const T * xyz ) :
 x( xyz[ 0 ] ),
 y( xyz[ 1 ] ),
 z( xyz[ 2 ] ) {}
 
-inline Vec3 & Vec3::operator = ( const Vec3 & rhs )
+template < typename T >
+template < typename U >
+inline Vec3T< T >::Vec3T( const Vec3T< U > & rhs ) :
+x( T( rhs.x ) ),
+y( T( rhs.y ) ),
+z( T( rhs.z ) ) {}
+
+template < typename T >
+inline Vec3T< T > & Vec3T< T >::operator = ( const Vec3T & rhs )
 {
 	x = rhs.x;
 	y = rhs.y;
@@ -281,7 +301,8 @@ inline Vec3 & Vec3::operator = ( const Vec3 & rhs )
 	return *this;
 }
 
-inline Vec3& Vec3::operator=( const float * rhs )
+template < typename T >
+inline Vec3T< T > & Vec3T< T >::operator = ( const T * rhs )
 {
 	x = rhs[ 0 ];
 	y = rhs[ 1 ];
@@ -289,7 +310,8 @@ inline Vec3& Vec3::operator=( const float * rhs )
 	return *this;
 }
 
-inline bool Vec3::operator == ( const Vec3 & rhs ) const
+template < typename T >
+inline bool Vec3T< T >::operator == ( const Vec3T & rhs ) const
 {
 	if ( x != rhs.x )
 	{
@@ -309,7 +331,8 @@ inline bool Vec3::operator == ( const Vec3 & rhs ) const
 	return true;
 }
 
-inline bool Vec3::operator != ( const Vec3 & rhs ) const
+template < typename T >
+inline bool Vec3T< T >::operator != ( const Vec3T & rhs ) const
 {
 	if ( *this == rhs )
 	{
@@ -319,16 +342,18 @@ inline bool Vec3::operator != ( const Vec3 & rhs ) const
 	return true;
 }
 
-inline Vec3 Vec3::operator + ( const Vec3 & rhs ) const
+template < typename T >
+inline Vec3T< T > Vec3T< T >::operator + ( const Vec3T & rhs ) const
 {
-	Vec3 temp;
+	Vec3T temp;
 	temp.x = x + rhs.x;
 	temp.y = y + rhs.y;
 	temp.z = z + rhs.z;
 	return temp;
 }
 
-inline const Vec3 & Vec3::operator += ( const Vec3 & rhs )
+template < typename T >
+inline const Vec3T< T > & Vec3T< T >::operator += ( const Vec3T & rhs )
 {
 	x += rhs.x;
 	y += rhs.y;
@@ -336,7 +361,8 @@ inline const Vec3 & Vec3::operator += ( const Vec3 & rhs )
 	return *this;
 }
 
-inline const Vec3 & Vec3::operator -= ( const Vec3 & rhs )
+template < typename T >
+inline const Vec3T< T > & Vec3T< T >::operator -= ( const Vec3T & rhs )
 {
 	x -= rhs.x;
 	y -= rhs.y;
@@ -344,34 +370,38 @@ inline const Vec3 & Vec3::operator -= ( const Vec3 & rhs )
 	return *this;
 }
 
-inline Vec3 Vec3::operator - ( const Vec3 & rhs ) const
+template < typename T >
+inline Vec3T< T > Vec3T< T >::operator - ( const Vec3T & rhs ) const
 {
-	Vec3 temp;
+	Vec3T temp;
 	temp.x = x - rhs.x;
 	temp.y = y - rhs.y;
 	temp.z = z - rhs.z;
 	return temp;
 }
 
-inline Vec3 Vec3::operator * ( const float rhs ) const
+template < typename T >
+inline Vec3T< T > Vec3T< T >::operator * ( const T rhs ) const
 {
-	Vec3 temp;
+	Vec3T temp;
 	temp.x = x * rhs;
 	temp.y = y * rhs;
 	temp.z = z * rhs;
 	return temp;
 }
 
-inline Vec3 Vec3::operator / ( const float rhs ) const
+template < typename T >
+inline Vec3T< T > Vec3T< T >::operator / ( const T rhs ) const
 {
-	Vec3 temp;
+	Vec3T temp;
 	temp.x = x / rhs;
 	temp.y = y / rhs;
 	temp.z = z / rhs;
 	return temp;
 }
 
-inline const Vec3 & Vec3::operator *= ( const float rhs )
+template < typename T >
+inline const Vec3T< T > & Vec3T< T >::operator *= ( const T rhs )
 {
 	x *= rhs;
 	y *= rhs;
@@ -379,7 +409,8 @@ inline const Vec3 & Vec3::operator *= ( const float rhs )
 	return *this;
 }
 
-inline const Vec3 & Vec3::operator /= ( const float rhs )
+template < typename T >
+inline const Vec3T< T > & Vec3T< T >::operator /= ( const T rhs )
 {
 	x /= rhs;
 	y /= rhs;
@@ -387,39 +418,44 @@ inline const Vec3 & Vec3::operator /= ( const float rhs )
 	return *this;
 }
 
-inline float Vec3::operator [] ( const int idx ) const
+template < typename T >
+inline T Vec3T< T >::operator [] ( const int idx ) const
 {
 	assert( idx >= 0 && idx < 3 );
 	return ( &x )[ idx ];
 }
 
-inline float & Vec3::operator [] ( const int idx )
+template < typename T >
+inline T & Vec3T< T >::operator [] ( const int idx )
 {
 	assert( idx >= 0 && idx < 3 );
 	return ( &x )[ idx ];
 }
 
-inline Vec3 Vec3::Cross( const Vec3 & rhs ) const
+template < typename T >
+inline Vec3T< T > Vec3T< T >::Cross( const Vec3T & rhs ) const
 {
 	// This cross product is A x B, where this is A and rhs is B
-	Vec3 temp;
+	Vec3T temp;
 	temp.x = ( y * rhs.z ) - ( rhs.y * z );
 	temp.y = ( rhs.x * z ) - ( x * rhs.z );
 	temp.z = ( x * rhs.y ) - ( rhs.x * y );
 	return temp;
 }
 
-inline float Vec3::Dot( const Vec3 & rhs ) const
+template < typename T >
+inline T Vec3T< T >::Dot( const Vec3T & rhs ) const
 {
-	float temp = ( x * rhs.x ) + ( y * rhs.y ) + ( z * rhs.z );
+	T temp = ( x * rhs.x ) + ( y * rhs.y ) + ( z * rhs.z );
 	return temp;
 }
 
-inline const Vec3 & Vec3::Normalize()
+template < typename T >
+inline const Vec3T< T > & Vec3T< T >::Normalize()
 {
-	float mag = GetMagnitude();
-	float invMag = 1.0f / mag;
-	if ( 0.0f * invMag == 0.0f * invMag )
+	T mag = GetMagnitude();
+	T invMag = T( 1 ) / mag;
+	if ( T( 0 ) * invMag == T( 0 ) * invMag )
 	{
 		x *= invMag;
 		y *= invMag;
@@ -428,29 +464,31 @@ inline const Vec3 & Vec3::Normalize()
     return *this;
 }
 
-inline float Vec3::GetMagnitude() const
+template < typename T >
+inline T Vec3T< T >::GetMagnitude() const
 {
-	float mag;
+	T mag;
 	
 	mag = x * x + y * y + z * z;
-	mag = sqrtf( mag );
+	mag = sqrt( mag );
 	
 	return mag;
 }
 
-inline bool Vec3::IsValid() const
+template < typename T >
+inline bool Vec3T< T >::IsValid() const
 {
-	if ( x * 0.0f != x * 0.0f )
+	if ( x * T( 0 ) != x * T( 0 ) )
 	{
 		return false;
 	}
 	
-	if ( y * 0.0f != y * 0.0f )
+	if ( y * T( 0 ) != y * T( 0 ) )
 	{
 		return false;
 	}
 	
-	if ( z * 0.0f != z * 0.0f )
+	if ( z * T( 0 ) != z * T( 0 ) )
 	{
 		return false;
 	}
@@ -458,12 +496,13 @@ inline bool Vec3::IsValid() const
 	return true;
 }
 
-inline void Vec3::GetOrtho( Vec3 & u, Vec3 & v ) const
+template < typename T >
+inline void Vec3T< T >::GetOrtho( Vec3T & u, Vec3T & v ) const
 {
-	Vec3 n = *this;
+	Vec3T n = *this;
 	n.Normalize();
 
-	const Vec3 w = ( n.z * n.z > 0.9f * 0.9f ) ? Vec3( 1, 0, 0 ) : Vec3( 0, 0, 1 );
+	const Vec3T w = ( n.z * n.z > T( 0.9 ) * T( 0.9 ) ) ? Vec3T( 1, 0, 0 ) : Vec3T( 0, 0, 1 );
 	u = w.Cross( n );
 	u.Normalize();
 
@@ -473,6 +512,9 @@ inline void Vec3::GetOrtho( Vec3 & u, Vec3 & v ) const
 	u.Normalize();
 }
 
+extern template class Vec3T< float >;
+extern template class Vec3T< double >;
+
 /*
  ================================
  Vec4
@@ -0,0 +1,536 @@
+//
+//  MathBenchmarks.cpp
+//
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "Intersections.h"
+#include "Math/LCP.h"
+#include "Math/Matrix.h"
+#include "Math/Quat.h"
+#include "Math/Simd.h"
+#include "Math/Vector.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Results go here so the compiler cannot drop the work that made them
+static volatile float g_sink;
+
+/*
+====================================================
+Measure
+Calls function, which does numOps operations, in batches of at least a
+millisecond; the median of the batches' time per operation is the result
+and the spread between their quartiles tells how far to trust it
+====================================================
+*/
+struct MathTiming
+{
+	double nsPerOp;
+	double spread;	// Interquartile range over the median
+};
+
+template <typename Function>
+static MathTiming Measure(const int numOps, Function function)
+{
+	const int numRepetitions = 15;
+	const double minBatchNs = 1.0e6;
+
+	// Warm the caches and find how many calls fill a batch
+	int numCalls = 1;
+	for (;;)
+	{
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < numCalls; ++i)
+		{
+			g_sink = g_sink + function();
+		}
+		const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		if (ns >= minBatchNs) break;
+		numCalls *= 2;
+	}
+
+	std::vector<double> nsPerOp(numRepetitions);
+	for (int repetition = 0; repetition < numRepetitions; ++repetition)
+	{
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < numCalls; ++i)
+		{
+			g_sink = g_sink + function();
+		}
+		nsPerOp[repetition] = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ((double)numCalls * numOps);
+	}
+	std::sort(nsPerOp.begin(), nsPerOp.end());
+
+	MathTiming timing;
+	timing.nsPerOp = nsPerOp[numRepetitions / 2];
+	timing.spread = (nsPerOp[numRepetitions * 3 / 4] - nsPerOp[numRepetitions / 4]) / timing.nsPerOp;
+	return timing;
+}
+
+static void Report(const char* name, const MathTiming& timing)
+{
+	printf("  %-40s %9.2f ns/op %10.1f Mop/s   +-%.1f%%\n", name, timing.nsPerOp, 1000.0 / timing.nsPerOp, 50.0 * timing.spread);
+}
+
+// For ops long enough that Mop/s reads as zero
+static void ReportSolve(const char* name, const MathTiming& timing)
+{
+	printf("  %-40s %9.2f us/solve %7.0f solves/s +-%.1f%%\n", name, timing.nsPerOp / 1000.0, 1.0e9 / timing.nsPerOp, 50.0 * timing.spread);
+}
+
+static float Random(unsigned int& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return (float)(state >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+/*
+====================================================
+Lane kernels
+The same loop for every SIMD backend, on structure of arrays data. With
+Simd1 it is the scalar reference the wider backends are measured against.
+====================================================
+*/
+struct Vec3Arrays
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+
+	void Resize(const int num) { x.resize(num); y.resize(num); z.resize(num); }
+};
+
+template <typename Lane>
+static void DotLanes(const Vec3Arrays& a, const Vec3Arrays& b, float* out, const int num)
+{
+	for (int i = 0; i < num; i += Lane::WIDTH)
+	{
+		const Lane dot = Lane::Load(&a.x[i]) * Lane::Load(&b.x[i]) + Lane::Load(&a.y[i]) * Lane::Load(&b.y[i]) + Lane::Load(&a.z[i]) * Lane::Load(&b.z[i]);
+		dot.Store(out + i);
+	}
+}
+
+template <typename Lane>
+static void CrossNormalizeLanes(const Vec3Arrays& a, const Vec3Arrays& b, Vec3Arrays& out, const int num)
+{
+	for (int i = 0; i < num; i += Lane::WIDTH)
+	{
+		const Lane ax = Lane::Load(&a.x[i]), ay = Lane::Load(&a.y[i]), az = Lane::Load(&a.z[i]);
+		const Lane bx = Lane::Load(&b.x[i]), by = Lane::Load(&b.y[i]), bz = Lane::Load(&b.z[i]);
+		const Lane cx = ay * bz - az * by;
+		const Lane cy = az * bx - ax * bz;
+		const Lane cz = ax * by - ay * bx;
+		const Lane invLength = Lane::Splat(1.0f) / Sqrt(cx * cx + cy * cy + cz * cz);
+		(cx * invLength).Store(&out.x[i]);
+		(cy * invLength).Store(&out.y[i]);
+		(cz * invLength).Store(&out.z[i]);
+	}
+}
+
+// v + 2w (q x v) + 2 q x (q x v), the same rotation as q v q^-1 for a unit q
+template <typename Lane>
+static void RotateLanes(const Vec3Arrays& q, const float* qw, const Vec3Arrays& v, Vec3Arrays& out, const int num)
+{
+	const Lane two = Lane::Splat(2.0f);
+	for (int i = 0; i < num; i += Lane::WIDTH)
+	{
+		const Lane qx = Lane::Load(&q.x[i]), qy = Lane::Load(&q.y[i]), qz = Lane::Load(&q.z[i]), w = Lane::Load(qw + i);
+		const Lane vx = Lane::Load(&v.x[i]), vy = Lane::Load(&v.y[i]), vz = Lane::Load(&v.z[i]);
+		const Lane tx = two * (qy * vz - qz * vy);
+		const Lane ty = two * (qz * vx - qx * vz);
+		const Lane tz = two * (qx * vy - qy * vx);
+		(vx + w * tx + (qy * tz - qz * ty)).Store(&out.x[i]);
+		(vy + w * ty + (qz * tx - qx * tz)).Store(&out.y[i]);
+		(vz + w * tz + (qx * ty - qy * tx)).Store(&out.z[i]);
+	}
+}
+
+template <typename Lane>
+static float DotNLanes(const float* a, const float* b, const int num)
+{
+	Lane sum = Lane::Splat(0.0f);
+	int i = 0;
+	for (; i + Lane::WIDTH <= num; i += Lane::WIDTH)
+	{
+		sum = sum + Lane::Load(a + i) * Lane::Load(b + i);
+	}
+
+	float lanes[Lane::WIDTH];
+	sum.Store(lanes);
+	float total = 0.0f;
+	for (int lane = 0; lane < Lane::WIDTH; ++lane)
+	{
+		total += lanes[lane];
+	}
+	for (; i < num; ++i)
+	{
+		total += a[i] * b[i];
+	}
+	return total;
+}
+
+/*
+====================================================
+Backends
+Every lane width this build was compiled for
+====================================================
+*/
+template <template <typename> class Bench>
+static void ForEachBackend()
+{
+	Bench<Simd1>::Run("scalar lanes");
+#if defined(SIMD_SSE)
+	Bench<Simd4>::Run("SSE");
+#endif
+#if defined(SIMD_AVX)
+	Bench<Simd8>::Run("AVX");
+#endif
+#if defined(SIMD_AVX512)
+	Bench<Simd16>::Run("AVX-512");
+#endif
+}
+
+static const int NUM_VECTORS = 1024;	// Sized to stay in L1, so these time the arithmetic
+static Vec3Arrays s_a;
+static Vec3Arrays s_b;
+static Vec3Arrays s_out;
+static std::vector<float> s_w;
+static std::vector<float> s_dots;
+static float s_maxError;
+
+template <typename Lane>
+struct DotBench
+{
+	static void Run(const char* backend)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "Vec3 dot, %s", backend);
+		Report(name, Measure(NUM_VECTORS, []() { DotLanes<Lane>(s_a, s_b, s_dots.data(), NUM_VECTORS); return s_dots[7]; }));
+		for (int i = 0; i < NUM_VECTORS; ++i)
+		{
+			const float dot = Vec3(s_a.x[i], s_a.y[i], s_a.z[i]).Dot(Vec3(s_b.x[i], s_b.y[i], s_b.z[i]));
+			s_maxError = std::max(s_maxError, fabsf(s_dots[i] - dot));
+		}
+	}
+};
+
+template <typename Lane>
+struct CrossNormalizeBench
+{
+	static void Run(const char* backend)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "Vec3 cross and normalize, %s", backend);
+		Report(name, Measure(NUM_VECTORS, []() { CrossNormalizeLanes<Lane>(s_a, s_b, s_out, NUM_VECTORS); return s_out.x[7]; }));
+		for (int i = 0; i < NUM_VECTORS; ++i)
+		{
+			Vec3 cross = Vec3(s_a.x[i], s_a.y[i], s_a.z[i]).Cross(Vec3(s_b.x[i], s_b.y[i], s_b.z[i]));
+			cross.Normalize();
+			s_maxError = std::max(s_maxError, (cross - Vec3(s_out.x[i], s_out.y[i], s_out.z[i])).GetMagnitude());
+		}
+	}
+};
+
+template <typename Lane>
+struct RotateBench
+{
+	static void Run(const char* backend)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "Quat rotate point, %s", backend);
+		Report(name, Measure(NUM_VECTORS, []() { RotateLanes<Lane>(s_a, s_w.data(), s_b, s_out, NUM_VECTORS); return s_out.x[7]; }));
+		for (int i = 0; i < NUM_VECTORS; ++i)
+		{
+			const Quat q(s_a.x[i], s_a.y[i], s_a.z[i], s_w[i]);
+			const Vec3 rotated = q.RotatePoint(Vec3(s_b.x[i], s_b.y[i], s_b.z[i]));
+			s_maxError = std::max(s_maxError, (rotated - Vec3(s_out.x[i], s_out.y[i], s_out.z[i])).GetMagnitude());
+		}
+	}
+};
+
+static int s_dotSize;
+static std::vector<float> s_dotA;
+static std::vector<float> s_dotB;
+
+template <typename Lane>
+struct DotNBench
+{
+	static void Run(const char* backend)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "VecN dot %i, %s", s_dotSize, backend);
+		Report(name, Measure(s_dotSize, []() { return DotNLanes<Lane>(s_dotA.data(), s_dotB.data(), s_dotSize); }));
+
+		// Summed in another order, so only close to the scalar sum
+		double exact = 0.0;
+		for (int i = 0; i < s_dotSize; ++i)
+		{
+			exact += (double)s_dotA[i] * s_dotB[i];
+		}
+		s_maxError = std::max(s_maxError, (float)(fabs(DotNLanes<Lane>(s_dotA.data(), s_dotB.data(), s_dotSize) - exact) / s_dotSize));
+	}
+};
+
+/*
+====================================================
+CheckSweptSpheres
+Intersections::SphereSphereDynamicBatch against SphereSphereDynamic on
+the same pairs, one by one. The count leaves a tail too short to fill
+the widest lanes, which goes through the scalar lanes instead. Reports
+the first pair that differs, with its lane, so a bad lane or tail shows.
+====================================================
+*/
+static bool CheckSweptSpheres(unsigned int& seed)
+{
+	const float dt = 0.1f;
+	const int numPairs = NUM_VECTORS + SimdWide::WIDTH - 1;
+	const int numWide = numPairs - numPairs % SimdWide::WIDTH;
+
+	// Pairs that close, miss, already touch, recede, and barely move so the ray is too short
+	SpherePairBatch pairs;
+	std::vector<ShapeSphere> spheresA;
+	std::vector<ShapeSphere> spheresB;
+	for (int i = 0; i < numPairs; ++i)
+	{
+		const Vec3 posA(2.0f * Random(seed), 2.0f * Random(seed), 2.0f * Random(seed));
+		const Vec3 posB = posA + Vec3(2.0f * Random(seed), 2.0f * Random(seed), 2.0f * Random(seed));
+		const float speed = (i % 4 == 3) ? 1.0e-3f : 10.0f;
+		const Vec3 velA = Vec3(Random(seed), Random(seed), Random(seed)) * speed;
+		const Vec3 velB = Vec3(Random(seed), Random(seed), Random(seed)) * speed;
+		spheresA.push_back(ShapeSphere(0.55f + 0.45f * Random(seed)));
+		spheresB.push_back(ShapeSphere(0.55f + 0.45f * Random(seed)));
+		pairs.Add(posA, posB, velA, velB, spheresA[i].radius, spheresB[i].radius);
+	}
+
+	SpherePairResults results;
+	Intersections::SphereSphereDynamicBatch(pairs, dt, results);
+
+	int numHits = 0;
+	int numWrong = 0;
+	int firstWrong = -1;
+	float maxTimeError = 0.0f;
+	float maxPointError = 0.0f;
+	for (int i = 0; i < numPairs; ++i)
+	{
+		const Vec3 posA(pairs.posAx[i], pairs.posAy[i], pairs.posAz[i]);
+		const Vec3 posB(pairs.posBx[i], pairs.posBy[i], pairs.posBz[i]);
+		const Vec3 velA(pairs.velAx[i], pairs.velAy[i], pairs.velAz[i]);
+		const Vec3 velB(pairs.velBx[i], pairs.velBy[i], pairs.velBz[i]);
+		Vec3 ptOnA;
+		Vec3 ptOnB;
+		float timeOfImpact = 0.0f;
+		const bool isHit = Intersections::SphereSphereDynamic(spheresA[i], spheresB[i], posA, posB, velA, velB, dt, ptOnA, ptOnB, timeOfImpact);
+
+		bool isSame = isHit == results.IsHit(i);
+		if (isSame && isHit)
+		{
+			const float timeError = fabsf(results.timeOfImpact[i] - timeOfImpact);
+			const float pointError = std::max((results.PtOnA(i) - ptOnA).GetMagnitude(), (results.PtOnB(i) - ptOnB).GetMagnitude());
+			maxTimeError = std::max(maxTimeError, timeError);
+			maxPointError = std::max(maxPointError, pointError);
+			isSame = timeError < 1.0e-5f && pointError < 1.0e-4f;
+			numHits++;
+		}
+		if (!isSame && firstWrong < 0) firstWrong = i;
+		numWrong += isSame ? 0 : 1;
+	}
+
+	printf(" Swept spheres, %i pairs, %i in lanes of %i and %i in the tail\n", numPairs, numWide, (int)SimdWide::WIDTH, numPairs - numWide);
+	Report("SphereSphereDynamic", Measure(numPairs, [&]()
+	{
+		Vec3 ptOnA;
+		Vec3 ptOnB;
+		float timeOfImpact = 0.0f;
+		float sum = 0.0f;
+		for (int i = 0; i < numPairs; ++i)
+		{
+			const Vec3 posA(pairs.posAx[i], pairs.posAy[i], pairs.posAz[i]);
+			const Vec3 posB(pairs.posBx[i], pairs.posBy[i], pairs.posBz[i]);
+			const Vec3 velA(pairs.velAx[i], pairs.velAy[i], pairs.velAz[i]);
+			const Vec3 velB(pairs.velBx[i], pairs.velBy[i], pairs.velBz[i]);
+			sum += Intersections::SphereSphereDynamic(spheresA[i], spheresB[i], posA, posB, velA, velB, dt, ptOnA, ptOnB, timeOfImpact) ? timeOfImpact : 0.0f;
+		}
+		return sum;
+	}));
+	Report("SphereSphereDynamicBatch", Measure(numPairs, [&]() { Intersections::SphereSphereDynamicBatch(pairs, dt, results); return results.timeOfImpact[7]; }));
+	printf("  %i of %i pairs hit, time of impact within %.2e s, points within %.2e m\n", numHits, numPairs, maxTimeError, maxPointError);
+	if (firstWrong >= 0)
+	{
+		const bool isTail = firstWrong >= numWide;
+		printf("  %i pairs differ, the first is pair %i, %s %i\n", numWrong, firstWrong, isTail ? "tail pair" : "lane", isTail ? firstWrong - numWide : firstWrong % (int)SimdWide::WIDTH);
+	}
+	return 0 == numWrong && numHits > 0;
+}
+
+/*
+====================================================
+RunMathBenchmark
+====================================================
+*/
+int RunMathBenchmark()
+{
+	printf("Math library, median of 15 runs of at least 1 ms, +- half the interquartile range\n");
+	unsigned int seed = 1234;
+
+	// Unit quaternions in a and w, anything in b
+	s_a.Resize(NUM_VECTORS);
+	s_b.Resize(NUM_VECTORS);
+	s_out.Resize(NUM_VECTORS);
+	s_w.resize(NUM_VECTORS);
+	s_dots.resize(NUM_VECTORS);
+	std::vector<Vec3> va(NUM_VECTORS);
+	std::vector<Vec3> vb(NUM_VECTORS);
+	std::vector<Quat> quats(NUM_VECTORS);
+	std::vector<Mat3> mat3s(NUM_VECTORS);
+	std::vector<Mat4> mat4s(NUM_VECTORS);
+	for (int i = 0; i < NUM_VECTORS; ++i)
+	{
+		Quat q(Random(seed), Random(seed), Random(seed), Random(seed));
+		q.Normalize();
+		quats[i] = q;
+		s_a.x[i] = q.x;
+		s_a.y[i] = q.y;
+		s_a.z[i] = q.z;
+		s_w[i] = q.w;
+		vb[i] = Vec3(Random(seed), Random(seed), Random(seed));
+		s_b.x[i] = vb[i].x;
+		s_b.y[i] = vb[i].y;
+		s_b.z[i] = vb[i].z;
+		va[i] = Vec3(q.x, q.y, q.z);
+
+		// Rotations scaled and shifted, well away from singular
+		mat3s[i] = q.ToMat3() * (1.0f + 0.5f * fabsf(Random(seed)));
+		mat4s[i].Identity();
+		for (int row = 0; row < 3; ++row)
+		{
+			mat4s[i].rows[row] = Vec4(mat3s[i].rows[row].x, mat3s[i].rows[row].y, mat3s[i].rows[row].z, Random(seed));
+		}
+	}
+
+	// The math library as the engine calls it, one value at a time
+	printf(" Scalar\n");
+	Report("Vec3 a + b * s", Measure(NUM_VECTORS, [&]()
+	{
+		Vec3 sum(0.0f);
+		for (int i = 0; i < NUM_VECTORS; ++i) sum += va[i] + vb[i] * 0.5f;
+		return sum.x;
+	}));
+	Report("Vec3 dot", Measure(NUM_VECTORS, [&]()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < NUM_VECTORS; ++i) sum += va[i].Dot(vb[i]);
+		return sum;
+	}));
+	Report("Vec3 cross and normalize", Measure(NUM_VECTORS, [&]()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < NUM_VECTORS; ++i) { Vec3 c = va[i].Cross(vb[i]); c.Normalize(); sum += c.x; }
+		return sum;
+	}));
+	Report("Quat::RotatePoint", Measure(NUM_VECTORS, [&]()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < NUM_VECTORS; ++i) sum += quats[i].RotatePoint(vb[i]).x;
+		return sum;
+	}));
+	Report("Quat::ToMat3", Measure(NUM_VECTORS, [&]()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < NUM_VECTORS; ++i) sum += quats[i].ToMat3().rows[1].z;
+		return sum;
+	}));
+	Report("Mat3::Inverse", Measure(NUM_VECTORS, [&]()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < NUM_VECTORS; ++i) sum += mat3s[i].Inverse().rows[2].x;
+		return sum;
+	}));
+	Report("Mat4::Inverse", Measure(NUM_VECTORS, [&]()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < NUM_VECTORS; ++i) sum += mat4s[i].Inverse().rows[3].x;
+		return sum;
+	}));
+	Report("Mat4::LookAt", Measure(NUM_VECTORS, [&]()
+	{
+		float sum = 0.0f;
+		Mat4 view;
+		for (int i = 0; i < NUM_VECTORS; ++i) { view.LookAt(va[i] * 10.0f, vb[i], Vec3(0, 0, 1)); sum += view.rows[0].w; }
+		return sum;
+	}));
+	Report("Mat4::PerspectiveVulkan", Measure(NUM_VECTORS, [&]()
+	{
+		float sum = 0.0f;
+		Mat4 projection;
+		for (int i = 0; i < NUM_VECTORS; ++i) { projection.PerspectiveVulkan(45.0f + vb[i].x, 1.5f, 0.1f, 1000.0f); sum += projection.rows[0].x; }
+		return sum;
+	}));
+
+	// The same work on structure of arrays, every backend this build has
+	printf(" Lanes, %i vectors\n", NUM_VECTORS);
+	s_maxError = 0.0f;
+	ForEachBackend<DotBench>();
+	ForEachBackend<CrossNormalizeBench>();
+	ForEachBackend<RotateBench>();
+	const bool isLanesSame = s_maxError < 1.0e-5f;
+
+	printf(" VecN dot\n");
+	const int dotSizes[4] = { 16, 256, 4096, 65536 };
+	s_maxError = 0.0f;
+	for (const int size : dotSizes)
+	{
+		s_dotSize = size;
+		s_dotA.resize(size);
+		s_dotB.resize(size);
+		VecN a(size);
+		VecN b(size);
+		for (int i = 0; i < size; ++i)
+		{
+			a[i] = s_dotA[i] = Random(seed);
+			b[i] = s_dotB[i] = Random(seed);
+		}
+		char name[64];
+		snprintf(name, sizeof(name), "VecN::Dot %i", size);
+		Report(name, Measure(size, [&]() { return a.Dot(b); }));
+		ForEachBackend<DotNBench>();
+	}
+	const bool isDotNSame = s_maxError < 1.0e-5f;
+
+	const bool isSweptSame = CheckSweptSpheres(seed);
+
+	// Diagonally dominant systems, as the joint and contact constraints give
+	printf(" LCP_GaussSeidel\n");
+	const int lcpSizes[5] = { 6, 12, 24, 48, 96 };
+	for (const int size : lcpSizes)
+	{
+		MatN A(size);
+		VecN b(size);
+		for (int row = 0; row < size; ++row)
+		{
+			for (int column = 0; column < size; ++column)
+			{
+				A.rows[row][column] = row == column ? (float)size : 0.5f * Random(seed);
+			}
+			b[row] = Random(seed);
+		}
+		char name[64];
+		snprintf(name, sizeof(name), "LCP_GaussSeidel %i", size);
+		ReportSolve(name, Measure(1, [&]() { return LCP_GaussSeidel(A, b)[0]; }));
+	}
+
+	int numFailed = 0;
+	printf("  %-40s %s\n", "lane kernels match the scalar library", isLanesSame ? "ok" : "FAILED");
+	printf("  %-40s %s\n", "lane dot products match", isDotNSame ? "ok" : "FAILED");
+	numFailed += isLanesSame ? 0 : 1;
+	printf("  %-40s %s\n", "swept sphere lanes match the scalar test", isSweptSame ? "ok" : "FAILED");
+	numFailed += isDotNSame ? 0 : 1;
+	numFailed += isSweptSame ? 0 : 1;
+	printf(numFailed ? "%i checks FAILED\n" : "All checks passed\n", numFailed);
+	return numFailed ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+#include "MemoryTracker.h"
+#include "Profiler.h"
+
+#include <assert.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+thread_local MemoryTag MemoryTracker::t_tag = MemoryTag::GENERAL;
+MemoryTracker::TagCounters MemoryTracker::s_counters[(int)MemoryTag::COUNT];
+MemoryTracker::HotLoopCheck MemoryTracker::s_hotLoopCheck = MemoryTracker::HotLoopCheck::OFF;
+std::atomic<int> MemoryTracker::s_numHotLoopViolations(0);
+
+namespace
+{
+	const char* const TAG_NAMES[(int)MemoryTag::COUNT] = { "general", "physics", "meshes", "textures", "gpu buffers", "scratch" };
+
+	// Profiler counters keep the name pointer, so these are literals too
+	const char* const COUNTER_NAMES[(int)MemoryTag::COUNT] = { "Memory: general", "Memory: physics", "Memory: meshes", "Memory: textures", "Memory: gpu buffers", "Memory: scratch" };
+}
+
+void MemoryTracker::Allocate(const MemoryTag tag, const size_t bytes)
+{
+	TagCounters& counters = s_counters[(int)tag];
+	const long long current = counters.currentBytes.fetch_add((long long)bytes, std::memory_order_relaxed) + (long long)bytes;
+	counters.numAllocations.fetch_add(1, std::memory_order_relaxed);
+	counters.allocatedBytes.fetch_add((long long)bytes, std::memory_order_relaxed);
+
+	long long peak = counters.peakBytes.load(std::memory_order_relaxed);
+	while (current > peak && !counters.peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+	{
+	}
+}
+
+void MemoryTracker::Free(const MemoryTag tag, const size_t bytes)
+{
+	s_counters[(int)tag].currentBytes.fetch_sub((long long)bytes, std::memory_order_relaxed);
+}
+
+const char* MemoryTracker::TagName(const MemoryTag tag)
+{
+	return TAG_NAMES[(int)tag];
+}
+
+MemoryTagStats MemoryTracker::GetStats(const MemoryTag tag)
+{
+	const TagCounters& counters = s_counters[(int)tag];
+	MemoryTagStats stats;
+	stats.currentBytes = counters.currentBytes.load(std::memory_order_relaxed);
+	stats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+	stats.numAllocations = counters.numAllocations.load(std::memory_order_relaxed);
+	stats.allocatedBytes = counters.allocatedBytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void MemoryTracker::Snapshot(MemorySnapshot& snapshot)
+{
+	for (int tag = 0; tag < (int)MemoryTag::COUNT; ++tag)
+	{
+		snapshot.tags[tag] = GetStats((MemoryTag)tag);
+	}
+	snapshot.time = std::chrono::steady_clock::now();
+}
+
+void MemoryTracker::ResetPeaks()
+{
+	for (TagCounters& counters : s_counters)
+	{
+		counters.peakBytes.store(counters.currentBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
+
+void MemoryTracker::PrintStats(const MemorySnapshot* since)
+{
+	MemorySnapshot now;
+	Snapshot(now);
+	const double seconds = NULL != since ? std::chrono::duration<double>(now.time - since->time).count() : 0.0;
+
+	printf("  %-12s %12s %12s %12s %12s %12s\n", "memory", "current KB", "peak KB", "allocations", "allocs/s", "KB/s");
+	for (int tag = 0; tag < (int)MemoryTag::COUNT; ++tag)
+	{
+		const MemoryTagStats& stats = now.tags[tag];
+		printf("  %-12s %12.1f %12.1f %12lld", TAG_NAMES[tag], stats.currentBytes / 1024.0, stats.peakBytes / 1024.0, stats.numAllocations);
+		if (seconds > 0.0)
+		{
+			printf(" %12.0f %12.1f", (stats.numAllocations - since->tags[tag].numAllocations) / seconds, (stats.allocatedBytes - since->tags[tag].allocatedBytes) / 1024.0 / seconds);
+		}
+		printf("\n");
+	}
+}
+
+std::string MemoryTracker::ToJson(const MemorySnapshot* since)
+{
+	MemorySnapshot now;
+	Snapshot(now);
+	const double seconds = NULL != since ? std::chrono::duration<double>(now.time - since->time).count() : 0.0;
+
+	std::string json = "{\"memory\":[";
+	for (int tag = 0; tag < (int)MemoryTag::COUNT; ++tag)
+	{
+		const MemoryTagStats& stats = now.tags[tag];
+		char entry[320];
+		snprintf(entry, sizeof(entry), "%s\n{\"tag\":\"%s\",\"currentBytes\":%lld,\"peakBytes\":%lld,\"allocations\":%lld,\"allocatedBytes\":%lld",
+			0 == tag ? "" : ",", TAG_NAMES[tag], stats.currentBytes, stats.peakBytes, stats.numAllocations, stats.allocatedBytes);
+		json += entry;
+		if (seconds > 0.0)
+		{
+			snprintf(entry, sizeof(entry), ",\"allocationsPerSecond\":%.1f,\"bytesPerSecond\":%.1f",
+				(stats.numAllocations - since->tags[tag].numAllocations) / seconds, (stats.allocatedBytes - since->tags[tag].allocatedBytes) / seconds);
+			json += entry;
+		}
+		json += "}";
+	}
+	json += "\n]}\n";
+	return json;
+}
+
+void MemoryTracker::RecordProfileCounters()
+{
+	if (!Profiler::IsCapturing()) return;
+	for (int tag = 0; tag < (int)MemoryTag::COUNT; ++tag)
+	{
+		PROFILE_COUNTER(COUNTER_NAMES[tag], s_counters[tag].currentBytes.load(std::memory_order_relaxed));
+	}
+}
+
+void MemoryTracker::ReportHotLoopAllocations(const char* name, const MemoryTag tag, const long long numAllocations)
+{
+	s_numHotLoopViolations.fetch_add(1, std::memory_order_relaxed);
+	printf("WARNING: %lld %s allocations in %s\n", numAllocations, TAG_NAMES[(int)tag], name);
+	assert(HotLoopCheck::ASSERT != s_hotLoopCheck);
+}
+
+/*
+====================================================
+operator new / delete
+Each block is a header and the caller's bytes, the header big enough to
+keep the caller's bytes aligned for anything malloc would be
+====================================================
+*/
+#if PHYSICS_MEMORY_TRACKING
+namespace
+{
+	struct alignas(alignof(max_align_t)) BlockHeader
+	{
+		size_t size;
+		MemoryTag tag;
+	};
+
+	void* TrackedAllocate(const size_t size)
+	{
+		BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+		if (NULL == header) return NULL;
+		header->size = size;
+		header->tag = MemoryTracker::ThreadTag();
+		MemoryTracker::Allocate(header->tag, size);
+		return header + 1;
+	}
+
+	void TrackedFree(void* memory)
+	{
+		if (NULL == memory) return;
+		BlockHeader* header = (BlockHeader*)memory - 1;
+		MemoryTracker::Free(header->tag, header->size);
+		free(header);
+	}
+}
+
+void* operator new(size_t size)
+{
+	void* memory = TrackedAllocate(size);
+	if (NULL == memory) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	void* memory = TrackedAllocate(size);
+	if (NULL == memory) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return TrackedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return TrackedAllocate(size); }
+void operator delete(void* memory) noexcept { TrackedFree(memory); }
+void operator delete[](void* memory) noexcept { TrackedFree(memory); }
+void operator delete(void* memory, size_t) noexcept { TrackedFree(memory); }
+void operator delete[](void* memory, size_t) noexcept { TrackedFree(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { TrackedFree(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { TrackedFree(memory); }
+#endif
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <string>
+
+/// <summary>
+/// Counts memory by the subsystem it is for. Compiled in unless
+/// PHYSICS_MEMORY_TRACKING is defined as 0, in which case operator new is
+/// the library's own and only the explicit Allocate/Free calls (Vulkan
+/// memory) are counted.
+///
+/// Compiled in, operator new is replaced: every block carries a small
+/// header with its size and tag, and is charged to the tag of the thread
+/// that made it. Jobs run under the tag of the thread that created them,
+/// so work the physics hands to the workers is still the physics'.
+/// </summary>
+#ifndef PHYSICS_MEMORY_TRACKING
+#define PHYSICS_MEMORY_TRACKING 1
+#endif
+
+enum class MemoryTag : unsigned char
+{
+	GENERAL,		// Untagged
+	PHYSICS,		// Bodies, shapes and the step's own buffers
+	MESHES,			// Vertices and indices built on the CPU
+	TEXTURES,		// Images in GPU memory
+	GPU_BUFFERS,	// Vertex, index and uniform buffers in GPU memory
+	SCRATCH,		// Temporaries of the solvers
+	COUNT
+};
+
+struct MemoryTagStats
+{
+	long long currentBytes;
+	long long peakBytes;
+	long long numAllocations;	// Ever made
+	long long allocatedBytes;	// Ever allocated
+};
+
+/// <summary>
+/// Every tag's figures at one moment, for rates between two of them
+/// </summary>
+struct MemorySnapshot
+{
+	MemoryTagStats tags[(int)MemoryTag::COUNT];
+	std::chrono::steady_clock::time_point time;
+};
+
+class MemoryTracker
+{
+public:
+	/// <summary>
+	/// What the hot loop checks do when memory was allocated inside one
+	/// </summary>
+	enum class HotLoopCheck
+	{
+		OFF,
+		REPORT,	// Print it and count it, see NumHotLoopViolations
+		ASSERT,
+	};
+
+	static void Allocate(const MemoryTag tag, const size_t bytes);
+	static void Free(const MemoryTag tag, const size_t bytes);
+
+	static MemoryTag ThreadTag() { return t_tag; }
+	static void SetThreadTag(const MemoryTag tag) { t_tag = tag; }
+
+	static const char* TagName(const MemoryTag tag);
+	static MemoryTagStats GetStats(const MemoryTag tag);
+	static void Snapshot(MemorySnapshot& snapshot);
+	static void ResetPeaks();
+
+	/// <summary>
+	/// Current, peak, and the allocation rates since the snapshot if there is one
+	/// </summary>
+	static void PrintStats(const MemorySnapshot* since = NULL);
+	static std::string ToJson(const MemorySnapshot* since = NULL);
+
+	/// <summary>
+	/// Each tag's current bytes as profiler counters, while a capture is on
+	/// </summary>
+	static void RecordProfileCounters();
+
+	static void SetHotLoopCheck(const HotLoopCheck check) { s_hotLoopCheck = check; }
+	static HotLoopCheck GetHotLoopCheck() { return s_hotLoopCheck; }
+	static int NumHotLoopViolations() { return s_numHotLoopViolations.load(std::memory_order_relaxed); }
+	static void ReportHotLoopAllocations(const char* name, const MemoryTag tag, const long long numAllocations);
+
+private:
+	struct TagCounters
+	{
+		std::atomic<long long> currentBytes;
+		std::atomic<long long> peakBytes;
+		std::atomic<long long> numAllocations;
+		std::atomic<long long> allocatedBytes;
+	};
+
+	static thread_local MemoryTag t_tag;
+	static TagCounters s_counters[(int)MemoryTag::COUNT];
+	static HotLoopCheck s_hotLoopCheck;
+	static std::atomic<int> s_numHotLoopViolations;
+};
+
+/// <summary>
+/// Charges the scope's allocations on this thread to a tag
+/// </summary>
+class ScopedMemoryTag
+{
+public:
+	explicit ScopedMemoryTag(const MemoryTag tag) : m_previous(MemoryTracker::ThreadTag()) { MemoryTracker::SetThreadTag(tag); }
+	~ScopedMemoryTag() { MemoryTracker::SetThreadTag(m_previous); }
+
+private:
+	MemoryTag m_previous;
+};
+
+/// <summary>
+/// A scope that should not allocate once warmed up, such as a physics
+/// step. Any allocation of the tag inside it, on any thread, is reported
+/// as the hot loop check says. Costs one load when the check is off.
+/// </summary>
+class HotLoopAllocationCheck
+{
+public:
+	HotLoopAllocationCheck(const char* name, const MemoryTag tag)
+		: m_name(name), m_tag(tag), m_numAllocations(MemoryTracker::HotLoopCheck::OFF != MemoryTracker::GetHotLoopCheck() ? MemoryTracker::GetStats(tag).numAllocations : -1) {}
+	~HotLoopAllocationCheck()
+	{
+		if (m_numAllocations < 0) return;
+		const long long numAllocations = MemoryTracker::GetStats(m_tag).numAllocations - m_numAllocations;
+		if (numAllocations > 0) MemoryTracker::ReportHotLoopAllocations(m_name, m_tag, numAllocations);
+	}
+
+private:
+	const char* m_name;
+	MemoryTag m_tag;
+	long long m_numAllocations;
+};
@@ -0,0 +1,212 @@
+#include "ParticleSystem.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+
+void ParticleSystem::AddBlock(const int numParticles, const float radius, const Vec3& center)
+{
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+
+	// As near a cube as the count allows, a little more than a diameter apart
+	const int side = std::max((int)ceilf(cbrtf((float)numParticles)), 1);
+	const float spacing = radius * 2.2f;
+	const Vec3 corner = center - Vec3((float)(side - 1) * spacing * 0.5f, (float)(side - 1) * spacing * 0.5f, 0.0f);
+	for (int i = 0; i < numParticles; ++i)
+	{
+		const int x = i % side;
+		const int y = i / side % side;
+		const int z = i / (side * side);
+		const Vec3 jitter((float)(i * 7 % 11) * 0.01f * radius, (float)(i * 5 % 13) * 0.01f * radius, 0.0f);
+
+		Particle particle;
+		particle.position = corner + Vec3((float)x, (float)y, (float)z) * spacing + jitter;
+		particle.radius = radius;
+		particle.velocity.Zero();
+		particle.inverseMass = 1.0f;
+		particles.push_back(particle);
+	}
+}
+
+ParticleParms ParticleSystem::GetParms(const float dt_sec) const
+{
+	float maxRadius = 0.0f;
+	for (const Particle& particle : particles)
+	{
+		maxRadius = std::max(maxRadius, particle.radius);
+	}
+
+	// Twice as many slots as particles keeps the lists short
+	uint32_t numCells = 1024;
+	while (numCells < 2 * particles.size())
+	{
+		numCells *= 2;
+	}
+
+	ParticleParms parms;
+	parms.gravity = Vec3(0, 0, -10);
+	parms.dt = dt_sec;
+	parms.inverseCellSize = maxRadius > 0.0f ? 1.0f / (2.0f * maxRadius) : 1.0f;
+	parms.numParticles = (uint32_t)particles.size();
+	parms.cellMask = numCells - 1;
+	parms.pass = (uint32_t)ParticlePass::INTEGRATE;
+	return parms;
+}
+
+void ParticleSystem::Update(const float dt_sec)
+{
+	ParticleParms parms = GetParms(dt_sec);
+	for (uint32_t pass = 0; pass < (uint32_t)ParticlePass::COUNT; ++pass)
+	{
+		parms.pass = pass;
+		RunPass(parms);
+	}
+}
+
+void ParticleSystem::RunPass(const ParticleParms& parms)
+{
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	const int count = (int)parms.numParticles;
+	switch ((ParticlePass)parms.pass)
+	{
+	case ParticlePass::INTEGRATE:
+		ParallelFor(count, &ParticleSystem::Integrate, parms);
+		break;
+	case ParticlePass::GRID:
+		BuildGrid(parms);
+		break;
+	case ParticlePass::COLLIDE:
+		m_corrections.resize(count);
+		ParallelFor(count, &ParticleSystem::Collide, parms);
+		break;
+	case ParticlePass::APPLY:
+		ParallelFor(count, &ParticleSystem::Apply, parms);
+		break;
+	default:
+		break;
+	}
+}
+
+int ParticleSystem::NumContacts() const
+{
+	long long numContacts = 0;
+	for (const ParticleCorrection& correction : m_corrections)
+	{
+		numContacts += correction.numContacts;
+	}
+	return (int)(numContacts / 2);	// Both particles of a pair count it
+}
+
+void ParticleSystem::ParallelFor(const int count, void (ParticleSystem::*pass)(const ParticleParms&, int), const ParticleParms& parms)
+{
+	const auto run = [this, pass, &parms](const int begin, const int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			(this->*pass)(parms, i);
+		}
+	};
+
+	// Each particle only writes its own, so the result is the same however the work is cut
+	if (NULL != m_jobs)
+	{
+		m_jobs->ParallelFor(0, count, run, 1024);
+	}
+	else
+	{
+		run(0, count);
+	}
+}
+
+void ParticleSystem::Integrate(const ParticleParms& parms, const int i)
+{
+	Particle& particle = particles[i];
+	if (0.0f == particle.inverseMass) return;
+
+	particle.velocity += parms.gravity * parms.dt;
+	particle.position += particle.velocity * parms.dt;
+
+	// The floor of the scenes
+	if (particle.position.z < particle.radius)
+	{
+		particle.position.z = particle.radius;
+		particle.velocity.z = std::max(particle.velocity.z, 0.0f);
+	}
+}
+
+void ParticleSystem::BuildGrid(const ParticleParms& parms)
+{
+	// In order on one thread, the GPU's atomics leave the lists in whatever order the particles arrived
+	m_cellHeads.assign(parms.cellMask + 1, PARTICLE_NO_INDEX);
+	m_next.resize(parms.numParticles);
+	for (uint32_t i = 0; i < parms.numParticles; ++i)
+	{
+		int cell[3];
+		ParticleCell(particles[i].position, parms.inverseCellSize, cell);
+		uint32_t& head = m_cellHeads[ParticleCellHash(cell, parms.cellMask)];
+		m_next[i] = head;
+		head = i;
+	}
+}
+
+void ParticleSystem::Collide(const ParticleParms& parms, const int i)
+{
+	const Particle& particle = particles[i];
+	int cell[3];
+	ParticleCell(particle.position, parms.inverseCellSize, cell);
+
+	// Cells that share a slot share its list, which is walked once. Particles
+	// of the cells further off the slot brings in are too far to touch.
+	uint32_t slots[27];
+	int numSlots = 0;
+	for (int z = -1; z <= 1; ++z)
+	{
+		for (int y = -1; y <= 1; ++y)
+		{
+			for (int x = -1; x <= 1; ++x)
+			{
+				const int neighbour[3] = { cell[0] + x, cell[1] + y, cell[2] + z };
+				const uint32_t slot = ParticleCellHash(neighbour, parms.cellMask);
+				if (std::find(slots, slots + numSlots, slot) == slots + numSlots)
+				{
+					slots[numSlots++] = slot;
+				}
+			}
+		}
+	}
+
+	ParticleCorrection& correction = m_corrections[i];
+	correction.delta.Zero();
+	correction.numContacts = 0;
+	for (int s = 0; s < numSlots; ++s)
+	{
+		for (uint32_t j = m_cellHeads[slots[s]]; PARTICLE_NO_INDEX != j; j = m_next[j])
+		{
+			const Particle& other = particles[j];
+			const Vec3 ab = particle.position - other.position;
+			const float radii = particle.radius + other.radius;
+			const float distanceSqr = ab.Dot(ab);
+			if ((uint32_t)i == j || distanceSqr >= radii * radii || 0.0f == distanceSqr) continue;
+
+			correction.numContacts++;
+			const float sumInverseMass = particle.inverseMass + other.inverseMass;
+			if (0.0f == sumInverseMass) continue;
+
+			const float distance = sqrtf(distanceSqr);
+			correction.delta += ab * ((radii - distance) / distance * particle.inverseMass / sumInverseMass);
+		}
+	}
+}
+
+void ParticleSystem::Apply(const ParticleParms& parms, const int i)
+{
+	const ParticleCorrection& correction = m_corrections[i];
+	if (0 == correction.numContacts) return;
+
+	// Pushed back out of the floor too, the pile above would sink through it otherwise
+	Particle& particle = particles[i];
+	Vec3 delta = correction.delta / (float)correction.numContacts;
+	delta.z = std::max(delta.z, particle.radius - particle.position.z);
+	particle.position += delta;
+	particle.velocity += delta / parms.dt;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Math/Vector.h"
+
+#include <stdint.h>
+#include <vector>
+
+class JobSystem;
+
+/// <summary>
+/// One sphere of a granular pile. Laid out as the std430 particle_t of
+/// data/shaders/particles.comp, so the GPU path steps the same array.
+/// </summary>
+struct Particle
+{
+	Vec3 position;
+	float radius;
+	Vec3 velocity;
+	float inverseMass;	// Zero for particles that never move
+};
+
+/// <summary>
+/// What the collide pass found for a particle, laid out as the shader's correction_t
+/// </summary>
+struct ParticleCorrection
+{
+	Vec3 delta;				// Summed over the contacts, the apply pass moves by the average
+	uint32_t numContacts;
+};
+
+/// <summary>
+/// The passes of a step, in the order they run
+/// </summary>
+enum class ParticlePass : uint32_t
+{
+	INTEGRATE,	// Gravity, then the velocity into the position, then the floor
+	GRID,		// Each particle pushed onto the list of its grid cell
+	COLLIDE,	// Overlaps with the particles of the 27 cells around, into the corrections
+	APPLY,		// The average correction onto the position and the velocity
+	COUNT
+};
+
+/// <summary>
+/// Everything a pass needs besides the buffers, laid out as the shader's push constants
+/// </summary>
+struct ParticleParms
+{
+	Vec3 gravity;
+	float dt;
+	float inverseCellSize;	// The cells are at least the widest particle across
+	uint32_t numParticles;
+	uint32_t cellMask;		// The hashed grid's cell count less one, the count is a power of two
+	uint32_t pass;			// A ParticlePass
+};
+
+static const uint32_t PARTICLE_NO_INDEX = 0xFFFFFFFF;
+
+/// <summary>
+/// The grid cell a point is in, and where that cell's list is kept. The grid
+/// is unbounded, cells hash into a fixed table and the collide pass walks
+/// each slot of the 27 cells around once, however many of them share it.
+/// </summary>
+inline void ParticleCell(const Vec3& position, const float inverseCellSize, int cell[3])
+{
+	cell[0] = (int)floorf(position.x * inverseCellSize);
+	cell[1] = (int)floorf(position.y * inverseCellSize);
+	cell[2] = (int)floorf(position.z * inverseCellSize);
+}
+
+inline uint32_t ParticleCellHash(const int cell[3], const uint32_t cellMask)
+{
+	// Summed, xor of the products maps many of the small cells of a pile to one
+	// value, then mixed so the high bits reach the mask
+	uint32_t hash = (uint32_t)cell[0] * 73856093u + (uint32_t)cell[1] * 19349663u + (uint32_t)cell[2] * 83492791u;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bu;
+	hash ^= hash >> 16;
+	return hash & cellMask;
+}
+
+/// <summary>
+/// Spheres that only collide with each other and the floor at z = 0, many
+/// more of them than the rigid bodies of a scene. Contacts are position
+/// based: overlaps are pushed apart, each particle by the average of its
+/// pushes, and the velocity takes up the move, so piles settle without
+/// bouncing. Broadphase is a hashed uniform grid rebuilt every step.
+///
+/// This is the CPU path, over the job system when there is one, and the
+/// reference for the compute shader path in GPUParticles, which runs the
+/// same passes on the same layouts.
+/// </summary>
+class ParticleSystem
+{
+public:
+	ParticleSystem() : m_jobs(NULL) {}
+
+	std::vector<Particle> particles;
+
+	void SetJobSystem(JobSystem* jobs) { m_jobs = jobs; }
+
+	/// <summary>
+	/// A loose block of particles, jittered a little so it does not stack
+	/// in columns, falling onto the floor
+	/// </summary>
+	void AddBlock(const int numParticles, const float radius, const Vec3& center);
+
+	/// <summary>
+	/// The push constants of a step, sized to the particles as they are now
+	/// </summary>
+	ParticleParms GetParms(const float dt_sec) const;
+
+	void Update(const float dt_sec);
+
+	/// <summary>
+	/// One pass over all the particles, for running a step a pass at a time
+	/// </summary>
+	void RunPass(const ParticleParms& parms);
+
+	/// <summary>
+	/// Pairs touching in the last step
+	/// </summary>
+	int NumContacts() const;
+
+	const std::vector<ParticleCorrection>& GetCorrections() const { return m_corrections; }
+
+private:
+	void ParallelFor(const int count, void (ParticleSystem::*pass)(const ParticleParms&, int), const ParticleParms& parms);
+
+	void Integrate(const ParticleParms& parms, const int i);
+	void Collide(const ParticleParms& parms, const int i);
+	void Apply(const ParticleParms& parms, const int i);
+	void BuildGrid(const ParticleParms& parms);
+
+	JobSystem* m_jobs;
+
+	std::vector<uint32_t> m_cellHeads;	// First particle in each slot of the grid
+	std::vector<uint32_t> m_next;		// Next particle in the same slot
+	std::vector<ParticleCorrection> m_corrections;
+};
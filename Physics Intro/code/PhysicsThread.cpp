@@ -0,0 +1,143 @@
+//
+//  PhysicsThread.cpp
+//
+#include "PhysicsThread.h"
+
+#include "Profiler.h"
+
+/*
+========================================================================================================
+
+PhysicsSnapshot
+
+========================================================================================================
+*/
+
+/*
+====================================================
+PhysicsSnapshot::InterpolationAlpha
+====================================================
+*/
+float PhysicsSnapshot::InterpolationAlpha(const std::chrono::steady_clock::time_point& now) const
+{
+	const float alpha = std::chrono::duration<float>(now - stepTime).count() * stepRate;
+	return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
+
+/*
+====================================================
+PhysicsSnapshot::InterpolatedPose
+====================================================
+*/
+Scene::BodyPose PhysicsSnapshot::InterpolatedPose(const int bodyId, const float alpha) const
+{
+	if (bodyId >= (int)prevPoses.size()) return poses[bodyId];
+	return Scene::BodyPose::Blend(prevPoses[bodyId], poses[bodyId], alpha);
+}
+
+/*
+========================================================================================================
+
+PhysicsThread
+
+========================================================================================================
+*/
+
+/*
+====================================================
+PhysicsThread::Start
+====================================================
+*/
+void PhysicsThread::Start(Scene* scene)
+{
+	Stop();
+
+	// The first snapshot goes out before the thread exists, so the renderer always has one
+	m_scene = scene;
+	Publish();
+
+	m_isRunning = true;
+	m_thread = std::thread(&PhysicsThread::Run, this);
+}
+
+/*
+====================================================
+PhysicsThread::Stop
+====================================================
+*/
+void PhysicsThread::Stop()
+{
+	m_isRunning = false;
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+/*
+====================================================
+PhysicsThread::Run
+====================================================
+*/
+void PhysicsThread::Run()
+{
+	PROFILE_THREAD_NAME("Physics");
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point lastTime = Clock::now();
+	while (m_isRunning)
+	{
+		const Clock::time_point time = Clock::now();
+		float dt_sec = std::chrono::duration<float>(time - lastTime).count();
+		lastTime = time;
+
+		float wait_sec;
+		{
+			std::unique_lock<std::mutex> lock(m_sceneMutex);
+			const float step_sec = 1.0f / m_scene->GetStepRate();
+			if (m_isPaused)
+			{
+				dt_sec = 0.0f;
+				if (m_numStepRequests > 0)
+				{
+					--m_numStepRequests;
+					dt_sec = step_sec;
+				}
+			}
+			else
+			{
+				m_numStepRequests = 0;
+			}
+
+			const int numSteps = m_scene->Advance(dt_sec);
+			if (numSteps > 0 || m_isSceneChanged.exchange(false))
+			{
+				Publish();
+			}
+
+			// Sleep until the accumulator has the next step in it
+			wait_sec = (1.0f - m_scene->GetInterpolationAlpha()) * step_sec;
+		}
+		std::this_thread::sleep_for(std::chrono::duration<float>(wait_sec));
+	}
+}
+
+/*
+====================================================
+PhysicsThread::Publish
+Single writer: Start before the thread runs, then the thread with the scene locked
+====================================================
+*/
+void PhysicsThread::Publish()
+{
+	PhysicsSnapshot& snapshot = m_snapshots.WriteBuffer();
+	snapshot.prevPoses = m_scene->GetPreviousPoses();
+	snapshot.poses.resize(m_scene->bodies.size());
+	for (int i = 0; i < (int)m_scene->bodies.size(); ++i)
+	{
+		snapshot.poses[i].position = m_scene->bodies[i].position;
+		snapshot.poses[i].orientation = m_scene->bodies[i].orientation;
+	}
+	snapshot.stepTime = std::chrono::steady_clock::now();
+	snapshot.stepRate = m_scene->GetStepRate();
+	m_snapshots.Publish();
+}
@@ -0,0 +1,73 @@
+//
+//  PhysicsThread.h
+//
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Scene.h"
+#include "TripleBuffer.h"
+
+/*
+====================================================
+PhysicsSnapshot
+Body poses of one completed step, and the step before it
+====================================================
+*/
+struct PhysicsSnapshot {
+	std::vector< Scene::BodyPose > prevPoses;
+	std::vector< Scene::BodyPose > poses;
+	std::chrono::steady_clock::time_point stepTime;	// When the step was published
+	float stepRate;
+
+	// How far the reader is past the step, clamped to [0, 1]
+	float InterpolationAlpha( const std::chrono::steady_clock::time_point & now ) const;
+	Scene::BodyPose InterpolatedPose( const int bodyId, const float alpha ) const;
+};
+
+/*
+====================================================
+PhysicsThread
+Runs the scene's fixed steps on its own thread. Each step's poses are
+published through a triple buffer, so the renderer reads the latest one
+without waiting on the physics. Anything else that touches the scene
+takes LockScene first.
+====================================================
+*/
+class PhysicsThread {
+public:
+	PhysicsThread() : m_scene( NULL ), m_isRunning( false ), m_isPaused( true ), m_numStepRequests( 0 ), m_isSceneChanged( false ) {}
+	~PhysicsThread() { Stop(); }
+
+	void Start( Scene * scene );
+	void Stop();
+
+	void SetPaused( const bool isPaused ) { m_isPaused = isPaused; }
+	bool IsPaused() const { return m_isPaused; }
+	void StepOnce() { ++m_numStepRequests; }
+
+	std::unique_lock< std::mutex > LockScene() { return std::unique_lock< std::mutex >( m_sceneMutex ); }
+
+	// The bodies were changed outside of a step (reset, new scene), publish them even while paused
+	void SceneChanged() { m_isSceneChanged = true; }
+
+	// Never blocks, the same snapshot comes back until physics publishes a newer one
+	const PhysicsSnapshot & LatestSnapshot() { return m_snapshots.Read(); }
+
+private:
+	void Run();
+	void Publish();
+
+	Scene * m_scene;
+	std::thread m_thread;
+	std::mutex m_sceneMutex;
+	std::atomic< bool > m_isRunning;
+	std::atomic< bool > m_isPaused;
+	std::atomic< int > m_numStepRequests;
+	std::atomic< bool > m_isSceneChanged;
+	TripleBuffer< PhysicsSnapshot > m_snapshots;
+};
@@ -0,0 +1,173 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+
+thread_local ProfileRing* Profiler::t_ring = NULL;
+thread_local const char* Profiler::t_threadName = NULL;
+std::atomic<bool> Profiler::s_isCapturing(false);
+std::mutex Profiler::s_mutex;
+std::vector<std::unique_ptr<ProfileRing>> Profiler::s_rings;
+unsigned long long Profiler::s_captureStartTicks = 0;
+double Profiler::s_captureStartUs = 0.0;
+unsigned long long Profiler::s_captureEndTicks = 0;
+double Profiler::s_captureEndUs = 0.0;
+
+static double SteadyMicroseconds()
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ProfileRing* Profiler::RegisterThread()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_rings.emplace_back(new ProfileRing);
+	ProfileRing* ring = s_rings.back().get();
+	ring->threadId = (int)s_rings.size() - 1;
+	ring->threadName = t_threadName;
+
+	// Joining mid capture, everything it records belongs to the capture
+	ring->captureStart = 0;
+	return ring;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	t_threadName = name;
+	if (NULL != t_ring)
+	{
+		t_ring->threadName = name;
+	}
+}
+
+void Profiler::BeginCapture()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	for (std::unique_ptr<ProfileRing>& ring : s_rings)
+	{
+		ring->captureStart = ring->head.load(std::memory_order_acquire);
+	}
+	s_captureStartUs = SteadyMicroseconds();
+	s_captureStartTicks = Now();
+	s_isCapturing.store(true, std::memory_order_release);
+}
+
+void Profiler::EndCapture()
+{
+	s_isCapturing.store(false, std::memory_order_release);
+	s_captureEndTicks = Now();
+	s_captureEndUs = SteadyMicroseconds();
+}
+
+void Profiler::Counter(const char* name, const long long value)
+{
+	if (!IsCapturing()) return;
+	const ProfileEvent event = { name, Now(), 0, value };
+	ThreadRing().Push(event);
+}
+
+double Profiler::TicksPerMicrosecond()
+{
+#if defined(PROFILE_HAS_TSC)
+	// Calibrated over the capture against the steady clock
+	const double us = s_captureEndUs - s_captureStartUs;
+	return us > 0.0 ? (double)(s_captureEndTicks - s_captureStartTicks) / us : 1.0;
+#else
+	return 1000.0;
+#endif
+}
+
+bool Profiler::WriteChromeTrace(const char* fileName)
+{
+	FILE* file = fopen(fileName, "wb");
+	if (NULL == file) return false;
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	const double usPerTick = 1.0 / TicksPerMicrosecond();
+	const auto toUs = [usPerTick](const unsigned long long ticks) { return (double)(long long)(ticks - s_captureStartTicks) * usPerTick; };
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool isFirst = true;
+	for (const std::unique_ptr<ProfileRing>& ring : s_rings)
+	{
+		const unsigned long long head = ring->head.load(std::memory_order_acquire);
+		const unsigned long long first = std::max(ring->captureStart, head > ProfileRing::CAPACITY ? head - ProfileRing::CAPACITY : 0);
+		if (first == head) continue;
+
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+			isFirst ? "" : ",\n", ring->threadId, NULL != ring->threadName ? ring->threadName : "Thread");
+		isFirst = false;
+
+		for (unsigned long long i = first; i < head; ++i)
+		{
+			const ProfileEvent& event = ring->events[i & (ProfileRing::CAPACITY - 1)];
+			if (0 == event.end)
+			{
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%i,\"args\":{\"value\":%lld}}",
+					event.name, toUs(event.start), ring->threadId, event.value);
+			}
+			else
+			{
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%i}",
+					event.name, toUs(event.start), (double)(event.end - event.start) * usPerTick, ring->threadId);
+			}
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return 0 == fclose(file);
+}
+
+void Profiler::GetZoneStats(std::vector<ProfileZoneStats>& stats)
+{
+	stats.clear();
+	std::lock_guard<std::mutex> lock(s_mutex);
+	const double msPerTick = 0.001 / TicksPerMicrosecond();
+	std::unordered_map<std::string, int> slots;	// By text, a literal may have a copy per translation unit
+	for (const std::unique_ptr<ProfileRing>& ring : s_rings)
+	{
+		const unsigned long long head = ring->head.load(std::memory_order_acquire);
+		const unsigned long long first = std::max(ring->captureStart, head > ProfileRing::CAPACITY ? head - ProfileRing::CAPACITY : 0);
+		for (unsigned long long i = first; i < head; ++i)
+		{
+			const ProfileEvent& event = ring->events[i & (ProfileRing::CAPACITY - 1)];
+			if (0 == event.end) continue;	// Counter
+
+			auto slot = slots.emplace(event.name, (int)stats.size());
+			if (slot.second)
+			{
+				const ProfileZoneStats zone = { event.name, 0, 0.0, 0.0 };
+				stats.push_back(zone);
+			}
+			ProfileZoneStats& zone = stats[slot.first->second];
+			const double ms = (double)(event.end - event.start) * msPerTick;
+			++zone.count;
+			zone.totalMs += ms;
+			zone.maxMs = std::max(zone.maxMs, ms);
+		}
+	}
+	std::sort(stats.begin(), stats.end(), [](const ProfileZoneStats& a, const ProfileZoneStats& b) { return a.totalMs > b.totalMs; });
+}
+
+long long Profiler::NumCapturedEvents()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	long long numEvents = 0;
+	for (const std::unique_ptr<ProfileRing>& ring : s_rings)
+	{
+		numEvents += (long long)(ring->head.load(std::memory_order_acquire) - ring->captureStart);
+	}
+	return numEvents;
+}
+
+void Profiler::PrintZoneStats()
+{
+	std::vector<ProfileZoneStats> stats;
+	GetZoneStats(stats);
+	printf("  %-28s %8s %10s %10s %10s\n", "zone", "count", "total ms", "avg us", "max us");
+	for (const ProfileZoneStats& zone : stats)
+	{
+		printf("  %-28s %8i %10.2f %10.2f %10.2f\n", zone.name, zone.count, zone.totalMs, 1000.0 * zone.totalMs / zone.count, 1000.0 * zone.maxMs);
+	}
+}
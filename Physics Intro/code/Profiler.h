@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILE_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_HAS_TSC 1
+#endif
+
+/// <summary>
+/// Zones and counters of the physics hot path, compiled in unless
+/// PHYSICS_PROFILE is defined as 0. Compiled out the macros below are
+/// empty. Compiled in, nothing is recorded outside a capture, and a zone
+/// costs a flag test; during one it costs two timestamps and an event
+/// written to its thread's own ring, with no lock and no allocation.
+/// </summary>
+#ifndef PHYSICS_PROFILE
+#define PHYSICS_PROFILE 1
+#endif
+
+#if PHYSICS_PROFILE
+#define PROFILE_JOIN_NAME(a, b) a##b
+#define PROFILE_ZONE_NAME(line) PROFILE_JOIN_NAME(profileZone, line)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_NAME(__LINE__)(name)
+#define PROFILE_ZONE_BEGIN(zone, name) ProfileZone zone(name)	// For a phase that ends before its scope does
+#define PROFILE_ZONE_END(zone) zone.End()
+#define PROFILE_COUNTER(name, value) Profiler::Counter(name, (long long)(value))
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_ZONE_BEGIN(zone, name)
+#define PROFILE_ZONE_END(zone)
+#define PROFILE_COUNTER(name, value)
+#define PROFILE_THREAD_NAME(name)
+#endif
+
+/// <summary>
+/// One zone or counter sample. Names are string literals, only the pointer is kept.
+/// </summary>
+struct ProfileEvent
+{
+	const char* name;
+	unsigned long long start;	// Ticks, see Profiler::Now
+	unsigned long long end;		// 0 for counters
+	long long value;			// Counters only
+};
+
+/// <summary>
+/// Single writer ring of one thread's events. The owner writes the slot,
+/// then publishes it by moving the head on with a release store; once the
+/// ring is full the oldest events are overwritten. Only the owner ever
+/// writes the head, a capture starts from where it was instead.
+/// </summary>
+struct ProfileRing
+{
+	static const int CAPACITY = 1 << 18;
+
+	std::vector<ProfileEvent> events;
+	std::atomic<unsigned long long> head;
+	unsigned long long captureStart;	// Head at BeginCapture
+	int threadId;
+	const char* threadName;
+
+	ProfileRing() : events(CAPACITY), head(0), captureStart(0), threadId(0), threadName(NULL) {}
+
+	void Push(const ProfileEvent& event)
+	{
+		const unsigned long long at = head.load(std::memory_order_relaxed);
+		events[at & (CAPACITY - 1)] = event;
+		head.store(at + 1, std::memory_order_release);
+	}
+};
+
+/// <summary>
+/// Total time spent in one zone name over a capture
+/// </summary>
+struct ProfileZoneStats
+{
+	const char* name;
+	int count;
+	double totalMs;
+	double maxMs;
+};
+
+class Profiler
+{
+public:
+	/// <summary>
+	/// Records from Begin to End, the events stay until the next capture. A
+	/// capture keeps the last ProfileRing::CAPACITY events of each thread.
+	/// </summary>
+	static void BeginCapture();
+	static void EndCapture();
+	static bool IsCapturing() { return s_isCapturing.load(std::memory_order_relaxed); }
+
+	static void Counter(const char* name, const long long value);
+	static void SetThreadName(const char* name);	// A string literal
+
+	/// <summary>
+	/// Chrome trace event JSON, for chrome://tracing or Perfetto. Call after EndCapture.
+	/// </summary>
+	static bool WriteChromeTrace(const char* fileName);
+
+	/// <summary>
+	/// Per zone name, by total time, most first. Call after EndCapture.
+	/// </summary>
+	static void GetZoneStats(std::vector<ProfileZoneStats>& stats);
+	static void PrintZoneStats();
+
+	/// <summary>
+	/// Zones and counters recorded over the last capture, those the rings
+	/// have since overwritten included. Call after EndCapture.
+	/// </summary>
+	static long long NumCapturedEvents();
+
+	/// <summary>
+	/// The time stamp counter on x86, steady clock nanoseconds elsewhere
+	/// </summary>
+	static unsigned long long Now()
+	{
+#if defined(PROFILE_HAS_TSC)
+		return __rdtsc();
+#else
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	/// <summary>
+	/// Made the first time the thread records, threads that never do cost nothing
+	/// </summary>
+	static ProfileRing& ThreadRing() { return NULL != t_ring ? *t_ring : *(t_ring = RegisterThread()); }
+
+private:
+	static ProfileRing* RegisterThread();
+	static double TicksPerMicrosecond();
+
+	static thread_local ProfileRing* t_ring;
+	static thread_local const char* t_threadName;
+	static std::atomic<bool> s_isCapturing;
+	static std::mutex s_mutex;	// Guards the list of rings, taken once per thread
+	static std::vector<std::unique_ptr<ProfileRing>> s_rings;
+	static unsigned long long s_captureStartTicks;
+	static double s_captureStartUs;
+	static unsigned long long s_captureEndTicks;
+	static double s_captureEndUs;
+};
+
+/// <summary>
+/// Times its scope as a zone of the current thread
+/// </summary>
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name) : m_name(name), m_start(Profiler::IsCapturing() ? Profiler::Now() : 0) {}
+	~ProfileZone() { End(); }
+
+	void End()
+	{
+		if (0 == m_start || !Profiler::IsCapturing()) return;
+		const ProfileEvent event = { m_name, m_start, Profiler::Now(), 0 };
+		Profiler::ThreadRing().Push(event);
+		m_start = 0;
+	}
+
+private:
+	const char* m_name;
+	unsigned long long m_start;
+};
@@ -2,6 +2,7 @@
 //  Buffer.cpp
 //
 #include "Buffer.h"
+#include "../MemoryTracker.h"
 #include <assert.h>
 #include <string.h>
 
@@ -19,7 +20,8 @@ Buffer::Buffer
 ====================================================
 */
 Buffer::Buffer() :
-	m_vkBufferSize( 0 ) {
+	m_vkBufferSize( 0 ),
+	m_vkMemorySize( 0 ) {
 }
 
 /*
@@ -27,7 +29,7 @@ Buffer::Buffer() :
 Buffer::Allocate
 ====================================================
 */
-bool Buffer::Allocate( DeviceContext * device, const void * data, int size, VkBufferUsageFlagBits usageFlags ) {
+bool Buffer::Allocate( DeviceContext * device, const void * data, int size, VkBufferUsageFlags usageFlags ) {
 	VkResult result;
 
 	m_vkBufferSize = size;
@@ -61,6 +63,8 @@ bool Buffer::Allocate( DeviceContext * device, const void * data, int size, VkBu
 		assert( 0 );
 		return false;
 	}
+	m_vkMemorySize = memRequirements.size;
+	MemoryTracker::Allocate( MemoryTag::GPU_BUFFERS, (size_t)m_vkMemorySize );
 
 	if ( NULL != data ) {
 		void * memory = MapBuffer( device );
@@ -80,6 +84,8 @@ Buffer::Cleanup
 void Buffer::Cleanup( DeviceContext * device ) {
 	vkDestroyBuffer( device->m_vkDevice, m_vkBuffer, nullptr );
 	vkFreeMemory( device->m_vkDevice, m_vkBufferMemory, nullptr );
+	MemoryTracker::Free( MemoryTag::GPU_BUFFERS, (size_t)m_vkMemorySize );
+	m_vkMemorySize = 0;
 }
 
 /*
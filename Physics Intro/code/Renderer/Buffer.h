@@ -18,7 +18,7 @@ class Buffer {
 public:
 	Buffer();
 
-	bool Allocate( DeviceContext * device, const void * data, int size, VkBufferUsageFlagBits usageFlags );
+	bool Allocate( DeviceContext * device, const void * data, int size, VkBufferUsageFlags usageFlags );
 	void Cleanup( DeviceContext * device );
 	void * MapBuffer( DeviceContext * device );
 	void UnmapBuffer( DeviceContext * device );
@@ -26,5 +26,6 @@ public:
 	VkBuffer		m_vkBuffer;
 	VkDeviceMemory	m_vkBufferMemory;
 	VkDeviceSize	m_vkBufferSize;
+	VkDeviceSize	m_vkMemorySize;	// Allocated, at least the buffer's size
 	VkMemoryPropertyFlags m_vkMemoryPropertyFlags;
 };
\ No newline at end of file
@@ -45,6 +45,12 @@ bool Descriptors::Create( DeviceContext * device, const CreateParms_t & parms )
 		poolSize.descriptorCount = parms.numImageSamplers * MAX_DESCRIPTOR_SETS;
 		poolSizes.push_back( poolSize );
 	}
+	if ( parms.numStorageBuffers > 0 ) {
+		VkDescriptorPoolSize poolSize;
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = parms.numStorageBuffers * MAX_DESCRIPTOR_SETS;
+		poolSizes.push_back( poolSize );
+	}
 
 	VkDescriptorPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -63,8 +69,9 @@ bool Descriptors::Create( DeviceContext * device, const CreateParms_t & parms )
 	//
 	// Create Descriptor Set Layout
 	//
-	VkDescriptorSetLayoutBinding * uniformBindings = (VkDescriptorSetLayoutBinding *)alloca( sizeof( VkDescriptorSetLayoutBinding ) * ( numUniforms ) );
-	memset( uniformBindings, 0, sizeof( VkDescriptorSetLayoutBinding ) * numUniforms );
+	const int numBindings = numUniforms + parms.numStorageBuffers;
+	VkDescriptorSetLayoutBinding * uniformBindings = (VkDescriptorSetLayoutBinding *)alloca( sizeof( VkDescriptorSetLayoutBinding ) * ( numBindings ) );
+	memset( uniformBindings, 0, sizeof( VkDescriptorSetLayoutBinding ) * numBindings );
 
 	int idx = 0;
 
@@ -79,6 +86,16 @@ bool Descriptors::Create( DeviceContext * device, const CreateParms_t & parms )
 		idx++;
 	}
 
+	for ( int i = 0; i < parms.numStorageBuffers; i++ ) {
+		uniformBindings[ idx ].binding = idx;
+		uniformBindings[ idx ].descriptorCount = 1;
+		uniformBindings[ idx ].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		uniformBindings[ idx ].pImmutableSamplers = nullptr;
+		uniformBindings[ idx ].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		idx++;
+	}
+
 	for ( int i = 0; i < parms.numUniformsFragment; i++ ) {
 		uniformBindings[ idx ].binding = idx;
 		uniformBindings[ idx ].descriptorCount = 1;
@@ -91,7 +108,7 @@ bool Descriptors::Create( DeviceContext * device, const CreateParms_t & parms )
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = numUniforms;
+	layoutInfo.bindingCount = numBindings;
 	layoutInfo.pBindings = uniformBindings;
 
 	result = vkCreateDescriptorSetLayout( device->m_vkDevice, &layoutInfo, nullptr, &m_vkDescriptorSetLayout );
@@ -201,6 +218,26 @@ Descriptor::BindDescriptor
 ====================================================
 */
 void Descriptor::BindDescriptor( DeviceContext * device, VkCommandBuffer vkCommandBuffer, Pipeline * pso ) {
+	UpdateDescriptorSet( device );
+	vkCmdBindDescriptorSets( vkCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pso->m_vkPipelineLayout, 0, 1, &m_parent->m_vkDescriptorSets[ m_id ], 0, nullptr );
+}
+
+/*
+====================================================
+Descriptor::BindDescriptorCompute
+====================================================
+*/
+void Descriptor::BindDescriptorCompute( DeviceContext * device, VkCommandBuffer vkCommandBuffer, Pipeline * pso ) {
+	UpdateDescriptorSet( device );
+	vkCmdBindDescriptorSets( vkCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pso->m_vkPipelineLayout, 0, 1, &m_parent->m_vkDescriptorSets[ m_id ], 0, nullptr );
+}
+
+/*
+====================================================
+Descriptor::UpdateDescriptorSet
+====================================================
+*/
+void Descriptor::UpdateDescriptorSet( DeviceContext * device ) {
 	const int numDescriptors = m_numImages + m_numBuffers;
 	const int allocationSize = sizeof( VkWriteDescriptorSet ) * numDescriptors;
 	VkWriteDescriptorSet * descriptorWrites = (VkWriteDescriptorSet *)alloca( allocationSize );
@@ -212,7 +249,7 @@ void Descriptor::BindDescriptor( DeviceContext * device, VkCommandBuffer vkComma
 		descriptorWrites[ idx ].dstSet = m_parent->m_vkDescriptorSets[ m_id ];
 		descriptorWrites[ idx ].dstBinding = idx;
 		descriptorWrites[ idx ].dstArrayElement = 0;
-		descriptorWrites[ idx ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrites[ idx ].descriptorType = ( i < m_parent->m_parms.numUniformsVertex ) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		descriptorWrites[ idx ].descriptorCount = 1;
 		descriptorWrites[ idx ].pBufferInfo = &m_bufferInfo[ i ];
 
@@ -232,5 +269,4 @@ void Descriptor::BindDescriptor( DeviceContext * device, VkCommandBuffer vkComma
 	}
 
 	vkUpdateDescriptorSets( device->m_vkDevice, (uint32_t)numDescriptors, descriptorWrites, 0, nullptr );
-	vkCmdBindDescriptorSets( vkCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pso->m_vkPipelineLayout, 0, 1, &m_parent->m_vkDescriptorSets[ m_id ], 0, nullptr );
 }
\ No newline at end of file
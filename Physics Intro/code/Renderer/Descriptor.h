@@ -21,11 +21,14 @@ public:
 	~Descriptor() {}
 
 	void BindImage( VkImageLayout imageLayout, VkImageView imageView, VkSampler sampler, int slot );
-	void BindBuffer( Buffer * uniformBuffer, int offset, int size, int slot );
+	void BindBuffer( Buffer * uniformBuffer, int offset, int size, int slot );	// Uniform or storage by the slot's place in the layout
 	void BindDescriptor( DeviceContext * device, VkCommandBuffer vkCommandBuffer, Pipeline * pso );
+	void BindDescriptorCompute( DeviceContext * device, VkCommandBuffer vkCommandBuffer, Pipeline * pso );
 
 	friend class Descriptors;
 private:
+	void UpdateDescriptorSet( DeviceContext * device );
+
 	Descriptors * m_parent;
 
 	int m_id;	// the id of the descriptor set to be used
@@ -49,11 +52,13 @@ public:
 	Descriptors() : m_numDescriptorUsed( 0 ) {}
 	~Descriptors() {}
 
-	// This structure creates the layout
+	// This structure creates the layout. The bindings are the vertex
+	// uniforms, then the storage buffers, then the fragment images.
 	struct CreateParms_t {
 		int numUniformsVertex;
 		int numUniformsFragment;
 		int numImageSamplers;
+		int numStorageBuffers;	// Read and written by compute
 	};
 	CreateParms_t m_parms;
 
@@ -49,48 +49,53 @@ bool PhysicalDeviceProperties::AcquireProperties( VkPhysicalDevice device, VkSur
 	vkGetPhysicalDeviceFeatures( m_vkPhysicalDevice, &m_vkFeatures );
 
 	// VkSurfaceCapabilitiesKHR
-	result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR( m_vkPhysicalDevice, vkSurface, &m_vkSurfaceCapabilities );
-	if ( VK_SUCCESS != result ) {
-		printf( "ERROR: Failed to vkGetPhysicalDeviceSurfaceCapabilitiesKHR\n" );
-		assert( 0 );
-		return false;
-	}
-
-	// VkSurfaceFormatKHR
-	{
-		uint32_t numFormats;
-		result = vkGetPhysicalDeviceSurfaceFormatsKHR( m_vkPhysicalDevice, vkSurface, &numFormats, NULL );
-		if ( VK_SUCCESS != result || 0 == numFormats ) {
-			printf( "ERROR: Failed to vkGetPhysicalDeviceSurfaceFormatsKHR\n" );
+	if ( VK_NULL_HANDLE == vkSurface ) {
+		// Nothing to present to
+		memset( &m_vkSurfaceCapabilities, 0, sizeof( m_vkSurfaceCapabilities ) );
+	} else {
+		result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR( m_vkPhysicalDevice, vkSurface, &m_vkSurfaceCapabilities );
+		if ( VK_SUCCESS != result ) {
+			printf( "ERROR: Failed to vkGetPhysicalDeviceSurfaceCapabilitiesKHR\n" );
 			assert( 0 );
 			return false;
 		}
 
-		m_vkSurfaceFormats.resize( numFormats );
-		result = vkGetPhysicalDeviceSurfaceFormatsKHR( m_vkPhysicalDevice, vkSurface, &numFormats, m_vkSurfaceFormats.data() );
-		if ( VK_SUCCESS != result || 0 == numFormats ) {
-			printf( "ERROR: Failed to vkGetPhysicalDeviceSurfaceFormatsKHR\n" );
-			assert( 0 );
-			return false;
-		}
-	}
+		// VkSurfaceFormatKHR
+		{
+			uint32_t numFormats;
+			result = vkGetPhysicalDeviceSurfaceFormatsKHR( m_vkPhysicalDevice, vkSurface, &numFormats, NULL );
+			if ( VK_SUCCESS != result || 0 == numFormats ) {
+				printf( "ERROR: Failed to vkGetPhysicalDeviceSurfaceFormatsKHR\n" );
+				assert( 0 );
+				return false;
+			}
 
-	// VkPresentModeKHR
-	{
-		uint32_t numPresentModes;
-		result = vkGetPhysicalDeviceSurfacePresentModesKHR( m_vkPhysicalDevice, vkSurface, &numPresentModes, NULL );
-		if ( VK_SUCCESS != result || 0 == numPresentModes ) {
-			printf( "ERROR: Failed to vkGetPhysicalDeviceSurfacePresentModesKHR\n" );
-			assert( 0 );
-			return false;
+			m_vkSurfaceFormats.resize( numFormats );
+			result = vkGetPhysicalDeviceSurfaceFormatsKHR( m_vkPhysicalDevice, vkSurface, &numFormats, m_vkSurfaceFormats.data() );
+			if ( VK_SUCCESS != result || 0 == numFormats ) {
+				printf( "ERROR: Failed to vkGetPhysicalDeviceSurfaceFormatsKHR\n" );
+				assert( 0 );
+				return false;
+			}
 		}
 
-		m_vkPresentModes.resize( numPresentModes );
-		result = vkGetPhysicalDeviceSurfacePresentModesKHR( m_vkPhysicalDevice, vkSurface, &numPresentModes, m_vkPresentModes.data() );
-		if ( VK_SUCCESS != result || 0 == numPresentModes ) {
-			printf( "ERROR: Failed to vkGetPhysicalDeviceSurfacePresentModesKHR\n" );
-			assert( 0 );
-			return false;
+		// VkPresentModeKHR
+		{
+			uint32_t numPresentModes;
+			result = vkGetPhysicalDeviceSurfacePresentModesKHR( m_vkPhysicalDevice, vkSurface, &numPresentModes, NULL );
+			if ( VK_SUCCESS != result || 0 == numPresentModes ) {
+				printf( "ERROR: Failed to vkGetPhysicalDeviceSurfacePresentModesKHR\n" );
+				assert( 0 );
+				return false;
+			}
+
+			m_vkPresentModes.resize( numPresentModes );
+			result = vkGetPhysicalDeviceSurfacePresentModesKHR( m_vkPhysicalDevice, vkSurface, &numPresentModes, m_vkPresentModes.data() );
+			if ( VK_SUCCESS != result || 0 == numPresentModes ) {
+				printf( "ERROR: Failed to vkGetPhysicalDeviceSurfacePresentModesKHR\n" );
+				assert( 0 );
+				return false;
+			}
 		}
 	}
 
@@ -172,6 +177,24 @@ const std::vector< const char * > DeviceContext::m_deviceExtensions = {
 	VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
 };
 
+/*
+====================================================
+DeviceExtensions
+Without a surface there is no swap chain to need its extension
+====================================================
+*/
+static std::vector< const char * > DeviceExtensions( VkSurfaceKHR vkSurface ) {
+	std::vector< const char * > extensions;
+	for ( int i = 0; i < DeviceContext::m_deviceExtensions.size(); i++ ) {
+		const char * extension = DeviceContext::m_deviceExtensions[ i ];
+		if ( VK_NULL_HANDLE == vkSurface && 0 == strcmp( extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME ) ) {
+			continue;
+		}
+		extensions.push_back( extension );
+	}
+	return extensions;
+}
+
 /*
 ====================================================
 VulkanErrorMessage
@@ -270,7 +293,9 @@ DeviceContext::Cleanup
 ====================================================
 */
 void DeviceContext::Cleanup() {
-	m_swapChain.Cleanup( this );
+	if ( VK_NULL_HANDLE != m_vkSurface ) {
+		m_swapChain.Cleanup( this );
+	}
 
 	// Destroy Command Buffers
 	vkFreeCommandBuffers( m_vkDevice, m_vkCommandPool, (uint32_t)m_vkCommandBuffers.size(), m_vkCommandBuffers.data() );
@@ -281,7 +306,9 @@ void DeviceContext::Cleanup() {
 	if ( m_enableLayers ) {
 		vfs::vkDestroyDebugReportCallbackEXT( m_vkInstance, m_vkDebugCallback, nullptr );
 	}
-	vkDestroySurfaceKHR( m_vkInstance, m_vkSurface, nullptr );
+	if ( VK_NULL_HANDLE != m_vkSurface ) {
+		vkDestroySurfaceKHR( m_vkInstance, m_vkSurface, nullptr );
+	}
 	vkDestroyInstance( m_vkInstance, nullptr );
 }
 
@@ -368,19 +395,21 @@ bool DeviceContext::CreatePhysicalDevice() {
 	//
 	//	Select a physical device
 	//
+	const bool isHeadless = ( VK_NULL_HANDLE == m_vkSurface );
+	const std::vector< const char * > deviceExtensions = DeviceExtensions( m_vkSurface );
 	for ( int i = 0; i < m_physicalDevices.size(); i++ ) {
 		const PhysicalDeviceProperties & deviceProperties = m_physicalDevices[ i ];
 
-		// Ignore non-drawing devices
-		if ( 0 == deviceProperties.m_vkPresentModes.size() ) {
+		// Ignore non-drawing devices, unless there is nothing to draw to
+		if ( !isHeadless && 0 == deviceProperties.m_vkPresentModes.size() ) {
 			continue;
 		}
-		if ( 0 == deviceProperties.m_vkSurfaceFormats.size() ) {
+		if ( !isHeadless && 0 == deviceProperties.m_vkSurfaceFormats.size() ) {
 			continue;
 		}
 
 		// Verify required extension support
-		if ( !deviceProperties.HasExtensions( (const char **)m_deviceExtensions.data(), (int)m_deviceExtensions.size() ) ) {
+		if ( !deviceProperties.HasExtensions( (const char **)deviceExtensions.data(), (int)deviceExtensions.size() ) ) {
 			continue;
 		}
 
@@ -409,8 +438,8 @@ bool DeviceContext::CreatePhysicalDevice() {
 		//
 		//	Find present queue family
 		//
-		int presentIdx = -1;
-		for ( int j = 0; j < deviceProperties.m_vkQueueFamilyProperties.size(); ++j ) {
+		int presentIdx = isHeadless ? graphicsIdx : -1;
+		for ( int j = 0; presentIdx < 0 && j < deviceProperties.m_vkQueueFamilyProperties.size(); ++j ) {
 			const VkQueueFamilyProperties & props = deviceProperties.m_vkQueueFamilyProperties[ j ];
 
 			if ( props.queueCount == 0 ) {
@@ -496,8 +525,9 @@ bool DeviceContext::CreateLogicalDevice() {
 	}
 	createInfo.pQueueCreateInfos = queueCreateInfos;
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = (uint32_t)m_deviceExtensions.size();
-	createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+	const std::vector< const char * > deviceExtensions = DeviceExtensions( m_vkSurface );
+	createInfo.enabledExtensionCount = (uint32_t)deviceExtensions.size();
+	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 	createInfo.enabledLayerCount = (uint32_t)validationLayers.size();
 	createInfo.ppEnabledLayerNames = validationLayers.data();
 
@@ -53,6 +53,7 @@ public:
 	VkInstance m_vkInstance;
 	VkDebugReportCallbackEXT m_vkDebugCallback;
 
+	// VK_NULL_HANDLE for a device with no window, which can't present but can still compute
 	VkSurfaceKHR m_vkSurface;
 
 	bool CreateDevice();
@@ -0,0 +1,191 @@
+//
+//  GPUParticles.cpp
+//
+#include "GPUParticles.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+========================================================================================================
+
+GPUParticles
+
+========================================================================================================
+*/
+
+/*
+====================================================
+PassBarrier
+Every write of the passes before is seen by what waits on dstStages
+====================================================
+*/
+static void PassBarrier( VkCommandBuffer cmdBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess ) {
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier( cmdBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr );
+}
+
+/*
+====================================================
+GPUParticles::Create
+====================================================
+*/
+bool GPUParticles::Create( DeviceContext * device, const ParticleSystem & particles ) {
+	const VkQueueFamilyProperties & family = device->m_physicalDevices[ device->m_deviceIndex ].m_vkQueueFamilyProperties[ device->m_graphicsFamilyIdx ];
+	if ( 0 == ( family.queueFlags & VK_QUEUE_COMPUTE_BIT ) ) {
+		printf( "ERROR: The graphics queue can't run compute\n" );
+		return false;
+	}
+
+	m_shader.Load( device, "particles" );
+	if ( NULL == m_shader.m_vkShaderModules[ Shader::SHADER_STAGE_COMPUTE ] ) {
+		printf( "ERROR: No data/shaders/spirv/particles.comp.spirv, run data/shaders/compileShaders.bat\n" );
+		m_shader.Cleanup( device );
+		return false;
+	}
+
+	const ParticleParms parms = particles.GetParms( 0.0f );
+	m_numParticles = (int)parms.numParticles;
+	m_numCells = (int)parms.cellMask + 1;
+
+	//
+	//	Buffers
+	//
+	const int particleSize = sizeof( Particle ) * m_numParticles;
+	m_particleBuffer.Allocate( device, particles.particles.data(), particleSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT );
+	m_cellHeadBuffer.Allocate( device, NULL, sizeof( uint32_t ) * m_numCells, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT );
+	m_nextBuffer.Allocate( device, NULL, sizeof( uint32_t ) * m_numParticles, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT );
+	m_correctionBuffer.Allocate( device, NULL, sizeof( ParticleCorrection ) * m_numParticles, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT );
+
+	//
+	//	Pipeline
+	//
+	Descriptors::CreateParms_t descriptorParms;
+	memset( &descriptorParms, 0, sizeof( descriptorParms ) );
+	descriptorParms.numStorageBuffers = 4;
+	if ( !m_descriptors.Create( device, descriptorParms ) ) {
+		printf( "ERROR: Failed to create particle descriptors\n" );
+		return false;
+	}
+
+	Pipeline::CreateParms_t pipelineParms;
+	pipelineParms.descriptors = &m_descriptors;
+	pipelineParms.shader = &m_shader;
+	pipelineParms.pushConstantSize = sizeof( ParticleParms );
+	if ( !m_pipeline.CreateCompute( device, pipelineParms ) ) {
+		printf( "ERROR: Failed to create particle pipeline\n" );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+====================================================
+GPUParticles::Cleanup
+====================================================
+*/
+void GPUParticles::Cleanup( DeviceContext * device ) {
+	m_pipeline.Cleanup( device );
+	m_descriptors.Cleanup( device );
+	m_shader.Cleanup( device );
+
+	m_particleBuffer.Cleanup( device );
+	m_cellHeadBuffer.Cleanup( device );
+	m_nextBuffer.Cleanup( device );
+	m_correctionBuffer.Cleanup( device );
+
+	m_numParticles = 0;
+	m_numCells = 0;
+}
+
+/*
+====================================================
+GPUParticles::Upload
+====================================================
+*/
+void GPUParticles::Upload( DeviceContext * device, const ParticleSystem & particles ) {
+	assert( (int)particles.particles.size() == m_numParticles );
+
+	void * memory = m_particleBuffer.MapBuffer( device );
+	memcpy( memory, particles.particles.data(), sizeof( Particle ) * m_numParticles );
+	m_particleBuffer.UnmapBuffer( device );
+}
+
+/*
+====================================================
+GPUParticles::RecordUpdate
+====================================================
+*/
+void GPUParticles::RecordUpdate( DeviceContext * device, VkCommandBuffer cmdBuffer, const ParticleParms & parms ) {
+	assert( (int)parms.numParticles == m_numParticles );
+	assert( (int)parms.cellMask + 1 == m_numCells );
+
+	Descriptor descriptor = m_pipeline.GetFreeDescriptor();
+	descriptor.BindBuffer( &m_particleBuffer, 0, (int)m_particleBuffer.m_vkBufferSize, 0 );
+	descriptor.BindBuffer( &m_cellHeadBuffer, 0, (int)m_cellHeadBuffer.m_vkBufferSize, 1 );
+	descriptor.BindBuffer( &m_nextBuffer, 0, (int)m_nextBuffer.m_vkBufferSize, 2 );
+	descriptor.BindBuffer( &m_correctionBuffer, 0, (int)m_correctionBuffer.m_vkBufferSize, 3 );
+	descriptor.BindDescriptorCompute( device, cmdBuffer, &m_pipeline );
+
+	m_pipeline.BindPipelineCompute( cmdBuffer );
+
+	// The last frame's draw may still be reading the particles
+	PassBarrier( cmdBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+
+	const int numGroups = ( m_numParticles + 63 ) / 64;
+	ParticleParms passParms = parms;
+	for ( uint32_t pass = 0; pass < (uint32_t)ParticlePass::COUNT; pass++ ) {
+		if ( (uint32_t)ParticlePass::GRID == pass ) {
+			// Empty every cell, the barriers since the last step's collide pass keep its reads ahead of this
+			vkCmdFillBuffer( cmdBuffer, m_cellHeadBuffer.m_vkBuffer, 0, VK_WHOLE_SIZE, PARTICLE_NO_INDEX );
+			PassBarrier( cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+		}
+
+		passParms.pass = pass;
+		vkCmdPushConstants( cmdBuffer, m_pipeline.m_vkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( ParticleParms ), &passParms );
+		m_pipeline.DispatchCompute( cmdBuffer, numGroups, 1, 1 );
+
+		// Each pass reads what the one before wrote, and the grid is emptied
+		// for the next step by a transfer, after its integrate pass
+		PassBarrier( cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT );
+	}
+
+	// Ready to draw from, or to read back once the queue is done
+	PassBarrier( cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT );
+}
+
+/*
+====================================================
+GPUParticles::Update
+====================================================
+*/
+void GPUParticles::Update( DeviceContext * device, const ParticleParms & parms ) {
+	VkCommandBuffer cmdBuffer = device->CreateCommandBuffer( VK_COMMAND_BUFFER_LEVEL_PRIMARY );
+	RecordUpdate( device, cmdBuffer, parms );
+	device->FlushCommandBuffer( cmdBuffer, device->m_vkGraphicsQueue );
+}
+
+/*
+====================================================
+GPUParticles::ReadBack
+====================================================
+*/
+void GPUParticles::ReadBack( DeviceContext * device, Particle * particles, ParticleCorrection * corrections ) {
+	void * memory = m_particleBuffer.MapBuffer( device );
+	memcpy( (void *)particles, memory, sizeof( Particle ) * m_numParticles );
+	m_particleBuffer.UnmapBuffer( device );
+
+	if ( NULL != corrections ) {
+		memory = m_correctionBuffer.MapBuffer( device );
+		memcpy( (void *)corrections, memory, sizeof( ParticleCorrection ) * m_numParticles );
+		m_correctionBuffer.UnmapBuffer( device );
+	}
+}
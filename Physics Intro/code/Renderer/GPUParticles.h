@@ -0,0 +1,62 @@
+//
+//  GPUParticles.h
+//
+#pragma once
+#include "Buffer.h"
+#include "Descriptor.h"
+#include "Pipeline.h"
+#include "shader.h"
+#include "../ParticleSystem.h"
+
+/*
+====================================================
+GPUParticles
+
+The compute shader path of ParticleSystem. The particles live in a
+storage buffer and each step is four dispatches of particles.comp, the
+same passes ParticleSystem::Update runs on the CPU, with the hashed grid
+built on the GPU each step.
+
+The particle buffer is host visible, so results can be read straight
+back. It is a vertex buffer as well, for drawing the particles as
+instances straight from it with no copy.
+====================================================
+*/
+class GPUParticles {
+public:
+	GPUParticles() : m_numParticles( 0 ), m_numCells( 0 ) {}
+
+	// False when the device cannot run compute on its graphics queue or
+	// particles.comp has not been compiled to spirv
+	bool Create( DeviceContext * device, const ParticleSystem & particles );
+	void Cleanup( DeviceContext * device );
+
+	// Overwrites what is on the GPU with the CPU's particles
+	void Upload( DeviceContext * device, const ParticleSystem & particles );
+
+	// Records a step into a command buffer, ending with the results ready for
+	// the vertex input and the host
+	void RecordUpdate( DeviceContext * device, VkCommandBuffer cmdBuffer, const ParticleParms & parms );
+
+	// Steps on the graphics queue and waits for it
+	void Update( DeviceContext * device, const ParticleParms & parms );
+
+	// Copies the particles back, and the corrections of the last step when given somewhere to go
+	void ReadBack( DeviceContext * device, Particle * particles, ParticleCorrection * corrections = NULL );
+
+	int NumParticles() const { return m_numParticles; }
+
+	Buffer m_particleBuffer;
+
+private:
+	int m_numParticles;
+	int m_numCells;
+
+	Buffer m_cellHeadBuffer;
+	Buffer m_nextBuffer;
+	Buffer m_correctionBuffer;
+
+	Shader m_shader;
+	Descriptors m_descriptors;
+	Pipeline m_pipeline;
+};
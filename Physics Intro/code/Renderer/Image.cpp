@@ -2,6 +2,7 @@
 //  Image.cpp
 //
 #include "Image.h"
+#include "../MemoryTracker.h"
 #include <assert.h>
 #include <stdio.h>
 
@@ -76,6 +77,8 @@ bool Image::Create( DeviceContext * device, const CreateParms_t & parms ) {
 		assert( 0 );
 		return false;
 	}
+	m_vkMemorySize = memReqs.size;
+	MemoryTracker::Allocate( MemoryTag::TEXTURES, (size_t)m_vkMemorySize );
 
 	result = vkBindImageMemory( device->m_vkDevice, m_vkImage, m_vkDeviceMemory, 0 );
 	if ( VK_SUCCESS != result ) {
@@ -131,6 +134,8 @@ void Image::Cleanup( DeviceContext * device ) {
 	vkDestroyImageView( device->m_vkDevice, m_vkImageView, nullptr );
 	vkDestroyImage( device->m_vkDevice, m_vkImage, nullptr );
 	vkFreeMemory( device->m_vkDevice, m_vkDeviceMemory, nullptr );
+	MemoryTracker::Free( MemoryTag::TEXTURES, (size_t)m_vkMemorySize );
+	m_vkMemorySize = 0;
 }
 
 /*
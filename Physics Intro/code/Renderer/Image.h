@@ -32,6 +32,7 @@ public:
 	VkImage			m_vkImage;
 	VkImageView		m_vkImageView;
 	VkDeviceMemory	m_vkDeviceMemory;
+	VkDeviceSize	m_vkMemorySize;
 
 	VkImageLayout	m_vkImageLayout;
 };
\ No newline at end of file
@@ -25,6 +25,18 @@ Pipeline	g_shadowPipeline;
 Shader		g_shadowShader;
 Descriptors	g_shadowDescriptors;
 
+/*
+====================================================
+QueueOffscreenShaders
+Starts reading the shaders InitOffscreen loads
+====================================================
+*/
+void QueueOffscreenShaders( AsyncFileReader & reader ) {
+	g_shadowShader.Queue( reader, "shadow2" );
+	g_skyShader.Queue( reader, "sky" );
+	g_checkerboardShadowShader.Queue( reader, "checkerboardShadowed2" );
+}
+
 /*
 ====================================================
 InitOffscreen
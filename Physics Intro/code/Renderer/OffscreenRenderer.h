@@ -5,8 +5,10 @@
 
 class DeviceContext;
 class Buffer;
+class AsyncFileReader;
 struct RenderModel;
 
+void QueueOffscreenShaders( AsyncFileReader & reader );
 bool InitOffscreen( DeviceContext * device, int width, int height );
 bool CleanupOffscreen( DeviceContext * device );
 
@@ -4,6 +4,7 @@
 #include "SwapChain.h"
 #include "DeviceContext.h"
 #include "../Fileio.h"
+#include "../MemoryTracker.h"
 #include <assert.h>
 
 /*
@@ -35,6 +36,8 @@ void SwapChain::Cleanup( DeviceContext * device ) {
 	vkDestroyImageView( device->m_vkDevice, m_vkDepthImageView, nullptr );
 	vkDestroyImage( device->m_vkDevice, m_vkDepthImage, nullptr );
 	vkFreeMemory( device->m_vkDevice, m_vkDepthImageMemory, nullptr );
+	MemoryTracker::Free( MemoryTag::TEXTURES, (size_t)m_vkDepthImageMemorySize );
+	m_vkDepthImageMemorySize = 0;
 
 	// frame buffer
 	for ( int i = 0; i < m_vkFramebuffers.size(); i++ ) {
@@ -231,6 +234,8 @@ bool SwapChain::Create( DeviceContext * device, int width, int height ) {
 			assert( 0 );
 			return false;
 		}
+		m_vkDepthImageMemorySize = memRequirements.size;
+		MemoryTracker::Allocate( MemoryTag::TEXTURES, (size_t)m_vkDepthImageMemorySize );
 
 		vkBindImageMemory( device->m_vkDevice, m_vkDepthImage, m_vkDepthImageMemory, 0 );
 
@@ -42,6 +42,7 @@ public:
 	VkImage m_vkDepthImage;
 	VkImageView m_vkDepthImageView;
 	VkDeviceMemory m_vkDepthImageMemory;
+	VkDeviceSize m_vkDepthImageMemorySize;
 
 	std::vector< VkFramebuffer > m_vkFramebuffers;
 
@@ -4,6 +4,7 @@
 #include "model.h"
 #include "../Math/Vector.h"
 #include "../Fileio.h"
+#include "../MemoryTracker.h"
 #include <string.h>
 #include <algorithm>
 #include "../../Shape.h"
@@ -394,6 +395,7 @@ bool Model::BuildFromShape(const Shape* shape) {
 	if (NULL == shape) {
 		return false;
 	}
+	ScopedMemoryTag tag( MemoryTag::MESHES );
 	if (shape->GetType() == Shape::ShapeType::SHAPE_SPHERE) {
 		const ShapeSphere* shapeSphere = (const ShapeSphere*)shape;
 
@@ -407,8 +409,6 @@ bool Model::BuildFromShape(const Shape* shape) {
 			}
 		}
 	}
-
-	/*
 	else if (shape->GetType() == Shape::ShapeType::SHAPE_BOX) {
 		const ShapeBox* shapeBox = (const ShapeBox*)shape;
 
@@ -431,34 +431,25 @@ bool Model::BuildFromShape(const Shape* shape) {
 		m_vertices.clear();
 		m_indices.clear();
 
-		// Build the connected convex hull from the points
-		std::vector< Vec3 > hullPts;
-		std::vector< tri_t > hullTris;
-		BuildConvexHull(shapeConvex->m_points, hullPts, hullTris);
-
-		// Calculate smoothed normals
-		std::vector< Vec3 > normals;
-		normals.reserve(hullPts.size());
-		for (int i = 0; i < hullPts.size(); i++) {
-			Vec3 norm(0.0f);
-
-			for (int t = 0; t < hullTris.size(); t++) {
-				const tri_t& tri = hullTris[t];
-				if (i != tri.a && i != tri.b && i != tri.c) {
-					continue;
-				}
-
-				const Vec3& a = hullPts[tri.a];
-				const Vec3& b = hullPts[tri.b];
-				const Vec3& c = hullPts[tri.c];
-
-				Vec3 ab = b - a;
-				Vec3 ac = c - a;
-				norm += ab.Cross(ac);
-			}
-
-			norm.Normalize();
-			normals.push_back(norm);
+		// The shape already holds the connected convex hull
+		const std::vector< Vec3 >& hullPts = shapeConvex->m_points;
+		const std::vector< tri_t >& hullTris = shapeConvex->m_tris;
+
+		// Calculate smoothed normals, each triangle adds its normal to its three vertices
+		std::vector< Vec3 > normals(hullPts.size(), Vec3(0.0f));
+		for (int t = 0; t < hullTris.size(); t++) {
+			const tri_t& tri = hullTris[t];
+
+			const Vec3& a = hullPts[tri.a];
+			const Vec3& b = hullPts[tri.b];
+			const Vec3& c = hullPts[tri.c];
+
+			Vec3 ab = b - a;
+			Vec3 ac = c - a;
+			Vec3 norm = ab.Cross(ac);
+			normals[tri.a] += norm;
+			normals[tri.b] += norm;
+			normals[tri.c] += norm;
 		}
 
 		m_vertices.reserve(hullPts.size());
@@ -488,7 +479,6 @@ bool Model::BuildFromShape(const Shape* shape) {
 			m_indices.push_back(hullTris[i].c);
 		}
 	}
-		*/
 	return true;
 
 	}
@@ -2,13 +2,32 @@
 //  shader.cpp
 //
 #include "shader.h"
+#include "../AsyncFileReader.h"
 #include "../Fileio.h"
 #include <assert.h>
+#include <utility>
 
 #include "model.h"
 
 #include "FrameBuffer.h"
 
+static const char * g_stageExtensions[ Shader::SHADER_STAGE_NUM ] = {
+	"vert",	// SHADER_STAGE_VERTEX
+	"tess",	// SHADER_STAGE_TESSELLATION_CONTROL
+	"tval",	// SHADER_STAGE_TESSELLATION_EVALUATION
+	"geom",	// SHADER_STAGE_GEOMETRY
+	"frag",	// SHADER_STAGE_FRAGMENT
+	"comp",	// SHADER_STAGE_COMPUTE
+	"rgen",	// SHADER_STAGE_RAYGEN
+	"ahit",	// SHADER_STAGE_ANY_HIT
+	"chit",	// SHADER_STAGE_CLOSEST_HIT
+	"miss",	// SHADER_STAGE_MISS
+	"rint",	// SHADER_STAGE_INTERSECTION
+	"call",	// SHADER_STAGE_CALLABLE
+	"task",	// SHADER_STAGE_TASK
+	"mesh",	// SHADER_STAGE_MESH
+};
+
 /*
 ========================================================================================================
 
@@ -26,39 +45,50 @@ Shader::Shader() {
 	memset( m_vkShaderModules, 0, sizeof( VkShaderModule ) * SHADER_STAGE_NUM );
 }
 
+/*
+====================================================
+Shader::Queue
+====================================================
+*/
+void Shader::Queue( AsyncFileReader & reader, const char * name ) {
+	for ( int i = 0; i < SHADER_STAGE_NUM; i++ ) {
+		char nameSpirv[ 1024 ];
+		sprintf_s( nameSpirv, 1024, "data/shaders/spirv/%s.%s.spirv", name, g_stageExtensions[ i ] );
+		if ( !FileExists( nameSpirv ) ) {
+			continue;
+		}
+
+		FileView * code = &m_queuedCode[ i ];
+		reader.Read( nameSpirv, [ code ]( FileView & file ) { *code = std::move( file ); } );
+	}
+}
+
 /*
 ====================================================
 Shader::Load
 ====================================================
 */
 bool Shader::Load( DeviceContext * device, const char * name ) {
-	const char * fileExtensions[ SHADER_STAGE_NUM ];
-	fileExtensions[ SHADER_STAGE_VERTEX ]					= "vert";
-	fileExtensions[ SHADER_STAGE_TESSELLATION_CONTROL ]		= "tess";
-	fileExtensions[ SHADER_STAGE_TESSELLATION_EVALUATION ]	= "tval";
-	fileExtensions[ SHADER_STAGE_GEOMETRY ]					= "geom";
-	fileExtensions[ SHADER_STAGE_FRAGMENT ]					= "frag";
-	fileExtensions[ SHADER_STAGE_COMPUTE ]					= "comp";
-	fileExtensions[ SHADER_STAGE_RAYGEN ]					= "rgen";
-	fileExtensions[ SHADER_STAGE_ANY_HIT ]					= "ahit";
-	fileExtensions[ SHADER_STAGE_CLOSEST_HIT ]				= "chit";
-	fileExtensions[ SHADER_STAGE_MISS ]						= "miss";
-	fileExtensions[ SHADER_STAGE_INTERSECTION ]				= "rint";
-	fileExtensions[ SHADER_STAGE_CALLABLE ]					= "call";
-	fileExtensions[ SHADER_STAGE_TASK ]						= "task";
-	fileExtensions[ SHADER_STAGE_MESH ]						= "mesh";
-
 	for ( int i = 0; i < SHADER_STAGE_NUM; i++ ) {
-		unsigned char * code = NULL;
-		unsigned int size = 0;
+		// Read already by Queue
+		if ( m_queuedCode[ i ].IsOpen() ) {
+			m_vkShaderModules[ i ] = Shader::CreateShaderModule( device->m_vkDevice, (const char *)m_queuedCode[ i ].Data(), (int)m_queuedCode[ i ].Size() );
+			m_queuedCode[ i ].Close();
+			continue;
+		}
 
-		// Try loading the spirv code first
+		// Most shaders have two or three of the stages, a stat rules out the rest without opening them
 		char nameSpirv[ 1024 ];
-		sprintf_s( nameSpirv, 1024, "data/shaders/spirv/%s.%s.spirv", name, fileExtensions[ i ] );
-		if ( GetFileData( nameSpirv, &code, size ) ) {
-			m_vkShaderModules[ i ] = Shader::CreateShaderModule( device->m_vkDevice, (char*)code, size );
+		sprintf_s( nameSpirv, 1024, "data/shaders/spirv/%s.%s.spirv", name, g_stageExtensions[ i ] );
+		if ( !FileExists( nameSpirv ) ) {
 			continue;
 		}
+
+		// The driver copies the code, so it is handed the mapped file and the view dropped after
+		FileView code;
+		if ( code.Open( nameSpirv ) ) {
+			m_vkShaderModules[ i ] = Shader::CreateShaderModule( device->m_vkDevice, (const char *)code.Data(), (int)code.Size() );
+		}
 	}
 
 	return true;
@@ -75,6 +105,7 @@ void Shader::Cleanup( DeviceContext * device ) {
 			vkDestroyShaderModule( device->m_vkDevice, m_vkShaderModules[ i ], nullptr );
 		}
 		m_vkShaderModules[ i ] = NULL;
+		m_queuedCode[ i ].Close();
 	}
 }
 
@@ -5,8 +5,11 @@
 #include "DeviceContext.h"
 #include "Pipeline.h"
 #include "Descriptor.h"
+#include "../Fileio.h"
 #include <vulkan/vulkan.h>
 
+class AsyncFileReader;
+
 /*
 ====================================================
 Shader
@@ -37,6 +40,9 @@ public:
 	Shader();
 	~Shader() {}
 
+	// Starts reading the stages in the background. Load, once the reader has
+	// been waited on, builds the modules from what was read.
+	void Queue( AsyncFileReader & reader, const char * name );
 	bool Load( DeviceContext * device, const char * name );
 	void Cleanup( DeviceContext * device );
 
@@ -48,4 +54,7 @@ public:
 	//	Shader Modules
 	//
 	VkShaderModule m_vkShaderModules[ SHADER_STAGE_NUM ];
+
+private:
+	FileView m_queuedCode[ SHADER_STAGE_NUM ];	// Read by Queue, waiting for Load
 };
\ No newline at end of file
@@ -3,12 +3,18 @@
 //
 #include "Scene.h"
 
+#include <algorithm>
+#include <float.h>
 #include <iostream>
+#include <stdio.h>
 #include <random>
 #include <string>
+#include <string.h>
 
 #include "Broadphase.h"
 #include "Intersections.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
 #include "../Shape.h"
 
 
@@ -27,11 +33,34 @@ Scene::~Scene
 */
 Scene::~Scene()
 {
-	for (auto& bodie : bodies)
+	DeleteShapes();
+	bodies.clear();
+}
+
+/*
+====================================================
+Scene::DeleteShapes
+Shapes borrowed from another scene are left to it
+====================================================
+*/
+void Scene::DeleteShapes()
+{
+	if (m_ownsShapes)
 	{
-		delete bodie.shape;
+		// Bodies can share a shape, each is deleted once
+		std::vector<Shape*> shapes(bodies.size());
+		for (int i = 0; i < (int)bodies.size(); ++i)
+		{
+			shapes[i] = bodies[i].shape;
+		}
+		std::sort(shapes.begin(), shapes.end());
+		shapes.erase(std::unique(shapes.begin(), shapes.end()), shapes.end());
+		for (Shape* shape : shapes)
+		{
+			delete shape;
+		}
 	}
-	bodies.clear();
+	m_ownsShapes = true;
 }
 
 /*
@@ -41,13 +70,91 @@ Scene::Reset
 */
 void Scene::Reset()
 {
-	for (auto& bodie : bodies)
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	DeleteShapes();
+	bodies.clear();
+	m_simplexCache.clear();
+	ClearJoints();
+	m_prevPoses.clear();
+	m_accumulator = 0.0f;
+	m_lodFrame = 0;
+	m_lastNumSubsteps = 1;
+	m_lastNumContacts = 0;
+	m_isQueryDirty = true;
+
+	const SceneFile& file = GetSceneFile();
+	if (file.bodies.empty())
+	{
+		Initialize();
+	}
+	else
+	{
+		file.CreateBodies(*this);
+	}
+}
+
+/*
+====================================================
+Scene::LoadScene
+====================================================
+*/
+bool Scene::LoadScene(const char* fileName)
+{
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	SceneFile file;
+	if (!file.Load(fileName) || !file.BuildHulls(m_jobs))
 	{
-		delete bodie.shape;
+		printf("ERROR: Unable to load scene %s: %s\n", fileName, file.GetError().c_str());
+		return false;
 	}
-	bodies.clear();
 
-	Initialize();
+	m_sceneFile = std::move(file);
+	m_sharedSceneFile = NULL;
+	Reset();
+	return true;
+}
+
+/*
+====================================================
+Scene::ShareFrom
+====================================================
+*/
+void Scene::ShareFrom(const Scene& base)
+{
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	DeleteShapes();
+	m_ownsShapes = false;
+	bodies = base.bodies;
+	
+	// Static bodies are copied like the rest, the solvers index every body in one array
+	m_sceneFile.Clear();
+	m_sharedSceneFile = &base.GetSceneFile();
+	
+	m_joints = base.m_joints;
+	m_jointPairs = base.m_jointPairs;
+	m_jointSolver.MarkDirty();
+	
+	m_isDeterministic = base.m_isDeterministic;
+	m_seed = base.m_seed;
+	m_solverMode = base.m_solverMode;
+	m_numSubsteps = base.m_numSubsteps;
+	m_stepRate = base.m_stepRate;
+	m_maxStepsPerFrame = base.m_maxStepsPerFrame;
+	m_accumulator = 0.0f;
+	m_prevPoses.clear();
+	m_isLodEnabled = base.m_isLodEnabled;
+	m_lodFocus = base.m_lodFocus;
+	m_lodRadius = base.m_lodRadius;
+	m_lodFrame = 0;
+	m_isAdaptive = base.m_isAdaptive;
+	m_maxAdaptiveSubsteps = base.m_maxAdaptiveSubsteps;
+	m_lastNumSubsteps = base.m_lastNumSubsteps;
+	m_lastNumContacts = base.m_lastNumContacts;
+	
+	// Same warm starts, so a copy left alone steps exactly like the base would
+	m_frame = base.m_frame;
+	m_simplexCache = base.m_simplexCache;
+	m_isQueryDirty = true;
 }
 
 /*
@@ -57,11 +164,13 @@ Scene::Initialize
 */
 void Scene::Initialize()
 {
-	// Random Generator
-	std::random_device rd; // obtain a random number from hardware
-	std::mt19937 gen(rd()); // seed the generator
-	//std::uniform_int_distribution<> distrInt(-7, 7); // define the range int
-	std::uniform_real_distribution<> distrDouble(-7.5f,7.5f); // define the range float
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	m_isQueryDirty = true;
+
+	// Random Generator, seeded from the hardware unless the run has to be repeatable
+	std::mt19937 gen(m_isDeterministic ? m_seed : std::random_device()());
+	// Floats straight from the generator's bits, the standard distributions differ between libraries
+	const auto random = [&gen](const float lo, const float hi) { return lo + (hi - lo) * (float)(gen() >> 8) * (1.0f / 16777216.0f); };
 	
 	
 	Body body;
@@ -77,8 +186,8 @@ void Scene::Initialize()
 	body.friction = 0.4f;
 	
 	// Random Direction for the Cochonet
-	float impulseDirectionX = floorf((float)distrDouble(gen) * 10) / 10;
-	float impulseDirectionY = floorf((float)distrDouble(gen) * 10) / 10;
+	float impulseDirectionX = floorf(random(-7.5f, 7.5f) * 10) / 10;
+	float impulseDirectionY = floorf(random(-7.5f, 7.5f) * 10) / 10;
 	
 	body.linearVelocity = Vec3(impulseDirectionX, impulseDirectionY, 0);
 	bodies.push_back(body);
@@ -146,6 +255,19 @@ void Scene::Initialize()
 	*/
 }
 
+/*
+====================================================
+JointPairKey
+Same key whichever way round the bodies are given
+====================================================
+*/
+static unsigned long long JointPairKey(const int a, const int b)
+{
+	const int lo = a < b ? a : b;
+	const int hi = a < b ? b : a;
+	return ((unsigned long long)lo << 32) | (unsigned int)hi;
+}
+
 /*
 ====================================================
 Scene::Update
@@ -153,9 +275,42 @@ Scene::Update
 */
 void Scene::Update(const float dt_sec)
 {
-	// Gravity
-	for (int i = 0; i < bodies.size(); ++i)
+	PROFILE_ZONE("Scene::Update");
+	PROFILE_COUNTER("Bodies", bodies.size());
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	HotLoopAllocationCheck allocationCheck("Scene::Update", MemoryTag::PHYSICS);
+	m_isQueryDirty = true;
+	++m_frame;
+
+	if (m_isLodEnabled)
+	{
+		UpdateLevelsOfDetail(dt_sec);
+	}
+	else
 	{
+		StepAdaptive(dt_sec);
+		PruneSimplexCache(1);
+	}
+
+	if (NULL != m_trace)
+	{
+		RecordTrace();
+	}
+	MemoryTracker::RecordProfileCounters();
+}
+
+/*
+====================================================
+Scene::Step
+Gravity, collisions and integration of the active bodies, all of them outside level of detail
+====================================================
+*/
+void Scene::Step(const float dt_sec)
+{
+	// Gravity, XPBD applies it itself on every substep
+	for (int i = 0; i < (int)bodies.size() && m_solverMode != SolverMode::XPBD; ++i)
+	{
+		if (!IsActive(i)) continue;
 		Body& body = bodies[i];
 		float mass = 1.0f / body.inverseMass;
 		// Gravity needs to be an impulse I
@@ -166,12 +321,451 @@ void Scene::Update(const float dt_sec)
 	}
 	
 	// Broadphase
-	std::vector<CollisionPair> collisionPairs;
-	BroadPhase(bodies.data(), bodies.size(), collisionPairs, dt_sec);
+	PROFILE_ZONE_BEGIN(broadphase, "Broadphase");
+	std::vector<CollisionPair>& collisionPairs = m_collisionPairs;
+	if (NULL == m_activeBodies)
+	{
+		BroadPhase(bodies.data(), bodies.size(), collisionPairs, dt_sec);
+	}
+	else
+	{
+		// Just the active bodies and the static ones they can hit, the pairs are then put back to scene ids
+		m_lodScratchIds.clear();
+		m_lodScratchBodies.clear();
+		for (int i = 0; i < (int)bodies.size(); ++i)
+		{
+			if (!m_activeBodies[i] && bodies[i].inverseMass != 0.0f) continue;
+			m_lodScratchIds.push_back(i);
+			m_lodScratchBodies.push_back(bodies[i]);
+		}
+		BroadPhase(m_lodScratchBodies.data(), m_lodScratchBodies.size(), collisionPairs, dt_sec);
+		for (CollisionPair& pair : collisionPairs)
+		{
+			pair.a = m_lodScratchIds[pair.a];
+			pair.b = m_lodScratchIds[pair.b];
+		}
+	}
+	
+	// Two static bodies never respond to each other, and jointed bodies do not collide
+	collisionPairs.erase(std::remove_if(collisionPairs.begin(), collisionPairs.end(), [this](const CollisionPair& pair)
+	{
+		if (bodies[pair.a].inverseMass == 0.0f && bodies[pair.b].inverseMass == 0.0f) return true;
+		return !m_jointPairs.empty() && m_jointPairs.count(JointPairKey(pair.a, pair.b)) > 0;
+	}), collisionPairs.end());
+	
+	// Canonical pair order, lowest body first, so the solvers see the same sequence every run
+	if (m_isDeterministic)
+	{
+		for (CollisionPair& pair : collisionPairs)
+		{
+			if (pair.a > pair.b) std::swap(pair.a, pair.b);
+		}
+		std::sort(collisionPairs.begin(), collisionPairs.end(), [](const CollisionPair& lhs, const CollisionPair& rhs)
+		{
+			return lhs.a != rhs.a ? lhs.a < rhs.a : lhs.b < rhs.b;
+		});
+	}
+	PROFILE_ZONE_END(broadphase);
+	PROFILE_COUNTER("Pairs", collisionPairs.size());
+	
+	if (m_solverMode == SolverMode::SPECULATIVE)
+	{
+		UpdateSpeculative(collisionPairs, dt_sec);
+	}
+	else if (m_solverMode == SolverMode::XPBD)
+	{
+		UpdateXPBD(collisionPairs, dt_sec);
+	}
+	else
+	{
+		UpdateTimeOfImpact(collisionPairs, dt_sec);
+	}
+	m_lastNumContacts = m_solverMode == SolverMode::XPBD ? m_xpbdSolver.NumContacts() : (int)m_contacts.size();
+	PROFILE_COUNTER("Contacts", m_lastNumContacts);
+}
+
+/*
+====================================================
+Scene::SetAdaptiveSubsteps
+====================================================
+*/
+void Scene::SetAdaptiveSubsteps(const bool isEnabled, const int maxSubsteps)
+{
+	m_isAdaptive = isEnabled;
+	m_maxAdaptiveSubsteps = maxSubsteps > 0 ? maxSubsteps : 1;
+	m_lastNumSubsteps = 1;
+}
+
+/*
+====================================================
+Scene::ChooseNumSubsteps
+A CFL style bound: no body may cover more than half the smallest radius
+in a substep, the fastest point of a body being its speed plus its spin
+times its reach. Plus the contact load of the last step.
+====================================================
+*/
+int Scene::ChooseNumSubsteps(const float dt_sec) const
+{
+	const float maxTravelPerRadius = 0.5f;
+	const float contactsPerSubstep = 2.0f;
+
+	float smallestRadius = FLT_MAX;
+	float fastestSpeed = 0.0f;
+	int numMoving = 0;
+	for (int i = 0; i < (int)bodies.size(); ++i)
+	{
+		const Body& body = bodies[i];
+		const Bounds bounds = body.shape->GetBounds();
+		const Vec3 extents = (bounds.maxs - bounds.mins) * 0.5f;
+		smallestRadius = std::min(smallestRadius, std::min(extents.x, std::min(extents.y, extents.z)));
+		if (body.inverseMass == 0.0f || !IsActive(i)) continue;
+
+		fastestSpeed = std::max(fastestSpeed, body.linearVelocity.GetMagnitude() + body.angularVelocity.GetMagnitude() * extents.GetMagnitude());
+		++numMoving;
+	}
+	if (0 == numMoving) return 1;
+
+	const float travel = fastestSpeed * dt_sec / (maxTravelPerRadius * std::max(smallestRadius, 0.001f));
+	const float load = (float)m_lastNumContacts / (float)numMoving / contactsPerSubstep;
+	const float numSubsteps = ceilf(std::max(travel, 1.0f + floorf(load)));
+	return numSubsteps < (float)m_maxAdaptiveSubsteps ? std::max((int)numSubsteps, 1) : m_maxAdaptiveSubsteps;
+}
+
+/*
+====================================================
+Scene::StepAdaptive
+====================================================
+*/
+void Scene::StepAdaptive(const float dt_sec)
+{
+	m_numXPBDSubsteps = m_numSubsteps;
+	if (!m_isAdaptive)
+	{
+		Step(dt_sec);
+		return;
+	}
+
+	const int numSubsteps = std::max(ChooseNumSubsteps(dt_sec), m_lastNumSubsteps - 1);
+	m_lastNumSubsteps = numSubsteps;
+	if (m_solverMode == SolverMode::XPBD)
+	{
+		// m_numSubsteps is the worst case, quiet steps take a share of it
+		m_numXPBDSubsteps = std::max((m_numSubsteps * numSubsteps + m_maxAdaptiveSubsteps - 1) / m_maxAdaptiveSubsteps, 1);
+		Step(dt_sec);
+		return;
+	}
+
+	const float substep_sec = dt_sec / (float)numSubsteps;
+	for (int i = 0; i < numSubsteps; ++i)
+	{
+		Step(substep_sec);
+	}
+}
+
+/*
+====================================================
+Scene::SetLevelOfDetail
+====================================================
+*/
+void Scene::SetLevelOfDetail(const bool isEnabled, const Vec3& focus, const float fullRateRadius)
+{
+	// Bodies between their steps are already where their velocity takes
+	// them, turning it off mid window just has them all step from there
+	m_isLodEnabled = isEnabled;
+	m_lodFrame = 0;
+	m_lodFocus = focus;
+	m_lodRadius = fullRateRadius > 0.0f ? fullRateRadius : 0.0f;
+}
+
+/*
+====================================================
+Scene::GetLodLevel
+====================================================
+*/
+int Scene::GetLodLevel(const int bodyId) const
+{
+	return m_isLodEnabled && bodyId < (int)m_lodLevels.size() ? m_lodLevels[bodyId] : 0;
+}
+
+/*
+====================================================
+Scene::AssignLevelsOfDetail
+Each dynamic body's level from how far it is from the focus, then the
+finest level of its island for all of the island, so no contact ever
+joins bodies stepping at different rates and the impulses between them
+stay equal and opposite. Islands are found with the bounds swept over two
+windows, enough for bodies that change course somewhat within the window.
+====================================================
+*/
+void Scene::AssignLevelsOfDetail(const float dt_sec)
+{
+	PROFILE_ZONE("Assign levels of detail");
+	const int numBodies = (int)bodies.size();
+	m_lodLevels.resize(numBodies);
+	m_lodAnchors.resize(numBodies);
+	m_lodMask.resize(numBodies);
+
+	std::vector<int>& island = m_lodIslands;
+	island.resize(numBodies);
+	for (int i = 0; i < numBodies; ++i)
+	{
+		island[i] = i;
+		m_lodAnchors[i].position = bodies[i].position;
+		m_lodAnchors[i].orientation = bodies[i].orientation;
+
+		const float distance = (bodies[i].position - m_lodFocus).GetMagnitude();
+		int level = 0;
+		while (level < MAX_LOD_LEVEL && distance >= m_lodRadius * (float)(1 << level))
+		{
+			++level;
+		}
+		m_lodLevels[i] = (char)level;
+	}
+
+	// Joints are only solved in full rate steps
+	for (const Joint& joint : m_joints)
+	{
+		m_lodLevels[joint.bodyA] = 0;
+		m_lodLevels[joint.bodyB] = 0;
+	}
+
+	const auto root = [&island](int id)
+	{
+		while (island[id] != id)
+		{
+			island[id] = island[island[id]];
+			id = island[id];
+		}
+		return id;
+	};
+
+	// The broadphase sweeps a single axis, its pairs only overlap along it
+	const int window = 1 << MAX_LOD_LEVEL;
+	const float sweep_sec = dt_sec * (float)(window * 2);
+	std::vector<Bounds>& swept = m_lodSwept;
+	swept.resize(numBodies);
+	for (int i = 0; i < numBodies; ++i)
+	{
+		const Body& body = bodies[i];
+		swept[i] = body.shape->GetBounds(body.position, body.orientation);
+		swept[i].Expand(swept[i].mins + body.linearVelocity * sweep_sec);
+		swept[i].Expand(swept[i].maxs + body.linearVelocity * sweep_sec);
+	}
+
+	std::vector<CollisionPair>& pairs = m_lodPairs;
+	BroadPhase(bodies.data(), bodies.size(), pairs, sweep_sec);
+	for (const CollisionPair& pair : pairs)
+	{
+		if (bodies[pair.a].inverseMass == 0.0f || bodies[pair.b].inverseMass == 0.0f) continue;
+		if (!swept[pair.a].DoesIntersect(swept[pair.b])) continue;
+
+		const int rootA = root(pair.a);
+		const int rootB = root(pair.b);
+		if (rootA == rootB) continue;
+
+		island[rootB] = rootA;
+		m_lodLevels[rootA] = std::min(m_lodLevels[rootA], m_lodLevels[rootB]);
+	}
+	for (int i = 0; i < numBodies; ++i)
+	{
+		m_lodLevels[i] = m_lodLevels[root(i)];
+	}
+}
+
+/*
+====================================================
+Scene::UpdateLevelsOfDetail
+Steps are grouped in windows of 2^MAX_LOD_LEVEL. A body at level L steps
+once every 2^L steps, at the end of each stretch, by 2^L times dt. In
+between it is moved along its velocity from where its last real step
+left it, so it does not stand still on screen, and put back there before
+the next real step.
+====================================================
+*/
+void Scene::UpdateLevelsOfDetail(const float dt_sec)
+{
+	const int window = 1 << MAX_LOD_LEVEL;
+	if (0 == m_lodFrame || m_lodLevels.size() != bodies.size())
+	{
+		m_lodFrame = 0;
+		AssignLevelsOfDetail(dt_sec);
+	}
+
+	const int numBodies = (int)bodies.size();
+	const int numSteps = m_lodFrame + 1;	// Into the window, counting this one
+	for (int level = 0; level <= MAX_LOD_LEVEL; ++level)
+	{
+		const int stride = 1 << level;
+		if (0 != numSteps % stride) continue;
+
+		bool isAnyActive = false;
+		for (int i = 0; i < numBodies; ++i)
+		{
+			m_lodMask[i] = m_lodLevels[i] == level && bodies[i].inverseMass != 0.0f;
+			isAnyActive = isAnyActive || m_lodMask[i];
+			if (m_lodMask[i] && level > 0)
+			{
+				bodies[i].position = m_lodAnchors[i].position;
+				bodies[i].orientation = m_lodAnchors[i].orientation;
+			}
+		}
+		if (!isAnyActive) continue;
+
+		m_activeBodies = m_lodMask.data();
+		m_isJointPass = 0 == level;
+		StepAdaptive(dt_sec * (float)stride);
+		m_activeBodies = NULL;
+		m_isJointPass = true;
+
+		for (int i = 0; i < numBodies; ++i)
+		{
+			if (!m_lodMask[i]) continue;
+			m_lodAnchors[i].position = bodies[i].position;
+			m_lodAnchors[i].orientation = bodies[i].orientation;
+		}
+	}
+
+	// Extrapolate the bodies that did not step
+	for (int i = 0; i < numBodies; ++i)
+	{
+		Body& body = bodies[i];
+		const int stride = 1 << m_lodLevels[i];
+		if (body.inverseMass == 0.0f || 0 == numSteps % stride) continue;
+
+		// Turned about the center of mass, as Body::Update does
+		const float time = dt_sec * (float)(numSteps % stride);
+		body.position = m_lodAnchors[i].position;
+		body.orientation = m_lodAnchors[i].orientation;
+		const Vec3 centerOfMass = body.GetCenterOfMassWorldSpace();
+		const Vec3 angle = body.angularVelocity * time;
+		const Quat dq = Quat(angle, angle.GetMagnitude());
+		body.orientation = dq * body.orientation;
+		body.orientation.Normalize();
+		body.position = centerOfMass + body.linearVelocity * time + dq.RotatePoint(body.position - centerOfMass);
+	}
+
+	// Every level has stepped by the end of the window, so a pair left out of all of it is gone
+	m_lodFrame = numSteps % window;
+	if (0 == m_lodFrame)
+	{
+		PruneSimplexCache(window);
+	}
+}
+
+/*
+====================================================
+Scene::Advance
+====================================================
+*/
+int Scene::Advance(const float frame_sec)
+{
+	const float step_sec = 1.0f / m_stepRate;
+	m_accumulator += frame_sec;
+
+	int numSteps = 0;
+	while (m_accumulator >= step_sec && numSteps < m_maxStepsPerFrame)
+	{
+		m_prevPoses.resize(bodies.size());
+		for (int i = 0; i < (int)bodies.size(); ++i)
+		{
+			m_prevPoses[i].position = bodies[i].position;
+			m_prevPoses[i].orientation = bodies[i].orientation;
+		}
+
+		Update(step_sec);
+		m_accumulator -= step_sec;
+		++numSteps;
+	}
+
+	// Out of steps, drop the time that is left rather than carry it forward
+	if (m_accumulator >= step_sec)
+	{
+		m_accumulator = fmodf(m_accumulator, step_sec);
+	}
+	return numSteps;
+}
+
+/*
+====================================================
+Scene::BodyPose::Blend
+Normalized lerp, close enough over a single step
+====================================================
+*/
+Scene::BodyPose Scene::BodyPose::Blend(const BodyPose& from, const BodyPose& to, const float alpha)
+{
+	const Quat& q0 = from.orientation;
+	const Quat& q1 = to.orientation;
+	const float dot = q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w;
+	const float beta = dot < 0.0f ? -alpha : alpha;
+
+	BodyPose pose;
+	pose.position = from.position * (1.0f - alpha) + to.position * alpha;
+	pose.orientation.x = q0.x * (1.0f - alpha) + q1.x * beta;
+	pose.orientation.y = q0.y * (1.0f - alpha) + q1.y * beta;
+	pose.orientation.z = q0.z * (1.0f - alpha) + q1.z * beta;
+	pose.orientation.w = q0.w * (1.0f - alpha) + q1.w * beta;
+	pose.orientation.Normalize();
+	return pose;
+}
+
+/*
+====================================================
+Scene::GetInterpolatedPosition
+====================================================
+*/
+Vec3 Scene::GetInterpolatedPosition(const int bodyId) const
+{
+	const Vec3& position = bodies[bodyId].position;
+	if (bodyId >= (int)m_prevPoses.size()) return position;
+
+	const float alpha = GetInterpolationAlpha();
+	return m_prevPoses[bodyId].position * (1.0f - alpha) + position * alpha;
+}
+
+/*
+====================================================
+Scene::GetInterpolatedOrientation
+====================================================
+*/
+Quat Scene::GetInterpolatedOrientation(const int bodyId) const
+{
+	const Body& body = bodies[bodyId];
+	if (bodyId >= (int)m_prevPoses.size()) return body.orientation;
+
+	BodyPose pose;
+	pose.position = body.position;
+	pose.orientation = body.orientation;
+	return BodyPose::Blend(m_prevPoses[bodyId], pose, GetInterpolationAlpha()).orientation;
+}
+
+/*
+====================================================
+Scene::UpdateTimeOfImpact
+====================================================
+*/
+void Scene::UpdateTimeOfImpact(const std::vector<CollisionPair>& collisionPairs, const float dt_sec)
+{
+	// Joints first, the contacts are then resolved in time order on top of them
+	if (!m_joints.empty() && m_isJointPass)
+	{
+		PROFILE_ZONE("Joints");
+		const int numJointIterations = 10;
+		m_jointSolver.Prepare(m_joints, bodies.data(), dt_sec);
+		m_jointSolver.Solve(numJointIterations);
+	}
+	
 	// Collision checks (Narrow phase)
+	PROFILE_ZONE_BEGIN(narrowPhase, "Narrow phase");
 	int numContacts = 0;
-	const int maxContacts = bodies.size() * bodies.size();
-	Contact* contacts = (Contact*)alloca(sizeof(Contact) * maxContacts);
+	// At most one contact per pair, large scenes overflowed a stack buffer of bodies squared
+	m_contacts.resize(collisionPairs.size());
+	Contact* contacts = m_contacts.data();
+	
+	// Sphere-sphere pairs are gathered and swept together in one SIMD batch,
+	// anything else goes through the generic per pair test
+	m_spherePairIds.clear();
+	m_spherePairs.Clear();
+	m_spherePairs.Reserve((int)collisionPairs.size());
 	for (int i = 0; i < collisionPairs.size(); ++i)
 	{
 		const CollisionPair& pair = collisionPairs[i];
@@ -179,13 +773,38 @@ void Scene::Update(const float dt_sec)
 		Body& bodyB = bodies[pair.b];
 		if (bodyA.inverseMass == 0.0f && bodyB.inverseMass == 0.0f) continue;
 		
+		if (bodyA.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE && bodyB.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE)
+		{
+			const ShapeSphere* sphereA = static_cast<const ShapeSphere*>(bodyA.shape);
+			const ShapeSphere* sphereB = static_cast<const ShapeSphere*>(bodyB.shape);
+			m_spherePairs.Add(bodyA.position, bodyB.position, bodyA.linearVelocity, bodyB.linearVelocity, sphereA->radius, sphereB->radius);
+			m_spherePairIds.push_back(pair);
+			continue;
+		}
+		
 		Contact contact;
-		if (Intersections::Intersect(bodyA, bodyB, dt_sec, contact))
+		if (Intersections::Intersect(bodyA, bodyB, dt_sec, contact, &SimplexCache(pair)))
 		{
 			contacts[numContacts] = contact;
 			++numContacts;
 		}
 	}
+	
+	Intersections::SphereSphereDynamicBatch(m_spherePairs, dt_sec, m_sphereResults);
+	for (int i = 0; i < (int)m_spherePairIds.size(); ++i)
+	{
+		if (!m_sphereResults.IsHit(i)) continue;
+		
+		Contact& contact = contacts[numContacts];
+		contact.timeOfImpact = m_sphereResults.timeOfImpact[i];
+		contact.ptOnAWorldSpace = m_sphereResults.PtOnA(i);
+		contact.ptOnBWorldSpace = m_sphereResults.PtOnB(i);
+		Intersections::FinishSphereContact(bodies[m_spherePairIds[i].a], bodies[m_spherePairIds[i].b], contact);
+		++numContacts;
+	}
+	m_contacts.resize(numContacts);
+	PROFILE_ZONE_END(narrowPhase);
+	
 	// Sort times of impact
 	if (numContacts > 1)
 	{
@@ -193,6 +812,8 @@ void Scene::Update(const float dt_sec)
 	}
 	
 	// Contact resolve in order
+	PROFILE_ZONE("Resolve impacts");
+	int numImpacts = 0;
 	float accumulatedTime = 0.0f;
 	for (int i = 0; i < numContacts; ++i)
 	{
@@ -206,22 +827,457 @@ void Scene::Update(const float dt_sec)
 		if (bodyA->inverseMass == 0.0f && bodyB->inverseMass == 0.0f) continue;
 		
 		// Position update
-		for (auto& bodie : bodies)
-		{
-			bodie.Update(dt);
-		}
+		UpdateBodies(dt);
 		Contact::ResolveContact(contact);
 		accumulatedTime += dt;
+		++numImpacts;
 	}
+	PROFILE_COUNTER("TOI events", numImpacts);
 	
 	// Other physics behaviours, outside collisions.
 	// Update the positions for the rest of this frame's time.
 	const float timeRemaining = dt_sec - accumulatedTime;
 	if (timeRemaining > 0.0f)
 	{
-		for (auto& bodie : bodies)
+		PROFILE_ZONE("Integrate");
+		UpdateBodies(timeRemaining);
+	}
+}
+
+/*
+====================================================
+Scene::UpdateSpeculative
+====================================================
+*/
+void Scene::UpdateSpeculative(const std::vector<CollisionPair>& collisionPairs, const float dt_sec)
+{
+	const int numIterations = 10;
+	
+	// Extra gap kept as a contact, so resting bodies do not flicker in and out of contact
+	const float margin = 0.01f;
+	
+	// Closest points of every pair as they are now. A contact is kept if
+	// the gap could close within the step at the speed the bodies move at.
+	// The simplex caches live in a map, so they are looked up before the pairs go wide
+	PROFILE_ZONE_BEGIN(narrowPhase, "Narrow phase");
+	const int numPairs = (int)collisionPairs.size();
+	m_pairCaches.resize(numPairs);
+	for (int i = 0; i < numPairs; ++i)
+	{
+		m_pairCaches[i] = PairSimplexCache(collisionPairs[i]);
+	}
+	
+	// Each pair writes only its own slot, the contacts are gathered in pair order after
+	m_pairContacts.resize(numPairs);
+	m_isPairTouching.resize(numPairs);
+	const auto narrowPhasePairs = [&](int first, int last)
+	{
+		for (int i = first; i < last; ++i)
+		{
+			m_isPairTouching[i] = 0;
+			Body& bodyA = bodies[collisionPairs[i].a];
+			Body& bodyB = bodies[collisionPairs[i].b];
+			if (bodyA.inverseMass == 0.0f && bodyB.inverseMass == 0.0f) continue;
+			
+			Contact& contact = m_pairContacts[i];
+			Intersections::IntersectStatic(bodyA, bodyB, contact, m_pairCaches[i]);
+			
+			const Vec3 relativeVelocity = bodyA.linearVelocity - bodyB.linearVelocity;
+			const float reach = relativeVelocity.GetMagnitude() * dt_sec + margin;
+			m_isPairTouching[i] = contact.separationDistance < reach ? 1 : 0;
+		}
+	};
+	// By reference, it captures too much to fit in a std::function without allocating
+	ParallelFor(numPairs, std::cref(narrowPhasePairs));
+	
+	// At most a contact per pair. Room for as many as the pairs have room for
+	// means the contacts only grow when the pairs do, not each time one more touches.
+	m_contacts.clear();
+	m_contacts.reserve(collisionPairs.capacity());
+	m_contactSolver.Reserve((int)collisionPairs.capacity());
+	for (int i = 0; i < numPairs; ++i)
+	{
+		if (m_isPairTouching[i])
+		{
+			m_contacts.push_back(m_pairContacts[i]);
+		}
+	}
+	PROFILE_ZONE_END(narrowPhase);
+	
+	// Contacts and joints are solved in the same iterations
+	PROFILE_ZONE_BEGIN(solve, "Solve contacts");
+	m_contactSolver.Prepare(m_contacts.data(), (int)m_contacts.size(), dt_sec);
+	if (m_isJointPass)
+	{
+		m_jointSolver.Prepare(m_joints, bodies.data(), dt_sec);
+	}
+	for (int iteration = 0; iteration < numIterations; ++iteration)
+	{
+		m_contactSolver.Iterate();
+		if (m_isJointPass)
 		{
-			bodie.Update(timeRemaining);
+			m_jointSolver.Iterate();
 		}
 	}
+	m_contactSolver.ApplyRestitution();
+	PROFILE_ZONE_END(solve);
+	
+	// Everything moves once, for the whole step
+	PROFILE_ZONE("Integrate");
+	UpdateBodies(dt_sec);
+}
+
+/*
+====================================================
+Scene::UpdateXPBD
+====================================================
+*/
+void Scene::UpdateXPBD(const std::vector<CollisionPair>& collisionPairs, const float dt_sec)
+{
+	// The pairs found for the whole frame are tested again on every substep,
+	// each keeps its simplex cache across them
+	m_pairCaches.resize(collisionPairs.size());
+	for (int i = 0; i < (int)collisionPairs.size(); ++i)
+	{
+		m_pairCaches[i] = PairSimplexCache(collisionPairs[i]);
+	}
+	
+	PROFILE_ZONE("XPBD substeps");
+	static const std::vector<Joint> noJoints;
+	m_xpbdSolver.Step(bodies.data(), (int)bodies.size(), collisionPairs, m_pairCaches.data(), m_isJointPass ? m_joints : noJoints, m_jointSolver, dt_sec, m_numXPBDSubsteps, Vec3(0, 0, -10), m_activeBodies);
+}
+
+/*
+====================================================
+Scene::ParallelFor
+Over the job system when there is one, else in one go on this thread
+====================================================
+*/
+void Scene::ParallelFor(const int count, const std::function<void(int, int)>& function)
+{
+	// Deterministic runs cut the work at fixed sizes rather than by thread count
+	if (NULL != m_jobs)
+	{
+		const int grainSize = m_isDeterministic ? 64 : 0;
+		m_jobs->ParallelFor(0, count, function, grainSize);
+	}
+	else
+	{
+		function(0, count);
+	}
+}
+
+/*
+====================================================
+Scene::UpdateBodies
+====================================================
+*/
+void Scene::UpdateBodies(const float dt_sec)
+{
+	// Zoned by the callers, the time of impact loop calls this once per impact
+	ParallelFor((int)bodies.size(), [&](int first, int last)
+	{
+		for (int i = first; i < last; ++i)
+		{
+			// Static bodies never move, and inverting their inertia for nothing adds up in the time of impact loop
+			if (bodies[i].inverseMass == 0.0f || !IsActive(i)) continue;
+			bodies[i].Update(dt_sec);
+		}
+	});
+}
+
+/*
+====================================================
+Scene::RecordTrace
+====================================================
+*/
+void Scene::RecordTrace()
+{
+	PROFILE_ZONE("Record trace");
+	m_traceContacts.clear();
+	if (m_solverMode == SolverMode::XPBD)
+	{
+		const int numContacts = m_xpbdSolver.NumContacts();
+		m_traceContacts.resize(numContacts);
+		for (int i = 0; i < numContacts; ++i)
+		{
+			TraceContact& event = m_traceContacts[i];
+			m_xpbdSolver.GetContact(i, event.a, event.b, event.point, event.normal);
+		}
+	}
+	else
+	{
+		for (const Contact& contact : m_contacts)
+		{
+			TraceContact event;
+			event.a = (int)(contact.a - bodies.data());
+			event.b = (int)(contact.b - bodies.data());
+			event.point = contact.ptOnAWorldSpace;
+			event.normal = contact.normal;
+			m_traceContacts.push_back(event);
+		}
+	}
+
+	m_trace->Record(m_frame, bodies.data(), (int)bodies.size(), m_traceContacts.data(), (int)m_traceContacts.size());
+}
+
+/*
+====================================================
+Scene::GetStepHash
+FNV-1a over the bits of every body's state
+====================================================
+*/
+unsigned long long Scene::GetStepHash() const
+{
+	unsigned long long hash = 14695981039346656037ull;
+	const auto mix = [&hash](const float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		for (int i = 0; i < 4; ++i)
+		{
+			hash ^= (bits >> (i * 8)) & 0xff;
+			hash *= 1099511628211ull;
+		}
+	};
+	
+	for (const Body& body : bodies)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			mix(body.position[i]);
+			mix(body.linearVelocity[i]);
+			mix(body.angularVelocity[i]);
+		}
+		mix(body.orientation.x);
+		mix(body.orientation.y);
+		mix(body.orientation.z);
+		mix(body.orientation.w);
+	}
+	return hash;
+}
+
+/*
+====================================================
+Scene::SetNumSnapshots
+====================================================
+*/
+void Scene::SetNumSnapshots(const int num)
+{
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	m_snapshots.resize(num > 0 ? num : 1);
+	for (SceneSnapshot& snapshot : m_snapshots)
+	{
+		snapshot.handle = -1;
+	}
+}
+
+/*
+====================================================
+Scene::Snapshot
+====================================================
+*/
+int Scene::Snapshot()
+{
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	if (m_snapshots.empty())
+	{
+		SetNumSnapshots(8);
+	}
+	
+	const int handle = m_nextSnapshot++;
+	SceneSnapshot& snapshot = m_snapshots[handle % m_snapshots.size()];
+	snapshot.handle = handle;
+	snapshot.frame = m_frame;
+	snapshot.accumulator = m_accumulator;
+	snapshot.lastNumSubsteps = m_lastNumSubsteps;
+	snapshot.lastNumContacts = m_lastNumContacts;
+	
+	const int numBodies = (int)bodies.size();
+	snapshot.bodies.resize(numBodies);
+	BodyState* state = snapshot.bodies.data();
+	for (int i = 0; i < numBodies; ++i)
+	{
+		const Body& body = bodies[i];
+		state[i].position = body.position;
+		state[i].orientation = body.orientation;
+		state[i].linearVelocity = body.linearVelocity;
+		state[i].angularVelocity = body.angularVelocity;
+	}
+	snapshot.prevPoses = m_prevPoses;
+	
+	// An empty cache is the same as none, so only the ones GJK filled in are kept
+	snapshot.simplexCaches.clear();
+	for (const auto& entry : m_simplexCache)
+	{
+		if (entry.second.num > 0)
+		{
+			snapshot.simplexCaches.push_back(entry);
+		}
+	}
+	snapshot.numJoints = (int)m_joints.size();
+	snapshot.jointImpulses = m_jointSolver.GetImpulses();
+	return handle;
+}
+
+/*
+====================================================
+Scene::Restore
+====================================================
+*/
+bool Scene::Restore(const int handle)
+{
+	ScopedMemoryTag tag(MemoryTag::PHYSICS);
+	if (handle < 0 || m_snapshots.empty()) return false;
+	
+	const SceneSnapshot& snapshot = m_snapshots[handle % m_snapshots.size()];
+	if (snapshot.handle != handle || snapshot.bodies.size() != bodies.size()) return false;
+	
+	m_frame = snapshot.frame;
+	m_accumulator = snapshot.accumulator;
+	m_lastNumSubsteps = snapshot.lastNumSubsteps;
+	m_lastNumContacts = snapshot.lastNumContacts;
+	m_lodFrame = 0;	// Levels and anchors are taken again from the restored poses
+	
+	const int numBodies = (int)bodies.size();
+	const BodyState* state = snapshot.bodies.data();
+	for (int i = 0; i < numBodies; ++i)
+	{
+		Body& body = bodies[i];
+		body.position = state[i].position;
+		body.orientation = state[i].orientation;
+		body.linearVelocity = state[i].linearVelocity;
+		body.angularVelocity = state[i].angularVelocity;
+	}
+	m_prevPoses = snapshot.prevPoses;
+	
+	// Warm starts as they were, so stepping again retraces the same path
+	m_simplexCache.clear();
+	m_simplexCache.insert(snapshot.simplexCaches.begin(), snapshot.simplexCaches.end());
+	if (snapshot.numJoints == (int)m_joints.size())
+	{
+		m_jointSolver.SetImpulses(snapshot.jointImpulses);
+	}
+	
+	m_isQueryDirty = true;
+	return true;
+}
+
+/*
+====================================================
+Scene::AddJoint
+====================================================
+*/
+int Scene::AddJoint(const Joint::JointType type, const int bodyA, const int bodyB, const Vec3& anchorA, const Vec3& anchorB, const Vec3& axis)
+{
+	Body& a = bodies[bodyA];
+	Body& b = bodies[bodyB];
+	
+	Joint joint;
+	joint.type = type;
+	joint.bodyA = bodyA;
+	joint.bodyB = bodyB;
+	joint.anchorA = a.WorldSpaceToBodySpace(anchorA);
+	joint.anchorB = b.WorldSpaceToBodySpace(anchorB);
+	joint.axisA = a.orientation.Inverse().RotatePoint(axis);
+	joint.axisB = b.orientation.Inverse().RotatePoint(axis);
+	joint.axisA.Normalize();
+	joint.axisB.Normalize();
+	joint.relativeOrientation = a.orientation.Inverse() * b.orientation;
+	joint.distance = (anchorA - anchorB).GetMagnitude();
+	m_joints.push_back(joint);
+	
+	m_jointPairs.insert(JointPairKey(bodyA, bodyB));
+	m_jointSolver.MarkDirty();
+	return (int)m_joints.size() - 1;
+}
+
+int Scene::AddDistanceJoint(const int bodyA, const int bodyB, const Vec3& anchorA, const Vec3& anchorB)
+{
+	return AddJoint(Joint::JointType::DISTANCE, bodyA, bodyB, anchorA, anchorB, Vec3(0, 0, 1));
+}
+
+int Scene::AddBallSocketJoint(const int bodyA, const int bodyB, const Vec3& anchor)
+{
+	return AddJoint(Joint::JointType::BALL_SOCKET, bodyA, bodyB, anchor, anchor, Vec3(0, 0, 1));
+}
+
+int Scene::AddHingeJoint(const int bodyA, const int bodyB, const Vec3& anchor, const Vec3& axis)
+{
+	return AddJoint(Joint::JointType::HINGE, bodyA, bodyB, anchor, anchor, axis);
+}
+
+int Scene::AddFixedJoint(const int bodyA, const int bodyB, const Vec3& anchor)
+{
+	return AddJoint(Joint::JointType::FIXED, bodyA, bodyB, anchor, anchor, Vec3(0, 0, 1));
+}
+
+/*
+====================================================
+Scene::ClearJoints
+====================================================
+*/
+void Scene::ClearJoints()
+{
+	m_joints.clear();
+	m_jointPairs.clear();
+	m_jointSolver.MarkDirty();
+}
+
+/*
+====================================================
+Scene::SimplexCache
+====================================================
+*/
+GJKSimplexCache& Scene::SimplexCache(const CollisionPair& pair)
+{
+	const unsigned long long key = ((unsigned long long)pair.a << 32) | (unsigned int)pair.b;
+	GJKSimplexCache& cache = m_simplexCache[key];
+	cache.lastFrame = m_frame;
+	return cache;
+}
+
+/*
+====================================================
+Scene::PairSimplexCache
+Only pairs that go through GJK get a cache: two spheres never do, and two
+static bodies are never tested
+====================================================
+*/
+GJKSimplexCache* Scene::PairSimplexCache(const CollisionPair& pair)
+{
+	const Body& a = bodies[pair.a];
+	const Body& b = bodies[pair.b];
+	if (a.inverseMass == 0.0f && b.inverseMass == 0.0f) return NULL;
+	if (a.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE && b.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE) return NULL;
+	return &SimplexCache(pair);
+}
+
+/*
+====================================================
+Scene::PruneSimplexCache
+Drops the pairs that were not tested this frame
+====================================================
+*/
+void Scene::PruneSimplexCache(const int numFrames)
+{
+	for (auto it = m_simplexCache.begin(); it != m_simplexCache.end();)
+	{
+		it = (m_frame - it->second.lastFrame >= numFrames) ? m_simplexCache.erase(it) : std::next(it);
+	}
+}
+
+/*
+====================================================
+Scene::GetQuery
+====================================================
+*/
+const SceneQuery& Scene::GetQuery()
+{
+	if (m_isQueryDirty)
+	{
+		m_query.Build(bodies.data(), (int)bodies.size());
+		m_isQueryDirty = false;
+	}
+	return m_query;
 }
@@ -3,9 +3,20 @@
 //
 #pragma once
 
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "../Body.h"
+#include "Broadphase.h"
+#include "ContactSolver.h"
+#include "Intersections.h"
+#include "JobSystem.h"
+#include "JointSolver.h"
+#include "SceneFile.h"
+#include "SceneQuery.h"
+#include "SimulationTrace.h"
+#include "XPBDSolver.h"
 
 /*
 ====================================================
@@ -14,13 +25,246 @@ Scene
 */
 class Scene {
 public:
-	Scene() { bodies.reserve( 128 ); }
+	enum class SolverMode
+	{
+		TIME_OF_IMPACT,	// Sweep every pair, then step to each impact in order and resolve it
+		SPECULATIVE,	// Contacts for pairs that can close their gap this step, solved together
+		XPBD,			// Substeps that push contacts apart by position, then derive the velocities
+	};
+
+	struct BodyPose
+	{
+		Vec3 position;
+		Quat orientation;
+
+		// Lerp of the position, normalized lerp of the orientation along the shorter arc
+		static BodyPose Blend( const BodyPose & from, const BodyPose & to, const float alpha );
+	};
+
+	Scene() : m_ownsShapes( true ), m_sharedSceneFile( NULL ), m_jobs( NULL ), m_trace( NULL ), m_isDeterministic( false ), m_seed( 0 ), m_isQueryDirty( true ), m_frame( 0 ), m_solverMode( SolverMode::TIME_OF_IMPACT ), m_numSubsteps( 20 ),
+		m_stepRate( 120.0f ), m_maxStepsPerFrame( 5 ), m_accumulator( 0.0f ),
+		m_isLodEnabled( false ), m_lodRadius( 50.0f ), m_lodFrame( 0 ), m_activeBodies( NULL ), m_isJointPass( true ),
+		m_isAdaptive( false ), m_maxAdaptiveSubsteps( 8 ), m_lastNumSubsteps( 1 ), m_lastNumContacts( 0 ), m_numXPBDSubsteps( 20 ), m_nextSnapshot( 0 ) { bodies.reserve( 128 ); }
 	~Scene();
 
+	// Reset rebuilds the scene from the loaded scene file, or with Initialize when there is none
 	void Reset();
 	void Initialize();
+
+	// Text or binary scene file, see SceneFile. Resets the scene from it; on
+	// failure the scene is left as it was and the reason printed.
+	bool LoadScene( const char * fileName );
+	const SceneFile & GetSceneFile() const { return NULL != m_sharedSceneFile ? *m_sharedSceneFile : m_sceneFile; }
 	void Update( const float dt_sec );	
 
+	// Becomes a copy of base that uses base's shapes instead of owning its
+	// own: bodies, joints and settings are copied, the shapes are not, and
+	// Reset builds from base's scene file. Cheap enough to make many
+	// throwaway variants of a scene. base has to outlive this scene.
+	void ShareFrom( const Scene & base );
+
+	// Narrow phase and integration are spread over the job system when one is set
+	void SetJobSystem( JobSystem * jobs ) { m_jobs = jobs; }
+
+	// Every step's body poses and contacts go to the recorder when one is set
+	void SetTraceRecorder( TraceRecorder * recorder ) { m_trace = recorder; }
+
+	// Same trajectory on any machine and thread count: Initialize draws from
+	// the seed instead of the hardware, parallel work is cut into the same
+	// pieces whatever the thread count, and the pairs are sorted by body id
+	// before solving. Takes effect from the next Reset.
+	void SetDeterministic( const bool isDeterministic, const unsigned int seed = 0 ) { m_isDeterministic = isDeterministic; m_seed = seed; }
+	bool IsDeterministic() const { return m_isDeterministic; }
+
+	// Hash of every body's pose and velocity, to compare two runs step by step
+	unsigned long long GetStepHash() const;
+
+	// Copies of the moving state (body poses and velocities, warm start
+	// caches, the fixed step clock) kept in a ring, for rollback, previews
+	// and undo. Restore puts the bodies back as they were; the bodies, their
+	// shapes and the joints must still be the ones there were at the
+	// snapshot. A handle goes stale once the ring has come round to its slot,
+	// Restore then returns false and leaves the scene alone.
+	void SetNumSnapshots( const int num );
+	int Snapshot();
+	bool Restore( const int handle );
+
+	// Fixed timestep. Advance adds the frame's time to the accumulator and
+	// runs as many steps of 1 / stepRate as fit, at most maxStepsPerFrame;
+	// time beyond that is dropped so a slow frame cannot snowball. Returns
+	// the number of steps run.
+	int Advance( const float frame_sec );
+	void SetStepRate( const float hz ) { m_stepRate = hz > 0.0f ? hz : 1.0f; }
+	float GetStepRate() const { return m_stepRate; }
+	void SetMaxStepsPerFrame( const int num ) { m_maxStepsPerFrame = num > 0 ? num : 1; }
+	int GetMaxStepsPerFrame() const { return m_maxStepsPerFrame; }
+
+	// How far the accumulator is into the next step, in [0, 1). Rendering
+	// blends each body from its pose before the last step to its current one.
+	float GetInterpolationAlpha() const { return m_accumulator * m_stepRate; }
+	Vec3 GetInterpolatedPosition( const int bodyId ) const;
+	Quat GetInterpolatedOrientation( const int bodyId ) const;
+	const std::vector< BodyPose > & GetPreviousPoses() const { return m_prevPoses; }
+
+	// Multi-rate level of detail. Bodies within fullRateRadius of the focus
+	// step every step; each doubling of the distance beyond halves their
+	// rate, down to one step in 2^MAX_LOD_LEVEL. Bodies that could touch in
+	// the next steps step together at the finest rate among them, so every
+	// contact is solved between bodies on the same clock. Levels are taken
+	// again every 2^MAX_LOD_LEVEL steps; the focus can move any time.
+	static const int MAX_LOD_LEVEL = 3;
+	void SetLevelOfDetail( const bool isEnabled, const Vec3 & focus, const float fullRateRadius );
+	void SetLodFocus( const Vec3 & focus ) { m_lodFocus = focus; }
+	bool IsLevelOfDetailEnabled() const { return m_isLodEnabled; }
+	int GetLodLevel( const int bodyId ) const;
+
+	void SetSolverMode( const SolverMode mode ) { m_solverMode = mode; }
+	SolverMode GetSolverMode() const { return m_solverMode; }
+
+	// Substeps per frame in XPBD mode, the broadphase still runs once per frame
+	void SetNumSubsteps( const int num ) { m_numSubsteps = num > 0 ? num : 1; }
+	int GetNumSubsteps() const { return m_numSubsteps; }
+
+	// Adaptive substeps: each step is cut into as many substeps as keep the
+	// fastest body from moving more than half the smallest body's radius in
+	// one, and one more for every two contacts per moving body in the last
+	// step, at most maxSubsteps. In XPBD mode the solver's own substeps are
+	// scaled instead, up to the number set above. The count rises at once but
+	// falls by one a step, so it does not flicker between steps.
+	void SetAdaptiveSubsteps( const bool isEnabled, const int maxSubsteps = 8 );
+	bool IsAdaptiveSubsteps() const { return m_isAdaptive; }
+	int GetLastNumSubsteps() const { return m_lastNumSubsteps; }
+
+	// Joints between two bodies by index, anchors and axes given in world space
+	// at the bodies' current poses. Returns the joint id. Jointed bodies do not
+	// collide with each other. Long chains need XPBD: the single step modes
+	// solve joints as soft springs over the whole step, and their top links
+	// stretch under the weight below.
+	int AddDistanceJoint( const int bodyA, const int bodyB, const Vec3 & anchorA, const Vec3 & anchorB );
+	int AddBallSocketJoint( const int bodyA, const int bodyB, const Vec3 & anchor );
+	int AddHingeJoint( const int bodyA, const int bodyB, const Vec3 & anchor, const Vec3 & axis );
+	int AddFixedJoint( const int bodyA, const int bodyB, const Vec3 & anchor );
+	void ClearJoints();
+	const std::vector< Joint > & GetJoints() const { return m_joints; }
+
+	// Ray casts and overlap tests against the current body positions.
+	// Rebuilt on first use after the bodies moved.
+	const SceneQuery & GetQuery();
+
 	std::vector<Body> bodies;
+
+private:
+	void UpdateTimeOfImpact( const std::vector< CollisionPair > & collisionPairs, const float dt_sec );
+	void UpdateSpeculative( const std::vector< CollisionPair > & collisionPairs, const float dt_sec );
+	void UpdateXPBD( const std::vector< CollisionPair > & collisionPairs, const float dt_sec );
+	void Step( const float dt_sec );
+	void StepAdaptive( const float dt_sec );
+	int ChooseNumSubsteps( const float dt_sec ) const;
+	void AssignLevelsOfDetail( const float dt_sec );
+	void UpdateLevelsOfDetail( const float dt_sec );
+	bool IsActive( const int bodyId ) const { return NULL == m_activeBodies || m_activeBodies[ bodyId ]; }
+
+	void DeleteShapes();
+	void ParallelFor( const int count, const std::function< void( int, int ) > & function );
+	void UpdateBodies( const float dt_sec );
+	void RecordTrace();
+
+	int AddJoint( const Joint::JointType type, const int bodyA, const int bodyB, const Vec3 & anchorA, const Vec3 & anchorB, const Vec3 & axis );
+
+	GJKSimplexCache & SimplexCache( const CollisionPair & pair );
+	GJKSimplexCache * PairSimplexCache( const CollisionPair & pair );
+	void PruneSimplexCache( const int numFrames );	// Drops the pairs not used in the last numFrames frames
+
+	bool m_ownsShapes;
+	SceneFile m_sceneFile;
+	const SceneFile * m_sharedSceneFile;	// The base's, for a scene made by ShareFrom
+	JobSystem * m_jobs;
+	TraceRecorder * m_trace;
+	std::vector< TraceContact > m_traceContacts;
+	bool m_isDeterministic;
+	unsigned int m_seed;
+
+	SceneQuery m_query;
+	bool m_isQueryDirty;
+
+	// Broadphase pairs of the step, kept between steps so they never reallocate
+	std::vector<CollisionPair> m_collisionPairs;
+
+	// Narrow phase scratch, kept between frames so the batch never reallocates
+	std::vector<CollisionPair> m_spherePairIds;
+	SpherePairBatch m_spherePairs;
+	SpherePairResults m_sphereResults;
+
+	// Last GJK simplex of each convex pair, keyed by the pair's body ids,
+	// to warm start the next frame. Pairs that stop overlapping are dropped.
+	std::unordered_map< unsigned long long, GJKSimplexCache > m_simplexCache;
+	int m_frame;
+
+	SolverMode m_solverMode;
+	ContactSolver m_contactSolver;
+	std::vector< Contact > m_contacts;
+	std::vector< Contact > m_pairContacts;	// One slot per broadphase pair, filled in parallel
+	std::vector< char > m_isPairTouching;
+
+	std::vector< Joint > m_joints;
+	std::unordered_set< unsigned long long > m_jointPairs;
+	JointSolver m_jointSolver;
+
+	int m_numSubsteps;
+	XPBDSolver m_xpbdSolver;
+	std::vector< GJKSimplexCache * > m_pairCaches;
+
+	float m_stepRate;
+	int m_maxStepsPerFrame;
+	float m_accumulator;
+	std::vector< BodyPose > m_prevPoses;	// Body poses before the last fixed step
+
+	bool m_isLodEnabled;
+	Vec3 m_lodFocus;
+	float m_lodRadius;
+	int m_lodFrame;							// Steps into the current window
+	std::vector< char > m_lodLevels;
+	std::vector< BodyPose > m_lodAnchors;	// Where each body's last real step left it
+	std::vector< char > m_lodMask;
+	std::vector< Body > m_lodScratchBodies;
+	std::vector< int > m_lodScratchIds;
+	std::vector< int > m_lodIslands;		// Scratch of AssignLevelsOfDetail, kept for its capacity
+	std::vector< Bounds > m_lodSwept;
+	std::vector< CollisionPair > m_lodPairs;
+	const char * m_activeBodies;			// Bodies stepping in this pass, NULL for all of them
+	bool m_isJointPass;
+
+	bool m_isAdaptive;
+	int m_maxAdaptiveSubsteps;
+	int m_lastNumSubsteps;
+	int m_lastNumContacts;	// Of the last Step, for the contact load
+	int m_numXPBDSubsteps;	// This step's, m_numSubsteps unless adaptive
+
+	struct BodyState
+	{
+		Vec3 position;
+		Quat orientation;
+		Vec3 linearVelocity;
+		Vec3 angularVelocity;
+	};
+
+	// Every vector keeps its capacity when the slot is reused, so taking
+	// snapshots allocates nothing once the ring has gone round
+	struct SceneSnapshot
+	{
+		int handle;
+		int frame;
+		float accumulator;
+		int lastNumSubsteps;
+		int lastNumContacts;
+		std::vector< BodyState > bodies;
+		std::vector< BodyPose > prevPoses;
+		std::vector< std::pair< unsigned long long, GJKSimplexCache > > simplexCaches;
+		int numJoints;
+		std::vector< float > jointImpulses;
+	};
+
+	std::vector< SceneSnapshot > m_snapshots;
+	int m_nextSnapshot;
 };
 
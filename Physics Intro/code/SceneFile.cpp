@@ -0,0 +1,567 @@
+//
+//  SceneFile.cpp
+//
+#include "SceneFile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+
+#include "ConvexHull.h"
+#include "Fileio.h"
+#include "Scene.h"
+#include "../Shape.h"
+
+static const char SCENE_MAGIC[4] = { 'P', 'S', 'C', 'N' };
+static const unsigned int SCENE_VERSION = 1;
+
+struct SceneFileHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int numShapes;
+	unsigned int numBodies;
+};
+
+static_assert(sizeof(SceneBody) == 17 * sizeof(float), "SceneBody is written to binary files as it is");
+
+/*
+====================================================
+DefaultBody
+What a text body line leaves out
+====================================================
+*/
+static SceneBody DefaultBody()
+{
+	SceneBody body;
+	body.shape = 0;
+	body.position.Zero();
+	body.orientation = Quat(0, 0, 0, 1);
+	body.linearVelocity.Zero();
+	body.angularVelocity.Zero();
+	body.inverseMass = 1.0f;
+	body.elasticity = 0.5f;
+	body.friction = 0.5f;
+	return body;
+}
+
+/*
+====================================================
+LineReader
+Splits one line of the text form into tokens, up to a # comment
+====================================================
+*/
+struct LineReader
+{
+	const char* at;
+	const char* end;
+
+	bool NextToken(const char*& token, int& length)
+	{
+		while (at < end && (' ' == *at || '\t' == *at || '\r' == *at)) ++at;
+		if (at >= end || '#' == *at) return false;
+
+		token = at;
+		while (at < end && ' ' != *at && '\t' != *at && '\r' != *at && '#' != *at) ++at;
+		length = (int)(at - token);
+		return true;
+	}
+
+	// Leaves a token that is not a number for the next read
+	bool NextFloat(float& value)
+	{
+		const char* start = at;
+		const char* token;
+		int length;
+		if (NextToken(token, length) && length < 64)
+		{
+			// The text is not null terminated, strtof gets a copy of the token
+			char number[64];
+			memcpy(number, token, length);
+			number[length] = '\0';
+			char* parsedEnd;
+			value = strtof(number, &parsedEnd);
+			if (parsedEnd == number + length) return true;
+		}
+		at = start;
+		return false;
+	}
+
+	bool NextVec3(Vec3& value)
+	{
+		return NextFloat(value.x) && NextFloat(value.y) && NextFloat(value.z);
+	}
+};
+
+/*
+====================================================
+IsToken
+====================================================
+*/
+static bool IsToken(const char* token, const int length, const char* word)
+{
+	return length == (int)strlen(word) && 0 == strncmp(token, word, length);
+}
+
+/*
+====================================================
+SceneFile::Fail
+====================================================
+*/
+bool SceneFile::Fail(const int line, const char* message)
+{
+	char text[128];
+	if (line > 0)
+	{
+		snprintf(text, sizeof(text), "line %i: %s", line, message);
+		m_error = text;
+	}
+	else
+	{
+		m_error = message;
+	}
+	Clear();
+	return false;
+}
+
+/*
+====================================================
+SceneFile::Load
+====================================================
+*/
+bool SceneFile::Load(const char* fileName)
+{
+	// Both forms parse straight out of the mapped file
+	FileView file;
+	if (!file.Open(fileName))
+	{
+		m_error = std::string("cannot open ") + fileName;
+		return false;
+	}
+
+	if (file.Size() >= sizeof(SCENE_MAGIC) && 0 == memcmp(file.Data(), SCENE_MAGIC, sizeof(SCENE_MAGIC)))
+	{
+		return LoadBinary(file.Data(), file.Size());
+	}
+	return LoadText((const char*)file.Data(), file.Size());
+}
+
+/*
+====================================================
+SceneFile::LoadText
+====================================================
+*/
+bool SceneFile::LoadText(const char* text, const size_t length)
+{
+	Clear();
+	m_error.clear();
+
+	std::unordered_map<std::string, int> shapeIds;
+	const char* const textEnd = text + length;
+	int lineNumber = 0;
+	for (const char* lineStart = text; lineStart < textEnd; )
+	{
+		++lineNumber;
+		const char* lineEnd = (const char*)memchr(lineStart, '\n', textEnd - lineStart);
+		if (NULL == lineEnd) lineEnd = textEnd;
+
+		LineReader line;
+		line.at = lineStart;
+		line.end = lineEnd;
+		lineStart = lineEnd + 1;
+
+		const char* token;
+		int tokenLength;
+		if (!line.NextToken(token, tokenLength)) continue;
+
+		if (IsToken(token, tokenLength, "shape"))
+		{
+			const char* name;
+			int nameLength;
+			const char* type;
+			int typeLength;
+			if (!line.NextToken(name, nameLength) || !line.NextToken(type, typeLength)) return Fail(lineNumber, "shape needs a name and a type");
+			if (!shapeIds.emplace(std::string(name, nameLength), (int)shapes.size()).second) return Fail(lineNumber, "shape name used twice");
+
+			SceneShape shape;
+			shape.radius = 0.0f;
+			std::vector<float> numbers;
+			float number;
+			while (line.NextFloat(number))
+			{
+				numbers.push_back(number);
+			}
+			if (line.NextToken(token, tokenLength)) return Fail(lineNumber, "shape sizes have to be numbers");
+
+			if (IsToken(type, typeLength, "sphere"))
+			{
+				shape.type = SceneShape::SPHERE;
+				if (1 != numbers.size() || numbers[0] <= 0.0f) return Fail(lineNumber, "sphere needs a radius");
+				shape.radius = numbers[0];
+			}
+			else if (IsToken(type, typeLength, "box"))
+			{
+				shape.type = SceneShape::BOX;
+				if (3 == numbers.size())
+				{
+					shape.points.push_back(Vec3(-numbers[0], -numbers[1], -numbers[2]));
+					shape.points.push_back(Vec3(numbers[0], numbers[1], numbers[2]));
+				}
+				else if (6 == numbers.size())
+				{
+					shape.points.push_back(Vec3(numbers.data()));
+					shape.points.push_back(Vec3(numbers.data() + 3));
+				}
+				else
+				{
+					return Fail(lineNumber, "box needs half extents, or min and max corners");
+				}
+			}
+			else if (IsToken(type, typeLength, "convex"))
+			{
+				shape.type = SceneShape::CONVEX;
+				if (numbers.size() < 12 || 0 != numbers.size() % 3) return Fail(lineNumber, "convex needs at least four points");
+				for (int i = 0; i < (int)numbers.size(); i += 3)
+				{
+					shape.points.push_back(Vec3(numbers.data() + i));
+				}
+			}
+			else
+			{
+				return Fail(lineNumber, "unknown shape type");
+			}
+			shapes.push_back(shape);
+		}
+		else if (IsToken(token, tokenLength, "body"))
+		{
+			const char* name;
+			int nameLength;
+			if (!line.NextToken(name, nameLength)) return Fail(lineNumber, "body needs a shape");
+			const auto shapeId = shapeIds.find(std::string(name, nameLength));
+			if (shapeIds.end() == shapeId) return Fail(lineNumber, "body uses a shape not defined above it");
+
+			SceneBody body = DefaultBody();
+			body.shape = shapeId->second;
+			if (!line.NextVec3(body.position)) return Fail(lineNumber, "body needs a position");
+
+			const char* option;
+			int optionLength;
+			while (line.NextToken(option, optionLength))
+			{
+				bool isOk;
+				if (IsToken(option, optionLength, "orientation"))
+				{
+					Quat& q = body.orientation;
+					isOk = line.NextFloat(q.x) && line.NextFloat(q.y) && line.NextFloat(q.z) && line.NextFloat(q.w);
+
+					// Rounded by hand more often than not, one written out by SaveText is left exactly as it was
+					const float lengthSqr = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+					isOk = isOk && lengthSqr > 0.0f;
+					if (isOk && fabsf(lengthSqr - 1.0f) > 1e-6f) q.Normalize();
+				}
+				else if (IsToken(option, optionLength, "velocity")) isOk = line.NextVec3(body.linearVelocity);
+				else if (IsToken(option, optionLength, "spin")) isOk = line.NextVec3(body.angularVelocity);
+				else if (IsToken(option, optionLength, "inverseMass")) isOk = line.NextFloat(body.inverseMass) && body.inverseMass >= 0.0f;
+				else if (IsToken(option, optionLength, "elasticity")) isOk = line.NextFloat(body.elasticity);
+				else if (IsToken(option, optionLength, "friction")) isOk = line.NextFloat(body.friction);
+				else return Fail(lineNumber, "unknown body option");
+
+				if (!isOk) return Fail(lineNumber, "bad value for a body option");
+			}
+			bodies.push_back(body);
+		}
+		else
+		{
+			return Fail(lineNumber, "expected shape or body");
+		}
+	}
+	return true;
+}
+
+/*
+====================================================
+SceneFile::LoadBinary
+====================================================
+*/
+bool SceneFile::LoadBinary(const unsigned char* data, const size_t size)
+{
+	Clear();
+	m_error.clear();
+
+	SceneFileHeader header;
+	if (size < sizeof(header)) return Fail(0, "file too short");
+	memcpy(&header, data, sizeof(header));
+	if (0 != memcmp(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) || SCENE_VERSION != header.version) return Fail(0, "not a scene file of this version");
+
+	size_t offset = sizeof(header);
+	const auto read = [&](void* to, const size_t numBytes)
+	{
+		if (size - offset < numBytes) return false;
+		memcpy(to, data + offset, numBytes);
+		offset += numBytes;
+		return true;
+	};
+
+	// Every shape takes twelve bytes at least, which bounds the count before anything is sized by it
+	if (header.numShapes > (size - offset) / 12) return Fail(0, "file too short");
+	shapes.resize(header.numShapes);
+	for (SceneShape& shape : shapes)
+	{
+		unsigned int type;
+		unsigned int numPoints;
+		if (!read(&type, sizeof(type)) || !read(&shape.radius, sizeof(shape.radius)) || !read(&numPoints, sizeof(numPoints))) return Fail(0, "file too short");
+		if (type > SceneShape::CONVEX) return Fail(0, "unknown shape type");
+		if (numPoints > (size - offset) / sizeof(Vec3)) return Fail(0, "file too short");
+
+		// What LoadText checks, the shapes would be built degenerate otherwise
+		if (SceneShape::SPHERE == type && !(shape.radius > 0.0f)) return Fail(0, "sphere needs a radius");
+		if (SceneShape::BOX == type && 2 != numPoints) return Fail(0, "box needs min and max corners");
+		if (SceneShape::CONVEX == type && numPoints < 4) return Fail(0, "convex needs at least four points");
+
+		shape.type = (SceneShape::Type)type;
+		shape.points.resize(numPoints);
+		read(shape.points.data(), numPoints * sizeof(Vec3));
+	}
+
+	// The body records go across in one copy
+	if (header.numBodies > (size - offset) / sizeof(SceneBody)) return Fail(0, "file too short");
+	bodies.resize(header.numBodies);
+	read(bodies.data(), bodies.size() * sizeof(SceneBody));
+	for (const SceneBody& body : bodies)
+	{
+		if (body.shape < 0 || body.shape >= (int)shapes.size()) return Fail(0, "body uses a shape that is not in the file");
+	}
+	return true;
+}
+
+/*
+====================================================
+SceneFile::SaveText
+====================================================
+*/
+bool SceneFile::SaveText(const char* fileName) const
+{
+	FILE* file = fopen(fileName, "wb");
+	if (NULL == file) return false;
+
+	// Nine significant digits bring every float back exactly
+	for (int i = 0; i < (int)shapes.size(); ++i)
+	{
+		const SceneShape& shape = shapes[i];
+		if (SceneShape::SPHERE == shape.type)
+		{
+			fprintf(file, "shape s%i sphere %.9g\n", i, shape.radius);
+			continue;
+		}
+
+		fprintf(file, "shape s%i %s", i, SceneShape::BOX == shape.type ? "box" : "convex");
+		for (const Vec3& point : shape.points)
+		{
+			fprintf(file, "  %.9g %.9g %.9g", point.x, point.y, point.z);
+		}
+		fprintf(file, "\n");
+	}
+
+	const SceneBody defaults = DefaultBody();
+	for (const SceneBody& body : bodies)
+	{
+		fprintf(file, "body s%i %.9g %.9g %.9g", body.shape, body.position.x, body.position.y, body.position.z);
+		const Quat& q = body.orientation;
+		if (q.x != 0.0f || q.y != 0.0f || q.z != 0.0f || q.w != 1.0f) fprintf(file, "  orientation %.9g %.9g %.9g %.9g", q.x, q.y, q.z, q.w);
+		const Vec3& v = body.linearVelocity;
+		if (v.x != 0.0f || v.y != 0.0f || v.z != 0.0f) fprintf(file, "  velocity %.9g %.9g %.9g", v.x, v.y, v.z);
+		const Vec3& w = body.angularVelocity;
+		if (w.x != 0.0f || w.y != 0.0f || w.z != 0.0f) fprintf(file, "  spin %.9g %.9g %.9g", w.x, w.y, w.z);
+		if (body.inverseMass != defaults.inverseMass) fprintf(file, "  inverseMass %.9g", body.inverseMass);
+		if (body.elasticity != defaults.elasticity) fprintf(file, "  elasticity %.9g", body.elasticity);
+		if (body.friction != defaults.friction) fprintf(file, "  friction %.9g", body.friction);
+		fprintf(file, "\n");
+	}
+
+	const bool isOk = 0 == ferror(file);
+	fclose(file);
+	return isOk;
+}
+
+/*
+====================================================
+SceneFile::SaveBinary
+====================================================
+*/
+bool SceneFile::SaveBinary(const char* fileName) const
+{
+	FILE* file = fopen(fileName, "wb");
+	if (NULL == file) return false;
+
+	SceneFileHeader header;
+	memcpy(header.magic, SCENE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_VERSION;
+	header.numShapes = (unsigned int)shapes.size();
+	header.numBodies = (unsigned int)bodies.size();
+	fwrite(&header, sizeof(header), 1, file);
+
+	for (const SceneShape& shape : shapes)
+	{
+		const unsigned int type = shape.type;
+		const unsigned int numPoints = (unsigned int)shape.points.size();
+		fwrite(&type, sizeof(type), 1, file);
+		fwrite(&shape.radius, sizeof(shape.radius), 1, file);
+		fwrite(&numPoints, sizeof(numPoints), 1, file);
+		fwrite(shape.points.data(), sizeof(Vec3), numPoints, file);
+	}
+	fwrite(bodies.data(), sizeof(SceneBody), bodies.size(), file);
+
+	const bool isOk = 0 == ferror(file);
+	fclose(file);
+	return isOk;
+}
+
+/*
+====================================================
+SceneFile::FromScene
+====================================================
+*/
+void SceneFile::FromScene(const Scene& scene)
+{
+	Clear();
+	m_error.clear();
+
+	// Shapes are looked up by pointer first, then by their bytes, so separately allocated equal shapes merge too
+	std::unordered_map<const Shape*, int> shapeIdsByPointer;
+	std::unordered_map<std::string, int> shapeIdsByValue;
+	bodies.resize(scene.bodies.size());
+	for (int i = 0; i < (int)scene.bodies.size(); ++i)
+	{
+		const Body& from = scene.bodies[i];
+		auto shapeId = shapeIdsByPointer.find(from.shape);
+		if (shapeIdsByPointer.end() == shapeId)
+		{
+			SceneShape shape;
+			shape.radius = 0.0f;
+			switch (from.shape->GetType())
+			{
+				case Shape::ShapeType::SHAPE_SPHERE:
+					shape.type = SceneShape::SPHERE;
+					shape.radius = static_cast<const ShapeSphere*>(from.shape)->radius;
+					break;
+				case Shape::ShapeType::SHAPE_BOX:
+					shape.type = SceneShape::BOX;
+					shape.points.push_back(static_cast<const ShapeBox*>(from.shape)->m_bounds.mins);
+					shape.points.push_back(static_cast<const ShapeBox*>(from.shape)->m_bounds.maxs);
+					break;
+				default:
+					shape.type = SceneShape::CONVEX;
+					shape.points = static_cast<const ShapeConvex*>(from.shape)->m_points;
+					break;
+			}
+
+			std::string key((const char*)&shape.type, sizeof(shape.type));
+			key.append((const char*)&shape.radius, sizeof(shape.radius));
+			key.append((const char*)shape.points.data(), shape.points.size() * sizeof(Vec3));
+			const auto inserted = shapeIdsByValue.emplace(key, (int)shapes.size());
+			if (inserted.second)
+			{
+				shapes.push_back(shape);
+			}
+			shapeId = shapeIdsByPointer.emplace(from.shape, inserted.first->second).first;
+		}
+
+		SceneBody& body = bodies[i];
+		body.shape = shapeId->second;
+		body.position = from.position;
+		body.orientation = from.orientation;
+		body.linearVelocity = from.linearVelocity;
+		body.angularVelocity = from.angularVelocity;
+		body.inverseMass = from.inverseMass;
+		body.elasticity = from.elasticity;
+		body.friction = from.friction;
+	}
+}
+
+/*
+====================================================
+SceneFile::BuildHulls
+====================================================
+*/
+bool SceneFile::BuildHulls(JobSystem* jobs)
+{
+	const int numShapes = (int)shapes.size();
+	std::vector<std::vector<Vec3>> points(numShapes);
+	for (int i = 0; i < numShapes; ++i)
+	{
+		if (SceneShape::CONVEX == shapes[i].type)
+		{
+			points[i] = shapes[i].points;
+		}
+	}
+	m_hullPoints.assign(numShapes, std::vector<Vec3>());
+	m_hullTris.assign(numShapes, std::vector<tri_t>());
+	BuildConvexHulls(points.data(), numShapes, m_hullPoints.data(), m_hullTris.data(), jobs);
+
+	for (int i = 0; i < numShapes; ++i)
+	{
+		if (SceneShape::CONVEX == shapes[i].type && m_hullTris[i].empty())
+		{
+			char text[96];
+			snprintf(text, sizeof(text), "convex shape %i has no volume, its points are all in a plane", i);
+			return Fail(0, text);
+		}
+	}
+	return true;
+}
+
+/*
+====================================================
+SceneFile::CreateBodies
+====================================================
+*/
+void SceneFile::CreateBodies(Scene& scene) const
+{
+	// The scene deletes shapes through its bodies, one that no body uses would never be deleted
+	std::vector<char> isUsed(shapes.size(), 0);
+	for (const SceneBody& body : bodies)
+	{
+		isUsed[body.shape] = 1;
+	}
+
+	std::vector<Shape*> created(shapes.size(), NULL);
+	for (int i = 0; i < (int)shapes.size(); ++i)
+	{
+		if (!isUsed[i]) continue;
+
+		const SceneShape& shape = shapes[i];
+		switch (shape.type)
+		{
+			case SceneShape::SPHERE: created[i] = new ShapeSphere(shape.radius); break;
+			case SceneShape::BOX: created[i] = new ShapeBox(shape.points.data(), (int)shape.points.size()); break;
+			default:
+				if (i < (int)m_hullTris.size() && !m_hullTris[i].empty())
+				{
+					created[i] = new ShapeConvex(m_hullPoints[i].data(), (int)m_hullPoints[i].size(), m_hullTris[i].data(), (int)m_hullTris[i].size());
+				}
+				else
+				{
+					created[i] = new ShapeConvex(shape.points.data(), (int)shape.points.size());
+				}
+				break;
+		}
+	}
+
+	const size_t first = scene.bodies.size();
+	scene.bodies.resize(first + bodies.size());
+	Body* to = scene.bodies.data() + first;
+	for (const SceneBody& from : bodies)
+	{
+		to->position = from.position;
+		to->orientation = from.orientation;
+		to->linearVelocity = from.linearVelocity;
+		to->angularVelocity = from.angularVelocity;
+		to->inverseMass = from.inverseMass;
+		to->elasticity = from.elasticity;
+		to->friction = from.friction;
+		to->shape = created[from.shape];
+		++to;
+	}
+}
@@ -0,0 +1,107 @@
+//
+//  SceneFile.h
+//
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Math/Quat.h"
+#include "Math/Vector.h"
+#include "../Shape.h"
+
+class JobSystem;
+class Scene;
+
+/*
+====================================================
+SceneShape
+One shape of the file, shared by every body that names it
+====================================================
+*/
+struct SceneShape {
+	enum Type {
+		SPHERE,
+		BOX,
+		CONVEX,
+	};
+
+	Type type;
+	float radius;				// Spheres
+	std::vector< Vec3 > points;	// Box corners, min then max, or the convex hull's points
+};
+
+/*
+====================================================
+SceneBody
+A fixed size record, the binary form stores them exactly as they are here
+====================================================
+*/
+struct SceneBody {
+	int shape;	// Index into the file's shapes
+	Vec3 position;
+	Quat orientation;
+	Vec3 linearVelocity;
+	Vec3 angularVelocity;
+	float inverseMass;
+	float elasticity;
+	float friction;
+};
+
+/*
+====================================================
+SceneFile
+The bodies of a scene and the shapes they use, as data instead of code.
+
+The text form is for writing by hand, a line per shape or body:
+
+	# Comment
+	shape ball sphere 0.75
+	shape crate box 0.5 0.5 0.5              half extents, or min xyz then max xyz
+	shape rock convex x y z  x y z  x y z  x y z ...
+	body ball 0 0 10  velocity 5 5 0  inverseMass 0.75  elasticity 0.15  friction 0.5
+
+A body's options are orientation (x y z w), velocity, spin (angular
+velocity), inverseMass (0 for static), elasticity and friction, in any
+order; left out they are identity, zero, 1, 0.5 and 0.5. The binary form
+is the same data as a header, the shapes and the body records, for
+loading large scenes quickly. Load tells the two apart by the header.
+====================================================
+*/
+class SceneFile {
+public:
+	bool Load( const char * fileName );
+	bool LoadText( const char * text, const size_t length );
+	bool LoadBinary( const unsigned char * data, const size_t size );
+
+	bool SaveText( const char * fileName ) const;
+	bool SaveBinary( const char * fileName ) const;
+
+	// The bodies of the scene, its shapes interned: bodies that point at the
+	// same shape, or at equal ones, share one entry
+	void FromScene( const Scene & scene );
+
+	// Builds the hulls of the convex shapes up front, over the job system when
+	// there is one. Fails on a shape whose points have no volume, too few or
+	// all in a plane, as it would have no mass.
+	bool BuildHulls( JobSystem * jobs = nullptr );
+
+	// Adds the bodies to the scene, with one new shape per entry that every
+	// body using it shares. The scene's storage grows once for all of them.
+	void CreateBodies( Scene & scene ) const;
+
+	void Clear() { shapes.clear(); bodies.clear(); m_hullPoints.clear(); m_hullTris.clear(); }
+	const std::string & GetError() const { return m_error; }
+
+	std::vector< SceneShape > shapes;
+	std::vector< SceneBody > bodies;
+
+private:
+	bool Fail( const int line, const char * message );	// Line 0 for the binary form
+
+	std::string m_error;
+
+	// Per shape, empty until BuildHulls and for shapes that are not convex
+	std::vector< std::vector< Vec3 > > m_hullPoints;
+	std::vector< std::vector< tri_t > > m_hullTris;
+};
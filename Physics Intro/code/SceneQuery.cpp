@@ -0,0 +1,507 @@
+//
+//  SceneQuery.cpp
+//
+#include "SceneQuery.h"
+
+#include <algorithm>
+
+#include "Intersections.h"
+#include "JobSystem.h"
+#include "../Shape.h"
+
+/*
+====================================================
+RayBounds
+Slab test, returns the parametric range of the ray inside the bounds
+====================================================
+*/
+static bool RayBounds( const Vec3 & rayStart, const Vec3 & rayDir, const Bounds & bounds, float & tEnter, float & tExit )
+{
+	for ( int i = 0; i < 3; i++ )
+	{
+		if ( rayDir[ i ] == 0.0f )
+		{
+			if ( rayStart[ i ] < bounds.mins[ i ] || rayStart[ i ] > bounds.maxs[ i ] )
+			{
+				return false;
+			}
+			continue;
+		}
+
+		const float invDir = 1.0f / rayDir[ i ];
+		float t0 = ( bounds.mins[ i ] - rayStart[ i ] ) * invDir;
+		float t1 = ( bounds.maxs[ i ] - rayStart[ i ] ) * invDir;
+		if ( t0 > t1 )
+		{
+			std::swap( t0, t1 );
+		}
+		tEnter = std::max( tEnter, t0 );
+		tExit = std::min( tExit, t1 );
+		if ( tEnter > tExit )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+====================================================
+DistanceSqrToBounds
+====================================================
+*/
+static float DistanceSqrToBounds( const Vec3 & pt, const Bounds & bounds )
+{
+	float distSqr = 0.0f;
+	for ( int i = 0; i < 3; i++ )
+	{
+		const float clamped = std::min( std::max( pt[ i ], bounds.mins[ i ] ), bounds.maxs[ i ] );
+		const float d = pt[ i ] - clamped;
+		distSqr += d * d;
+	}
+	return distSqr;
+}
+
+/*
+====================================================
+ParallelChunks
+Splits [0, num) over the job system. Small batches stay on the calling
+thread, handing them out would cost more than the queries.
+====================================================
+*/
+template < typename Function >
+static void ParallelChunks( const int num, JobSystem * jobs, Function function )
+{
+	const int minQueriesPerJob = 64;
+	if ( nullptr == jobs || num < 2 * minQueriesPerJob )
+	{
+		function( 0, num );
+		return;
+	}
+	jobs->ParallelFor( 0, num, function, minQueriesPerJob );
+}
+
+/*
+========================================================================================================
+
+SceneQuery
+
+========================================================================================================
+*/
+
+/*
+====================================================
+SceneQuery::Build
+====================================================
+*/
+void SceneQuery::Build( const Body * bodies, const int num )
+{
+	m_bodies = bodies;
+	m_entries.resize( num > 0 ? num : 0 );
+	m_nodes.clear();
+	if ( num <= 0 )
+	{
+		return;
+	}
+
+	for ( int i = 0; i < num; i++ )
+	{
+		const Body & body = bodies[ i ];
+		Entry & entry = m_entries[ i ];
+		entry.id = i;
+		entry.bounds = body.shape->GetBounds( body.position, body.orientation );
+		entry.center = ( entry.bounds.mins + entry.bounds.maxs ) * 0.5f;
+	}
+
+	m_nodes.reserve( 2 * num );
+	m_nodes.push_back( Node() );
+	BuildNode( 0, 0, num );
+}
+
+/*
+====================================================
+SceneQuery::BuildNode
+Fills m_nodes[ nodeIndex ] with the entries [first, first + count).
+Both children of a node are allocated together so they sit side by side.
+====================================================
+*/
+void SceneQuery::BuildNode( const int nodeIndex, const int first, const int count )
+{
+	Bounds bounds;
+	Bounds centers;
+	for ( int i = first; i < first + count; i++ )
+	{
+		bounds.Expand( m_entries[ i ].bounds );
+		centers.Expand( m_entries[ i ].center );
+	}
+	m_nodes[ nodeIndex ].bounds = bounds;
+
+	const int maxLeafSize = 4;
+	if ( count <= maxLeafSize )
+	{
+		m_nodes[ nodeIndex ].first = first;
+		m_nodes[ nodeIndex ].count = count;
+		return;
+	}
+
+	// Median split along the widest spread of centers
+	const float widths[ 3 ] = { centers.WidthX(), centers.WidthY(), centers.WidthZ() };
+	int axis = 0;
+	if ( widths[ 1 ] > widths[ axis ] )
+	{
+		axis = 1;
+	}
+	if ( widths[ 2 ] > widths[ axis ] )
+	{
+		axis = 2;
+	}
+	const int half = count / 2;
+	std::nth_element( m_entries.begin() + first, m_entries.begin() + first + half, m_entries.begin() + first + count,
+		[ axis ]( const Entry & a, const Entry & b ) { return a.center[ axis ] < b.center[ axis ]; } );
+
+	const int childIndex = (int)m_nodes.size();
+	m_nodes[ nodeIndex ].first = childIndex;
+	m_nodes[ nodeIndex ].count = 0;
+	m_nodes.push_back( Node() );
+	m_nodes.push_back( Node() );
+
+	BuildNode( childIndex, first, half );
+	BuildNode( childIndex + 1, first + half, count - half );
+}
+
+/*
+====================================================
+SceneQuery::VisitBounds
+Calls visitor( entry ) for every body whose bounds overlap queryBounds
+====================================================
+*/
+template < typename Visitor >
+void SceneQuery::VisitBounds( const Bounds & queryBounds, Visitor & visitor ) const
+{
+	if ( m_nodes.empty() )
+	{
+		return;
+	}
+
+	int stack[ 64 ];
+	int top = 0;
+	stack[ top++ ] = 0;
+	while ( top > 0 )
+	{
+		const Node & node = m_nodes[ stack[ --top ] ];
+		if ( !node.bounds.DoesIntersect( queryBounds ) )
+		{
+			continue;
+		}
+
+		if ( node.count > 0 )
+		{
+			for ( int i = node.first; i < node.first + node.count; i++ )
+			{
+				if ( m_entries[ i ].bounds.DoesIntersect( queryBounds ) )
+				{
+					visitor( m_entries[ i ] );
+				}
+			}
+			continue;
+		}
+
+		stack[ top++ ] = node.first;
+		stack[ top++ ] = node.first + 1;
+	}
+}
+
+/*
+====================================================
+SceneQuery::VisitRay
+Calls visitor( entry ) for every body whose bounds the ray passes through.
+Children are visited front to back, and the visitor returns the furthest t
+still worth looking at, so a close hit prunes everything behind it.
+====================================================
+*/
+template < typename Visitor >
+void SceneQuery::VisitRay( const RayQuery & ray, Visitor & visitor ) const
+{
+	if ( m_nodes.empty() )
+	{
+		return;
+	}
+
+	float maxT = ray.maxT;
+	int stack[ 64 ];
+	int top = 0;
+	stack[ top++ ] = 0;
+	while ( top > 0 )
+	{
+		const Node & node = m_nodes[ stack[ --top ] ];
+		float tEnter = 0.0f;
+		float tExit = maxT;
+		if ( !RayBounds( ray.rayStart, ray.rayDir, node.bounds, tEnter, tExit ) )
+		{
+			continue;
+		}
+
+		if ( node.count > 0 )
+		{
+			for ( int i = node.first; i < node.first + node.count; i++ )
+			{
+				tEnter = 0.0f;
+				tExit = maxT;
+				if ( RayBounds( ray.rayStart, ray.rayDir, m_entries[ i ].bounds, tEnter, tExit ) )
+				{
+					maxT = visitor( m_entries[ i ], maxT );
+				}
+			}
+			continue;
+		}
+
+		// Push the far child first so the near one is popped next
+		const Node & childA = m_nodes[ node.first ];
+		const Node & childB = m_nodes[ node.first + 1 ];
+		const Vec3 centerA = ( childA.bounds.mins + childA.bounds.maxs ) * 0.5f;
+		const Vec3 centerB = ( childB.bounds.mins + childB.bounds.maxs ) * 0.5f;
+		const bool isANear = ( centerA - centerB ).Dot( ray.rayDir ) <= 0.0f;
+		stack[ top++ ] = isANear ? node.first + 1 : node.first;
+		stack[ top++ ] = isANear ? node.first : node.first + 1;
+	}
+}
+
+/*
+====================================================
+SceneQuery::RayBody
+Exact test for spheres, other shapes are tested against their bounds
+====================================================
+*/
+bool SceneQuery::RayBody( const RayQuery & ray, const Entry & entry, RayHit & hit ) const
+{
+	const Body & body = m_bodies[ entry.id ];
+
+	float t0 = 0.0f;
+	float t1 = ray.maxT;
+	Vec3 normal;
+	if ( body.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE )
+	{
+		const ShapeSphere * sphere = static_cast< const ShapeSphere * >( body.shape );
+		if ( !Intersections::RaySphere( ray.rayStart, ray.rayDir, body.position, sphere->radius, t0, t1 ) )
+		{
+			return false;
+		}
+		if ( t1 < 0.0f || t0 > ray.maxT )
+		{
+			return false;
+		}
+		t0 = std::max( t0, 0.0f );
+		normal = ray.rayStart + ray.rayDir * t0 - body.position;
+	}
+	else
+	{
+		t0 = 0.0f;
+		if ( !RayBounds( ray.rayStart, ray.rayDir, entry.bounds, t0, t1 ) )
+		{
+			return false;
+		}
+		const Vec3 center = ( entry.bounds.mins + entry.bounds.maxs ) * 0.5f;
+		normal = ray.rayStart + ray.rayDir * t0 - center;
+	}
+	normal.Normalize();
+
+	hit.bodyId = entry.id;
+	hit.t = t0;
+	hit.point = ray.rayStart + ray.rayDir * t0;
+	hit.normal = normal;
+	return true;
+}
+
+/*
+====================================================
+SceneQuery::RayCastClosest
+====================================================
+*/
+bool SceneQuery::RayCastClosest( const RayQuery & ray, RayHit & hit ) const
+{
+	hit.bodyId = -1;
+	hit.t = ray.maxT;
+
+	auto visitor = [ & ]( const Entry & entry, const float )
+	{
+		RayHit candidate;
+		if ( RayBody( ray, entry, candidate ) && candidate.t <= hit.t )
+		{
+			// Ties go to the lower body id so the result does not depend on visit order
+			if ( candidate.t < hit.t || hit.bodyId < 0 || candidate.bodyId < hit.bodyId )
+			{
+				hit = candidate;
+			}
+		}
+		return hit.t;
+	};
+	VisitRay( ray, visitor );
+	return hit.bodyId >= 0;
+}
+
+/*
+====================================================
+SceneQuery::RayCastAll
+Appends every hit, sorted front to back
+====================================================
+*/
+int SceneQuery::RayCastAll( const RayQuery & ray, std::vector< RayHit > & hits ) const
+{
+	const size_t first = hits.size();
+	auto visitor = [ & ]( const Entry & entry, const float maxT )
+	{
+		RayHit candidate;
+		if ( RayBody( ray, entry, candidate ) )
+		{
+			hits.push_back( candidate );
+		}
+		return maxT;
+	};
+	VisitRay( ray, visitor );
+
+	std::sort( hits.begin() + first, hits.end(), []( const RayHit & a, const RayHit & b )
+	{
+		return ( a.t < b.t ) || ( a.t == b.t && a.bodyId < b.bodyId );
+	} );
+	return (int)( hits.size() - first );
+}
+
+/*
+====================================================
+SceneQuery::OverlapSphere
+Appends the ids of every body touching the sphere
+====================================================
+*/
+int SceneQuery::OverlapSphere( const Vec3 & center, const float radius, std::vector< int > & bodyIds ) const
+{
+	if ( m_bodies == nullptr )
+	{
+		return 0;
+	}
+
+	Bounds queryBounds;
+	queryBounds.mins = center - Vec3( radius );
+	queryBounds.maxs = center + Vec3( radius );
+
+	int count = 0;
+	auto visitor = [ & ]( const Entry & entry )
+	{
+		const Body & body = m_bodies[ entry.id ];
+		bool overlaps;
+		if ( body.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE )
+		{
+			const float r = static_cast< const ShapeSphere * >( body.shape )->radius + radius;
+			overlaps = ( body.position - center ).GetLengthSqr() <= r * r;
+		}
+		else
+		{
+			overlaps = DistanceSqrToBounds( center, entry.bounds ) <= radius * radius;
+		}
+		if ( overlaps )
+		{
+			bodyIds.push_back( entry.id );
+			count++;
+		}
+	};
+	VisitBounds( queryBounds, visitor );
+	return count;
+}
+
+/*
+====================================================
+SceneQuery::OverlapBounds
+Appends the ids of every body touching the bounds
+====================================================
+*/
+int SceneQuery::OverlapBounds( const Bounds & bounds, std::vector< int > & bodyIds ) const
+{
+	if ( m_bodies == nullptr )
+	{
+		return 0;
+	}
+
+	int count = 0;
+	auto visitor = [ & ]( const Entry & entry )
+	{
+		const Body & body = m_bodies[ entry.id ];
+		if ( body.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE )
+		{
+			const float r = static_cast< const ShapeSphere * >( body.shape )->radius;
+			if ( DistanceSqrToBounds( body.position, bounds ) > r * r )
+			{
+				return;
+			}
+		}
+		bodyIds.push_back( entry.id );
+		count++;
+	};
+	VisitBounds( bounds, visitor );
+	return count;
+}
+
+/*
+====================================================
+SceneQuery::RayCastClosestBatch
+====================================================
+*/
+void SceneQuery::RayCastClosestBatch( const RayQuery * rays, const int num, RayHit * hits, JobSystem * jobs ) const
+{
+	ParallelChunks( num, jobs, [ = ]( const int begin, const int end )
+	{
+		for ( int i = begin; i < end; i++ )
+		{
+			RayCastClosest( rays[ i ], hits[ i ] );
+		}
+	} );
+}
+
+/*
+====================================================
+SceneQuery::RayCastAllBatch
+====================================================
+*/
+void SceneQuery::RayCastAllBatch( const RayQuery * rays, const int num, std::vector< RayHit > * hits, JobSystem * jobs ) const
+{
+	ParallelChunks( num, jobs, [ = ]( const int begin, const int end )
+	{
+		for ( int i = begin; i < end; i++ )
+		{
+			hits[ i ].clear();
+			RayCastAll( rays[ i ], hits[ i ] );
+		}
+	} );
+}
+
+/*
+====================================================
+SceneQuery::OverlapSphereBatch
+====================================================
+*/
+void SceneQuery::OverlapSphereBatch( const Vec3 * centers, const float * radii, const int num, std::vector< int > * bodyIds, JobSystem * jobs ) const
+{
+	ParallelChunks( num, jobs, [ = ]( const int begin, const int end )
+	{
+		for ( int i = begin; i < end; i++ )
+		{
+			bodyIds[ i ].clear();
+			OverlapSphere( centers[ i ], radii[ i ], bodyIds[ i ] );
+		}
+	} );
+}
+
+/*
+====================================================
+SceneQuery::OverlapBoundsBatch
+====================================================
+*/
+void SceneQuery::OverlapBoundsBatch( const Bounds * bounds, const int num, std::vector< int > * bodyIds, JobSystem * jobs ) const
+{
+	ParallelChunks( num, jobs, [ = ]( const int begin, const int end )
+	{
+		for ( int i = begin; i < end; i++ )
+		{
+			bodyIds[ i ].clear();
+			OverlapBounds( bounds[ i ], bodyIds[ i ] );
+		}
+	} );
+}
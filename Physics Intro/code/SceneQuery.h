@@ -0,0 +1,99 @@
+//
+//  SceneQuery.h
+//
+#pragma once
+
+#include <vector>
+
+#include "../Body.h"
+#include "Math/Bounds.h"
+
+class JobSystem;
+
+/*
+====================================================
+RayQuery
+The ray is rayStart + rayDir * t for t in [0, maxT].
+rayDir does not need to be normalized, hit times are in units of rayDir.
+====================================================
+*/
+struct RayQuery
+{
+	Vec3 rayStart;
+	Vec3 rayDir;
+	float maxT;
+};
+
+/*
+====================================================
+RayHit
+bodyId is -1 when nothing was hit
+====================================================
+*/
+struct RayHit
+{
+	int bodyId;
+	float t;
+	Vec3 point;
+	Vec3 normal;
+};
+
+/*
+====================================================
+SceneQuery
+Ray casts and overlap tests against the bodies of a scene.
+
+The sweep and prune axis the broadphase sorts on cannot cull anything
+perpendicular to it, which is the common case for a ray, so queries get
+their own bounding volume tree over the body bounds instead. It is flat,
+median split and rebuilt from scratch, which costs about as much as the
+broadphase sort and is only done once per frame.
+====================================================
+*/
+class SceneQuery
+{
+public:
+	SceneQuery() : m_bodies( nullptr ) {}
+
+	void Build( const Body * bodies, const int num );
+
+	bool RayCastClosest( const RayQuery & ray, RayHit & hit ) const;
+	int RayCastAll( const RayQuery & ray, std::vector< RayHit > & hits ) const;
+	int OverlapSphere( const Vec3 & center, const float radius, std::vector< int > & bodyIds ) const;
+	int OverlapBounds( const Bounds & bounds, std::vector< int > & bodyIds ) const;
+
+	// Batched versions, large batches are split over the job system when there is one.
+	// Results are written per query, in the same order as the queries.
+	void RayCastClosestBatch( const RayQuery * rays, const int num, RayHit * hits, JobSystem * jobs = nullptr ) const;
+	void RayCastAllBatch( const RayQuery * rays, const int num, std::vector< RayHit > * hits, JobSystem * jobs = nullptr ) const;
+	void OverlapSphereBatch( const Vec3 * centers, const float * radii, const int num, std::vector< int > * bodyIds, JobSystem * jobs = nullptr ) const;
+	void OverlapBoundsBatch( const Bounds * bounds, const int num, std::vector< int > * bodyIds, JobSystem * jobs = nullptr ) const;
+
+private:
+	struct Entry
+	{
+		Bounds bounds;
+		Vec3 center;
+		int id;
+	};
+
+	struct Node
+	{
+		Bounds bounds;
+		int first;	// Leaf: first entry. Interior: index of the first child, the second follows it
+		int count;	// Number of entries for a leaf, 0 for an interior node
+	};
+
+	void BuildNode( const int nodeIndex, const int first, const int count );
+
+	template < typename Visitor >
+	void VisitBounds( const Bounds & queryBounds, Visitor & visitor ) const;
+	template < typename Visitor >
+	void VisitRay( const RayQuery & ray, Visitor & visitor ) const;
+
+	bool RayBody( const RayQuery & ray, const Entry & entry, RayHit & hit ) const;
+
+	const Body * m_bodies;
+	std::vector< Entry > m_entries;
+	std::vector< Node > m_nodes;
+};
@@ -0,0 +1,70 @@
+//
+//  SceneVariants.cpp
+//
+#include "SceneVariants.h"
+
+/*
+====================================================
+SceneVariants::Build
+====================================================
+*/
+void SceneVariants::Build(const Scene& base, const int numVariants)
+{
+	while ((int)m_variants.size() < numVariants)
+	{
+		m_variants.emplace_back(new Scene);
+	}
+	m_numVariants = numVariants;
+
+	for (int i = 0; i < numVariants; ++i)
+	{
+		m_variants[i]->ShareFrom(base);
+		m_variants[i]->SetJobSystem(NULL);
+	}
+}
+
+/*
+====================================================
+SceneVariants::Run
+====================================================
+*/
+void SceneVariants::Run(const int numSteps, const float dt_sec, JobSystem* jobs)
+{
+	const auto stepVariants = [&](int first, int last)
+	{
+		for (int i = first; i < last; ++i)
+		{
+			for (int step = 0; step < numSteps; ++step)
+			{
+				m_variants[i]->Update(dt_sec);
+			}
+		}
+	};
+
+	if (NULL != jobs)
+	{
+		// One variant per job, they can take very different amounts of time
+		jobs->ParallelFor(0, m_numVariants, stepVariants, 1);
+	}
+	else
+	{
+		stepVariants(0, m_numVariants);
+	}
+}
+
+/*
+====================================================
+SceneVariants::GetOutcomes
+====================================================
+*/
+void SceneVariants::GetOutcomes(const int bodyId, std::vector<VariantOutcome>& outcomes) const
+{
+	outcomes.resize(m_numVariants);
+	for (int i = 0; i < m_numVariants; ++i)
+	{
+		const Body& body = m_variants[i]->bodies[bodyId];
+		outcomes[i].position = body.position;
+		outcomes[i].orientation = body.orientation;
+		outcomes[i].linearVelocity = body.linearVelocity;
+	}
+}
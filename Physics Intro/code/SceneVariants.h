@@ -0,0 +1,54 @@
+//
+//  SceneVariants.h
+//
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Scene.h"
+
+/*
+====================================================
+VariantOutcome
+Where one body ended up in one variant
+====================================================
+*/
+struct VariantOutcome {
+	Vec3 position;
+	Quat orientation;
+	Vec3 linearVelocity;
+};
+
+/*
+====================================================
+SceneVariants
+Many copies of one scene that differ in a few starting values, such as
+candidate throws, run side by side. The copies share the base scene's
+shapes, so building them only copies bodies. Each variant is one job
+and steps on a single thread, the variants themselves are the
+parallelism.
+====================================================
+*/
+class SceneVariants {
+public:
+	SceneVariants() : m_numVariants( 0 ) {}
+
+	// The scenes from a previous Build are reused, so building again allocates little
+	void Build( const Scene & base, const int numVariants );
+
+	int NumVariants() const { return m_numVariants; }
+	Scene & GetVariant( const int id ) { return *m_variants[ id ]; }
+	const Scene & GetVariant( const int id ) const { return *m_variants[ id ]; }
+
+	// Steps every variant numSteps times by dt_sec, over the jobs when given
+	void Run( const int numSteps, const float dt_sec, JobSystem * jobs );
+
+	// Where bodyId ended up in every variant
+	void GetOutcomes( const int bodyId, std::vector< VariantOutcome > & outcomes ) const;
+
+private:
+	std::vector< std::unique_ptr< Scene > > m_variants;
+	int m_numVariants;
+};
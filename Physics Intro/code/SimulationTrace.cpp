@@ -0,0 +1,505 @@
+//
+//  SimulationTrace.cpp
+//
+#include "SimulationTrace.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "../Body.h"
+
+static const char TRACE_MAGIC[4] = { 'P', 'T', 'R', 'C' };
+static const char TRACE_INDEX_MAGIC[4] = { 'P', 'T', 'R', 'I' };
+static const unsigned int TRACE_VERSION = 1;
+static const unsigned int POSITIONS_PER_METER = 1024;	// Just under a millimeter
+static const float ORIENTATION_SCALE = 32767.0f * 1.41421356f;	// The three smallest components are within +-1/sqrt(2)
+static const float NORMAL_SCALE = 2047.0f;	// Two bytes a component once zigzagged
+
+/*
+========================================================================================================
+
+Encoding
+
+========================================================================================================
+*/
+
+/*
+====================================================
+Quantize
+Rounds to the nearest integer, clamped well clear of overflow
+====================================================
+*/
+static int Quantize(const float value)
+{
+	const float limit = 1073741824.0f;
+	const float clamped = value < -limit ? -limit : (value > limit ? limit : value);
+	return (int)floorf(clamped + 0.5f);
+}
+
+/*
+====================================================
+QuantizePose
+====================================================
+*/
+static void QuantizePose(const Vec3& position, const Quat& orientation, int* out)
+{
+	out[0] = Quantize(position.x * POSITIONS_PER_METER);
+	out[1] = Quantize(position.y * POSITIONS_PER_METER);
+	out[2] = Quantize(position.z * POSITIONS_PER_METER);
+
+	// q and -q are the same rotation, flip so the largest component is positive and can be rebuilt from the others
+	const float components[4] = { orientation.x, orientation.y, orientation.z, orientation.w };
+	int largest = 0;
+	for (int i = 1; i < 4; ++i)
+	{
+		if (fabsf(components[i]) > fabsf(components[largest])) largest = i;
+	}
+	const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+	out[3] = largest;
+	int next = 4;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (i != largest) out[next++] = Quantize(components[i] * sign * ORIENTATION_SCALE);
+	}
+}
+
+/*
+====================================================
+DequantizePose
+====================================================
+*/
+static void DequantizePose(const int* in, TracePose& pose)
+{
+	pose.position = Vec3((float)in[0], (float)in[1], (float)in[2]) * (1.0f / POSITIONS_PER_METER);
+
+	const int largest = in[3] & 3;
+	float components[4];
+	float sumSqr = 0.0f;
+	int next = 4;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (i == largest) continue;
+		components[i] = (float)in[next++] / ORIENTATION_SCALE;
+		sumSqr += components[i] * components[i];
+	}
+	components[largest] = sqrtf(sumSqr < 1.0f ? 1.0f - sumSqr : 0.0f);
+
+	pose.orientation = Quat(components[0], components[1], components[2], components[3]);
+	pose.orientation.Normalize();
+}
+
+/*
+====================================================
+PutVarint
+Seven bits a byte, low bits first, the top bit set on all but the last
+====================================================
+*/
+static void PutVarint(std::vector<unsigned char>& bytes, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		bytes.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((unsigned char)value);
+}
+
+/*
+====================================================
+PutSigned
+Zigzag first, so small negative numbers stay small
+====================================================
+*/
+static void PutSigned(std::vector<unsigned char>& bytes, const int value)
+{
+	PutVarint(bytes, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
+
+/*
+====================================================
+ByteReader
+Reads varints up to the end of a frame, running past it only marks it failed
+====================================================
+*/
+struct ByteReader
+{
+	const unsigned char* at;
+	const unsigned char* end;
+	bool isOk;
+
+	ByteReader(const unsigned char* data, const unsigned int size) : at(data), end(data + size), isOk(true) {}
+
+	unsigned int Varint()
+	{
+		unsigned int value = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			if (at >= end) break;
+			const unsigned char byte = *at++;
+			value |= (unsigned int)(byte & 0x7f) << shift;
+			if (0 == (byte & 0x80)) return value;
+		}
+		isOk = false;
+		return 0;
+	}
+
+	int Signed()
+	{
+		const unsigned int value = Varint();
+		return (int)(value >> 1) ^ -(int)(value & 1);
+	}
+};
+
+/*
+========================================================================================================
+
+TraceRecorder
+
+========================================================================================================
+*/
+
+/*
+====================================================
+TraceRecorder::Open
+====================================================
+*/
+bool TraceRecorder::Open(const char* fileName, const int keyframeInterval)
+{
+	Close();
+
+	m_file = fopen(fileName, "wb");
+	if (NULL == m_file) return false;
+	setvbuf(m_file, NULL, _IOFBF, 1 << 20);
+
+	TraceHeader header;
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+	header.positionsPerMeter = POSITIONS_PER_METER;
+	fwrite(&header, sizeof(header), 1, m_file);
+
+	m_keyframeInterval = header.keyframeInterval;
+	m_numFrames = 0;
+	m_offset = sizeof(header);
+	m_frameOffsets.clear();
+	m_prevPoses.clear();
+
+	m_isRunning = true;
+	m_writer = std::thread(&TraceRecorder::WriterMain, this);
+	return true;
+}
+
+/*
+====================================================
+TraceRecorder::Close
+====================================================
+*/
+void TraceRecorder::Close()
+{
+	if (NULL == m_file) return;
+
+	// The writer empties the queue before it stops
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isRunning = false;
+	}
+	m_frameQueued.notify_one();
+	m_writer.join();
+
+	TraceFooter footer;
+	footer.indexOffset = m_offset;
+	footer.numFrames = m_numFrames;
+	memcpy(footer.magic, TRACE_INDEX_MAGIC, sizeof(footer.magic));
+	fwrite(m_frameOffsets.data(), sizeof(unsigned long long), m_frameOffsets.size(), m_file);
+	fwrite(&footer, sizeof(footer), 1, m_file);
+
+	fclose(m_file);
+	m_file = NULL;
+}
+
+/*
+====================================================
+TraceRecorder::Record
+====================================================
+*/
+void TraceRecorder::Record(const int step, const Body* bodies, const int numBodies, const TraceContact* contacts, const int numContacts)
+{
+	if (NULL == m_file) return;
+
+	TraceFrame* frame;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_freeFrames.empty() && m_frames.size() < MAX_PENDING_FRAMES)
+		{
+			m_frames.emplace_back(new TraceFrame);
+			m_freeFrames.push_back(m_frames.back().get());
+		}
+		m_frameFreed.wait(lock, [this]() { return !m_freeFrames.empty(); });
+		frame = m_freeFrames.back();
+		m_freeFrames.pop_back();
+	}
+
+	// The frames keep their capacity, once every one has been used recording allocates nothing
+	frame->step = step;
+	frame->poses.resize(numBodies);
+	for (int i = 0; i < numBodies; ++i)
+	{
+		frame->poses[i].position = bodies[i].position;
+		frame->poses[i].orientation = bodies[i].orientation;
+	}
+	frame->contacts.assign(contacts, contacts + numContacts);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(frame);
+	}
+	m_frameQueued.notify_one();
+}
+
+/*
+====================================================
+TraceRecorder::WriterMain
+====================================================
+*/
+void TraceRecorder::WriterMain()
+{
+	for (;;)
+	{
+		TraceFrame* frame;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_frameQueued.wait(lock, [this]() { return !m_queue.empty() || !m_isRunning; });
+			if (m_queue.empty()) return;
+
+			frame = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		WriteFrame(*frame);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_freeFrames.push_back(frame);
+		}
+		m_frameFreed.notify_one();
+	}
+}
+
+/*
+====================================================
+TraceRecorder::WriteFrame
+====================================================
+*/
+void TraceRecorder::WriteFrame(const TraceFrame& frame)
+{
+	const int numBodies = (int)frame.poses.size();
+	const bool isKeyframe = 0 == m_numFrames % m_keyframeInterval;
+
+	m_bytes.clear();
+	PutVarint(m_bytes, (unsigned int)frame.step);
+	PutVarint(m_bytes, (unsigned int)numBodies);
+
+	// Bodies added since the last frame are deltas from zero, as on a keyframe.
+	// The differences wrap rather than overflow, the reader wraps them back.
+	m_prevPoses.resize(numBodies * QUANTIZED_POSE_SIZE, 0);
+	for (int i = 0; i < numBodies; ++i)
+	{
+		int quantized[QUANTIZED_POSE_SIZE];
+		QuantizePose(frame.poses[i].position, frame.poses[i].orientation, quantized);
+
+		int* prev = &m_prevPoses[i * QUANTIZED_POSE_SIZE];
+		for (int j = 0; j < QUANTIZED_POSE_SIZE; ++j)
+		{
+			const unsigned int base = isKeyframe ? 0 : (unsigned int)prev[j];
+			PutSigned(m_bytes, (int)((unsigned int)quantized[j] - base));
+			prev[j] = quantized[j];
+		}
+	}
+
+	// Contacts come and go from frame to frame, so they are not delta encoded.
+	// The point is kept relative to body A, which makes it a small number.
+	PutVarint(m_bytes, (unsigned int)frame.contacts.size());
+	for (const TraceContact& contact : frame.contacts)
+	{
+		const int* positionA = &m_prevPoses[contact.a * QUANTIZED_POSE_SIZE];
+		PutVarint(m_bytes, (unsigned int)contact.a);
+		PutVarint(m_bytes, (unsigned int)contact.b);
+		PutSigned(m_bytes, (int)((unsigned int)Quantize(contact.point.x * POSITIONS_PER_METER) - (unsigned int)positionA[0]));
+		PutSigned(m_bytes, (int)((unsigned int)Quantize(contact.point.y * POSITIONS_PER_METER) - (unsigned int)positionA[1]));
+		PutSigned(m_bytes, (int)((unsigned int)Quantize(contact.point.z * POSITIONS_PER_METER) - (unsigned int)positionA[2]));
+		PutSigned(m_bytes, Quantize(contact.normal.x * NORMAL_SCALE));
+		PutSigned(m_bytes, Quantize(contact.normal.y * NORMAL_SCALE));
+		PutSigned(m_bytes, Quantize(contact.normal.z * NORMAL_SCALE));
+	}
+
+	const unsigned int byteCount = (unsigned int)m_bytes.size();
+	fwrite(&byteCount, sizeof(byteCount), 1, m_file);
+	fwrite(m_bytes.data(), 1, byteCount, m_file);
+
+	m_frameOffsets.push_back(m_offset);
+	m_offset += sizeof(byteCount) + byteCount;
+	++m_numFrames;
+}
+
+/*
+========================================================================================================
+
+TraceReader
+
+========================================================================================================
+*/
+
+/*
+====================================================
+TraceReader::Open
+====================================================
+*/
+bool TraceReader::Open(const char* fileName)
+{
+	Close();
+	if (!m_file.Open(fileName)) return false;
+	m_data = m_file.Data();
+	m_size = m_file.Size();
+
+	if (m_size < sizeof(TraceHeader)) { Close(); return false; }
+	memcpy(&m_header, m_data, sizeof(m_header));
+	if (0 != memcmp(m_header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) || TRACE_VERSION != m_header.version || 0 == m_header.keyframeInterval)
+	{
+		Close();
+		return false;
+	}
+
+	// The index at the end when the recorder was closed properly
+	if (m_size >= sizeof(TraceHeader) + sizeof(TraceFooter))
+	{
+		TraceFooter footer;
+		memcpy(&footer, m_data + m_size - sizeof(footer), sizeof(footer));
+		const unsigned long long indexSize = (unsigned long long)footer.numFrames * sizeof(unsigned long long);
+		if (0 == memcmp(footer.magic, TRACE_INDEX_MAGIC, sizeof(TRACE_INDEX_MAGIC)) && footer.indexOffset + indexSize + sizeof(footer) == m_size)
+		{
+			m_frameOffsets.resize(footer.numFrames);
+			memcpy(m_frameOffsets.data(), m_data + footer.indexOffset, indexSize);
+			return true;
+		}
+	}
+
+	// Otherwise walk the frames' byte counts, up to the last frame that was written whole
+	unsigned long long offset = sizeof(TraceHeader);
+	while (offset + sizeof(unsigned int) <= m_size)
+	{
+		unsigned int byteCount;
+		memcpy(&byteCount, m_data + offset, sizeof(byteCount));
+		if (offset + sizeof(byteCount) + byteCount > m_size) break;
+
+		m_frameOffsets.push_back(offset);
+		offset += sizeof(byteCount) + byteCount;
+	}
+	return true;
+}
+
+/*
+====================================================
+TraceReader::Close
+====================================================
+*/
+void TraceReader::Close()
+{
+	m_file.Close();
+	m_data = NULL;
+	m_size = 0;
+	m_frameOffsets.clear();
+	m_quantized.clear();
+	m_decodedFrame = -1;
+}
+
+/*
+====================================================
+TraceReader::ReadFrame
+====================================================
+*/
+bool TraceReader::ReadFrame(const int frame, TraceFrame& out)
+{
+	if (frame < 0 || frame >= NumFrames()) return false;
+
+	// From the keyframe before, or carry on from the frame decoded last when that is on the way
+	const int keyframeInterval = (int)m_header.keyframeInterval;
+	int first = frame - frame % keyframeInterval;
+	if (m_decodedFrame >= first && m_decodedFrame < frame)
+	{
+		first = m_decodedFrame + 1;
+	}
+
+	for (int i = first; i < frame; ++i)
+	{
+		if (!DecodeFrame(i, NULL))
+		{
+			m_decodedFrame = -1;
+			return false;
+		}
+	}
+	if (!DecodeFrame(frame, &out))
+	{
+		m_decodedFrame = -1;
+		return false;
+	}
+	return true;
+}
+
+/*
+====================================================
+TraceReader::DecodeFrame
+Applies the frame's deltas to the quantized poses, and fills out when given
+====================================================
+*/
+bool TraceReader::DecodeFrame(const int frame, TraceFrame* out)
+{
+	const unsigned long long offset = m_frameOffsets[frame];
+	unsigned int byteCount;
+	if (offset + sizeof(byteCount) > m_size) return false;
+	memcpy(&byteCount, m_data + offset, sizeof(byteCount));
+	if (offset + sizeof(byteCount) + byteCount > m_size) return false;
+
+	// Every body takes a byte per value at least, that bounds the counts before anything is sized by them
+	ByteReader reader(m_data + offset + sizeof(byteCount), byteCount);
+	const int step = (int)reader.Varint();
+	const unsigned int numBodies = reader.Varint();
+	if (!reader.isOk || numBodies > byteCount / QUANTIZED_POSE_SIZE) return false;
+
+	const bool isKeyframe = 0 == frame % m_header.keyframeInterval;
+	m_quantized.resize(numBodies * QUANTIZED_POSE_SIZE, 0);
+	for (int& value : m_quantized)
+	{
+		const unsigned int base = isKeyframe ? 0 : (unsigned int)value;
+		value = (int)(base + (unsigned int)reader.Signed());
+	}
+	if (!reader.isOk) return false;
+	m_decodedFrame = frame;
+	if (NULL == out) return true;
+
+	out->step = step;
+	out->poses.resize(numBodies);
+	for (unsigned int i = 0; i < numBodies; ++i)
+	{
+		DequantizePose(&m_quantized[i * QUANTIZED_POSE_SIZE], out->poses[i]);
+	}
+
+	const unsigned int numContacts = reader.Varint();
+	if (!reader.isOk || numContacts > byteCount / 8) return false;
+	out->contacts.resize(numContacts);
+	for (TraceContact& contact : out->contacts)
+	{
+		contact.a = (int)reader.Varint();
+		contact.b = (int)reader.Varint();
+		if ((unsigned int)contact.a >= numBodies || (unsigned int)contact.b >= numBodies) return false;
+
+		const int* positionA = &m_quantized[contact.a * QUANTIZED_POSE_SIZE];
+		contact.point.x = (float)(int)((unsigned int)positionA[0] + (unsigned int)reader.Signed()) / POSITIONS_PER_METER;
+		contact.point.y = (float)(int)((unsigned int)positionA[1] + (unsigned int)reader.Signed()) / POSITIONS_PER_METER;
+		contact.point.z = (float)(int)((unsigned int)positionA[2] + (unsigned int)reader.Signed()) / POSITIONS_PER_METER;
+		contact.normal.x = (float)reader.Signed() / NORMAL_SCALE;
+		contact.normal.y = (float)reader.Signed() / NORMAL_SCALE;
+		contact.normal.z = (float)reader.Signed() / NORMAL_SCALE;
+	}
+	return reader.isOk;
+}
@@ -0,0 +1,153 @@
+//
+//  SimulationTrace.h
+//
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "Fileio.h"
+#include "Math/Quat.h"
+#include "Math/Vector.h"
+
+template <typename T> class BodyT;
+typedef BodyT<float> Body;
+
+/*
+====================================================
+Trace file layout
+
+	TraceHeader
+	frames: a uint32 byte count, then the frame's varints
+	index: the file offset of every frame, a uint64 each
+	TraceFooter
+
+Positions are stored in fixed point, orientations as their three smallest
+components. Each body is delta encoded against the frame before, except
+on keyframes every keyframeInterval frames, so any frame decodes from at
+most keyframeInterval frames. The index and footer are written on Close; a
+trace cut short has its index rebuilt from the byte counts on open.
+====================================================
+*/
+struct TraceHeader {
+	char magic[ 4 ];
+	unsigned int version;
+	unsigned int keyframeInterval;
+	unsigned int positionsPerMeter;
+};
+
+struct TraceFooter {
+	unsigned long long indexOffset;
+	unsigned int numFrames;
+	char magic[ 4 ];
+};
+
+// A quantized pose is three fixed point coordinates, the index of the
+// orientation's largest component and its other three components
+const int QUANTIZED_POSE_SIZE = 7;
+
+struct TracePose {
+	Vec3 position;
+	Quat orientation;
+};
+
+struct TraceContact {
+	int a;
+	int b;
+	Vec3 point;		// On body A, in world space
+	Vec3 normal;	// As the solver used it
+};
+
+struct TraceFrame {
+	int step;
+	std::vector< TracePose > poses;
+	std::vector< TraceContact > contacts;
+};
+
+/*
+====================================================
+TraceRecorder
+Streams the steps of a scene to a trace file. Record only copies the
+poses and contacts into a recycled frame, a writer thread encodes and
+writes them, so the step barely notices. When the writer falls
+MAX_PENDING_FRAMES behind, Record waits for it rather than grow without
+bound.
+====================================================
+*/
+class TraceRecorder {
+public:
+	static const int MAX_PENDING_FRAMES = 256;
+
+	TraceRecorder() : m_file( NULL ), m_isRunning( false ), m_keyframeInterval( 60 ), m_numFrames( 0 ), m_offset( 0 ) {}
+	~TraceRecorder() { Close(); }
+
+	bool Open( const char * fileName, const int keyframeInterval = 60 );
+	void Close();	// Writes out what is still pending, then the index
+	bool IsOpen() const { return NULL != m_file; }
+
+	void Record( const int step, const Body * bodies, const int numBodies, const TraceContact * contacts, const int numContacts );
+
+private:
+	void WriterMain();
+	void WriteFrame( const TraceFrame & frame );
+
+	FILE * m_file;
+	std::thread m_writer;
+	bool m_isRunning;
+
+	std::mutex m_mutex;
+	std::condition_variable m_frameQueued;
+	std::condition_variable m_frameFreed;
+	std::vector< std::unique_ptr< TraceFrame > > m_frames;
+	std::vector< TraceFrame * > m_freeFrames;
+	std::deque< TraceFrame * > m_queue;
+
+	// Only touched by the writer
+	int m_keyframeInterval;
+	int m_numFrames;
+	unsigned long long m_offset;
+	std::vector< unsigned long long > m_frameOffsets;
+	std::vector< int > m_prevPoses;	// QUANTIZED_POSE_SIZE values per body
+	std::vector< unsigned char > m_bytes;
+};
+
+/*
+====================================================
+TraceReader
+Maps a trace file and decodes frames straight out of the mapping, for
+scrubbing back and forth without simulating again. Seeking goes through
+the frame index to the keyframe before, then forward; stepping to the
+next frame decodes just that one.
+====================================================
+*/
+class TraceReader {
+public:
+	TraceReader() : m_data( NULL ), m_size( 0 ), m_decodedFrame( -1 ) {}
+	~TraceReader() { Close(); }
+
+	bool Open( const char * fileName );
+	void Close();
+	bool IsOpen() const { return NULL != m_data; }
+
+	int NumFrames() const { return (int)m_frameOffsets.size(); }
+	bool ReadFrame( const int frame, TraceFrame & out );
+
+private:
+	bool DecodeFrame( const int frame, TraceFrame * out );
+
+	FileView m_file;
+	const unsigned char * m_data;	// m_file's bytes while open
+	size_t m_size;
+
+	TraceHeader m_header;
+	std::vector< unsigned long long > m_frameOffsets;
+
+	// Quantized poses of the last frame decoded, the base for the next one's deltas
+	int m_decodedFrame;
+	std::vector< int > m_quantized;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+
+/// <summary>
+/// Single producer, single consumer handoff of the latest value. The writer
+/// fills its own slot and swaps it with the middle one, the reader swaps the
+/// middle slot for its own when a new value was published. Neither side ever
+/// waits, the reader just keeps the last value until a newer one arrives.
+/// </summary>
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : m_middle(1), m_write(0), m_read(2) {}
+
+	/// <summary>
+	/// Slot the writer fills, only valid until the next Publish
+	/// </summary>
+	T& WriteBuffer() { return m_slots[m_write]; }
+
+	/// <summary>
+	/// Hands the write slot to the reader and takes the middle one to write next
+	/// </summary>
+	void Publish()
+	{
+		m_write = m_middle.exchange(m_write | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	/// <summary>
+	/// The latest published value, or the same one as last time if nothing new came in
+	/// </summary>
+	const T& Read()
+	{
+		if (m_middle.load(std::memory_order_relaxed) & FRESH)
+		{
+			m_read = m_middle.exchange(m_read, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+		return m_slots[m_read];
+	}
+
+private:
+	static const int INDEX_MASK = 3;
+	static const int FRESH = 4;	// The middle slot holds a value the reader has not seen
+
+	T m_slots[3];
+	std::atomic<int> m_middle;
+	int m_write;	// Only touched by the writer
+	int m_read;		// Only touched by the reader
+};
@@ -0,0 +1,242 @@
+#include "XPBDSolver.h"
+
+#include "Contact.h"
+#include "Intersections.h"
+
+#include <algorithm>
+
+void XPBDSolver::Step(Body* bodies, const int numBodies, const std::vector<CollisionPair>& pairs, GJKSimplexCache* const* caches,
+	const std::vector<Joint>& joints, JointSolver& jointSolver, const float dt, const int numSubsteps, const Vec3& gravity, const char* active)
+{
+	m_bodies = bodies;
+	m_pairs = pairs.data();
+	m_states.resize(numBodies);
+	m_contacts.reserve(pairs.capacity());	// At most a contact per pair, so only grows when the pairs do
+
+	const float h = dt / (float)numSubsteps;
+	const float gravityMagnitude = gravity.GetMagnitude();
+	for (int substep = 0; substep < numSubsteps; ++substep)
+	{
+		// Where the bodies start the substep, and gravity
+		for (int i = 0; i < numBodies; ++i)
+		{
+			Body& body = bodies[i];
+			BodyState& state = m_states[i];
+			state.prevCenterOfMass = body.GetCenterOfMassWorldSpace();
+			state.prevOrientation = body.orientation;
+			state.prevLinearVelocity = body.linearVelocity;
+			state.prevAngularVelocity = body.angularVelocity;
+			if (body.inverseMass != 0.0f && (NULL == active || active[i]))
+			{
+				body.linearVelocity += gravity * h;
+			}
+		}
+
+		if (!joints.empty())
+		{
+			jointSolver.Prepare(joints, bodies, h);
+			jointSolver.Iterate();
+		}
+
+		// Predict
+		for (int i = 0; i < numBodies; ++i)
+		{
+			Body& body = bodies[i];
+			BodyState& state = m_states[i];
+			if (body.inverseMass == 0.0f || (NULL != active && !active[i]))
+			{
+				state.invInertiaWorld.Zero();
+				continue;
+			}
+
+			body.Update(h);
+			state.predictedCenterOfMass = body.GetCenterOfMassWorldSpace();
+			state.predictedOrientation = body.orientation;
+			state.invInertiaWorld = body.GetInverseInertiaTensorWorldSpace();
+		}
+
+		// Project the contacts
+		m_contacts.clear();
+		for (int i = 0; i < (int)pairs.size(); ++i)
+		{
+			SolveContact(i, caches[i]);
+		}
+
+		// The new velocities are what moved the bodies over the substep. The
+		// prediction already moved them by their velocity, so only the
+		// corrections are turned into velocity: far from the origin, a float
+		// position change cannot hold what gravity adds in one short substep.
+		const float invH = 1.0f / h;
+		for (int i = 0; i < numBodies; ++i)
+		{
+			Body& body = bodies[i];
+			const BodyState& state = m_states[i];
+			if (body.inverseMass == 0.0f || (NULL != active && !active[i])) continue;
+
+			body.linearVelocity += (body.GetCenterOfMassWorldSpace() - state.predictedCenterOfMass) * invH;
+
+			Quat dq = body.orientation * state.predictedOrientation.Inverse();
+			if (dq.w < 0.0f)
+			{
+				dq.x = -dq.x;
+				dq.y = -dq.y;
+				dq.z = -dq.z;
+			}
+			body.angularVelocity += Vec3(dq.x, dq.y, dq.z) * (2.0f * invH);
+		}
+
+		SolveVelocities(h, gravityMagnitude);
+	}
+}
+
+void XPBDSolver::GetContact(const int i, int& a, int& b, Vec3& ptOnAWorldSpace, Vec3& normal) const
+{
+	const ContactState& contact = m_contacts[i];
+	a = contact.a;
+	b = contact.b;
+	ptOnAWorldSpace = m_bodies[contact.a].BodySpaceToWorldSpace(contact.ptOnALocalSpace);
+	normal = contact.normal;
+}
+
+float XPBDSolver::GeneralizedInverseMass(const int bodyId, const Vec3& r, const Vec3& dir) const
+{
+	const Vec3 rn = r.Cross(dir);
+	return m_bodies[bodyId].inverseMass + rn.Dot(m_states[bodyId].invInertiaWorld * rn);
+}
+
+void XPBDSolver::ApplyPositionImpulse(const int bodyId, const Vec3& r, const Vec3& impulse)
+{
+	Body& body = m_bodies[bodyId];
+	if (body.inverseMass == 0.0f) return;
+
+	// Move the center of mass and turn about it, then place the body origin back relative to it
+	const Vec3 centerOfMass = body.GetCenterOfMassWorldSpace() + impulse * body.inverseMass;
+
+	const Vec3 dTheta = m_states[bodyId].invInertiaWorld * r.Cross(impulse);
+	const Quat spin = Quat(dTheta.x, dTheta.y, dTheta.z, 0.0f) * body.orientation;
+	body.orientation.x += 0.5f * spin.x;
+	body.orientation.y += 0.5f * spin.y;
+	body.orientation.z += 0.5f * spin.z;
+	body.orientation.w += 0.5f * spin.w;
+	body.orientation.Normalize();
+
+	body.position = centerOfMass - body.orientation.RotatePoint(body.GetCenterOfMassBodySpace());
+}
+
+void XPBDSolver::ApplyVelocityImpulse(const int bodyId, const Vec3& r, const Vec3& impulse)
+{
+	Body& body = m_bodies[bodyId];
+	if (body.inverseMass == 0.0f) return;
+
+	body.linearVelocity += impulse * body.inverseMass;
+	body.angularVelocity += m_states[bodyId].invInertiaWorld * r.Cross(impulse);
+}
+
+void XPBDSolver::SolveContact(const int pairId, GJKSimplexCache* cache)
+{
+	const int idA = m_pairs[pairId].a;
+	const int idB = m_pairs[pairId].b;
+	Body& a = m_bodies[idA];
+	Body& b = m_bodies[idB];
+	if (a.inverseMass == 0.0f && b.inverseMass == 0.0f) return;
+
+	Contact contact;
+	Intersections::IntersectStatic(a, b, contact, cache);
+	if (contact.separationDistance >= 0.0f) return;
+
+	// Push the contact points apart along the normal, with no compliance
+	const Vec3 n = contact.normal;
+	Vec3 rA = contact.ptOnAWorldSpace - a.GetCenterOfMassWorldSpace();
+	Vec3 rB = contact.ptOnBWorldSpace - b.GetCenterOfMassWorldSpace();
+	const float w = GeneralizedInverseMass(idA, rA, n) + GeneralizedInverseMass(idB, rB, n);
+	if (w <= 0.0f) return;
+
+	const float normalLambda = -contact.separationDistance / w;
+	ApplyPositionImpulse(idA, rA, n * normalLambda);
+	ApplyPositionImpulse(idB, rB, n * -normalLambda);
+
+	ContactState state;
+	state.a = idA;
+	state.b = idB;
+	state.normal = n;
+	state.ptOnALocalSpace = contact.ptOnALocalSpace;
+	state.ptOnBLocalSpace = contact.ptOnBLocalSpace;
+	state.normalLambda = normalLambda;
+	state.friction = a.friction * b.friction;
+	state.elasticity = a.elasticity * b.elasticity;
+
+	const BodyState& stateA = m_states[idA];
+	const BodyState& stateB = m_states[idB];
+	const Vec3 velA = stateA.prevLinearVelocity + stateA.prevAngularVelocity.Cross(rA);
+	const Vec3 velB = stateB.prevLinearVelocity + stateB.prevAngularVelocity.Cross(rB);
+	state.normalVelocity = (velA - velB).Dot(n);
+
+	// Static friction: undo the sliding of the contact points over this
+	// substep, as long as that takes less than the normal push times the friction
+	const Vec3 prevPtA = stateA.prevCenterOfMass + stateA.prevOrientation.RotatePoint(contact.ptOnALocalSpace);
+	const Vec3 prevPtB = stateB.prevCenterOfMass + stateB.prevOrientation.RotatePoint(contact.ptOnBLocalSpace);
+	rA = a.orientation.RotatePoint(contact.ptOnALocalSpace);
+	rB = b.orientation.RotatePoint(contact.ptOnBLocalSpace);
+	const Vec3 ptA = a.GetCenterOfMassWorldSpace() + rA;
+	const Vec3 ptB = b.GetCenterOfMassWorldSpace() + rB;
+
+	const Vec3 dp = (ptA - prevPtA) - (ptB - prevPtB);
+	const Vec3 dpTangent = dp - n * dp.Dot(n);
+	const float sliding = dpTangent.GetMagnitude();
+	if (sliding > 1e-6f)
+	{
+		const Vec3 t = dpTangent / sliding;
+		const float wt = GeneralizedInverseMass(idA, rA, t) + GeneralizedInverseMass(idB, rB, t);
+		const float tangentLambda = sliding / wt;
+		if (wt > 0.0f && tangentLambda < state.friction * normalLambda)
+		{
+			ApplyPositionImpulse(idA, rA, t * -tangentLambda);
+			ApplyPositionImpulse(idB, rB, t * tangentLambda);
+		}
+	}
+
+	m_contacts.push_back(state);
+}
+
+void XPBDSolver::SolveVelocities(const float h, const float gravityMagnitude)
+{
+	for (const ContactState& contact : m_contacts)
+	{
+		const Body& a = m_bodies[contact.a];
+		const Body& b = m_bodies[contact.b];
+		const Vec3 rA = a.orientation.RotatePoint(contact.ptOnALocalSpace);
+		const Vec3 rB = b.orientation.RotatePoint(contact.ptOnBLocalSpace);
+		const Vec3& n = contact.normal;
+
+		const Vec3 velA = a.linearVelocity + a.angularVelocity.Cross(rA);
+		const Vec3 velB = b.linearVelocity + b.angularVelocity.Cross(rB);
+		const Vec3 relativeVelocity = velA - velB;
+		const float normalVelocity = relativeVelocity.Dot(n);
+		const Vec3 tangentVelocity = relativeVelocity - n * normalVelocity;
+
+		// Dynamic friction, the normal force is the position push over h squared
+		Vec3 dv = Vec3(0.0f);
+		const float tangentSpeed = tangentVelocity.GetMagnitude();
+		if (tangentSpeed > 1e-6f)
+		{
+			const float frictionSpeed = std::min(contact.friction * contact.normalLambda / h, tangentSpeed);
+			dv -= tangentVelocity * (frictionSpeed / tangentSpeed);
+		}
+
+		// Restitution from the approach speed at the start of the substep,
+		// turned off for speeds gravity alone could build up in the substep
+		const float elasticity = fabsf(contact.normalVelocity) > 2.0f * gravityMagnitude * h ? contact.elasticity : 0.0f;
+		dv += n * (std::max(-elasticity * contact.normalVelocity, 0.0f) - normalVelocity);
+
+		const float speed = dv.GetMagnitude();
+		if (speed < 1e-6f) continue;
+
+		const Vec3 dir = dv / speed;
+		const float w = GeneralizedInverseMass(contact.a, rA, dir) + GeneralizedInverseMass(contact.b, rB, dir);
+		if (w <= 0.0f) continue;
+
+		const Vec3 impulse = dir * (speed / w);
+		ApplyVelocityImpulse(contact.a, rA, impulse);
+		ApplyVelocityImpulse(contact.b, rB, impulse * -1.0f);
+	}
+}
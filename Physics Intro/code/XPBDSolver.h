@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Broadphase.h"
+#include "GJK.h"
+#include "JointSolver.h"
+#include "Math/Matrix.h"
+
+#include <vector>
+
+/// <summary>
+/// Extended position based dynamics with substepping (Macklin and Muller).
+/// Every substep predicts the bodies forward, pushes contacts apart by moving
+/// positions directly, then derives the velocities from how far the bodies
+/// moved. Contacts are rigid (zero compliance) and solved once per substep,
+/// many small substeps converge stacks better than many iterations.
+/// </summary>
+class XPBDSolver
+{
+public:
+	/// <summary>
+	/// Advances the bodies by dt. The pairs come from a single broadphase run
+	/// for the whole step, caches is one GJK simplex cache per pair. Joints
+	/// are solved on velocities with one iteration per substep, before the
+	/// prediction moves the bodies. When active is given, only the bodies
+	/// it flags move, the pairs must not involve any of the others.
+	/// </summary>
+	void Step(Body* bodies, const int numBodies, const std::vector<CollisionPair>& pairs, GJKSimplexCache* const* caches,
+		const std::vector<Joint>& joints, JointSolver& jointSolver, const float dt, const int numSubsteps, const Vec3& gravity, const char* active = NULL);
+
+	/// <summary>
+	/// Contacts solved on the last substep, with the point on A in world space
+	/// </summary>
+	int NumContacts() const { return (int)m_contacts.size(); }
+	void GetContact(const int i, int& a, int& b, Vec3& ptOnAWorldSpace, Vec3& normal) const;
+
+private:
+	struct BodyState
+	{
+		Vec3 prevCenterOfMass;
+		Quat prevOrientation;
+		Vec3 prevLinearVelocity;
+		Vec3 prevAngularVelocity;
+		Vec3 predictedCenterOfMass;
+		Quat predictedOrientation;
+		Mat3 invInertiaWorld;	// Scaled by the inverse mass, zero for static bodies
+	};
+
+	struct ContactState
+	{
+		int a;
+		int b;
+		Vec3 normal;	// From B to A
+		Vec3 ptOnALocalSpace;
+		Vec3 ptOnBLocalSpace;
+		float normalLambda;
+		float normalVelocity;	// Relative velocity along the normal at the start of the substep
+		float friction;
+		float elasticity;
+	};
+
+	float GeneralizedInverseMass(const int bodyId, const Vec3& r, const Vec3& dir) const;
+	void ApplyPositionImpulse(const int bodyId, const Vec3& r, const Vec3& impulse);
+	void ApplyVelocityImpulse(const int bodyId, const Vec3& r, const Vec3& impulse);
+
+	void SolveContact(const int pairId, GJKSimplexCache* cache);
+	void SolveVelocities(const float h, const float gravityMagnitude);
+
+	Body* m_bodies;
+	const CollisionPair* m_pairs;
+	std::vector<BodyState> m_states;
+	std::vector<ContactState> m_contacts;
+};
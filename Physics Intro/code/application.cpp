@@ -1,8 +1,10 @@
 //
 //  application.cpp
 //
+#include <algorithm>
 #include <chrono>
 #include <thread>
+#include <unordered_map>
 
 #include "Renderer/DeviceContext.h"
 #include "Renderer/model.h"
@@ -10,12 +12,14 @@
 #include "Renderer/Samplers.h"
 
 #include "application.h"
+#include "AsyncFileReader.h"
 #include "Fileio.h"
 #include <assert.h>
 #include <iostream>
 
 #include "Renderer/OffscreenRenderer.h"
 
+#include "Profiler.h"
 #include "Scene.h"
 
 Application * application = NULL;
@@ -67,21 +71,36 @@ Application
 Application::Initialize
 ====================================================
 */
-void Application::Initialize() {
+void Application::Initialize( const char * sceneFileName ) {
 	//FillDiamond();
 
-	InitializeGLFW();
-	InitializeVulkan();
+	// The shaders are read in the background while the scene is built and the window made
+	AsyncFileReader fileReader;
+	m_copyShader.Queue( fileReader, "DebugImage2D" );
+	QueueOffscreenShaders( fileReader );
 
+	// The scene comes before Vulkan, the uniform buffer is sized for its bodies
 	scene = new Scene;
-	scene->Initialize();
-	scene->Reset();
+	scene->SetJobSystem( &m_jobs );
+	if ( NULL == sceneFileName || !scene->LoadScene( sceneFileName ) ) {
+		scene->Initialize();
+		scene->Reset();
+	}
+
+	InitializeGLFW();
+	fileReader.Wait();
+	InitializeVulkan();
 
+	// One model per shape, bodies loaded from a scene file share their shapes
+	std::unordered_map< const Shape *, Model * > shapeModels;
 	m_models.reserve( scene->bodies.size() );
 	for ( int i = 0; i < scene->bodies.size(); i++ ) {
-		Model * model = new Model();
-		model->BuildFromShape( scene->bodies[ i ].shape );
-		model->MakeVBO( &deviceContext );
+		Model *& model = shapeModels[ scene->bodies[ i ].shape ];
+		if ( NULL == model ) {
+			model = new Model();
+			model->BuildFromShape( scene->bodies[ i ].shape );
+			model->MakeVBO( &deviceContext );
+		}
 
 		m_models.push_back( model );
 	}
@@ -93,7 +112,8 @@ void Application::Initialize() {
 	m_cameraFocusPoint = Vec3( 0, 0, 3 );
 
 	m_isPaused = true;
-	m_stepFrame = false;
+	m_physicsThread.SetPaused( m_isPaused );
+	m_physicsThread.Start( scene );
 	
 	m_escPressed = false;
 	printf(m_isPaused? " Paused \n" : " Resumed \n");
@@ -220,7 +240,9 @@ bool Application::InitializeVulkan() {
 	//
 	//	Uniform Buffer
 	//
-	m_uniformBuffer.Allocate( &deviceContext, NULL, sizeof( float ) * 16 * 4 * 128, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT );
+	// A slot for each camera and each body
+	const int numUniformSlots = std::max( (int)scene->bodies.size() + 2, 128 );
+	m_uniformBuffer.Allocate( &deviceContext, NULL, sizeof( float ) * 16 * 4 * numUniformSlots, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT );
 
 	//
 	//	Offscreen rendering
@@ -291,10 +313,14 @@ void Application::Cleanup() {
 	m_modelFullScreen.Cleanup( deviceContext );
 
 	// Delete the screen so that it can clean itself up
+	m_physicsThread.Stop();
+	m_traceRecorder.Close();
 	delete scene;
 	scene = NULL;
 
-	// Delete models
+	// Delete models, each once however many bodies share it
+	std::sort( m_models.begin(), m_models.end() );
+	m_models.erase( std::unique( m_models.begin(), m_models.end() ), m_models.end() );
 	for ( int i = 0; i < m_models.size(); i++ ) {
 		m_models[ i ]->Cleanup( deviceContext );
 		delete m_models[ i ];
@@ -436,20 +462,102 @@ void Application::Keyboard( int key, int scancode, int action, int modifiers )
 {
 	if ( GLFW_KEY_R == key && GLFW_RELEASE == action )
 	{
+		std::unique_lock< std::mutex > lock = m_physicsThread.LockScene();
 		scene->Reset();
+		m_physicsThread.SceneChanged();
 		printf(" Scene Reset \n");
 	}
 	if ( GLFW_KEY_P == key && GLFW_RELEASE == action )
 	{
 		m_isPaused = !m_isPaused;
+		m_physicsThread.SetPaused( m_isPaused );
 		
 		printf(m_isPaused? " Paused \n" : " Resumed \n");
 	}
-	if ( GLFW_KEY_SEMICOLON == key && ( GLFW_PRESS == action || GLFW_REPEAT == action ) )
+	if ( GLFW_KEY_SEMICOLON == key && ( GLFW_PRESS == action || GLFW_REPEAT == action ) && m_isPaused )
+	{
+		m_physicsThread.StepOnce();
+	}
+	if ( GLFW_KEY_M == key && GLFW_RELEASE == action )
 	{
-		m_stepFrame = m_isPaused && !m_stepFrame;
+		std::unique_lock< std::mutex > lock = m_physicsThread.LockScene();
+
+		// Cycles time of impact -> speculative -> XPBD
+		switch ( scene->GetSolverMode() )
+		{
+			case Scene::SolverMode::TIME_OF_IMPACT:
+				scene->SetSolverMode( Scene::SolverMode::SPECULATIVE );
+				printf( " Solver: Speculative contacts \n" );
+				break;
+			case Scene::SolverMode::SPECULATIVE:
+				scene->SetSolverMode( Scene::SolverMode::XPBD );
+				printf( " Solver: XPBD, %i substeps \n", scene->GetNumSubsteps() );
+				break;
+			default:
+				scene->SetSolverMode( Scene::SolverMode::TIME_OF_IMPACT );
+				printf( " Solver: Time of impact \n" );
+				break;
+		}
+	}
+	if ( GLFW_KEY_L == key && GLFW_RELEASE == action )
+	{
+		std::unique_lock< std::mutex > lock = m_physicsThread.LockScene();
+
+		// Full rate around what the camera looks at, coarser further out
+		const bool isEnabled = !scene->IsLevelOfDetailEnabled();
+		scene->SetLevelOfDetail( isEnabled, m_cameraFocusPoint, 10.0f );
+		printf( " Level of detail: %s \n", isEnabled ? "on" : "off" );
+	}
+	if ( GLFW_KEY_N == key && GLFW_RELEASE == action )
+	{
+		std::unique_lock< std::mutex > lock = m_physicsThread.LockScene();
+
+		const bool isEnabled = !scene->IsAdaptiveSubsteps();
+		scene->SetAdaptiveSubsteps( isEnabled );
+		printf( " Adaptive substeps: %s \n", isEnabled ? "on" : "off" );
+	}
+	if ( GLFW_KEY_C == key && GLFW_RELEASE == action )
+	{
+		// Holding the scene, no step is halfway through a zone when the capture ends
+		std::unique_lock< std::mutex > lock = m_physicsThread.LockScene();
+		if ( !Profiler::IsCapturing() )
+		{
+			Profiler::BeginCapture();
+			MemoryTracker::Snapshot( m_profileMemory );
+			printf( " Profiling \n" );
+		}
+		else
+		{
+			Profiler::EndCapture();
+			Profiler::PrintZoneStats();
+			MemoryTracker::PrintStats( &m_profileMemory );
+			const char * fileName = "physics_profile.json";
+			printf( Profiler::WriteChromeTrace( fileName ) ? " Profile written to %s \n" : " ERROR: Unable to write %s \n", fileName );
+		}
 	}
 	
+	if ( GLFW_KEY_T == key && GLFW_RELEASE == action )
+	{
+		ToggleRecording();
+	}
+	if ( GLFW_KEY_Y == key && GLFW_RELEASE == action )
+	{
+		ToggleReplay();
+	}
+	if ( m_isReplaying && ( GLFW_PRESS == action || GLFW_REPEAT == action ) )
+	{
+		// Shift scrubs a second at a time
+		const int stride = ( modifiers & GLFW_MOD_SHIFT ) ? (int)scene->GetStepRate() : 1;
+		switch ( key )
+		{
+			case GLFW_KEY_LEFT:		SeekReplay( m_replayFrameId - stride ); break;
+			case GLFW_KEY_RIGHT:	SeekReplay( m_replayFrameId + stride ); break;
+			case GLFW_KEY_HOME:		SeekReplay( 0 ); break;
+			case GLFW_KEY_END:		SeekReplay( m_traceReader.NumFrames() - 1 ); break;
+			default: break;
+		}
+	}
+
 	if ( GLFW_KEY_ESCAPE == key && ( GLFW_PRESS == action || GLFW_REPEAT == action ) )
 	{
 		m_escPressed = !m_escPressed;
@@ -467,6 +575,73 @@ void Application::Keyboard( int key, int scancode, int action, int modifiers )
 	}
 }
 
+/*
+====================================================
+Application::ToggleRecording
+====================================================
+*/
+void Application::ToggleRecording()
+{
+	std::unique_lock< std::mutex > lock = m_physicsThread.LockScene();
+	if ( m_traceRecorder.IsOpen() )
+	{
+		scene->SetTraceRecorder( NULL );
+		m_traceRecorder.Close();
+		printf( " Recording stopped \n" );
+	}
+	else if ( m_traceRecorder.Open( "physics.trace" ) )
+	{
+		scene->SetTraceRecorder( &m_traceRecorder );
+		printf( " Recording to physics.trace \n" );
+	}
+}
+
+/*
+====================================================
+Application::ToggleReplay
+The physics pauses while the trace plays, the arrow keys scrub through it
+====================================================
+*/
+void Application::ToggleReplay()
+{
+	if ( m_isReplaying )
+	{
+		m_isReplaying = false;
+		m_traceReader.Close();
+		printf( " Replay stopped \n" );
+		return;
+	}
+
+	// The trace is only complete once its index is written
+	if ( m_traceRecorder.IsOpen() )
+	{
+		ToggleRecording();
+	}
+	if ( !m_traceReader.Open( "physics.trace" ) || 0 == m_traceReader.NumFrames() )
+	{
+		printf( " Nothing recorded to replay \n" );
+		return;
+	}
+
+	m_isPaused = true;
+	m_physicsThread.SetPaused( true );
+	m_isReplaying = true;
+	SeekReplay( 0 );
+	printf( " Replaying %i frames \n", m_traceReader.NumFrames() );
+}
+
+/*
+====================================================
+Application::SeekReplay
+====================================================
+*/
+void Application::SeekReplay( const int frameId )
+{
+	const int lastFrameId = m_traceReader.NumFrames() - 1;
+	m_replayFrameId = frameId < 0 ? 0 : ( frameId > lastFrameId ? lastFrameId : frameId );
+	m_traceReader.ReadFrame( m_replayFrameId, m_replayFrame );
+}
+
 /*
 ====================================================
 Application::MainLoop
@@ -474,9 +649,6 @@ Application::MainLoop
 */
 void Application::MainLoop() {
 	static int timeLastFrame = 0;
-	static int numSamples = 0;
-	static float avgTime = 0.0f;
-	static float maxTime = 0.0f;
 
 	while ( !glfwWindowShouldClose( glfwWindow ) )
 	{
@@ -495,53 +667,7 @@ void Application::MainLoop() {
 		// Get User Input
 		glfwPollEvents();
 
-		// If the time is greater than 33ms (30fps)
-		// then force the time difference to smaller
-		// to prevent super large simulation steps.
-		if ( dt_us > 33000.0f )
-		{
-			dt_us = 33000.0f;
-		}
-
-		bool runPhysics = true;
-		if ( m_isPaused )
-		{
-			dt_us = 0.0f;
-			runPhysics = false;
-			if ( m_stepFrame )
-			{
-				dt_us = 16667.0f;
-				m_stepFrame = false;
-				runPhysics = true;
-			}
-			numSamples = 0;
-			maxTime = 0.0f;
-		}
-		float dt_sec = dt_us * 0.001f * 0.001f;
-
-		// Run Update
-		if ( runPhysics )
-		{
-			int startTime = GetTimeMicroseconds();
-			for ( int i = 0; i < 2; i++ )
-			{
-				scene->Update( dt_sec * 0.5f );
-			}
-			int endTime = GetTimeMicroseconds();
-
-			dt_us = (float)endTime - (float)startTime;
-			if ( dt_us > maxTime )
-			{
-				maxTime = dt_us;
-			}
-
-			avgTime = ( avgTime * float( numSamples ) + dt_us ) / float( numSamples + 1 );
-			numSamples++;
-
-			//printf( "frame dt_ms: %.2f %.2f %.2f", avgTime * 0.001f, maxTime * 0.001f, dt_us * 0.001f );
-		}
-
-		// Draw the Scene
+		// Draw the Scene, physics steps on its own thread meanwhile
 		DrawFrame();
 	}
 }
@@ -654,30 +780,51 @@ void Application::UpdateUniforms()
 		//
 		//	Update the uniform buffer with the body positions/orientations
 		//
-		for ( int i = 0; i < scene->bodies.size(); i++ )
-		{
-			Body & body = scene->bodies[ i ];
-
-			Vec3 fwd = body.orientation.RotatePoint( Vec3( 1, 0, 0 ) );
-			Vec3 up = body.orientation.RotatePoint( Vec3( 0, 0, 1 ) );
-
-			Mat4 matOrient;
-			matOrient.Orient( body.position, fwd, up );
-			matOrient = matOrient.Transpose();
-
-			// Update the uniform buffer with the orientation of this body
-			memcpy( mappedData + uboByteOffset, matOrient.ToPtr(), sizeof( matOrient ) );
-
-			RenderModel renderModel;
-			renderModel.model = m_models[ i ];
-			renderModel.uboByteOffset = uboByteOffset;
-			renderModel.uboByteSize = sizeof( matOrient );
-			renderModel.pos = body.position;
-			renderModel.orient = body.orientation;
-			m_renderModels.push_back( renderModel );
-
-			uboByteOffset += deviceContext.GetAligendUniformByteOffset( sizeof( matOrient ) );
-		}
+		// Latest step from the physics thread, blended from the step before by how long ago it came in
+		const PhysicsSnapshot & snapshot = m_physicsThread.LatestSnapshot();
+		const float alpha = snapshot.InterpolationAlpha( std::chrono::steady_clock::now() );
+		const size_t numPoses = m_isReplaying ? m_replayFrame.poses.size() : snapshot.poses.size();
+		const int numBodies = (int)std::min( numPoses, m_models.size() );
+		const uint32_t bodyByteStride = deviceContext.GetAligendUniformByteOffset( sizeof( Mat4 ) );
+		m_renderModels.resize( numBodies );
+
+		// Every body has its own slot in the buffer and in the render models, so they fill in parallel
+		m_jobs.ParallelFor( 0, numBodies, [ & ]( int first, int last ) {
+			for ( int i = first; i < last; i++ )
+			{
+				Scene::BodyPose pose;
+				if ( m_isReplaying )
+				{
+					pose.position = m_replayFrame.poses[ i ].position;
+					pose.orientation = m_replayFrame.poses[ i ].orientation;
+				}
+				else
+				{
+					pose = snapshot.InterpolatedPose( i, alpha );
+				}
+				const Vec3 & position = pose.position;
+				const Quat & orientation = pose.orientation;
+
+				Vec3 fwd = orientation.RotatePoint( Vec3( 1, 0, 0 ) );
+				Vec3 up = orientation.RotatePoint( Vec3( 0, 0, 1 ) );
+
+				Mat4 matOrient;
+				matOrient.Orient( position, fwd, up );
+				matOrient = matOrient.Transpose();
+
+				// Update the uniform buffer with the orientation of this body
+				const uint32_t bodyByteOffset = uboByteOffset + bodyByteStride * i;
+				memcpy( mappedData + bodyByteOffset, matOrient.ToPtr(), sizeof( matOrient ) );
+
+				RenderModel & renderModel = m_renderModels[ i ];
+				renderModel.model = m_models[ i ];
+				renderModel.uboByteOffset = bodyByteOffset;
+				renderModel.uboByteSize = sizeof( matOrient );
+				renderModel.pos = position;
+				renderModel.orient = orientation;
+			}
+		} );
+		uboByteOffset += bodyByteStride * numBodies;
 
 		m_uniformBuffer.UnmapBuffer( &deviceContext );
 	}
@@ -19,6 +19,11 @@
 #include "Renderer/shader.h"
 #include "Renderer/FrameBuffer.h"
 
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+#include "PhysicsThread.h"
+#include "SimulationTrace.h"
+
 /*
 ====================================================
 Application
@@ -26,10 +31,10 @@ Application
 */
 class Application {
 public:
-	Application() : m_isPaused( true ), m_stepFrame( false ) {}
+	Application() : m_isReplaying( false ), m_replayFrameId( 0 ), m_isPaused( true ) {}
 	~Application();
 
-	void Initialize();
+	void Initialize( const char * sceneFileName = NULL );	// The built in scene without a file
 	void MainLoop();
 
 private:
@@ -44,6 +49,9 @@ private:
 	void MouseMoved( float x, float y );
 	void MouseScrolled( float z );
 	void Keyboard( int key, int scancode, int action, int modifiers );
+	void ToggleRecording();
+	void ToggleReplay();
+	void SeekReplay( const int frameId );
 
 	static void OnWindowResized( GLFWwindow * window, int width, int height );
 	static void OnMouseMoved( GLFWwindow * window, double x, double y );
@@ -52,6 +60,16 @@ private:
 
 private:
 	class Scene * scene;
+	JobSystem m_jobs;	// Shared by the physics thread and the renderer
+	PhysicsThread m_physicsThread;
+	MemorySnapshot m_profileMemory;	// At the start of the profile, for the allocation rates over it
+
+	// Recorded steps, played back in place of the live physics while replaying
+	TraceRecorder m_traceRecorder;
+	TraceReader m_traceReader;
+	TraceFrame m_replayFrame;
+	bool m_isReplaying;
+	int m_replayFrameId;
 
 	GLFWwindow * glfwWindow;
 
@@ -82,7 +100,6 @@ private:
 	float m_cameraPositionPhi;
 	float m_cameraRadius;
 	bool m_isPaused;
-	bool m_stepFrame;
 	bool m_escPressed;
 
 	std::vector< RenderModel > m_renderModels;
@@ -2,6 +2,9 @@
 //  main.cpp
 //
 #include "application.h"
+#include "Benchmarks.h"
+
+#include <string.h>
 
 /*
 ====================================================
@@ -9,8 +12,66 @@ main
 ====================================================
 */
 int main( int argc, char * argv[] ) {
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-jobbench" ) ) {
+		return RunJobSystemBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 0 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-determinism" ) ) {
+		return RunDeterminismCheck();
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-variants" ) ) {
+		return RunVariantsBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 256 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-trace" ) ) {
+		return RunTraceBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 1200 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-scenefile" ) ) {
+		return RunSceneFileBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 100000 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-lod" ) ) {
+		return RunLodBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 24 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-adaptive" ) ) {
+		return RunAdaptiveBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 8 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-profile" ) ) {
+		return RunProfilerBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 600 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-regression" ) ) {
+		return RunRegressionSuite( argc > 2 && 0 == strcmp( argv[ 2 ], "update" ) );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-mathbench" ) ) {
+		return RunMathBenchmark();
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-asyncread" ) ) {
+		return RunAsyncReadBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 64 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-memory" ) ) {
+		return RunMemoryBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 240 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-precision" ) ) {
+		return RunPrecisionBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 1200 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-particles" ) ) {
+		return RunParticlesBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 100000 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-gpuparticles" ) ) {
+		return RunGPUParticlesCheck( argc > 2 ? atoi( argv[ 2 ] ) : 100000 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-query" ) ) {
+		return RunQueryBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 20000 );
+	}
+	if ( argc > 1 && 0 == strcmp( argv[ 1 ], "-joints" ) ) {
+		return RunJointsBenchmark( argc > 2 ? atoi( argv[ 2 ] ) : 1000 );
+	}
+
+	// -scene <file>: a scene file instead of the built in scene
+	const char * sceneFileName = NULL;
+	if ( argc > 2 && 0 == strcmp( argv[ 1 ], "-scene" ) ) {
+		sceneFileName = argv[ 2 ];
+	}
+
 	application = new Application;
-	application->Initialize();
+	application->Initialize( sceneFileName );
 
 	application->MainLoop();
 
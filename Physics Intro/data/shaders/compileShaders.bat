@@ -0,0 +1,11 @@
+@echo off
+rem Compiles every shader here to spirv\<name>.<stage>.spirv, which is what
+rem Shader::Load reads. Needs the Vulkan SDK for glslangValidator.
+pushd "%~dp0"
+for %%f in (*.vert *.frag *.comp) do "%VULKAN_SDK%\Bin\glslangValidator.exe" -V %%f -o spirv\%%f.spirv || goto failed
+popd
+exit /b 0
+
+:failed
+popd
+exit /b 1